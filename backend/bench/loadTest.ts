@@ -0,0 +1,251 @@
+/**
+ * CinCout Load Test
+ * Drives a running server with virtual users, each repeatedly picking a
+ * scenario from the workload mix and running it over the real Socket.IO
+ * protocol or REST routes with the bundled templates. Reports throughput
+ * and latency percentiles per stage for every concurrency level, and
+ * compares saved results of two builds
+ *
+ * Usage:
+ *   npm run bench -- --url http://localhost:9527 --concurrency 1,4,16 \
+ *     --duration 60 --mix compile=6,input=1,debug=1,strace=1 --out head.json
+ *   npm run bench -- --compare base.json head.json --threshold 10
+ *
+ * Start the server under test with the rate limiter opened up, e.g.
+ * CINCOUT_RATE_CAPACITY=1000000 CINCOUT_RATE_REFILL=1000000, or the run
+ * measures the limiter instead of the node. Admission control still sheds
+ * expensive requests once the node saturates; those show up as errors
+ */
+import fs from "fs";
+import path from "path";
+import { performance } from "perf_hooks";
+import { Program, SCENARIOS, loadPrograms, runScenario } from "./scenarios";
+import {
+  BenchResult,
+  LevelResult,
+  Recorder,
+  compareResults,
+  formatLevel,
+} from "./stats";
+
+const DEFAULT_MIX =
+  "compile=6,input=1,debug=1,leak_asan=1,strace=1,assembly=2,format=1,lint=1,template=2";
+const TEMPLATES_DIR = path.join(__dirname, "../templates");
+
+/**
+ * Command line options
+ */
+interface Options {
+  url: string;
+  concurrency: number[];
+  durationS: number;
+  mix: Record<string, number>;
+  compiler: string;
+  optimization: string;
+  label: string;
+  out: string | null;
+  baseline: string | null;
+  threshold: number;
+}
+
+/**
+ * Read "--name value" pairs from the command line
+ * @param {string[]} argv - Arguments after the script name
+ * @returns {Map<string, string[]>} Values of each option
+ */
+const parseArgs = (argv: string[]): Map<string, string[]> => {
+  const args = new Map<string, string[]>();
+  let current = "";
+  argv.forEach((arg) => {
+    if (arg.startsWith("--")) {
+      current = arg.slice(2);
+      args.set(current, []);
+    } else {
+      args.get(current)?.push(arg);
+    }
+  });
+  return args;
+};
+
+/**
+ * Parse a workload mix such as "compile=6,debug=1"
+ * @param {string} mix - Scenario weights
+ * @returns {Record<string, number>} Weight of each scenario
+ */
+const parseMix = (mix: string): Record<string, number> => {
+  const weights: Record<string, number> = {};
+  mix.split(",").forEach((entry) => {
+    const [name, weight = "1"] = entry.split("=");
+    if (!SCENARIOS[name]) {
+      throw new Error(
+        `Unknown scenario '${name}', expected one of: ${Object.keys(
+          SCENARIOS
+        ).join(", ")}`
+      );
+    }
+    weights[name] = parseFloat(weight);
+  });
+  return weights;
+};
+
+/**
+ * Pick a scenario at random by weight
+ * @param {Record<string, number>} mix - Scenario weights
+ * @returns {string} Scenario name
+ */
+const pickScenario = (mix: Record<string, number>): string => {
+  const entries = Object.entries(mix);
+  let remaining =
+    Math.random() * entries.reduce((sum, [, weight]) => sum + weight, 0);
+  for (const [name, weight] of entries) {
+    remaining -= weight;
+    if (remaining < 0) {
+      return name;
+    }
+  }
+  return entries[entries.length - 1][0];
+};
+
+/**
+ * Run the workload at one concurrency level
+ * Virtual users start new scenario runs until the duration is over; runs
+ * in progress then are finished and recorded
+ * @param {Options} options - Run options
+ * @param {number} concurrency - Number of virtual users
+ * @param {Program[]} programs - Workload programs
+ * @returns {Promise<LevelResult>} Results of the level
+ */
+const runLevel = async (
+  options: Options,
+  concurrency: number,
+  programs: Program[]
+): Promise<LevelResult> => {
+  const recorder = new Recorder();
+  const ctx = {
+    url: options.url,
+    recorder,
+    compiler: options.compiler,
+    optimization: options.optimization,
+    pickProgram: () => programs[Math.floor(Math.random() * programs.length)],
+  };
+
+  const started = performance.now();
+  const deadline = started + options.durationS * 1000;
+  const user = async () => {
+    while (performance.now() < deadline) {
+      await runScenario(pickScenario(options.mix), ctx);
+    }
+  };
+  await Promise.all(Array.from({ length: concurrency }, user));
+
+  const durationS = (performance.now() - started) / 1000;
+  return recorder.summarize(concurrency, Math.round(durationS * 10) / 10);
+};
+
+/**
+ * Read the options of a load test run
+ * @param {Map<string, string[]>} args - Parsed command line
+ * @returns {Options} Run options
+ */
+const readOptions = (args: Map<string, string[]>): Options => {
+  const value = (name: string, fallback: string): string =>
+    args.get(name)?.[0] ?? fallback;
+
+  return {
+    url: value("url", "http://localhost:9527").replace(/\/$/, ""),
+    concurrency: value("concurrency", "4")
+      .split(",")
+      .map((level) => parseInt(level, 10)),
+    durationS: parseFloat(value("duration", "30")),
+    mix: parseMix(value("mix", DEFAULT_MIX)),
+    compiler: value("compiler", "gcc"),
+    optimization: value("optimization", "-O0"),
+    label: value("label", value("url", "http://localhost:9527")),
+    out: args.get("out")?.[0] ?? null,
+    baseline: args.get("baseline")?.[0] ?? null,
+    threshold: parseFloat(value("threshold", "10")),
+  };
+};
+
+/**
+ * Print a comparison of two runs
+ * @param {BenchResult} base - Reference results
+ * @param {BenchResult} head - Results under test
+ * @param {number} threshold - Allowed change in percent
+ * @returns {boolean} True if no stage regressed
+ */
+const printComparison = (
+  base: BenchResult,
+  head: BenchResult,
+  threshold: number
+): boolean => {
+  const { report, regressions } = compareResults(base, head, threshold);
+  console.log(report);
+  console.log(
+    regressions > 0
+      ? `\n${regressions} stages regressed by more than ${threshold}%`
+      : `\nNo stage regressed by more than ${threshold}%`
+  );
+  return regressions === 0;
+};
+
+const readResult = (file: string): BenchResult =>
+  JSON.parse(fs.readFileSync(file, "utf8"));
+
+const main = async (): Promise<void> => {
+  const args = parseArgs(process.argv.slice(2));
+  const threshold = parseFloat(args.get("threshold")?.[0] ?? "10");
+
+  // Compare two saved runs without running anything
+  const compare = args.get("compare");
+  if (compare) {
+    if (compare.length !== 2) {
+      throw new Error("--compare needs two result files");
+    }
+    const passed = printComparison(
+      readResult(compare[0]),
+      readResult(compare[1]),
+      threshold
+    );
+    process.exitCode = passed ? 0 : 1;
+    return;
+  }
+
+  const options = readOptions(args);
+  const programs = loadPrograms(TEMPLATES_DIR);
+  const result: BenchResult = {
+    label: options.label,
+    url: options.url,
+    startedAt: new Date().toISOString(),
+    mix: options.mix,
+    levels: [],
+  };
+
+  for (const concurrency of options.concurrency) {
+    console.log(
+      `Running ${concurrency} virtual users for ${options.durationS}s against ${options.url}...`
+    );
+    const level = await runLevel(options, concurrency, programs);
+    result.levels.push(level);
+    console.log(`${formatLevel(level)}\n`);
+  }
+
+  if (options.out) {
+    fs.writeFileSync(options.out, JSON.stringify(result, null, 2));
+    console.log(`Results written to ${options.out}`);
+  }
+
+  if (options.baseline) {
+    const passed = printComparison(
+      readResult(options.baseline),
+      result,
+      options.threshold
+    );
+    process.exitCode = passed ? 0 : 1;
+  }
+};
+
+main().catch((error) => {
+  console.error("Load test failed:", (error as Error).message);
+  process.exit(1);
+});
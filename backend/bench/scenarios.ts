@@ -0,0 +1,471 @@
+/**
+ * Load Test Scenarios
+ * Each scenario drives one feature the way the frontend does, over the
+ * real Socket.IO protocol or REST routes, and records how long each of
+ * its stages took
+ */
+import fs from "fs";
+import http from "http";
+import https from "https";
+import path from "path";
+import { performance } from "perf_hooks";
+import { io, Socket } from "socket.io-client";
+import { Recorder } from "./stats";
+
+// A stage taking longer than this fails its scenario run
+const STAGE_TIMEOUT_MS = 120 * 1000;
+// Lines the input scenario sends, one round trip each
+const INPUT_ROUNDS = 5;
+// Commands of the debug scenario, each answered with a new prompt
+const DEBUG_COMMANDS = ["break main", "run", "next", "next", "continue"];
+const GDB_PROMPT = /\(gdb\) $/;
+
+// Echoes its input line by line, so every round trip can be timed
+const ECHO_PROGRAM = `#include <stdio.h>
+
+int main(void) {
+  char line[256];
+  while (fgets(line, sizeof(line), stdin)) {
+    printf("echo: %s", line);
+    fflush(stdout);
+  }
+  return 0;
+}
+`;
+
+// Programs reading any input would wait forever in the other scenarios
+const READS_INPUT = /\bstdin\b|\bscanf\s*\(|\bgetchar\s*\(|\bcin\b/;
+
+// Events that end a scenario with an error, with their message field
+const ERROR_EVENTS = [
+  "error",
+  "compile_error",
+  "debug_error",
+  "leak_check_error",
+  "strace_error",
+];
+
+/**
+ * Source of a run
+ */
+export interface Program {
+  name: string; // Template name, e.g. "Hello World"
+  lang: "c" | "cpp";
+  code: string;
+}
+
+/**
+ * What a scenario runs against
+ */
+export interface ScenarioContext {
+  url: string;
+  recorder: Recorder;
+  compiler: string;
+  optimization: string;
+  pickProgram: () => Program;
+}
+
+type Scenario = (ctx: ScenarioContext) => Promise<void>;
+
+/**
+ * Load the bundled templates that run without input
+ * Benchmark templates in subdirectories are left out; they are written to
+ * run for a long time
+ * @param {string} templatesDir - Directory with a folder per language
+ * @returns {Program[]} Templates to use as workload
+ */
+export const loadPrograms = (templatesDir: string): Program[] =>
+  (["c", "cpp"] as const).flatMap((lang) =>
+    fs
+      .readdirSync(path.join(templatesDir, lang), { withFileTypes: true })
+      .filter((entry) => entry.isFile() && /\.(c|cpp)$/.test(entry.name))
+      .map((entry) => ({
+        name: entry.name.replace(/\.[^.]+$/, ""),
+        lang,
+        code: fs.readFileSync(
+          path.join(templatesDir, lang, entry.name),
+          "utf8"
+        ),
+      }))
+      .filter((program) => !READS_INPUT.test(program.code))
+  );
+
+/**
+ * Connect a new client, like a browser tab starting an action
+ * @param {ScenarioContext} ctx - Target server
+ * @param {string} scenario - Scenario the connection time is recorded for
+ * @returns {Promise<Socket>} Connected socket
+ */
+const connect = (ctx: ScenarioContext, scenario: string): Promise<Socket> => {
+  const started = performance.now();
+  const socket = io(ctx.url, {
+    transports: ["websocket"],
+    reconnection: false,
+    forceNew: true,
+    timeout: 10000,
+  });
+
+  return new Promise((resolve, reject) => {
+    socket.once("connect", () => {
+      ctx.recorder.record(scenario, "connect", performance.now() - started);
+      resolve(socket);
+    });
+    socket.once("connect_error", (error) => {
+      socket.close();
+      reject(new Error(`connect failed: ${error.message}`));
+    });
+  });
+};
+
+/**
+ * Wait for an event, failing on any error event or after the stage timeout
+ * @param {Socket} socket - Connected socket
+ * @param {string} event - Event to wait for
+ * @param {Function} accept - Whether a payload of the event ends the wait
+ * @returns {Promise<any>} Payload of the event
+ */
+const waitFor = (
+  socket: Socket,
+  event: string,
+  accept: (data: any) => boolean = () => true
+): Promise<any> =>
+  new Promise((resolve, reject) => {
+    const timer = setTimeout(() => {
+      cleanup();
+      reject(new Error(`${event} timed out`));
+    }, STAGE_TIMEOUT_MS);
+    const cleanup = () => {
+      clearTimeout(timer);
+      socket.off(event, onEvent);
+      ERROR_EVENTS.forEach((name) => socket.off(name, onError));
+      socket.off("disconnect", onDisconnect);
+    };
+    const onEvent = (data: any) => {
+      if (!accept(data)) {
+        return;
+      }
+      cleanup();
+      resolve(data);
+    };
+    const onError = (data: any) => {
+      cleanup();
+      reject(new Error(String(data?.message ?? data?.output ?? "error")));
+    };
+    const onDisconnect = (reason: string) => {
+      cleanup();
+      reject(new Error(`disconnected: ${reason}`));
+    };
+
+    socket.on(event, onEvent);
+    ERROR_EVENTS.forEach((name) => socket.on(name, onError));
+    socket.on("disconnect", onDisconnect);
+  });
+
+/**
+ * Text of an output payload; program output arrives as raw bytes
+ * @param {any} data - Event payload
+ * @returns {string} Output text
+ */
+const outputText = (data: any): string =>
+  Buffer.isBuffer(data?.output) || data?.output instanceof ArrayBuffer
+    ? Buffer.from(data.output).toString("utf8")
+    : String(data?.output ?? "");
+
+/**
+ * Run a scenario stage and record how long it took
+ * @param {ScenarioContext} ctx - Scenario context
+ * @param {string} scenario - Scenario name
+ * @param {string} name - Stage name
+ * @param {Function} task - The stage
+ * @returns {Promise<T>} Result of the stage
+ */
+const stage = async <T>(
+  ctx: ScenarioContext,
+  scenario: string,
+  name: string,
+  task: () => Promise<T>
+): Promise<T> => {
+  const started = performance.now();
+  const result = await task();
+  ctx.recorder.record(scenario, name, performance.now() - started);
+  return result;
+};
+
+/**
+ * Send an HTTP request
+ * @param {string} method - HTTP method
+ * @param {string} url - Absolute URL
+ * @param {any} body - JSON body, if any
+ * @returns {Promise<void>} Resolves on a 2xx response
+ */
+const request = (method: string, url: string, body?: any): Promise<void> =>
+  new Promise((resolve, reject) => {
+    const payload = body === undefined ? undefined : JSON.stringify(body);
+    const client = url.startsWith("https:") ? https : http;
+    const req = client.request(
+      url,
+      {
+        method,
+        headers: payload
+          ? {
+              "Content-Type": "application/json",
+              "Content-Length": Buffer.byteLength(payload),
+            }
+          : {},
+      },
+      (res) => {
+        res.resume();
+        res.on("end", () => {
+          const status = res.statusCode ?? 0;
+          if (status >= 200 && status < 300) {
+            resolve();
+          } else {
+            reject(new Error(`HTTP ${status}`));
+          }
+        });
+      }
+    );
+    req.setTimeout(STAGE_TIMEOUT_MS, () =>
+      req.destroy(new Error("request timed out"))
+    );
+    req.on("error", reject);
+    req.end(payload);
+  });
+
+/**
+ * Compile and run a template: compile, first output and run to exit
+ */
+const compileScenario: Scenario = async (ctx) => {
+  const program = ctx.pickProgram();
+  const socket = await connect(ctx, "compile");
+  try {
+    // Output and exit are only timed once the program runs
+    let running = 0;
+    socket.once("output", () =>
+      ctx.recorder.record(
+        "compile",
+        "first_output",
+        performance.now() - running
+      )
+    );
+    const exited = waitFor(socket, "exit");
+    // Rejects along with the compile stage if compiling fails
+    exited.catch(() => undefined);
+
+    socket.emit("compile", {
+      code: program.code,
+      lang: program.lang,
+      compiler: ctx.compiler,
+      optimization: ctx.optimization,
+    });
+    await stage(ctx, "compile", "compile", () =>
+      waitFor(socket, "compile_success")
+    );
+
+    running = performance.now();
+    await exited;
+    ctx.recorder.record("compile", "run", performance.now() - running);
+  } finally {
+    socket.close();
+  }
+};
+
+/**
+ * Run an interactive program and time input round trips
+ */
+const inputScenario: Scenario = async (ctx) => {
+  const socket = await connect(ctx, "input");
+  try {
+    socket.emit("compile", {
+      code: ECHO_PROGRAM,
+      lang: "c",
+      compiler: ctx.compiler,
+      optimization: ctx.optimization,
+    });
+    await stage(ctx, "input", "compile", () =>
+      waitFor(socket, "compile_success")
+    );
+
+    let output = "";
+    socket.on("output", (data: any) => {
+      output += outputText(data);
+    });
+    for (let round = 0; round < INPUT_ROUNDS; round++) {
+      const expected = `echo: line ${round}`;
+      await stage(ctx, "input", "round_trip", () => {
+        const echoed = waitFor(socket, "output", () =>
+          output.includes(expected)
+        );
+        socket.emit("input", { input: `line ${round}\n` });
+        return echoed;
+      });
+    }
+
+    // End of input ends the program
+    const exited = waitFor(socket, "exit");
+    socket.emit("input", { input: "\x04" });
+    await exited;
+  } finally {
+    socket.close();
+  }
+};
+
+/**
+ * Start gdb on a template and time a few commands
+ */
+const debugScenario: Scenario = async (ctx) => {
+  const program = ctx.pickProgram();
+  const socket = await connect(ctx, "debug");
+  try {
+    let output = "";
+    socket.on("debug_response", (data: any) => {
+      output += outputText(data);
+    });
+
+    socket.emit("debug_start", {
+      code: program.code,
+      lang: program.lang,
+      compiler: ctx.compiler,
+    });
+    await stage(ctx, "debug", "start", () => waitFor(socket, "debug_start"));
+
+    for (const command of DEBUG_COMMANDS) {
+      output = "";
+      await stage(ctx, "debug", "command", () => {
+        const prompted = waitFor(socket, "debug_response", () =>
+          GDB_PROMPT.test(output)
+        );
+        socket.emit("input", { input: `${command}\n` });
+        return prompted;
+      });
+    }
+
+    // Confirm quitting in case the program is still running
+    const exited = waitFor(socket, "debug_exit");
+    socket.emit("input", { input: "quit\ny\n" });
+    await stage(ctx, "debug", "quit", () => exited);
+  } finally {
+    socket.close();
+  }
+};
+
+/**
+ * Leak check a template with Valgrind or ASan
+ * @param {string} mode - Leak check mode
+ * @returns {Scenario} The scenario
+ */
+const leakScenario =
+  (mode: "valgrind" | "asan"): Scenario =>
+  async (ctx) => {
+    const program = ctx.pickProgram();
+    const name = `leak_${mode}`;
+    const socket = await connect(ctx, name);
+    try {
+      socket.emit("leak_check", {
+        code: program.code,
+        lang: program.lang,
+        compiler: ctx.compiler,
+        optimization: ctx.optimization,
+        mode,
+      });
+      await stage(ctx, name, "report", () =>
+        waitFor(socket, "leak_check_report")
+      );
+    } finally {
+      socket.close();
+    }
+  };
+
+/**
+ * Trace the system calls of a template
+ */
+const straceScenario: Scenario = async (ctx) => {
+  const program = ctx.pickProgram();
+  const socket = await connect(ctx, "strace");
+  try {
+    socket.emit("strace_start", {
+      code: program.code,
+      lang: program.lang,
+      compiler: ctx.compiler,
+      optimization: ctx.optimization,
+    });
+    await stage(ctx, "strace", "report", () =>
+      waitFor(socket, "strace_report")
+    );
+  } finally {
+    socket.close();
+  }
+};
+
+/**
+ * Call a REST route with a template
+ * @param {string} name - Scenario name
+ * @param {Function} send - Sends the request for a program
+ * @returns {Scenario} The scenario
+ */
+const restScenario =
+  (
+    name: string,
+    send: (ctx: ScenarioContext, program: Program) => Promise<void>
+  ): Scenario =>
+  async (ctx) => {
+    const program = ctx.pickProgram();
+    await stage(ctx, name, "request", () => send(ctx, program));
+  };
+
+/**
+ * Scenarios by name, as used in --mix
+ */
+export const SCENARIOS: Record<string, Scenario> = {
+  compile: compileScenario,
+  input: inputScenario,
+  debug: debugScenario,
+  leak_valgrind: leakScenario("valgrind"),
+  leak_asan: leakScenario("asan"),
+  strace: straceScenario,
+  assembly: restScenario("assembly", (ctx, program) =>
+    request("POST", `${ctx.url}/api/assembly`, {
+      code: program.code,
+      lang: program.lang,
+      compiler: ctx.compiler,
+      optimization: ctx.optimization,
+    })
+  ),
+  format: restScenario("format", (ctx, program) =>
+    request("POST", `${ctx.url}/api/format`, { code: program.code })
+  ),
+  lint: restScenario("lint", (ctx, program) =>
+    request("POST", `${ctx.url}/api/lintCode`, {
+      code: program.code,
+      lang: program.lang,
+      // A newer lint request of a client cancels its previous one
+      clientId: `bench-${process.pid}-${Math.random()}`,
+    })
+  ),
+  template: restScenario("template", (ctx, program) =>
+    request(
+      "GET",
+      `${ctx.url}/api/templates/${program.lang}/${encodeURIComponent(
+        program.name
+      )}`
+    )
+  ),
+};
+
+/**
+ * Run a scenario once, recording its total time or its failure
+ * @param {string} name - Scenario name
+ * @param {ScenarioContext} ctx - Scenario context
+ */
+export const runScenario = async (
+  name: string,
+  ctx: ScenarioContext
+): Promise<void> => {
+  const started = performance.now();
+  try {
+    await SCENARIOS[name](ctx);
+    ctx.recorder.record(name, "total", performance.now() - started);
+  } catch (error) {
+    ctx.recorder.recordError(name, (error as Error).message);
+  }
+};
@@ -0,0 +1,268 @@
+/**
+ * Load Test Statistics
+ * Collects stage latencies of a load test run, summarizes them as
+ * throughput and percentiles, and compares the results of two runs
+ */
+
+/**
+ * Latency summary of one stage of a scenario
+ */
+export interface StageResult {
+  scenario: string;
+  stage: string;
+  count: number;
+  throughput: number; // Completions per second
+  mean: number; // Milliseconds, like the percentiles
+  p50: number;
+  p90: number;
+  p99: number;
+  max: number;
+}
+
+/**
+ * Results of a run at one concurrency level
+ */
+export interface LevelResult {
+  concurrency: number;
+  durationS: number;
+  stages: StageResult[];
+  errors: Record<string, Record<string, number>>; // scenario -> message -> count
+}
+
+/**
+ * Results of a load test run, as saved with --out
+ */
+export interface BenchResult {
+  label: string;
+  url: string;
+  startedAt: string;
+  mix: Record<string, number>;
+  levels: LevelResult[];
+}
+
+/**
+ * Value at a percentile of sorted samples (nearest rank)
+ * @param {number[]} sorted - Samples in ascending order
+ * @param {number} p - Percentile, 0-100
+ * @returns {number} The sample at the percentile
+ */
+export const percentile = (sorted: number[], p: number): number =>
+  sorted.length === 0
+    ? 0
+    : sorted[
+        Math.min(sorted.length - 1, Math.ceil((p / 100) * sorted.length) - 1)
+      ];
+
+/**
+ * Stage Recorder Implementation
+ */
+export class Recorder {
+  private readonly samples = new Map<string, number[]>();
+  private readonly errors = new Map<string, Map<string, number>>();
+
+  /**
+   * Record how long a stage took
+   * @param {string} scenario - Scenario name, e.g. "compile"
+   * @param {string} stage - Stage name, e.g. "first_output"
+   * @param {number} ms - Duration in milliseconds
+   */
+  record(scenario: string, stage: string, ms: number): void {
+    const key = `${scenario}\0${stage}`;
+    if (!this.samples.has(key)) {
+      this.samples.set(key, []);
+    }
+    this.samples.get(key)?.push(ms);
+  }
+
+  /**
+   * Record a failed scenario run
+   * @param {string} scenario - Scenario name
+   * @param {string} message - What went wrong
+   */
+  recordError(scenario: string, message: string): void {
+    if (!this.errors.has(scenario)) {
+      this.errors.set(scenario, new Map());
+    }
+    const messages = this.errors.get(scenario)!;
+    messages.set(message, (messages.get(message) ?? 0) + 1);
+  }
+
+  /**
+   * Summarize the recorded samples
+   * @param {number} concurrency - Virtual users of the run
+   * @param {number} durationS - Length of the run in seconds
+   * @returns {LevelResult} Per-stage throughput and percentiles
+   */
+  summarize(concurrency: number, durationS: number): LevelResult {
+    const stages = Array.from(this.samples.entries()).map(([key, values]) => {
+      const [scenario, stage] = key.split("\0");
+      const sorted = [...values].sort((a, b) => a - b);
+      return {
+        scenario,
+        stage,
+        count: sorted.length,
+        throughput: sorted.length / durationS,
+        mean: sorted.reduce((sum, value) => sum + value, 0) / sorted.length,
+        p50: percentile(sorted, 50),
+        p90: percentile(sorted, 90),
+        p99: percentile(sorted, 99),
+        max: sorted[sorted.length - 1],
+      };
+    });
+    stages.sort(
+      (a, b) =>
+        a.scenario.localeCompare(b.scenario) || a.stage.localeCompare(b.stage)
+    );
+
+    const errors: LevelResult["errors"] = {};
+    this.errors.forEach((messages, scenario) => {
+      errors[scenario] = Object.fromEntries(messages);
+    });
+
+    return { concurrency, durationS, stages, errors };
+  }
+}
+
+/**
+ * Format milliseconds for a table cell
+ * @param {number} ms - Duration
+ * @returns {string} Rounded duration
+ */
+const formatMs = (ms: number): string =>
+  ms >= 100 ? ms.toFixed(0) : ms.toFixed(1);
+
+/**
+ * Lay out rows as a table with aligned columns
+ * @param {string[][]} rows - Header row followed by data rows
+ * @returns {string} The table
+ */
+const formatTable = (rows: string[][]): string => {
+  const widths = rows[0].map((_, column) =>
+    Math.max(...rows.map((row) => row[column].length))
+  );
+  return rows
+    .map((row) =>
+      row
+        .map((cell, column) =>
+          column < 2
+            ? cell.padEnd(widths[column])
+            : cell.padStart(widths[column])
+        )
+        .join("  ")
+        .trimEnd()
+    )
+    .join("\n");
+};
+
+/**
+ * Format the results of one concurrency level
+ * @param {LevelResult} level - Results to show
+ * @returns {string} Stage table followed by any errors
+ */
+export const formatLevel = (level: LevelResult): string => {
+  const rows = [
+    ["scenario", "stage", "count", "req/s", "mean", "p50", "p90", "p99", "max"],
+    ...level.stages.map((stage) => [
+      stage.scenario,
+      stage.stage,
+      String(stage.count),
+      stage.throughput.toFixed(2),
+      formatMs(stage.mean),
+      formatMs(stage.p50),
+      formatMs(stage.p90),
+      formatMs(stage.p99),
+      formatMs(stage.max),
+    ]),
+  ];
+
+  const errors = Object.entries(level.errors).flatMap(([scenario, messages]) =>
+    Object.entries(messages).map(
+      ([message, count]) => `  ${scenario}: ${message} (${count}x)`
+    )
+  );
+
+  return [
+    `Concurrency ${level.concurrency}, ${level.durationS}s (latencies in ms)`,
+    formatTable(rows),
+    ...(errors.length > 0 ? ["Errors:", ...errors] : []),
+  ].join("\n");
+};
+
+/**
+ * Compare two runs level by level and stage by stage
+ * A stage regresses when its p50 or p99 grew, or its throughput fell, by
+ * more than the threshold
+ * @param {BenchResult} base - Results of the reference build
+ * @param {BenchResult} head - Results of the build under test
+ * @param {number} thresholdPct - Allowed change in percent
+ * @returns {{ report: string; regressions: number }} Comparison table
+ */
+export const compareResults = (
+  base: BenchResult,
+  head: BenchResult,
+  thresholdPct: number
+): { report: string; regressions: number } => {
+  const change = (from: number, to: number): number =>
+    from === 0 ? 0 : ((to - from) / from) * 100;
+  const formatChange = (pct: number): string =>
+    `${pct >= 0 ? "+" : ""}${pct.toFixed(1)}%`;
+
+  let regressions = 0;
+  const sections = head.levels.flatMap((level) => {
+    const baseLevel = base.levels.find(
+      (candidate) => candidate.concurrency === level.concurrency
+    );
+    if (!baseLevel) {
+      return [];
+    }
+
+    const rows = [
+      ["scenario", "stage", "p50", "Δp50", "p99", "Δp99", "req/s", "Δreq/s", ""],
+    ];
+    level.stages.forEach((stage) => {
+      const before = baseLevel.stages.find(
+        (candidate) =>
+          candidate.scenario === stage.scenario &&
+          candidate.stage === stage.stage
+      );
+      if (!before) {
+        return;
+      }
+
+      const p50 = change(before.p50, stage.p50);
+      const p99 = change(before.p99, stage.p99);
+      const throughput = change(before.throughput, stage.throughput);
+      const regressed =
+        p50 > thresholdPct || p99 > thresholdPct || -throughput > thresholdPct;
+      if (regressed) {
+        regressions++;
+      }
+
+      rows.push([
+        stage.scenario,
+        stage.stage,
+        formatMs(stage.p50),
+        formatChange(p50),
+        formatMs(stage.p99),
+        formatChange(p99),
+        stage.throughput.toFixed(2),
+        formatChange(throughput),
+        regressed ? "REGRESSED" : "",
+      ]);
+    });
+
+    return [
+      `Concurrency ${level.concurrency}: ${base.label} -> ${head.label}\n${formatTable(
+        rows
+      )}`,
+    ];
+  });
+
+  return {
+    report:
+      sections.length > 0
+        ? sections.join("\n\n")
+        : "No concurrency level was run by both builds",
+    regressions,
+  };
+};
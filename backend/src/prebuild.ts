@@ -0,0 +1,91 @@
+/**
+ * CinCout Template Prebuild
+ * Compiles every bundled template with every compiler and optimization level
+ * into a build cache directory, run at image build time
+ * The directory is then mounted read-only as CINCOUT_PREBUILT_DIR so that
+ * untouched templates run and show assembly without compiling
+ *
+ * Usage: CINCOUT_BUILD_CACHE_DIR=<dir> node prebuild.bundle.js
+ */
+import fs from "fs-extra";
+import path from "path";
+import { codeProcessingService } from "./utils/codeProcessingService";
+import { OPTIMIZATION_LEVELS } from "./utils/toolchain";
+import { listTemplateFiles } from "./utils/templateFiles";
+import { CompilationOptions } from "./types";
+
+const templatesDir = path.join(__dirname, "../templates");
+const LANGUAGES = ["c", "cpp"];
+const COMPILERS = ["gcc", "clang"];
+
+/**
+ * Build one template variant: the binary, the assembly listing and the
+ * remarks, and the listing with debug info used for structured assembly
+ * @returns {Promise<boolean>} True if every build succeeded
+ */
+const prebuild = async (
+  code: string,
+  options: CompilationOptions
+): Promise<boolean> => {
+  const env = await codeProcessingService.createCompilationEnvironment(
+    options.lang
+  );
+
+  try {
+    const compiled = await codeProcessingService.compileCode(env, code, {
+      ...options,
+      remarks: true,
+    });
+    const structured = await codeProcessingService.generateStructuredAssembly(
+      env,
+      code,
+      options
+    );
+    return compiled.success && structured.success;
+  } finally {
+    env.tmpDir.removeCallback();
+  }
+};
+
+const main = async (): Promise<void> => {
+  if (!process.env.CINCOUT_BUILD_CACHE_DIR) {
+    throw new Error("CINCOUT_BUILD_CACHE_DIR must name the output directory");
+  }
+
+  let built = 0;
+  let failed = 0;
+  for (const lang of LANGUAGES) {
+    const langDir = path.join(templatesDir, lang);
+    for (const { name, file } of await listTemplateFiles(langDir)) {
+      const code = await fs.readFile(file, "utf8");
+
+      for (const compiler of COMPILERS) {
+        for (const optimization of OPTIMIZATION_LEVELS) {
+          const options = {
+            lang,
+            compiler,
+            optimization,
+            schedule: { priority: "background" as const },
+          };
+          if (await prebuild(code, options)) {
+            built++;
+          } else {
+            failed++;
+            console.warn(
+              `Failed to prebuild ${name} (${compiler} ${optimization})`
+            );
+          }
+        }
+      }
+    }
+  }
+
+  console.log(`Prebuilt ${built} template variants, ${failed} failed`);
+};
+
+main()
+  .then(() => process.exit(0))
+  .catch((error) => {
+    console.error("Error prebuilding templates:", error);
+    process.exit(1);
+  });
@@ -1,14 +1,72 @@
 /**
  * Assembly view router
- * Handles assembly code generation
+ * Handles assembly code generation and comparison of two builds' assembly
  */
 import Router from "koa-router";
-import { koaHandler } from "../utils/routeHandler";
+import { getRequestSignal, koaHandler } from "../utils/routeHandler";
 import { codeProcessingService } from "../utils/codeProcessingService";
-import { AppError, AssemblyRequest } from "../types";
+import { diffAssembly } from "../utils/asmParser";
+import { OPTIMIZATION_LEVELS } from "../utils/toolchain";
+import { getRequestClientAddress } from "../utils/clientAddress";
+import {
+  AppError,
+  AssemblyDiff,
+  AssemblyDiffRequest,
+  AssemblyRequest,
+  AssemblyResult,
+  BenchmarkVariant,
+} from "../types";
 
 const router = new Router();
 
+/**
+ * Validate a requested compiler configuration
+ * @param {Partial<BenchmarkVariant>} variant - Requested configuration
+ * @returns {BenchmarkVariant} Configuration with known values only
+ */
+const toVariant = (variant?: Partial<BenchmarkVariant>): BenchmarkVariant => ({
+  compiler: variant?.compiler === "clang" ? "clang" : "gcc",
+  optimization:
+    variant?.optimization && OPTIMIZATION_LEVELS.includes(variant.optimization)
+      ? variant.optimization
+      : "-O0",
+});
+
+/**
+ * Build a filtered listing in its own environment
+ * @param {AssemblyDiffRequest} request - Diff request
+ * @param {BenchmarkVariant} variant - Compiler configuration
+ * @param {string} clientId - Client the build is scheduled for
+ * @param {AbortSignal} signal - Aborted when the client goes away
+ * @returns {Promise<AssemblyResult>} Assembly generation result
+ */
+const buildListing = async (
+  request: AssemblyDiffRequest,
+  variant: BenchmarkVariant,
+  clientId: string,
+  signal: AbortSignal
+): Promise<AssemblyResult> => {
+  const env = await codeProcessingService.createCompilationEnvironment(
+    request.lang || "c"
+  );
+
+  try {
+    return await codeProcessingService.generateStructuredAssembly(
+      env,
+      request.code,
+      {
+        lang: request.lang || "c",
+        compiler: variant.compiler,
+        optimization: variant.optimization,
+        schedule: { clientId, signal },
+      },
+      !!request.demangle
+    );
+  } finally {
+    env.tmpDir.removeCallback();
+  }
+};
+
 /**
  * POST /api/assembly
  * Generates assembly code from provided source code
@@ -16,7 +74,8 @@ const router = new Router();
 router.post(
   "/",
   koaHandler<AssemblyRequest>(async (ctx) => {
-    const { code, lang, compiler, optimization } = ctx.request.body;
+    const { code, lang, compiler, optimization, format, demangle } =
+      ctx.request.body;
 
     // Validate request
     if (!code) {
@@ -24,22 +83,39 @@ router.post(
     }
 
     // Create environment for assembly generation
-    const env = codeProcessingService.createCompilationEnvironment(lang || "c");
+    const env = await codeProcessingService.createCompilationEnvironment(
+      lang || "c"
+    );
 
     try {
-      // Generate assembly
-      const result = await codeProcessingService.generateAssembly(env, code, {
+      const options = {
         lang: lang || "c",
         compiler,
         optimization,
-      });
+        schedule: {
+          clientId: getRequestClientAddress(ctx),
+          signal: getRequestSignal(ctx),
+        },
+      };
+
+      // Generate assembly
+      const result =
+        format === "structured"
+          ? await codeProcessingService.generateStructuredAssembly(
+              env,
+              code,
+              options,
+              !!demangle
+            )
+          : await codeProcessingService.generateAssembly(env, code, options);
 
       // Clean up temporary files
       env.tmpDir.removeCallback();
 
       if (result.success) {
-        // Return assembly code
-        ctx.body = result.assembly;
+        // Return the listing as text, or its structure as JSON
+        ctx.body =
+          format === "structured" ? result.structured : result.assembly;
       } else {
         throw new AppError(`Assembly generation error: ${result.error}`, 500);
       }
@@ -53,4 +129,42 @@ router.post(
   })
 );
 
+/**
+ * POST /api/assembly/diff
+ * Builds the same source with two compiler configurations in parallel and
+ * returns the filtered listings aligned function by function
+ */
+router.post(
+  "/diff",
+  koaHandler<AssemblyDiffRequest>(async (ctx) => {
+    const request = ctx.request.body;
+
+    // Validate request
+    if (!request.code) {
+      throw new AppError("No code provided", 400);
+    }
+
+    const clientId = getRequestClientAddress(ctx);
+    const signal = getRequestSignal(ctx);
+    const left = toVariant(request.left);
+    const right = toVariant(request.right);
+    const [before, after] = await Promise.all([
+      buildListing(request, left, clientId, signal),
+      buildListing(request, right, clientId, signal),
+    ]);
+
+    const failed = !before.success ? before : !after.success ? after : null;
+    if (failed) {
+      throw new AppError(`Assembly generation error: ${failed.error}`, 500);
+    }
+
+    const diff: AssemblyDiff = {
+      left,
+      right,
+      functions: diffAssembly(before.structured!, after.structured!),
+    };
+    ctx.body = diff;
+  })
+);
+
 export default router;
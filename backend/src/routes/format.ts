@@ -12,19 +12,35 @@ const router = new Router();
 /**
  * POST /api/format
  * Formats code using clang-format
+ * An optional line range restricts formatting to the edited region
  */
 router.post(
   "/",
   koaHandler<FormatRequest>(async (ctx) => {
-    const { code } = ctx.request.body;
+    const { code, lines } = ctx.request.body;
 
     // Validate request
     if (!code) {
       throw new AppError("No code provided", 400);
     }
+    if (
+      lines &&
+      !(
+        Number.isInteger(lines.start) &&
+        Number.isInteger(lines.end) &&
+        lines.start >= 1 &&
+        lines.end >= lines.start
+      )
+    ) {
+      throw new AppError("Invalid line range", 400);
+    }
 
-    // Format the code
-    const result = await codeProcessingService.formatCode(code);
+    // Format the code, or only the requested lines
+    const result = await codeProcessingService.formatCode(
+      code,
+      undefined,
+      lines && { start: lines.start, end: lines.end }
+    );
 
     if (result.success) {
       // Return formatted code
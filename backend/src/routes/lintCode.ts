@@ -5,6 +5,7 @@
 import Router from "koa-router";
 import { koaHandler } from "../utils/routeHandler";
 import { codeProcessingService } from "../utils/codeProcessingService";
+import { getRequestClientAddress } from "../utils/clientAddress";
 import { AppError, LintCodeRequest } from "../types";
 
 const router = new Router();
@@ -16,17 +17,22 @@ const router = new Router();
 router.post(
   "/",
   koaHandler<LintCodeRequest>(async (ctx) => {
-    const { code } = ctx.request.body;
+    const { code, clientId } = ctx.request.body;
 
     // Validate request
     if (!code) {
       throw new AppError("No code provided", 400);
     }
 
-    // Run lint code check
-    const result = await codeProcessingService.runLintCode(code);
+    // Run lint code check; a newer request from this client supersedes it
+    const result = await codeProcessingService.runLintCode(
+      code,
+      `${getRequestClientAddress(ctx)}:${String(clientId || "").slice(0, 64)}`
+    );
 
-    if (result.success) {
+    if (result.superseded) {
+      throw new AppError(result.error!, 409);
+    } else if (result.success) {
       // Return formatted report
       ctx.body = result.report;
     } else {
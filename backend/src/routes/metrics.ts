@@ -0,0 +1,35 @@
+/**
+ * Metrics router
+ * Serves the metrics of all cluster workers in the Prometheus text format
+ */
+import Router from "koa-router";
+import { koaHandler } from "../utils/routeHandler";
+import { metrics } from "../utils/metrics";
+import { AppError } from "../types";
+
+// When set, scrapes must send it as a bearer token
+const METRICS_TOKEN = process.env.CINCOUT_METRICS_TOKEN || "";
+
+const router = new Router();
+
+/**
+ * GET /metrics
+ * Returns the merged metrics of the primary and every worker
+ */
+router.get(
+  "/metrics",
+  koaHandler<any>(async (ctx) => {
+    if (
+      METRICS_TOKEN &&
+      ctx.get("Authorization") !== `Bearer ${METRICS_TOKEN}`
+    ) {
+      throw new AppError("Unauthorized", 401);
+    }
+
+    ctx.set("Cache-Control", "no-store");
+    ctx.type = "text/plain; version=0.0.4; charset=utf-8";
+    ctx.body = await metrics.scrape();
+  })
+);
+
+export default router;
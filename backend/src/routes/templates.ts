@@ -7,88 +7,72 @@ import fs from "fs-extra";
 import path from "path";
 import { koaHandler } from "../utils/routeHandler";
 import { AppError } from "../types";
+import {
+  compressAsset,
+  CompressedAsset,
+  sendAsset,
+} from "../utils/staticAssets";
+import { listTemplateFiles } from "../utils/templateFiles";
 
 const router = new Router();
 const templatesDir = path.join(__dirname, "../templates");
-const templateCache: Record<
-  string,
-  { list: string[]; templates: Record<string, string> }
-> = {};
+const LANGUAGES = ["c", "cpp"];
 
 /**
- * Load template list for a specific language
+ * Templates of a language, ready to be sent
  */
-const loadTemplateList = async (lang: string): Promise<string[]> => {
-  // Check if templates are already cached
-  if (templateCache[lang]?.list) {
-    return templateCache[lang].list;
-  }
-
-  const langDir = path.join(templatesDir, lang);
-  try {
-    // Check if directory exists
-    if (!fs.existsSync(langDir)) {
-      throw new Error(`Template directory for ${lang} not found`);
-    }
-
-    // Read all template files and extract names
-    const files = await fs.readdir(langDir);
-    const templateNames = files
-      .filter((file) => file.endsWith(".c") || file.endsWith(".cpp"))
-      .map((file) => file.replace(/\.[^.]+$/, ""));
-
-    // Initialize cache with destructuring for cleaner code
-    templateCache[lang] = {
-      list: templateNames,
-      templates: templateCache[lang]?.templates || {},
-    };
-
-    return templateNames;
-  } catch (error) {
-    console.error(`Error loading template list for ${lang}:`, error);
-    throw new AppError(`Failed to load template list for ${lang}`, 500);
-  }
-};
+interface LanguageTemplates {
+  list: CompressedAsset;
+  templates: Map<string, CompressedAsset>;
+}
 
 /**
- * Load a specific template content
+ * Load and precompress the templates of every language
+ * Runs once per worker at startup, so no request reads or compresses a file
  */
-const loadTemplateContent = async (
-  lang: string,
-  templateName: string
-): Promise<string> => {
-  // Check if template is already cached
-  if (templateCache[lang]?.templates?.[templateName]) {
-    return templateCache[lang].templates[templateName];
-  }
+const loadTemplates = async (): Promise<Map<string, LanguageTemplates>> => {
+  const loaded = new Map<string, LanguageTemplates>();
 
-  // Ensure template list is loaded
-  if (!templateCache[lang]) {
-    await loadTemplateList(lang);
+  for (const lang of LANGUAGES) {
+    const langDir = path.join(templatesDir, lang);
+    try {
+      const templates = new Map<string, CompressedAsset>();
+      for (const { name, file } of await listTemplateFiles(langDir)) {
+        const content = await fs.readFile(file, "utf8");
+        templates.set(
+          name,
+          await compressAsset(content, "text/plain; charset=utf-8")
+        );
+      }
+
+      loaded.set(lang, {
+        list: await compressAsset(
+          JSON.stringify({ list: Array.from(templates.keys()) }),
+          "application/json; charset=utf-8"
+        ),
+        templates,
+      });
+    } catch (error) {
+      console.error(`Error loading templates for ${lang}:`, error);
+    }
   }
 
-  const langDir = path.join(templatesDir, lang);
-  const fileExtension = lang === "cpp" ? "cpp" : "c";
-  const filePath = path.join(langDir, `${templateName}.${fileExtension}`);
-
-  try {
-    // Read template content
-    const content = await fs.readFile(filePath, "utf8");
+  return loaded;
+};
 
-    // Cache the content
-    templateCache[lang].templates[templateName] = content;
+const templatesReady = loadTemplates();
 
-    return content;
-  } catch (error) {
-    console.error(
-      `Error loading template content for ${templateName} (${lang}):`,
-      error
-    );
-    throw new AppError(
-      `Failed to load template '${templateName}' for ${lang}`,
-      500
-    );
+/**
+ * Get the loaded templates of a language
+ */
+const getLanguageTemplates = async (
+  lang: string
+): Promise<LanguageTemplates> => {
+  const templates = (await templatesReady).get(lang);
+  if (!templates) {
+    throw new AppError(`Failed to load template list for ${lang}`, 500);
   }
+  return templates;
 };
 
 /**
@@ -104,13 +88,8 @@ router.get(
       throw new AppError(`Unsupported language: ${lang}`, 400);
     }
 
-    try {
-      // Load template list
-      const templateNames = await loadTemplateList(lang);
-      ctx.body = { list: templateNames };
-    } catch (error) {
-      throw error; // Will be handled by koaHandler
-    }
+    const { list } = await getLanguageTemplates(lang);
+    sendAsset(ctx, list);
   })
 );
 
@@ -128,13 +107,14 @@ router.get(
       throw new AppError(`Unsupported language: ${lang}`, 400);
     }
 
-    try {
-      // Load template content
-      const content = await loadTemplateContent(lang, template);
-      ctx.body = content;
-    } catch (error) {
-      throw error; // Will be handled by koaHandler
+    const content = (await getLanguageTemplates(lang)).templates.get(template);
+    if (!content) {
+      throw new AppError(
+        `Failed to load template '${template}' for ${lang}`,
+        404
+      );
     }
+    sendAsset(ctx, content);
   })
 );
 
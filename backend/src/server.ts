@@ -10,7 +10,6 @@ import bodyParser from "koa-bodyparser";
 import cors from "@koa/cors";
 import path from "path";
 import http from "http";
-import ratelimit from "koa-ratelimit";
 import compress from "koa-compress";
 import helmet from "koa-helmet";
 import serve from "koa-static";
@@ -24,6 +23,25 @@ import formatRouter from "./routes/format";
 import lintCodeRouter from "./routes/lintCode";
 import templatesRouter from "./routes/templates";
 import assemblyRouter from "./routes/assembly";
+import metricsRouter from "./routes/metrics";
+import { pchService } from "./utils/pchService";
+import { compileSlotPool } from "./utils/compileScheduler";
+import { benchmarkSlotPool } from "./utils/benchmarkService";
+import { sandboxPool } from "./utils/sandboxPool";
+import { rateLimiter } from "./utils/rateLimiter";
+import { precompressedStatic } from "./utils/staticAssets";
+import { debuggerPool, launcherPool } from "./utils/warmPool";
+import { connectionRouter } from "./utils/connectionRouter";
+import { executionLimiter } from "./utils/executionLimits";
+import { sessionService } from "./utils/sessionService";
+import { setupAdapterRelay } from "./utils/socketAdapter";
+import { nodeRole } from "./utils/nodeRole";
+import { metrics } from "./utils/metrics";
+import { memoryGuard } from "./utils/memoryGuard";
+import {
+  TRUSTED_PROXY_HOPS,
+  getRequestClientAddress,
+} from "./utils/clientAddress";
 
 // Determine number of worker processes
 const numCPUs = os.cpus().length;
@@ -36,6 +54,9 @@ const port = parseInt(process.env.PORT || "9527", 10);
 function startWorker() {
   // Create Koa application
   const app = new Koa();
+  // Trust forwarding headers only as far as the proxies in front of us
+  app.proxy = TRUSTED_PROXY_HOPS > 0;
+  app.maxIpsCount = TRUSTED_PROXY_HOPS;
 
   // Add error handler
   app.use(async (ctx: Context, next: () => Promise<any>) => {
@@ -101,27 +122,14 @@ function startWorker() {
     })
   );
 
-  // Rate limiter middleware
-  const rateLimitDb = new Map();
-  app.use(
-    ratelimit({
-      driver: "memory",
-      db: rateLimitDb,
-      duration: 60 * 1000, // 1 minute
-      max: 30, // limit each IP to 30 requests per duration
-      errorMessage: "Rate limit exceeded",
-      id: (ctx: Context) => ctx.ip,
-      whitelist: (_ctx: Context) => {
-        // Optional whitelist function
-        return false;
-      },
-      disableHeader: false,
-    })
-  );
+  // Rate limiter middleware, charging API requests by cost cluster-wide
+  app.use(rateLimiter.middleware());
 
-  // Static files middleware
+  // Static files middleware, precompressed text assets first
+  const staticRoot = path.join(__dirname, "../../frontend/dist");
+  app.use(precompressedStatic(staticRoot));
   app.use(
-    serve(path.join(__dirname, "../../frontend/dist"), {
+    serve(staticRoot, {
       maxage: 86400000, // 1 day in milliseconds
       index: "index.html",
       immutable: true, // Add immutable directive for improved caching
@@ -142,8 +150,12 @@ function startWorker() {
   server.keepAliveTimeout = 61 * 1000; // Client Keep-Alive timeout (61 seconds)
   server.headersTimeout = 65 * 1000; // Headers timeout (65 seconds)
 
-  // Setup Socket.IO handlers
-  setupSocketHandlers(server);
+  // Setup Socket.IO handlers, or hand sessions on to the runner tier
+  if (nodeRole.runsSessions()) {
+    setupSocketHandlers(server);
+  } else {
+    nodeRole.replaySessions(server);
+  }
 
   // Set up main router
   const apiRouter = new Router({ prefix: "/api" });
@@ -173,6 +185,9 @@ function startWorker() {
   // Use the router middleware
   app.use(apiRouter.routes()).use(apiRouter.allowedMethods());
 
+  // Prometheus scrapes, merged across the cluster
+  app.use(metricsRouter.routes()).use(metricsRouter.allowedMethods());
+
   // Custom 404 handler
   app.use((ctx: Context) => {
     ctx.status = 404;
@@ -190,28 +205,44 @@ function startWorker() {
       status: ctx.status,
       path: ctx.path,
       method: ctx.method,
-      ip: ctx.ip,
+      ip: getRequestClientAddress(ctx),
     };
 
     console.error("Server error:", errorDetails, err.stack);
   });
 
   // Start server
-  server.listen(port, () => {
-    // memory usage monitoring
-    const memoryCheckInterval = 30000; // 30 seconds
-    setInterval(() => {
-      const memoryUsage = process.memoryUsage();
-      const mbUsed = Math.round((memoryUsage.rss / 1024 / 1024) * 100) / 100;
-      if (mbUsed > 800) {
-        // 800 MB threshold
-        console.error(
-          `Worker ${process.pid} memory usage critical (${mbUsed} MB), exiting for restart`
-        );
-        process.exit(1); // Exit with error code so cluster manager will restart
-      }
-    }, memoryCheckInterval);
-  });
+  const onListening = () => {
+    // Pre-create working directories before the first request needs one
+    sandboxPool.warmUp().catch((error) => {
+      console.error("Error warming up sandbox pool:", error);
+    });
+
+    // Pre-start gdb and launcher processes for debug, run and leak check
+    // sessions
+    if (nodeRole.runsSessions()) {
+      debuggerPool.warmUp();
+      launcherPool.warmUp();
+    }
+
+    // Event loop lag shows work blocking the worker, e.g. parsing
+    metrics.monitorProcess();
+
+    // Drain and recycle this worker when its memory grows too large
+    memoryGuard.watch(server);
+  };
+
+  // With load-based routing the primary owns the port and hands connections
+  // to the worker with the fewest sessions
+  if (connectionRouter.isEnabled()) {
+    connectionRouter.attach(
+      server,
+      () => sessionService.getActiveSessions().size
+    );
+    onListening();
+  } else {
+    server.listen(port, onListening);
+  }
 
   // Handle unexpected errors
   process.on("uncaughtException", (err) => {
@@ -226,7 +257,18 @@ function startWorker() {
 // Main application entry point
 if (cluster.isPrimary) {
   // Master process
-  console.log(`Master ${process.pid} is running`);
+  console.log(`Master ${process.pid} is running (role: ${nodeRole.role})`);
+
+  // Share Socket.IO rooms and broadcasts between workers
+  setupAdapterRelay();
+
+  // Accept connections here and route them by worker load
+  if (connectionRouter.isEnabled()) {
+    connectionRouter.listen(port);
+  }
+
+  // Fork a replacement as soon as a worker starts draining
+  memoryGuard.supervise();
 
   // Fork workers
   for (let i = 0; i < numCPUs; i++) {
@@ -235,16 +277,38 @@ if (cluster.isPrimary) {
 
   // Restart workers if they die
   cluster.on("exit", (worker, code, signal) => {
+    // A drained worker's replacement was forked when it started draining
+    const replaced = memoryGuard.wasReplaced(worker);
     console.warn(
-      `Worker ${worker.process.pid} died (${signal || code}), forking a new one`
+      `Worker ${worker.process.pid} died (${signal || code})${
+        replaced ? "" : ", forking a new one"
+      }`
     );
-    cluster.fork();
+    // Free compile slots the dead worker was holding or waiting for
+    compileSlotPool?.releaseWorker(worker);
+    benchmarkSlotPool?.releaseWorker(worker);
+    // Reclaim the dead worker's working directories (they may live in RAM)
+    if (worker.process.pid) {
+      sandboxPool.removeOrphans(worker.process.pid).catch((error) => {
+        console.error("Error removing orphaned sandboxes:", error);
+      });
+      // Kill and remove process trees the dead worker left in their cgroups
+      executionLimiter.removeOrphans(worker.process.pid);
+    }
+    if (!replaced) {
+      cluster.fork();
+    }
   });
 
   // Log when a worker comes online
   cluster.on("online", (worker) => {
     console.log(`Worker ${worker.process.pid} is online`);
   });
+
+  // Build precompiled headers in the background; workers pick them up once ready
+  pchService.buildAll().then(() => {
+    console.log("Precompiled headers are ready");
+  });
 } else {
   // Worker process
   startWorker();
@@ -2,6 +2,7 @@ import * as pty from "node-pty";
 import { DirResult } from "tmp";
 import { Socket } from "socket.io";
 import { Context } from "koa";
+import type { LimitedExecution } from "./utils/executionLimits";
 
 // ==========================================
 // Server & API Types
@@ -49,6 +50,32 @@ export class AppError extends Error {
   }
 }
 
+/**
+ * Compiler failure carrying structured diagnostics
+ * The message holds the diagnostics rendered for the output panel
+ */
+export class CompileError extends Error {
+  diagnostics: CompilerDiagnostic[];
+
+  constructor(message: string, diagnostics: CompilerDiagnostic[]) {
+    super(message);
+    this.diagnostics = diagnostics;
+    this.name = this.constructor.name;
+    Error.captureStackTrace(this, this.constructor);
+  }
+}
+
+/**
+ * Request given up through its abort signal, e.g. after the client left
+ */
+export class CancelledError extends Error {
+  constructor(message: string = "Request cancelled") {
+    super(message);
+    this.name = this.constructor.name;
+    Error.captureStackTrace(this, this.constructor);
+  }
+}
+
 // ==========================================
 // Compilation Types
 // ==========================================
@@ -71,6 +98,88 @@ export interface CompilationOptions {
   compiler?: string; // 'gcc', 'g++', 'clang', 'clang++'
   optimization?: string; // Optimization level
   standard?: string; // Language standard override
+  schedule?: CompileScheduleOptions; // Compile slot scheduling
+  remarks?: boolean; // Collect vectorization and inlining remarks
+  onDiagnostic?: (html: string, diagnostic: CompilerDiagnostic) => void; // Streams diagnostics while compiling
+}
+
+/**
+ * A file of a multi-file workspace
+ */
+export interface WorkspaceFile {
+  name: string; // File name without directory, e.g. 'vec.hpp'
+  content: string;
+}
+
+/**
+ * Object file of a workspace translation unit kept between builds
+ */
+export interface WorkspaceObject {
+  key: string; // Hash of the flags and every source the object was built from
+  deps: string[]; // Workspace headers the unit included, from its -MMD output
+}
+
+/**
+ * Build state of a workspace, kept by the session service between runs
+ */
+export interface WorkspaceCache {
+  id: string; // Issued to the client, which sends it back with its next run
+  dir: string; // Sources, object files and the last linked program
+  sources: Map<string, string>; // Content hash by file name
+  objects: Map<string, WorkspaceObject>; // By translation unit
+  linkKey: string | null; // Hash of the inputs of the last linked program
+  lastUsed: number;
+  queue: Promise<unknown>; // Builds of a workspace run one at a time
+}
+
+/**
+ * Compile slot priority
+ */
+export type CompilePriority = "interactive" | "background";
+
+/**
+ * Options for acquiring a compile slot
+ */
+export interface CompileScheduleOptions {
+  clientId?: string; // Client identifier (IP address) used for fairness
+  priority?: CompilePriority;
+  onQueued?: (position: number) => void; // Called when the queue position changes
+  signal?: AbortSignal; // Cancels the request while queued or running
+}
+
+/**
+ * Compile scheduler statistics
+ */
+export interface CompileSchedulerStats {
+  capacity: number;
+  running: number;
+  queued: number;
+  granted: number;
+  averageWaitMs: number;
+  maxWaitMs: number;
+}
+
+/**
+ * Outcome of charging a request against its client's token bucket
+ */
+export interface RateDecision {
+  allowed: boolean;
+  reason?: "rate" | "load"; // Out of tokens, or shed because the node is busy
+  remaining: number; // Tokens left in the bucket
+  retryAfterMs: number; // When the request could succeed, 0 if allowed
+}
+
+/**
+ * Structured compiler diagnostic
+ */
+export interface CompilerDiagnostic {
+  kind: string; // 'error', 'warning', 'note', 'fatal error', ...
+  message: string;
+  file?: string; // File name without directory
+  line?: number;
+  column?: number;
+  option?: string; // Warning option that enabled the diagnostic
+  children: CompilerDiagnostic[]; // Attached notes
 }
 
 /**
@@ -80,6 +189,7 @@ export interface ExecutionResult {
   stdout: string;
   stderr: string;
   exitCode: number;
+  truncated?: boolean; // Output exceeded the byte limit and the process was killed
 }
 
 /**
@@ -89,6 +199,28 @@ export interface CompilationResult {
   success: boolean;
   output?: string;
   error?: string;
+  diagnostics?: CompilerDiagnostic[]; // Structured errors and warnings
+  cached?: boolean; // Whether the binary was served from the build cache
+  usedPch?: boolean; // Whether a precompiled header was injected
+  remarks?: OptimizationRemark[]; // When requested in the options
+  units?: { compiled: number; reused: number }; // Workspace translation units
+}
+
+/**
+ * What an optimization remark reports
+ */
+export type OptimizationRemarkKind = "passed" | "missed" | "analysis";
+
+/**
+ * An optimizer report about a line of the program, e.g. why a loop was not
+ * vectorized or a call was inlined
+ */
+export interface OptimizationRemark {
+  line: number;
+  column: number;
+  kind: OptimizationRemarkKind;
+  pass: string; // "vectorize", "inline", ...
+  message: string;
 }
 
 /**
@@ -97,7 +229,116 @@ export interface CompilationResult {
 export interface AssemblyResult {
   success: boolean;
   assembly?: string;
+  structured?: StructuredAssembly; // Filtered listing, when requested
   error?: string;
+  cached?: boolean; // Whether the listing was served from the build cache
+}
+
+/**
+ * An instruction or a referenced label of a filtered listing
+ */
+export interface AsmInstruction {
+  text: string;
+  line?: number; // Source line the instruction was generated for
+  label?: boolean; // A jump target rather than an instruction
+}
+
+/**
+ * A function of a filtered listing
+ */
+export interface AsmFunction {
+  name: string; // Symbol name, demangled when requested
+  symbol: string; // Symbol name as emitted
+  instructions: AsmInstruction[];
+  instructionCount: number; // Instructions, not counting labels
+  vectorCount: number; // Packed SIMD instructions
+}
+
+/**
+ * A contiguous range of a function's rows generated for one source line
+ */
+export interface AsmLineRange {
+  line: number;
+  function: number; // Index into StructuredAssembly.functions
+  start: number; // First row, index into AsmFunction.instructions
+  end: number; // One past the last row
+}
+
+/**
+ * Assembly listing without directives, split into functions and mapped to
+ * the source lines the instructions were generated for
+ */
+export interface StructuredAssembly {
+  functions: AsmFunction[];
+  lineMap: AsmLineRange[]; // Ordered by function, then by row
+}
+
+/**
+ * A row of an aligned assembly diff
+ * "changed" rows pair an instruction on each side; "left" and "right" rows
+ * exist on one side only
+ */
+export interface AsmDiffRow {
+  kind: "same" | "changed" | "left" | "right";
+  left?: AsmInstruction;
+  right?: AsmInstruction;
+}
+
+/**
+ * One function of an assembly diff, matched by symbol name
+ */
+export interface AsmFunctionDiff {
+  name: string;
+  left: { instructionCount: number; vectorCount: number } | null;
+  right: { instructionCount: number; vectorCount: number } | null;
+  rows: AsmDiffRow[];
+  aligned: boolean; // False if the function was too large to align
+}
+
+/**
+ * Assembly of the same source built with two configurations
+ */
+export interface AssemblyDiff {
+  left: BenchmarkVariant;
+  right: BenchmarkVariant;
+  functions: AsmFunctionDiff[];
+}
+
+/**
+ * Inputs that determine the artifacts produced by a build
+ */
+export interface BuildCacheKeyInput {
+  code: string;
+  lang: string;
+  compiler: string; // Resolved compiler command ('gcc', 'g++', 'clang', 'clang++')
+  fingerprint: string; // Fingerprint of the compiler's version
+  standard: string;
+  optimization: string;
+  flags: string[]; // Additional flags such as '-g'
+  pch: boolean; // Whether a precompiled header is injected
+}
+
+/**
+ * Build cache counters
+ */
+export interface BuildCacheStats {
+  hits: number;
+  prebuiltHits: number; // Hits served from the read-only prebuilt store
+  misses: number;
+  stores: number;
+  evictions: number;
+  hitRate: number;
+}
+
+/**
+ * Sandbox pool counters
+ */
+export interface SandboxPoolStats {
+  rootDir: string;
+  idle: number;
+  active: number;
+  created: number;
+  recycled: number;
 }
 
 /**
@@ -107,6 +348,15 @@ export interface LintCodeResult {
   success: boolean;
   report?: string;
   error?: string;
+  superseded?: boolean; // A newer request from the same client replaced it
+}
+
+/**
+ * Lines to format, 1-based and inclusive
+ */
+export interface FormatLineRange {
+  start: number;
+  end: number;
 }
 
 /**
@@ -131,11 +381,19 @@ export interface DebugSessionResult {
 // Session Types
 // ==========================================
 
+/**
+ * Process of a session: a PTY, or pipes for programs that read no input
+ */
+export type SessionProcess = Pick<
+  pty.IPty,
+  "pid" | "write" | "kill" | "pause" | "resume" | "onData" | "onExit"
+>;
+
 /**
  * Session information
  */
 export interface Session {
-  pty: pty.IPty;
+  pty: SessionProcess;
   tmpDir: DirResult;
   lastActivity: number;
   dimensions: { cols: number; rows: number };
@@ -143,6 +401,273 @@ export interface Session {
   socketId?: string; // Optional Socket.IO socket ID for reference
   isDebugSession?: boolean; // Whether this is a GDB debug session
   straceLogFile?: string; // Path to strace log file (only for strace sessions)
+  execution?: LimitedExecution; // Resource limits of the running program
+}
+
+/**
+ * Kinds of sessions with their own execution limits
+ */
+export type ExecutionProfileName =
+  | "run"
+  | "debug"
+  | "trace"
+  | "memcheck"
+  | "benchmark"
+  | "profile";
+
+/**
+ * Resource limits for a user program
+ */
+export interface ExecutionProfile {
+  cpuPercent: number; // Share of one core
+  memoryMB: number;
+  pids: number; // Maximum number of processes and threads (cgroups only)
+  wallClockSeconds: number;
+  limitAddressSpace: boolean; // Whether the ulimit fallback may cap virtual memory
+}
+
+/**
+ * Why a program was killed
+ */
+export type KillReason = "timeout" | "memory" | "cpu" | "output";
+
+/**
+ * Resource usage reported when a program exits
+ */
+export interface ExecutionStats {
+  wallTimeMs: number;
+  cpuTimeMs: number | null; // null without cgroup accounting
+  peakMemoryBytes: number | null; // null without cgroup accounting
+  killReason: KillReason | null;
+}
+
+/**
+ * Output coalescer batching and limits
+ */
+export interface OutputCoalescerOptions {
+  flushIntervalMs: number; // Maximum time output is held back
+  maxBatchBytes: number; // Flush early once this much output is queued
+  maxTotalBytes: number; // Output beyond this is cut off
+  maxBytesPerSecond: number; // The source is paused above this rate
+}
+
+/**
+ * A stack frame reported by valgrind
+ */
+export interface MemcheckFrame {
+  fn?: string; // Function name
+  file?: string; // Source file name, without directories
+  line?: number;
+  obj?: string; // Shared object, when there is no source location
+}
+
+/**
+ * Leak check implementation: Valgrind memcheck (precise) or
+ * AddressSanitizer with LeakSanitizer and UBSan (fast)
+ */
+export type LeakCheckMode = "valgrind" | "asan";
+
+/**
+ * A memcheck error or leak, merged with identical ones
+ */
+export interface MemcheckRecord {
+  kind: string; // Valgrind kind, e.g. "Leak_DefinitelyLost" or "InvalidRead"
+  message: string;
+  bytes?: number; // Leaked bytes (leaks only)
+  blocks?: number; // Leaked blocks (leaks only)
+  stack: MemcheckFrame[];
+  auxMessage?: string; // Secondary explanation, e.g. where a block was freed
+  auxStack?: MemcheckFrame[];
+  count: number; // Occurrences with the same kind and stack
+}
+
+/**
+ * Totals of a memcheck run
+ */
+export interface MemcheckSummary {
+  errors: number; // Non-leak errors, counting repeats
+  definitelyLost: number; // Bytes by leak kind
+  indirectlyLost: number;
+  possiblyLost: number;
+  stillReachable: number;
+}
+
+/**
+ * A single entry of an strace log
+ */
+export interface SyscallRecord {
+  pid: number | null; // null when only one process was traced
+  kind: "syscall" | "signal" | "exit";
+  name: string; // Syscall or signal name; "exit" for process exits
+  args: string; // Arguments, signal info or exit message
+  result?: string; // Return value, "?" if the call did not return
+  errno?: string; // Error name for failed calls
+  durationMs?: number; // Time spent in the call (strace -T)
+}
+
+/**
+ * Per-syscall totals in the style of strace -c
+ */
+export interface SyscallSummaryEntry {
+  name: string;
+  calls: number;
+  errors: number;
+  totalMs: number;
+  percent: number; // Share of the total time spent in syscalls
+}
+
+/**
+ * A compiler configuration to benchmark
+ */
+export interface BenchmarkVariant {
+  compiler: string; // 'gcc' or 'clang'
+  optimization: string;
+}
+
+/**
+ * How each variant is run
+ */
+export interface BenchmarkOptions {
+  iterations: number; // Timed runs
+  warmup: number; // Untimed runs before the timed ones
+  input: string; // Standard input of every run
+}
+
+/**
+ * Distribution of timed samples, in milliseconds
+ */
+export interface BenchmarkDistribution {
+  min: number;
+  median: number;
+  p95: number;
+  mean: number;
+  stddev: number;
+}
+
+/**
+ * Wall time distribution of the timed runs, in milliseconds
+ */
+export interface BenchmarkTiming extends BenchmarkDistribution {
+  launchOverhead: number; // Median time to start and reap an empty program
+}
+
+/**
+ * Timing of a section the program measured itself
+ * Programs report a section by printing "BENCH <name> <nanoseconds>"
+ */
+export interface BenchmarkSection extends BenchmarkDistribution {
+  name: string;
+  samples: number; // Timed runs that reported the section
+}
+
+/**
+ * Hardware counters per run, averaged by perf stat
+ * A counter is null when the CPU or kernel does not provide it
+ */
+export interface BenchmarkCounters {
+  cycles: number | null;
+  instructions: number | null;
+  ipc: number | null; // Instructions per cycle
+  cacheMisses: number | null;
+  branchMisses: number | null;
+}
+
+/**
+ * Result of benchmarking one variant
+ */
+export interface BenchmarkResult {
+  variant: BenchmarkVariant;
+  iterations: number; // Timed runs that completed
+  timing: BenchmarkTiming | null; // null when no timed run completed
+  counters: BenchmarkCounters | null; // null when perf is unavailable
+  sections: BenchmarkSection[]; // Self-timed sections, in order of appearance
+  cpu: number | null; // CPU the runs were pinned to
+  error?: string; // Why the runs stopped early
+  stats: ExecutionStats; // Resource usage of all runs together
+}
+
+/**
+ * A single timed run of a program
+ */
+export interface ProgramRun {
+  ms: number; // Wall time
+  exitCode: number | null;
+  signal: string | null;
+  outputHash: string; // Shortened SHA-256 of everything written to stdout
+  outputBytes: number;
+  error?: string; // Why the run failed
+}
+
+/**
+ * Matrix run request sent by the client
+ * Every combination of the selected compilers, optimization levels and
+ * standards is built and run
+ */
+export interface MatrixRequest {
+  code: string;
+  lang: string;
+  compilers?: string[]; // Defaults to gcc and clang
+  optimizations?: string[]; // Defaults to -O0 and -O2
+  standards?: string[]; // Defaults to the language's default standard
+  input?: string;
+}
+
+/**
+ * A build configuration of a matrix run
+ */
+export interface MatrixConfig {
+  compiler: string; // 'gcc' or 'clang'
+  optimization: string;
+  standard: string; // e.g. '-std=c++20'
+}
+
+/**
+ * Outcome of one configuration of a matrix run
+ */
+export interface MatrixCell {
+  config: MatrixConfig;
+  cached: boolean; // Whole cell served from the matrix result cache
+  buildCached: boolean; // Binary served from the build cache
+  compileMs: number;
+  binaryBytes: number | null; // null when compiling failed
+  run: ProgramRun | null; // null when compiling failed
+  error?: string; // Compiler output when compiling failed
+}
+
+/**
+ * How a profile was sampled
+ */
+export type ProfilerMode = "perf" | "sampler";
+
+/**
+ * A distinct call stack and how often it was sampled
+ */
+export interface ProfileStack {
+  stack: string; // Collapsed stack: function names, outermost first, ";"-joined
+  samples: number;
+}
+
+/**
+ * A source line of the program the CPU was sampled in
+ */
+export interface ProfileHotspot {
+  file: string; // File name without the sandbox directory
+  line: number;
+  function: string;
+  samples: number;
+  percent: number; // Share of all samples
+}
+
+/**
+ * Sampling profile of a run
+ */
+export interface ProfileReport {
+  mode: ProfilerMode;
+  samples: number;
+  lost: number; // Samples the sampler had no room for
+  stacks: ProfileStack[]; // Most sampled first
+  dropped: number; // Samples in stacks beyond the stack limit
+  hotspots: ProfileHotspot[]; // Most sampled first
 }
 
 // ==========================================
@@ -175,30 +700,56 @@ export interface SessionSocket extends Socket {
  * Code processing service interface
  */
 export interface ICodeProcessingService {
-  createCompilationEnvironment(lang: string): CompilationEnvironment;
-  writeCodeToFile(filePath: string, code: string): void;
+  createCompilationEnvironment(lang: string): Promise<CompilationEnvironment>;
+  writeCodeToFile(filePath: string, code: string): Promise<void>;
   compileCode(
     env: CompilationEnvironment,
     code: string,
     options: CompilationOptions
   ): Promise<CompilationResult>;
+  compileWorkspace(
+    env: CompilationEnvironment,
+    files: WorkspaceFile[],
+    options: CompilationOptions,
+    workspace: WorkspaceCache
+  ): Promise<CompilationResult>;
   generateAssembly(
     env: CompilationEnvironment,
     code: string,
     options: CompilationOptions
   ): Promise<AssemblyResult>;
+  generateStructuredAssembly(
+    env: CompilationEnvironment,
+    code: string,
+    options: CompilationOptions,
+    demangle?: boolean
+  ): Promise<AssemblyResult>;
   prepareLeakDetection(
     env: CompilationEnvironment,
     code: string,
     options: CompilationOptions
-  ): Promise<{ success: boolean; valgrindLogFile?: string; error?: string }>;
+  ): Promise<{ success: boolean; valgrindXmlFile?: string; error?: string }>;
+  prepareSanitizerCheck(
+    env: CompilationEnvironment,
+    code: string,
+    options: CompilationOptions
+  ): Promise<{ success: boolean; sanitizerLogPath?: string; error?: string }>;
   prepareSyscallTracing(
     env: CompilationEnvironment,
     code: string,
     options: CompilationOptions
   ): Promise<{ success: boolean; straceLogFile?: string; error?: string }>;
-  formatCode(code: string, style?: string): Promise<FormatResult>;
-  runLintCode(code: string, lang: string): Promise<LintCodeResult>;
+  prepareProfiling(
+    env: CompilationEnvironment,
+    code: string,
+    options: CompilationOptions
+  ): Promise<{ success: boolean; error?: string }>;
+  formatCode(
+    code: string,
+    style?: string,
+    lines?: FormatLineRange
+  ): Promise<FormatResult>;
+  runLintCode(code: string, clientId?: string): Promise<LintCodeResult>;
   prepareDebugSession(
     env: CompilationEnvironment,
     options: CompilationOptions
@@ -215,14 +766,15 @@ export interface ISessionService {
     socket: Socket,
     sessionId: string,
     tmpDir: DirResult,
-    outputFile: string
-  ): boolean;
+    outputFile: string,
+    launcher?: Promise<pty.IPty>
+  ): Promise<boolean>;
   executeDebugSession(
     socket: Socket,
     sessionId: string,
     tmpDir: DirResult,
     outputFile: string
-  ): boolean;
+  ): Promise<boolean>;
 
   // Strace session method for syscall tracing
   executeStraceSession(
@@ -231,11 +783,13 @@ export interface ISessionService {
     tmpDir: DirResult,
     outputFile: string,
     straceLogFile: string
-  ): boolean;
+  ): Promise<boolean>;
   sendInputToSession(sessionId: string, input: string): boolean;
   terminateSession(sessionId: string): void;
   getActiveSessions(): Map<string, Session>;
   getSession(sessionId: string): Session | undefined;
+  getWorkspaceCache(workspaceId?: string): Promise<WorkspaceCache>;
+  shedMemory(maxOutputBytes: number): void;
 }
 
 /**
@@ -243,6 +797,7 @@ export interface ISessionService {
  */
 export interface IWebSocketManager {
   initialize(server: any): any;
+  stopAccepting(): void;
   emitToClient(socket: Socket, event: string, data: any): void;
 }
 
@@ -253,14 +808,32 @@ export interface IWebSocketManager {
 /**
  * Assembly route request
  */
-export interface AssemblyRequest extends CodeRequest {}
+export interface AssemblyRequest extends CodeRequest {
+  format?: "text" | "structured"; // Defaults to the raw listing as text
+  demangle?: boolean; // Demangle C++ symbols in structured listings
+}
+
+/**
+ * Assembly diff route request
+ */
+export interface AssemblyDiffRequest {
+  code: string;
+  lang: string;
+  left?: Partial<BenchmarkVariant>;
+  right?: Partial<BenchmarkVariant>;
+  demangle?: boolean;
+}
 
 /**
  * Format route request
  */
-export interface FormatRequest extends CodeRequest {}
+export interface FormatRequest extends CodeRequest {
+  lines?: FormatLineRange; // Format only these lines, e.g. the edited region
+}
 
 /**
  * Lint code route request
  */
-export interface LintCodeRequest extends CodeRequest {}
+export interface LintCodeRequest extends CodeRequest {
+  clientId?: string; // Editor tab; tabs sharing an address do not supersede each other
+}
@@ -0,0 +1,330 @@
+/**
+ * Assembly Parser
+ * Turns a compiler's assembly listing into functions of instructions mapped
+ * to source lines, and aligns the functions of two listings for comparison
+ */
+import {
+  AsmDiffRow,
+  AsmFunction,
+  AsmFunctionDiff,
+  AsmInstruction,
+  AsmLineRange,
+  StructuredAssembly,
+} from "../types";
+
+// Larger functions are compared row by row instead of aligned
+const MAX_ALIGN_CELLS = 4_000_000;
+
+// ".file 1 "program.cpp"" or, with DWARF 5, ".file 0 "/dir" "program.cpp" md5 0x..."
+const FILE_DIRECTIVE = /^\.file\s+(\d+)\s+"([^"]*)"(?:\s+"([^"]*)")?/;
+// ".loc 1 12 5 is_stmt 0 view .LVU3"
+const LOC_DIRECTIVE = /^\.loc\s+(\d+)\s+(\d+)/;
+// ".type name, @function" (x86) or ".type name, %function" (Arm)
+const TYPE_DIRECTIVE = /^\.type\s+([^,\s]+)\s*,\s*[@%]function/;
+const SIZE_DIRECTIVE = /^\.size\s+([^,\s]+)\s*,/;
+const LABEL = /^([\w.$@]+|"[^"]+"):$/;
+const LOCAL_LABEL = /\.L[\w.$]+/g;
+// Directives through which data such as jump tables refers to labels
+const DATA_DIRECTIVE = /^\.(?:long|quad|word|xword|4byte|8byte)\s/;
+// Comments at the end of an instruction: "# kill: ..." (x86), "// ..." (Arm)
+const TRAILING_COMMENT = /\s+(?:#|\/\/)(?:\s.*)?$/;
+
+// Packed SIMD arithmetic: SSE/AVX floating point and integer forms, and
+// Arm NEON or SVE operands with several lanes
+const VECTOR_MNEMONIC =
+  /^v?(?:(?:add|sub|mul|div|sqrt|max|min|hadd|dp|rcp|rsqrt|round|fn?m(?:add|sub)\d*)p[sdh]|p(?:add|sub|mul|madd|max|min|avg|sad|abs|sll|srl|sra|cmp|shuf|and|or|xor)[a-z0-9]*)$/;
+const VECTOR_OPERAND = /\b(?:v\d+\.(?:2|4|8|16)[bhsd]|z\d+\.[bhsd])\b/;
+const X86_VECTOR_REGISTER = /%[xyz]mm\d+/;
+
+/**
+ * Whether an instruction operates on several values at once
+ * @param {string} text - Instruction text
+ * @returns {boolean} True for packed SIMD instructions
+ */
+const isVectorInstruction = (text: string): boolean => {
+  const space = text.indexOf(" ");
+  const mnemonic = space === -1 ? text : text.slice(0, space);
+  if (VECTOR_MNEMONIC.test(mnemonic)) {
+    // "pxor %xmm0, %xmm0" also zeroes scalar registers, but packed integer
+    // forms never appear outside vector registers
+    return !/^v?p/.test(mnemonic) || X86_VECTOR_REGISTER.test(text);
+  }
+  return VECTOR_OPERAND.test(text);
+};
+
+/**
+ * Parse an assembly listing built with debug information
+ * Directives, comments, non-code sections and unreferenced labels are
+ * dropped; .loc directives attribute each instruction to a source line
+ * @param {string} listing - Assembly listing
+ * @param {string} sourceName - Name of the source file as passed to the compiler
+ * @returns {StructuredAssembly} Functions and their source line ranges
+ */
+export const parseAssembly = (
+  listing: string,
+  sourceName: string
+): StructuredAssembly => {
+  const sourceFiles = new Set<number>();
+  const functionSymbols = new Set<string>();
+  const referenced = new Set<string>();
+  const functions: AsmFunction[] = [];
+
+  let current: AsmFunction | null = null;
+  let line: number | undefined;
+  let inText = true;
+  let previousInText = true;
+  let inDebug = false;
+
+  const noteReferences = (text: string) => {
+    for (const label of text.match(LOCAL_LABEL) || []) {
+      referenced.add(label);
+    }
+  };
+
+  for (const raw of listing.split("\n")) {
+    const text = raw.trim();
+    if (!text || text.startsWith("#") || text.startsWith("//")) {
+      continue;
+    }
+
+    if (text.startsWith(".")) {
+      const label = text.match(LABEL);
+      if (label) {
+        if (current && inText) {
+          current.instructions.push({ text, label: true });
+        }
+        continue;
+      }
+
+      let match: RegExpMatchArray | null;
+      if ((match = text.match(LOC_DIRECTIVE))) {
+        const number = parseInt(match[2], 10);
+        line =
+          sourceFiles.has(parseInt(match[1], 10)) && number > 0
+            ? number
+            : undefined;
+      } else if ((match = text.match(FILE_DIRECTIVE))) {
+        const name = match[3] ?? match[2];
+        if (name === sourceName || name.endsWith(`/${sourceName}`)) {
+          sourceFiles.add(parseInt(match[1], 10));
+        }
+      } else if ((match = text.match(TYPE_DIRECTIVE))) {
+        functionSymbols.add(match[1]);
+      } else if ((match = text.match(SIZE_DIRECTIVE))) {
+        if (current && current.symbol === match[1]) {
+          current = null;
+        }
+      } else if (/^\.(?:text|section|data|bss|previous)\b/.test(text)) {
+        const wasInText = inText;
+        if (text.startsWith(".previous")) {
+          inText = previousInText;
+        } else {
+          const name = text.startsWith(".section")
+            ? text.slice(8).trim().split(/[\s,]/)[0]
+            : text;
+          inText = name.startsWith(".text");
+          inDebug = name.startsWith(".debug");
+        }
+        previousInText = wasInText;
+      } else if (!inDebug && DATA_DIRECTIVE.test(text)) {
+        noteReferences(text);
+      }
+      continue;
+    }
+
+    const label = text.match(LABEL);
+    if (label) {
+      if (inText && functionSymbols.has(label[1])) {
+        current = {
+          name: label[1],
+          symbol: label[1],
+          instructions: [],
+          instructionCount: 0,
+          vectorCount: 0,
+        };
+        functions.push(current);
+        line = undefined;
+      } else if (current && inText) {
+        current.instructions.push({ text, label: true });
+      }
+      continue;
+    }
+
+    if (current && inText) {
+      const instruction = text
+        .replace(TRAILING_COMMENT, "")
+        .replace(/\s+/g, " ");
+      noteReferences(instruction);
+      current.instructions.push(
+        line === undefined ? { text: instruction } : { text: instruction, line }
+      );
+    }
+  }
+
+  const lineMap: AsmLineRange[] = [];
+  functions.forEach((fn, index) => {
+    // Labels only matter where something jumps to them
+    fn.instructions = fn.instructions.filter(
+      (instruction) =>
+        !instruction.label ||
+        !instruction.text.startsWith(".L") ||
+        referenced.has(instruction.text.slice(0, -1))
+    );
+
+    let open: AsmLineRange | null = null;
+    fn.instructions.forEach((instruction, row) => {
+      if (instruction.label) {
+        return;
+      }
+      fn.instructionCount++;
+      if (isVectorInstruction(instruction.text)) {
+        fn.vectorCount++;
+      }
+
+      if (instruction.line === undefined) {
+        open = null;
+      } else if (open && open.line === instruction.line) {
+        open.end = row + 1;
+      } else {
+        open = {
+          line: instruction.line,
+          function: index,
+          start: row,
+          end: row + 1,
+        };
+        lineMap.push(open);
+      }
+    });
+  });
+
+  return { functions, lineMap };
+};
+
+/**
+ * Comparison key of a row; local label numbers differ between builds
+ * @private
+ */
+const rowKey = (instruction: AsmInstruction): string =>
+  instruction.text.replace(LOCAL_LABEL, ".L");
+
+/**
+ * Align the rows of two versions of a function
+ * Rows are matched by longest common subsequence; unmatched rows between two
+ * matches are paired up as changed rows
+ * @private
+ */
+const alignRows = (
+  left: AsmInstruction[],
+  right: AsmInstruction[]
+): { rows: AsmDiffRow[]; aligned: boolean } => {
+  const n = left.length;
+  const m = right.length;
+  const a = left.map(rowKey);
+  const b = right.map(rowKey);
+
+  if ((n + 1) * (m + 1) > MAX_ALIGN_CELLS) {
+    const rows: AsmDiffRow[] = [];
+    for (let i = 0; i < Math.max(n, m); i++) {
+      if (i >= n) {
+        rows.push({ kind: "right", right: right[i] });
+      } else if (i >= m) {
+        rows.push({ kind: "left", left: left[i] });
+      } else {
+        rows.push({
+          kind: a[i] === b[i] ? "same" : "changed",
+          left: left[i],
+          right: right[i],
+        });
+      }
+    }
+    return { rows, aligned: false };
+  }
+
+  // common[i * (m + 1) + j] is the common subsequence length of the suffixes
+  // starting at i and j; it never exceeds min(n, m), which fits 16 bits here
+  const width = m + 1;
+  const common = new Uint16Array((n + 1) * width);
+  for (let i = n - 1; i >= 0; i--) {
+    for (let j = m - 1; j >= 0; j--) {
+      common[i * width + j] =
+        a[i] === b[j]
+          ? common[(i + 1) * width + j + 1] + 1
+          : Math.max(common[(i + 1) * width + j], common[i * width + j + 1]);
+    }
+  }
+
+  const rows: AsmDiffRow[] = [];
+  let removed: AsmInstruction[] = [];
+  let added: AsmInstruction[] = [];
+  const flush = () => {
+    for (let k = 0; k < Math.max(removed.length, added.length); k++) {
+      if (k < removed.length && k < added.length) {
+        rows.push({ kind: "changed", left: removed[k], right: added[k] });
+      } else if (k < removed.length) {
+        rows.push({ kind: "left", left: removed[k] });
+      } else {
+        rows.push({ kind: "right", right: added[k] });
+      }
+    }
+    removed = [];
+    added = [];
+  };
+
+  let i = 0;
+  let j = 0;
+  while (i < n || j < m) {
+    if (i < n && j < m && a[i] === b[j]) {
+      flush();
+      rows.push({ kind: "same", left: left[i++], right: right[j++] });
+    } else if (
+      j >= m ||
+      (i < n && common[(i + 1) * width + j] >= common[i * width + j + 1])
+    ) {
+      removed.push(left[i++]);
+    } else {
+      added.push(right[j++]);
+    }
+  }
+  flush();
+
+  return { rows, aligned: true };
+};
+
+/**
+ * Compare the functions of two listings of the same source
+ * Functions are matched by symbol; those of the left listing come first, in
+ * its order, followed by functions only the right listing has
+ * @param {StructuredAssembly} left - First listing
+ * @param {StructuredAssembly} right - Second listing
+ * @returns {AsmFunctionDiff[]} Aligned rows per function
+ */
+export const diffAssembly = (
+  left: StructuredAssembly,
+  right: StructuredAssembly
+): AsmFunctionDiff[] => {
+  const summary = (fn?: AsmFunction) =>
+    fn
+      ? { instructionCount: fn.instructionCount, vectorCount: fn.vectorCount }
+      : null;
+  const rightBySymbol = new Map(right.functions.map((fn) => [fn.symbol, fn]));
+  const leftSymbols = new Set(left.functions.map((fn) => fn.symbol));
+
+  const pairs: [AsmFunction | undefined, AsmFunction | undefined][] = [
+    ...left.functions.map(
+      (fn): [AsmFunction, AsmFunction | undefined] => [
+        fn,
+        rightBySymbol.get(fn.symbol),
+      ]
+    ),
+    ...right.functions
+      .filter((fn) => !leftSymbols.has(fn.symbol))
+      .map((fn): [undefined, AsmFunction] => [undefined, fn]),
+  ];
+
+  return pairs.map(([before, after]) => ({
+    name: (before || after)!.name,
+    left: summary(before),
+    right: summary(after),
+    ...alignRows(before?.instructions || [], after?.instructions || []),
+  }));
+};
@@ -0,0 +1,493 @@
+/**
+ * Benchmark Service
+ * Runs a compiled program repeatedly on a CPU of its own and reports the wall
+ * time distribution, plus hardware counters where perf is usable
+ * Benchmark CPUs form a cluster-wide slot pool, so two benchmarks never share
+ * a core
+ */
+import * as crypto from "crypto";
+import * as fs from "fs-extra";
+import * as path from "path";
+import os from "os";
+import { spawn, ChildProcess } from "child_process";
+import {
+  BenchmarkCounters,
+  BenchmarkDistribution,
+  BenchmarkOptions,
+  BenchmarkResult,
+  BenchmarkSection,
+  BenchmarkTiming,
+  BenchmarkVariant,
+  CompileScheduleOptions,
+  ProgramRun,
+} from "../types";
+import { CompileScheduler, createSlotPool } from "./compileScheduler";
+import { executionLimiter, LimitedExecution } from "./executionLimits";
+import { isToolUsable } from "./toolchain";
+
+// Runs used to measure the cost of starting a program
+const OVERHEAD_RUNS = 5;
+// perf stat repetitions; counters vary far less than wall times
+const COUNTER_RUNS = 3;
+// stderr kept to explain a failed run
+const STDERR_LIMIT = 4096;
+// stdout scanned for self-timed sections; the rest is discarded
+const STDOUT_LIMIT = 64 * 1024;
+// Sections reported per run beyond this are ignored
+const MAX_SECTIONS = 32;
+
+// "BENCH <name> <nanoseconds>", printed by the program for each section
+const SECTION_LINE = /^BENCH\s+(\S+)\s+(\d+(?:\.\d+)?)\s*$/;
+
+const PERF_EVENTS: Record<string, keyof BenchmarkCounters> = {
+  cycles: "cycles",
+  instructions: "instructions",
+  "cache-misses": "cacheMisses",
+  "branch-misses": "branchMisses",
+};
+
+/**
+ * Parse a comma separated CPU list such as "2,3" or "4-7"
+ * @param {string} list - CPU list
+ * @returns {number[]} CPU numbers
+ */
+const parseCpuList = (list: string): number[] =>
+  list
+    .split(",")
+    .flatMap((part) => {
+      const [from, to] = part.split("-").map((n) => parseInt(n, 10));
+      if (isNaN(from)) {
+        return [];
+      }
+      const cpus: number[] = [];
+      for (let cpu = from; cpu <= (isNaN(to) ? from : to); cpu++) {
+        cpus.push(cpu);
+      }
+      return cpus;
+    })
+    .filter((cpu, index, cpus) => cpus.indexOf(cpu) === index);
+
+// By default only the last CPU is used, away from the event loop on CPU 0
+const BENCHMARK_CPUS = parseCpuList(
+  process.env.CINCOUT_BENCH_CPUS || String(os.cpus().length - 1)
+);
+
+/**
+ * Value at a percentile of sorted samples (nearest rank)
+ * @private
+ */
+const percentile = (sorted: number[], p: number): number =>
+  sorted[Math.min(sorted.length - 1, Math.ceil(p * sorted.length) - 1)];
+
+const round = (ms: number): number => Math.round(ms * 1000) / 1000;
+
+/**
+ * Summarize timed samples
+ * @param {number[]} samples - Times in milliseconds
+ * @returns {BenchmarkDistribution} Distribution
+ */
+const distribution = (samples: number[]): BenchmarkDistribution => {
+  const sorted = [...samples].sort((a, b) => a - b);
+  const mean = sorted.reduce((sum, ms) => sum + ms, 0) / sorted.length;
+  const variance =
+    sorted.reduce((sum, ms) => sum + (ms - mean) ** 2, 0) / sorted.length;
+
+  return {
+    min: round(sorted[0]),
+    median: round(percentile(sorted, 0.5)),
+    p95: round(percentile(sorted, 0.95)),
+    mean: round(mean),
+    stddev: round(Math.sqrt(variance)),
+  };
+};
+
+/**
+ * Summarize timed runs
+ * @param {number[]} samples - Wall times in milliseconds
+ * @param {number} launchOverhead - Time to start an empty program
+ * @returns {BenchmarkTiming} Distribution
+ */
+const summarize = (
+  samples: number[],
+  launchOverhead: number
+): BenchmarkTiming => ({
+  ...distribution(samples),
+  launchOverhead: round(launchOverhead),
+});
+
+/**
+ * Parse the sections a run reported on stdout
+ * A section reported several times in one run counts with its total
+ * @param {string} stdout - Beginning of the program's output
+ * @returns {Map<string, number>} Milliseconds by section name
+ */
+export const parseSections = (stdout: string): Map<string, number> => {
+  const sections = new Map<string, number>();
+  for (const line of stdout.split("\n")) {
+    const match = line.match(SECTION_LINE);
+    if (match && (sections.has(match[1]) || sections.size < MAX_SECTIONS)) {
+      sections.set(
+        match[1],
+        (sections.get(match[1]) || 0) + parseFloat(match[2]) / 1e6
+      );
+    }
+  }
+  return sections;
+};
+
+/**
+ * Outcome of a single run
+ */
+interface RunOutcome {
+  ms: number;
+  exitCode: number | null;
+  signal: string | null;
+  stdout: string;
+  stderr: string;
+  stdoutBytes: number; // Everything written, not only what was kept
+}
+
+/**
+ * Benchmark Service Implementation
+ */
+export class BenchmarkService {
+  private readonly cpus: number[];
+  private readonly scheduler = new CompileScheduler("bench");
+
+  /**
+   * Create a new BenchmarkService
+   * @param {number[]} cpus - CPUs benchmarks are pinned to, one per slot
+   */
+  constructor(cpus: number[]) {
+    this.cpus = cpus;
+  }
+
+  /**
+   * Benchmark a compiled program
+   * Waits for a free benchmark CPU first
+   * @param {string} binary - Program to run
+   * @param {string} workDir - Working directory (the sandbox)
+   * @param {BenchmarkVariant} variant - How the program was compiled
+   * @param {BenchmarkOptions} options - Iterations, warmup and input
+   * @param {string} sessionId - Session ID, used to name the cgroup
+   * @param {object} hooks - Slot scheduling, progress callback and abort signal
+   * @returns {Promise<BenchmarkResult>} Timings and counters
+   */
+  run(
+    binary: string,
+    workDir: string,
+    variant: BenchmarkVariant,
+    options: BenchmarkOptions,
+    sessionId: string,
+    hooks: {
+      schedule?: CompileScheduleOptions;
+      onProgress?: (completed: number, total: number) => void;
+      signal?: AbortSignal;
+    } = {}
+  ): Promise<BenchmarkResult> {
+    return this.scheduler.run(hooks.schedule, async (slot) => {
+      const { cpu, pin } = await this.pinToSlot(slot);
+
+      const execution = await executionLimiter.create("benchmark", sessionId);
+      let current: ChildProcess | null = null;
+      execution.start(() => current?.kill("SIGKILL"));
+      const abort = () => current?.kill("SIGKILL");
+      hooks.signal?.addEventListener("abort", abort);
+
+      const runOnce = (command: string): Promise<RunOutcome> =>
+        this.spawnRun(pin + command, workDir, execution, options.input, {
+          onSpawn: (child) => {
+            current = child;
+          },
+        });
+
+      const samples: number[] = [];
+      const sectionSamples = new Map<string, number[]>();
+      let error: string | undefined;
+      let counters: BenchmarkCounters | null = null;
+      const total = options.warmup + options.iterations;
+
+      try {
+        // Cost of the wrapper shell, pinning and process start-up
+        const overhead: number[] = [];
+        for (let i = 0; i < OVERHEAD_RUNS; i++) {
+          overhead.push((await runOnce("true")).ms);
+        }
+        overhead.sort((a, b) => a - b);
+
+        for (let i = 0; i < total && !hooks.signal?.aborted; i++) {
+          const outcome = await runOnce(`"${binary}"`);
+          if (outcome.exitCode !== 0) {
+            error = this.describeFailure(outcome);
+            break;
+          }
+          if (i >= options.warmup) {
+            samples.push(outcome.ms);
+            parseSections(outcome.stdout).forEach((ms, name) => {
+              if (!sectionSamples.has(name)) {
+                sectionSamples.set(name, []);
+              }
+              sectionSamples.get(name)!.push(ms);
+            });
+          }
+          hooks.onProgress?.(i + 1, total);
+        }
+
+        if (!error && !hooks.signal?.aborted) {
+          counters = await this.countEvents(binary, workDir, runOnce);
+        }
+
+        return {
+          variant,
+          iterations: samples.length,
+          timing:
+            samples.length > 0
+              ? summarize(samples, percentile(overhead, 0.5))
+              : null,
+          counters,
+          sections: Array.from(
+            sectionSamples,
+            ([name, times]): BenchmarkSection => ({
+              name,
+              samples: times.length,
+              ...distribution(times),
+            })
+          ),
+          cpu,
+          error: error || (hooks.signal?.aborted ? "Cancelled" : undefined),
+          stats: await execution.finish(),
+        };
+      } finally {
+        hooks.signal?.removeEventListener("abort", abort);
+        await execution.finish();
+      }
+    });
+  }
+
+  /**
+   * Run a compiled program once on a benchmark CPU
+   * Matrix runs time one run per build; stdout is hashed so the outputs of
+   * builds can be compared without sending them
+   * @param {string} binary - Program to run
+   * @param {string} workDir - Working directory (the sandbox)
+   * @param {string} input - Standard input
+   * @param {string} sessionId - Session ID, used to name the cgroup
+   * @param {object} hooks - Slot scheduling and abort signal
+   * @returns {Promise<ProgramRun>} Wall time, exit status and output hash
+   */
+  measure(
+    binary: string,
+    workDir: string,
+    input: string,
+    sessionId: string,
+    hooks: { schedule?: CompileScheduleOptions; signal?: AbortSignal } = {}
+  ): Promise<ProgramRun> {
+    return this.scheduler.run(hooks.schedule, async (slot) => {
+      // Cancelled while waiting for the slot
+      if (hooks.signal?.aborted) {
+        return {
+          ms: 0,
+          exitCode: null,
+          signal: null,
+          outputHash: "",
+          outputBytes: 0,
+          error: "Cancelled",
+        };
+      }
+      const { pin } = await this.pinToSlot(slot);
+
+      const execution = await executionLimiter.create("benchmark", sessionId);
+      let current: ChildProcess | null = null;
+      execution.start(() => current?.kill("SIGKILL"));
+      const abort = () => current?.kill("SIGKILL");
+      hooks.signal?.addEventListener("abort", abort);
+
+      try {
+        const hash = crypto.createHash("sha256");
+        const outcome = await this.spawnRun(
+          `${pin}"${binary}"`,
+          workDir,
+          execution,
+          input,
+          {
+            onSpawn: (child) => {
+              current = child;
+            },
+            onStdout: (chunk) => hash.update(chunk),
+          }
+        );
+        const stats = await execution.finish();
+
+        return {
+          ms: round(outcome.ms),
+          exitCode: outcome.exitCode,
+          signal: outcome.signal,
+          outputHash: hash.digest("hex").slice(0, 16),
+          outputBytes: outcome.stdoutBytes,
+          error: hooks.signal?.aborted
+            ? "Cancelled"
+            : stats.killReason
+            ? `Program was stopped (${stats.killReason} limit)`
+            : outcome.exitCode !== 0
+            ? this.describeFailure(outcome)
+            : undefined,
+        };
+      } finally {
+        hooks.signal?.removeEventListener("abort", abort);
+        await execution.finish();
+      }
+    });
+  }
+
+  /**
+   * Get the CPU of a benchmark slot and the prefix pinning a command to it
+   * @private
+   */
+  private async pinToSlot(
+    slot: number
+  ): Promise<{ cpu: number | null; pin: string }> {
+    const cpu = this.cpus.length > 0 ? this.cpus[slot] : undefined;
+    const pinned =
+      cpu !== undefined &&
+      (await isToolUsable("taskset", ["-c", String(cpu), "true"]));
+    return pinned
+      ? { cpu: cpu!, pin: `taskset -c ${cpu} ` }
+      : { cpu: null, pin: "" };
+  }
+
+  /**
+   * Run a command once under limits and time it
+   * Only the beginning of stdout and stderr is kept; onStdout sees all of it
+   * @private
+   */
+  private spawnRun(
+    command: string,
+    workDir: string,
+    execution: LimitedExecution,
+    input: string,
+    hooks: {
+      onSpawn: (child: ChildProcess | null) => void;
+      onStdout?: (chunk: Buffer) => void;
+    }
+  ): Promise<RunOutcome> {
+    return new Promise((resolve, reject) => {
+      let stdout = "";
+      let stderr = "";
+      let stdoutBytes = 0;
+      const started = process.hrtime.bigint();
+      const child = spawn("/bin/sh", ["-c", execution.wrapCommand(command)], {
+        cwd: workDir,
+        env: execution.getEnv(workDir),
+        stdio: ["pipe", "pipe", "pipe"],
+      });
+      hooks.onSpawn(child);
+
+      child.stdout?.on("data", (chunk: Buffer) => {
+        stdoutBytes += chunk.length;
+        hooks.onStdout?.(chunk);
+        if (stdout.length < STDOUT_LIMIT) {
+          stdout += chunk
+            .toString("utf8")
+            .slice(0, STDOUT_LIMIT - stdout.length);
+        }
+      });
+      child.stderr?.on("data", (chunk: Buffer) => {
+        if (stderr.length < STDERR_LIMIT) {
+          stderr += chunk
+            .toString("utf8")
+            .slice(0, STDERR_LIMIT - stderr.length);
+        }
+      });
+      child.stdin?.on("error", () => {}); // Program exited before reading
+      child.stdin?.end(input);
+      child.on("error", reject);
+      // Timed at exit; output may still be in the pipes until close
+      let ms = 0;
+      child.on("exit", () => {
+        ms = Number(process.hrtime.bigint() - started) / 1e6;
+      });
+      child.on("close", (exitCode, signal) => {
+        hooks.onSpawn(null);
+        resolve({ ms, exitCode, signal, stdout, stderr, stdoutBytes });
+      });
+    });
+  }
+
+  /**
+   * Count hardware events with perf stat
+   * @returns {Promise<BenchmarkCounters | null>} Counters, or null without perf
+   * @private
+   */
+  private async countEvents(
+    binary: string,
+    workDir: string,
+    runOnce: (command: string) => Promise<RunOutcome>
+  ): Promise<BenchmarkCounters | null> {
+    const events = Object.keys(PERF_EVENTS).join(",");
+    const usable = await isToolUsable("perf", [
+      "stat",
+      "-x",
+      ",",
+      "-e",
+      events,
+      "true",
+    ]);
+    if (!usable) {
+      return null;
+    }
+
+    const output = path.join(workDir, "perf-stat.csv");
+    const outcome = await runOnce(
+      `perf stat -x , -r ${COUNTER_RUNS} -e ${events} -o "${output}" "${binary}"`
+    );
+    if (outcome.exitCode !== 0) {
+      return null;
+    }
+
+    const counters: BenchmarkCounters = {
+      cycles: null,
+      instructions: null,
+      ipc: null,
+      cacheMisses: null,
+      branchMisses: null,
+    };
+
+    // "value,unit,event,..."; the event may carry a ":u" modifier
+    const csv = await fs.readFile(output, "utf8").catch(() => "");
+    for (const line of csv.split("\n")) {
+      const [value, , event] = line.split(",");
+      const key = event && PERF_EVENTS[event.replace(/:\w+$/, "")];
+      const count = parseFloat(value);
+      if (key && Number.isFinite(count)) {
+        counters[key] = count;
+      }
+    }
+
+    if (counters.cycles && counters.instructions !== null) {
+      counters.ipc =
+        Math.round((counters.instructions / counters.cycles) * 100) / 100;
+    }
+    return counters;
+  }
+
+  /**
+   * Explain why a run failed
+   * @private
+   */
+  private describeFailure(outcome: RunOutcome): string {
+    const reason = outcome.signal
+      ? `was killed by ${outcome.signal}`
+      : `exited with code ${outcome.exitCode}`;
+    const detail = outcome.stderr.trim().split("\n")[0];
+    return `Program ${reason}${detail ? `: ${detail}` : ""}`;
+  }
+}
+
+// One slot per benchmark CPU, shared by all workers
+export const benchmarkSlotPool = createSlotPool(
+  "bench",
+  BENCHMARK_CPUS.length
+);
+
+// Create singleton instance
+export const benchmarkService = new BenchmarkService(BENCHMARK_CPUS);
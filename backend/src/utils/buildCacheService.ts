@@ -0,0 +1,259 @@
+/**
+ * Build Cache Service
+ * Content-addressed on-disk store for compiled artifacts (program.out, program.s)
+ * The store lives on the filesystem so it is shared by every cluster worker
+ * A read-only prebuilt store, filled at image build time, is consulted after it
+ */
+import * as fs from "fs-extra";
+import * as path from "path";
+import * as os from "os";
+import * as crypto from "crypto";
+import { BuildCacheKeyInput, BuildCacheStats } from "../types";
+import { metrics } from "./metrics";
+
+/**
+ * Build Cache Service Implementation
+ * Stores each build under a directory named after the hash of its inputs and
+ * evicts the least recently used entries once the store exceeds its size budget
+ */
+export class BuildCacheService {
+  private readonly cacheDir: string;
+  private readonly maxBytes: number;
+  private readonly prebuiltDir: string | null;
+  private hits = 0;
+  private prebuiltHits = 0;
+  private misses = 0;
+  private stores = 0;
+  private evictions = 0;
+  private evicting: Promise<void> | null = null;
+
+  /**
+   * Create a new BuildCacheService
+   * @param {string} cacheDir - Directory holding the cache entries
+   * @param {number} maxSizeMB - Maximum total size of the store in megabytes
+   * @param {string | null} prebuiltDir - Read-only store of prebuilt entries
+   */
+  constructor(
+    cacheDir: string,
+    maxSizeMB: number = 512,
+    prebuiltDir: string | null = null
+  ) {
+    this.cacheDir = cacheDir;
+    this.maxBytes = maxSizeMB * 1024 * 1024;
+    this.prebuiltDir = prebuiltDir;
+  }
+
+  /**
+   * Compute the cache key for a build
+   * @param {BuildCacheKeyInput} input - Everything that influences the produced artifacts
+   * @returns {string} Hex encoded SHA-256 key
+   */
+  computeKey(input: BuildCacheKeyInput): string {
+    return crypto
+      .createHash("sha256")
+      .update(
+        JSON.stringify([
+          input.lang,
+          input.compiler,
+          input.fingerprint,
+          input.standard,
+          input.optimization,
+          [...input.flags].sort(),
+          input.pch,
+        ])
+      )
+      .update("\0")
+      .update(input.code)
+      .digest("hex");
+  }
+
+  /**
+   * Copy cached artifacts to their destination paths
+   * Keys are tried in order; the first entry holding every artifact is used
+   * @param {string[]} keys - Cache keys, preferred first
+   * @param {Record<string, string>} artifacts - Map of artifact name to destination path
+   * @returns {Promise<boolean>} True when every requested artifact was restored
+   */
+  async restore(
+    keys: string[],
+    artifacts: Record<string, string>
+  ): Promise<boolean> {
+    for (const key of keys) {
+      const entryDir = path.join(this.cacheDir, key);
+
+      if (await this.copyEntry(entryDir, artifacts)) {
+        // Touch the entry so LRU eviction sees it as recently used
+        const now = new Date();
+        await fs.utimes(entryDir, now, now).catch(() => {});
+
+        this.hits++;
+        return true;
+      }
+
+      if (
+        this.prebuiltDir &&
+        (await this.copyEntry(path.join(this.prebuiltDir, key), artifacts))
+      ) {
+        this.hits++;
+        this.prebuiltHits++;
+        return true;
+      }
+    }
+
+    this.misses++;
+    return false;
+  }
+
+  /**
+   * Store artifacts in the cache
+   * Each file is written under a temporary name and renamed into place so
+   * concurrent workers never observe a partially written artifact
+   * @param {string} key - Cache key
+   * @param {Record<string, string>} artifacts - Map of artifact name to source path
+   */
+  async store(key: string, artifacts: Record<string, string>): Promise<void> {
+    const entryDir = path.join(this.cacheDir, key);
+
+    try {
+      await fs.ensureDir(entryDir);
+
+      for (const [name, source] of Object.entries(artifacts)) {
+        if (!(await fs.pathExists(source))) {
+          continue;
+        }
+
+        const target = path.join(entryDir, name);
+        const staging = `${target}.tmp-${process.pid}-${crypto
+          .randomBytes(4)
+          .toString("hex")}`;
+
+        await fs.copy(source, staging);
+        await fs.rename(staging, target);
+      }
+
+      this.stores++;
+      this.scheduleEviction();
+    } catch (error) {
+      console.error(`Error storing build cache entry ${key}:`, error);
+    }
+  }
+
+  /**
+   * Get cache statistics for this worker
+   * @returns {BuildCacheStats} Hit, miss, store and eviction counters
+   */
+  getStats(): BuildCacheStats {
+    const lookups = this.hits + this.misses;
+    return {
+      hits: this.hits,
+      prebuiltHits: this.prebuiltHits,
+      misses: this.misses,
+      stores: this.stores,
+      evictions: this.evictions,
+      hitRate: lookups > 0 ? this.hits / lookups : 0,
+    };
+  }
+
+  /**
+   * Copy the artifacts of an entry to their destination paths
+   * @returns {Promise<boolean>} True when every requested artifact was copied
+   * @private
+   */
+  private async copyEntry(
+    entryDir: string,
+    artifacts: Record<string, string>
+  ): Promise<boolean> {
+    try {
+      for (const [name, destination] of Object.entries(artifacts)) {
+        await fs.copy(path.join(entryDir, name), destination, {
+          overwrite: true,
+          preserveTimestamps: false,
+        });
+      }
+      return true;
+    } catch {
+      return false;
+    }
+  }
+
+  /**
+   * Run an eviction pass in the background unless one is already running
+   * @private
+   */
+  private scheduleEviction(): void {
+    if (this.evicting) {
+      return;
+    }
+
+    this.evicting = this.evictLeastRecentlyUsed()
+      .catch((error) => {
+        console.error("Error evicting build cache entries:", error);
+      })
+      .finally(() => {
+        this.evicting = null;
+      });
+  }
+
+  /**
+   * Remove least recently used entries until the store is below 90% of its budget
+   * @private
+   */
+  private async evictLeastRecentlyUsed(): Promise<void> {
+    const names = await fs.readdir(this.cacheDir);
+    const entries: { dir: string; size: number; lastUsed: number }[] = [];
+    let totalSize = 0;
+
+    for (const name of names) {
+      const dir = path.join(this.cacheDir, name);
+      try {
+        const dirStat = await fs.stat(dir);
+        if (!dirStat.isDirectory()) {
+          continue;
+        }
+
+        let size = 0;
+        for (const file of await fs.readdir(dir)) {
+          size += (await fs.stat(path.join(dir, file))).size;
+        }
+
+        entries.push({ dir, size, lastUsed: dirStat.mtimeMs });
+        totalSize += size;
+      } catch {
+        // Entry removed concurrently by another worker
+      }
+    }
+
+    if (totalSize <= this.maxBytes) {
+      return;
+    }
+
+    const target = this.maxBytes * 0.9;
+    entries.sort((a, b) => a.lastUsed - b.lastUsed);
+
+    for (const entry of entries) {
+      if (totalSize <= target) {
+        break;
+      }
+
+      await fs.remove(entry.dir);
+      totalSize -= entry.size;
+      this.evictions++;
+    }
+  }
+}
+
+// Create singleton instance
+export const buildCacheService = new BuildCacheService(
+  process.env.CINCOUT_BUILD_CACHE_DIR ||
+    path.join(os.tmpdir(), "CinCout-build-cache"),
+  parseInt(process.env.CINCOUT_BUILD_CACHE_MB || "512", 10),
+  process.env.CINCOUT_PREBUILT_DIR || null
+);
+
+// Prebuilt hits count as build cache hits; the prebuilt store is also
+// reported alone, as it is only looked up after a local miss
+metrics.trackCache("build", () => buildCacheService.getStats());
+metrics.trackCache("prebuilt", () => {
+  const { prebuiltHits, misses } = buildCacheService.getStats();
+  return { hits: prebuiltHits, misses };
+});
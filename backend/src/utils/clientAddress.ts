@@ -0,0 +1,70 @@
+/**
+ * Client Address
+ * Identifies the client of an HTTP request or Socket.IO connection by an
+ * address it cannot choose, for rate limits and compile scheduling. On Fly
+ * the edge proxy sets Fly-Client-IP; elsewhere only the entries that the
+ * trusted proxies in front of the server appended to X-Forwarded-For count
+ */
+import { IncomingHttpHeaders } from "http";
+import { Context } from "koa";
+import { Socket } from "socket.io";
+
+// Fly sets FLY_APP_NAME on its machines; anywhere else a client could send
+// Fly-Client-IP itself
+const ON_FLY = !!process.env.FLY_APP_NAME;
+
+// Proxies between the clients and the server, e.g. 1 behind a single load
+// balancer; 0 trusts no forwarding header
+export const TRUSTED_PROXY_HOPS = Math.max(
+  0,
+  parseInt(process.env.CINCOUT_TRUSTED_PROXIES || "0", 10) || 0
+);
+
+/**
+ * Resolve the client address from request headers
+ * Each trusted proxy appends the address it received the request from, so
+ * the client is that many entries from the right of the chain ending in the
+ * peer; entries further left were sent by the client
+ * @param {IncomingHttpHeaders} headers - Request headers
+ * @param {string} peerAddress - Address of the connection's peer
+ * @returns {string} Client address
+ */
+export const resolveClientAddress = (
+  headers: IncomingHttpHeaders,
+  peerAddress: string
+): string => {
+  const flyClientIp = headers["fly-client-ip"];
+  if (ON_FLY && typeof flyClientIp === "string" && flyClientIp) {
+    return flyClientIp.trim();
+  }
+
+  if (TRUSTED_PROXY_HOPS === 0) {
+    return peerAddress;
+  }
+
+  const forwardedFor = headers["x-forwarded-for"];
+  const chain = [
+    ...String(forwardedFor || "")
+      .split(",")
+      .map((entry) => entry.trim())
+      .filter(Boolean),
+    peerAddress,
+  ];
+  return chain[Math.max(0, chain.length - 1 - TRUSTED_PROXY_HOPS)];
+};
+
+/**
+ * Get the client address of an HTTP request
+ * @param {Context} ctx - Koa context
+ * @returns {string} Client address
+ */
+export const getRequestClientAddress = (ctx: Context): string =>
+  resolveClientAddress(ctx.req.headers, ctx.req.socket.remoteAddress || "");
+
+/**
+ * Get the client address of a Socket.IO connection
+ * @param {Socket} socket - Socket.IO socket
+ * @returns {string} Client address
+ */
+export const getSocketClientAddress = (socket: Socket): string =>
+  resolveClientAddress(socket.handshake.headers, socket.handshake.address);
@@ -0,0 +1,143 @@
+/**
+ * Cluster IPC
+ * Channel-based messaging between cluster workers and the primary process
+ * Outside of a cluster (single process) messages are delivered locally
+ */
+import cluster, { Worker } from "cluster";
+import net from "net";
+
+/**
+ * Envelope for all CinCout IPC messages
+ */
+interface IpcEnvelope {
+  cincout: string; // Channel name
+  payload: any;
+}
+
+type PrimaryHandler = (payload: any, worker: Worker | null) => void;
+type WorkerListener = (payload: any, handle?: net.Socket) => void;
+
+/**
+ * Cluster IPC Implementation
+ */
+export class ClusterIpc {
+  private primaryHandlers = new Map<string, PrimaryHandler>();
+  private workerListeners = new Map<string, Set<WorkerListener>>();
+  private listening = false;
+
+  /**
+   * Whether this process talks to a primary over IPC
+   * @returns {boolean} True inside a cluster worker
+   */
+  isWorker(): boolean {
+    return cluster.isWorker && typeof process.send === "function";
+  }
+
+  /**
+   * Register a handler for messages sent by workers (primary side)
+   * @param {string} channel - Channel name
+   * @param {PrimaryHandler} handler - Receives the payload and the sending worker
+   */
+  handle(channel: string, handler: PrimaryHandler): void {
+    this.primaryHandlers.set(channel, handler);
+    this.ensureListening();
+  }
+
+  /**
+   * Send a message to the primary (worker side)
+   * @param {string} channel - Channel name
+   * @param {any} payload - Message payload
+   */
+  notify(channel: string, payload: any): void {
+    if (this.isWorker()) {
+      process.send!({ cincout: channel, payload } as IpcEnvelope);
+      return;
+    }
+
+    this.primaryHandlers.get(channel)?.(payload, null);
+  }
+
+  /**
+   * Send a message to a worker (primary side)
+   * @param {Worker | null} worker - Target worker, null for the local process
+   * @param {string} channel - Channel name
+   * @param {any} payload - Message payload
+   * @param {net.Socket} handle - Optional connection to hand over
+   */
+  sendToWorker(
+    worker: Worker | null,
+    channel: string,
+    payload: any,
+    handle?: net.Socket
+  ): void {
+    if (!worker) {
+      this.dispatchToListeners(channel, payload, handle);
+      return;
+    }
+
+    if (worker.isConnected()) {
+      worker.send({ cincout: channel, payload } as IpcEnvelope, handle);
+    } else {
+      handle?.destroy();
+    }
+  }
+
+  /**
+   * Subscribe to messages sent by the primary (worker side)
+   * @param {string} channel - Channel name
+   * @param {WorkerListener} listener - Receives the payload and any handle
+   */
+  on(channel: string, listener: WorkerListener): void {
+    if (!this.workerListeners.has(channel)) {
+      this.workerListeners.set(channel, new Set());
+    }
+    this.workerListeners.get(channel)?.add(listener);
+    this.ensureListening();
+  }
+
+  /**
+   * Attach the process level message listener once
+   * @private
+   */
+  private ensureListening(): void {
+    if (this.listening) {
+      return;
+    }
+    this.listening = true;
+
+    if (cluster.isPrimary) {
+      cluster.on("message", (worker: Worker, message: IpcEnvelope) => {
+        if (message && typeof message.cincout === "string") {
+          this.primaryHandlers.get(message.cincout)?.(message.payload, worker);
+        }
+      });
+    } else {
+      process.on("message", (message: IpcEnvelope, handle?: net.Socket) => {
+        if (message && typeof message.cincout === "string") {
+          this.dispatchToListeners(message.cincout, message.payload, handle);
+        }
+      });
+    }
+  }
+
+  /**
+   * Deliver a payload to local listeners
+   * @private
+   */
+  private dispatchToListeners(
+    channel: string,
+    payload: any,
+    handle?: net.Socket
+  ): void {
+    this.workerListeners.get(channel)?.forEach((listener) => {
+      try {
+        listener(payload, handle);
+      } catch (error) {
+        console.error(`Error in IPC listener for ${channel}:`, error);
+      }
+    });
+  }
+}
+
+// Create singleton instance
+export const clusterIpc = new ClusterIpc();
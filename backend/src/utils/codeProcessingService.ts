@@ -3,10 +3,10 @@
  * Centralizes all code processing operations in the application including
  * compilation, assembly generation, static analysis, formatting and debugging
  */
+import * as crypto from "crypto";
 import * as fs from "fs-extra";
 import * as path from "path";
-import * as tmp from "tmp";
-import { exec, ExecOptions } from "child_process";
+import { spawn } from "child_process";
 import {
   CompilationEnvironment,
   CompilationOptions,
@@ -16,26 +16,148 @@ import {
   AssemblyResult,
   LintCodeResult,
   FormatResult,
+  FormatLineRange,
   DebugSessionResult,
+  CompileError,
+  CancelledError,
+  CompilerDiagnostic,
+  StructuredAssembly,
+  OptimizationRemark,
+  WorkspaceCache,
+  WorkspaceFile,
 } from "../types";
+import { buildCacheService } from "./buildCacheService";
+import { pchService } from "./pchService";
+import { compileScheduler } from "./compileScheduler";
+import { sandboxPool } from "./sandboxPool";
+import {
+  getCompilerFingerprint,
+  isToolUsable,
+  OPTIMIZATION_LEVELS,
+  LANGUAGE_STANDARDS,
+  DEFAULT_STANDARDS,
+} from "./toolchain";
+import { getUnitLanguage, parseDepFile, validateWorkspace } from "./workspace";
+import {
+  DiagnosticStream,
+  renderDiagnostics,
+  hasCompileErrors,
+} from "./diagnostics";
+import { parseAssembly } from "./asmParser";
+import { parseClangRemarks, parseGccRemarks } from "./optRemarks";
+import { ResultCache } from "./resultCache";
+import { metrics } from "./metrics";
+import { traceOperation, traceStage } from "./tracing";
+
+/**
+ * Artifacts a build can produce
+ */
+type BuildArtifact = "binary" | "assembly";
+
+/**
+ * How a build artifact was produced
+ */
+interface BuildOutcome {
+  cached: boolean; // Served from the build cache
+  usedPch: boolean; // Compiled with a precompiled header
+  diagnostics: CompilerDiagnostic[]; // Warnings reported by the compiler
+}
+
+// Names of the artifacts inside an environment and a build cache entry
+const BINARY_ARTIFACT = "program.out";
+const ASSEMBLY_ARTIFACT = "program.s";
+// Optimization remarks; kept with the build they describe, if requested
+const REMARKS_ARTIFACT = "program.remarks";
+
+// Output limits; a template error avalanche is cut off well before this
+const DEFAULT_OUTPUT_LIMIT = 1024 * 1024;
+const COMPILER_OUTPUT_LIMIT = 256 * 1024;
+const MAX_COMPILER_ERRORS = 50;
+// Wall-clock limit of a compiler or tool run
+const TOOL_TIMEOUT_MS =
+  parseInt(process.env.CINCOUT_COMPILE_TIMEOUT_S || "30", 10) * 1000;
+
+// Tokens rewritten by formatOutput: file paths, HTML special characters,
+// severities and line:column locations
+const OUTPUT_TOKENS =
+  /[^:\s]+\.(?:cpp|c|h|hpp):|[&<>]|error:|warning:|(\d+):(\d+):/gi;
+
+// Instrumentation for the fast leak check mode
+const SANITIZER_FLAGS = [
+  "-g",
+  "-fsanitize=address,undefined",
+  "-fno-omit-frame-pointer",
+];
+
+// Profiling builds keep frame pointers for cheap stack walks and link at
+// fixed addresses, so sampled addresses map straight to source lines
+const PROFILE_FLAGS = ["-g", "-fno-omit-frame-pointer", "-no-pie"];
+
+// Structured listings need the .loc directives emitted with debug info
+const STRUCTURED_ASSEMBLY_FLAGS = ["-g"];
+
+// Formatting and lint results kept per worker
+const FORMAT_CACHE_ENTRIES = 200;
+const LINT_CACHE_ENTRIES = 200;
+
+const compileDuration = metrics.histogram(
+  "cincout_compile_duration_seconds",
+  "Time to produce an executable, by compiler, language and optimization"
+);
+
+// Lint requests arrive in bursts while typing; only the last one of a burst
+// from a client is analyzed
+const LINT_DEBOUNCE_MS = 150;
+
+// Intermediate files written by -save-temps
+const SAVED_TEMP_EXTENSIONS = ["i", "ii", "s", "o", "bc"];
+
+// Object and dependency files inside a workspace directory
+const OBJECT_DIR = "obj";
+// Faster linkers, used in this order if the compiler driver can run them
+const FAST_LINKERS = ["mold", "lld"];
 
 /**
  * Code Processing Service Implementation
  * Handles code compilation, assembly generation, memory checks, and code analysis
  */
 export class CodeProcessingService implements ICodeProcessingService {
+  // Builds currently running in this worker, keyed by build cache key
+  private inFlightBuilds = new Map<string, Promise<BuildOutcome>>();
+  private readonly formatResults = new ResultCache<string>(
+    FORMAT_CACHE_ENTRIES,
+    "format"
+  );
+  private readonly lintResults = new ResultCache<LintCodeResult>(
+    LINT_CACHE_ENTRIES,
+    "lint"
+  );
+  // Lint run in progress per client
+  private readonly lintRuns = new Map<
+    string,
+    {
+      key: string;
+      controller: AbortController;
+      result: Promise<LintCodeResult>;
+    }
+  >();
+
   // =====================================
   // ENVIRONMENT MANAGEMENT
   // =====================================
 
   /**
    * Creates a compilation environment with appropriate files
+   * The working directory comes from the sandbox pool; tmpDir.removeCallback
+   * returns it to the pool
    * @param {string} lang - Programming language ('c' or 'cpp')
-   * @returns {CompilationEnvironment} Object with file paths
+   * @returns {Promise<CompilationEnvironment>} Object with file paths
    */
-  createCompilationEnvironment(lang: string): CompilationEnvironment {
+  async createCompilationEnvironment(
+    lang: string
+  ): Promise<CompilationEnvironment> {
     try {
-      const tmpDir = tmp.dirSync({ prefix: "CinCout-", unsafeCleanup: true });
+      const tmpDir = await sandboxPool.acquire();
       const sourceExtension = lang === "cpp" ? "cpp" : "c";
       const sourceFile = path.join(tmpDir.name, `program.${sourceExtension}`);
       const outputFile = path.join(tmpDir.name, "program.out");
@@ -53,9 +175,9 @@ export class CodeProcessingService implements ICodeProcessingService {
    * @param {string} filePath - Path to write to
    * @param {string} code - Code content
    */
-  writeCodeToFile(filePath: string, code: string): void {
+  async writeCodeToFile(filePath: string, code: string): Promise<void> {
     try {
-      fs.writeFileSync(filePath, code, "utf8");
+      await fs.writeFile(filePath, code, "utf8");
     } catch (error) {
       console.error(`Error writing code to file ${filePath}:`, error);
       throw new Error(`Failed to write code to file: ${error}`);
@@ -78,25 +200,77 @@ export class CodeProcessingService implements ICodeProcessingService {
     code: string,
     options: CompilationOptions
   ): Promise<CompilationResult> {
-    try {
-      // Write code to source file
-      this.writeCodeToFile(env.sourceFile, code);
+    const labels = {
+      compiler: options.compiler === "clang" ? "clang" : "gcc",
+      lang: options.lang === "cpp" ? "cpp" : "c",
+      optimization: this.getOptimizationOption(options.optimization),
+    };
+    const timer = compileDuration.startTimer(labels);
 
-      // Determine compiler options
-      const compilerCmd = this.getCompilerCommand(
-        options.lang,
-        options.compiler
-      );
-      const standardOption =
-        options.standard || this.getStandardOption(options.lang);
-      const optimizationOption = options.optimization || "-O0";
+    return traceOperation("compile", labels, async () => {
+      try {
+        // Write code to source file
+        await traceStage("write_source", () =>
+          this.writeCodeToFile(env.sourceFile, code)
+        );
 
-      // Compile command
-      const compileCmd = `${compilerCmd} ${standardOption} ${optimizationOption} "${env.sourceFile}" -o "${env.outputFile}"`;
+        // Build the executable, reusing a cached binary when possible
+        const { cached, usedPch, diagnostics } = await this.buildArtifact(
+          env,
+          options,
+          "binary"
+        );
+        const result: CompilationResult = {
+          success: true,
+          cached,
+          usedPch,
+          diagnostics,
+        };
+        if (options.remarks) {
+          result.remarks = await traceStage("read_remarks", () =>
+            this.readRemarks(env, options)
+          );
+        }
+        timer({ cached: String(cached), result: "success" });
+        return result;
+      } catch (error) {
+        timer({ cached: "false", result: "error" });
+        return this.handleError(error);
+      }
+    });
+  }
 
-      // Execute compilation
-      await this.executeCommand(compileCmd);
-      return { success: true };
+  /**
+   * Compile a multi-file workspace incrementally
+   * Each translation unit is compiled to its own object file and is only
+   * recompiled if it, a header it included or the flags changed. Units
+   * compile in parallel through the compile scheduler, then the objects are
+   * linked into the environment's program
+   * @param {CompilationEnvironment} env - Environment receiving the program
+   * @param {WorkspaceFile[]} files - Sources and headers of the workspace
+   * @param {CompilationOptions} options - Compilation options; the language
+   * of each unit follows its file extension
+   * @param {WorkspaceCache} workspace - Object cache of the workspace
+   * @returns {Promise<CompilationResult>} Compilation result
+   */
+  async compileWorkspace(
+    env: CompilationEnvironment,
+    files: WorkspaceFile[],
+    options: CompilationOptions,
+    workspace: WorkspaceCache
+  ): Promise<CompilationResult> {
+    // Builds of a workspace share its directory, so they take turns
+    const build = workspace.queue.then(() =>
+      traceOperation(
+        "workspace",
+        { compiler: options.compiler || "gcc", files: String(files.length) },
+        () => this.buildWorkspace(env, files, options, workspace)
+      )
+    );
+    workspace.queue = build.catch(() => {});
+
+    try {
+      return await build;
     } catch (error) {
       return this.handleError(error);
     }
@@ -116,26 +290,62 @@ export class CodeProcessingService implements ICodeProcessingService {
   ): Promise<AssemblyResult> {
     try {
       // Write code to source file
-      this.writeCodeToFile(env.sourceFile, code);
+      await this.writeCodeToFile(env.sourceFile, code);
 
-      // Determine compiler options
-      const compilerCmd = this.getCompilerCommand(
-        options.lang,
-        options.compiler
+      // Generate the assembly listing, reusing a cached one when possible
+      const { cached } = await traceOperation(
+        "assembly",
+        { compiler: options.compiler || "gcc", lang: options.lang },
+        () => this.buildArtifact(env, options, "assembly")
       );
-      const standardOption =
-        options.standard || this.getStandardOption(options.lang);
-      const optimizationOption = options.optimization || "-O0";
 
-      // Generate assembly command
-      const asmCmd = `${compilerCmd} -S  ${optimizationOption} ${standardOption} "${env.sourceFile}" -o "${env.asmFile}"`;
+      // Read assembly code
+      const assemblyCode = await fs.readFile(env.asmFile, "utf8");
+      return { success: true, assembly: assemblyCode, cached };
+    } catch (error) {
+      return this.handleError(error);
+    }
+  }
 
-      // Execute assembly generation
-      await this.executeCommand(asmCmd);
+  /**
+   * Generate a filtered assembly listing mapped to source lines
+   * @param {CompilationEnvironment} env - Compilation environment
+   * @param {string} code - Source code
+   * @param {CompilationOptions} options - Compilation options
+   * @param {boolean} demangle - Demangle C++ symbols
+   * @returns {Promise<AssemblyResult>} Assembly generation result
+   */
+  async generateStructuredAssembly(
+    env: CompilationEnvironment,
+    code: string,
+    options: CompilationOptions,
+    demangle: boolean = false
+  ): Promise<AssemblyResult> {
+    try {
+      // Write code to source file
+      await this.writeCodeToFile(env.sourceFile, code);
+
+      const { cached } = await traceOperation(
+        "assembly",
+        { compiler: options.compiler || "gcc", lang: options.lang },
+        () =>
+          this.buildArtifact(
+            env,
+            options,
+            "assembly",
+            STRUCTURED_ASSEMBLY_FLAGS
+          )
+      );
 
-      // Read assembly code
-      const assemblyCode = fs.readFileSync(env.asmFile, "utf8");
-      return { success: true, assembly: assemblyCode };
+      const listing = await fs.readFile(env.asmFile, "utf8");
+      const structured = parseAssembly(
+        listing,
+        path.basename(env.sourceFile)
+      );
+      if (demangle) {
+        await this.demangleAssembly(structured);
+      }
+      return { success: true, structured, cached };
     } catch (error) {
       return this.handleError(error);
     }
@@ -152,19 +362,14 @@ export class CodeProcessingService implements ICodeProcessingService {
     options: CompilationOptions
   ): Promise<DebugSessionResult> {
     try {
-      // Determine compiler options for debug build
-      const compilerCmd = this.getCompilerCommand(
-        options.lang,
-        options.compiler
-      );
-      const standardOption =
-        options.standard || this.getStandardOption(options.lang);
-
       // Always compile with debug info and optimize for debugging
-      const compileCmd = `${compilerCmd} -g -O0 ${standardOption} "${env.sourceFile}" -o "${env.outputFile}"`;
-
       try {
-        await this.executeCommand(compileCmd);
+        await this.buildArtifact(
+          env,
+          { ...options, optimization: "-O0" },
+          "binary",
+          ["-g"]
+        );
       } catch (error) {
         return this.handleError(error);
       }
@@ -192,32 +397,13 @@ export class CodeProcessingService implements ICodeProcessingService {
   ): Promise<{ success: boolean; straceLogFile?: string; error?: string }> {
     try {
       // Write code to source file
-      this.writeCodeToFile(env.sourceFile, code);
-
-      // Determine compiler options
-      const compilerCmd = this.getCompilerCommand(
-        options.lang,
-        options.compiler
-      );
-      const standardOption =
-        options.standard || this.getStandardOption(options.lang);
-      const optimizationOption = options.optimization || "-O0";
+      await this.writeCodeToFile(env.sourceFile, code);
 
       // Compile with optimization level specified by user
-      const compileCmd = `${compilerCmd} ${standardOption} ${optimizationOption} "${env.sourceFile}" -o "${env.outputFile}"`;
-
       try {
-        await this.executeCommand(compileCmd);
+        await this.buildArtifact(env, options, "binary");
       } catch (error) {
-        const errorStr =
-          typeof error === "string"
-            ? error
-            : error instanceof Error
-            ? error.message
-            : String(error);
-
-        const formattedError = this.formatOutput(errorStr, "default");
-        return { success: false, error: formattedError };
+        return this.handleError(error);
       }
 
       // Create strace log file path
@@ -243,77 +429,153 @@ export class CodeProcessingService implements ICodeProcessingService {
 
   /**
    * Format code using clang-format
+   * The code is piped through clang-format; results are cached by content,
+   * style and range
    * @param {string} code - Source code to format
    * @param {string} style - Formatting style
+   * @param {FormatLineRange} lines - Only format these lines
    * @returns {Promise<FormatResult>} Formatting result
    */
   async formatCode(
     code: string,
-    style: string = "WebKit"
+    style: string = "WebKit",
+    lines?: FormatLineRange
   ): Promise<FormatResult> {
-    // Create temporary directory
-    const tmpDir = tmp.dirSync({
-      prefix: "CinCout-Format-",
-      unsafeCleanup: true,
-    });
-    const inFile = path.join(tmpDir.name, "input.cpp");
+    const range = lines ? `${lines.start}:${lines.end}` : "";
+    const key = ResultCache.key("clang-format", style, range, code);
+    const cached = this.formatResults.get(key);
+    if (cached !== undefined) {
+      return { success: true, formattedCode: cached };
+    }
 
     try {
-      // Write code to file
-      fs.writeFileSync(inFile, code, "utf8");
-
-      // Run clang-format
-      const formatCmd = `clang-format -style=${style} "${inFile}" -i`;
-      await this.executeCommand(formatCmd);
+      const { stdout } = await this.executeCommand(
+        "clang-format",
+        [
+          `-style=${style}`,
+          // Language detection and .clang-format lookup go by this name
+          "--assume-filename=input.cpp",
+          ...(range ? [`--lines=${range}`] : []),
+        ],
+        { input: code }
+      );
 
-      // Read formatted code
-      const formattedCode = fs.readFileSync(inFile, "utf8");
-      return { success: true, formattedCode };
+      this.formatResults.set(key, stdout);
+      return { success: true, formattedCode: stdout };
     } catch (error) {
       return {
         success: false,
         error: `Error formatting code: ${error}`,
       };
-    } finally {
-      // Clean up
-      tmpDir.removeCallback();
     }
   }
 
   /**
    * Run lint code check on code
+   * Results are cached by content. A client's newer request supersedes its
+   * request in flight, which is cancelled; an identical one joins it
    * @param {string} code - Source code to check
-   * @param {string} lang - Language type (c or cpp)
+   * @param {string} clientId - Client the request came from
    * @returns {Promise<LintCodeResult>} Lint code result
    */
-  async runLintCode(code: string): Promise<LintCodeResult> {
-    // Create temporary directory
-    const tmpDir = tmp.dirSync({
-      prefix: "CinCout-Style-",
-      unsafeCleanup: true,
-    });
-    const inFile = path.join(tmpDir.name, "input.cpp");
+  async runLintCode(
+    code: string,
+    clientId: string = ""
+  ): Promise<LintCodeResult> {
+    const key = ResultCache.key("cppcheck", code);
+    const cached = this.lintResults.get(key);
+    if (cached) {
+      return cached;
+    }
+
+    const running = this.lintRuns.get(clientId);
+    if (running) {
+      if (running.key === key) {
+        return running.result;
+      }
+      running.controller.abort();
+    }
+
+    const controller = new AbortController();
+    const run = {
+      key,
+      controller,
+      result: this.runCppcheck(code, controller.signal),
+    };
+    this.lintRuns.set(clientId, run);
 
     try {
-      // Write code to file
-      fs.writeFileSync(inFile, code, "utf8");
+      const result = await run.result;
+      if (result.success) {
+        this.lintResults.set(key, result);
+      }
+      return result;
+    } finally {
+      if (this.lintRuns.get(clientId) === run) {
+        this.lintRuns.delete(clientId);
+      }
+    }
+  }
 
-      // Run cppcheck
-      const cppcheckCmd = `cppcheck --enable=all --suppress=missingInclude --suppress=missingIncludeSystem --suppress=unmatchedSuppression --suppress=checkersReport --inline-suppr --verbose "${inFile}" 2>&1`;
+  /**
+   * Run cppcheck on code once no newer request has arrived
+   * @param {string} code - Source code to check
+   * @param {AbortSignal} signal - Aborted when a newer request supersedes this one
+   * @returns {Promise<LintCodeResult>} Lint code result
+   * @private
+   */
+  private async runCppcheck(
+    code: string,
+    signal: AbortSignal
+  ): Promise<LintCodeResult> {
+    const superseded: LintCodeResult = {
+      success: false,
+      superseded: true,
+      error: "Superseded by a newer lint request",
+    };
 
-      const { stdout } = await this.executeCommand(cppcheckCmd, {
-        shell: true as unknown as string,
-        failOnError: false,
-      });
+    await new Promise((resolve) => setTimeout(resolve, LINT_DEBOUNCE_MS));
+    if (signal.aborted) {
+      return superseded;
+    }
 
-      return this.processLintOutput(stdout);
+    // cppcheck only reads files; borrow a working directory from the pool
+    const tmpDir = await sandboxPool.acquire();
+    const inFile = path.join(tmpDir.name, "input.cpp");
+
+    try {
+      // Write code to file
+      await fs.writeFile(inFile, code, "utf8");
+
+      // Run cppcheck; findings are reported on stderr
+      const { stdout, stderr } = await this.executeCommand(
+        "cppcheck",
+        [
+          "--enable=all",
+          "--suppress=missingInclude",
+          "--suppress=missingIncludeSystem",
+          "--suppress=unmatchedSuppression",
+          "--suppress=checkersReport",
+          "--inline-suppr",
+          "--verbose",
+          inFile,
+        ],
+        { failOnError: false, signal }
+      );
+
+      if (signal.aborted) {
+        return superseded;
+      }
+      return this.processLintOutput(`${stdout}\n${stderr}`);
     } catch (error) {
-      return {
-        success: false,
-        error: `Error linting code: ${error}`,
-      };
+      return signal.aborted
+        ? superseded
+        : {
+            success: false,
+            error: `Error linting code: ${error}`,
+          };
     } finally {
-      // Clean up
+      // Return the directory to the pool
       tmpDir.removeCallback();
     }
   }
@@ -382,42 +644,31 @@ export class CodeProcessingService implements ICodeProcessingService {
    * @param {CompilationEnvironment} env - Compilation environment
    * @param {string} code - Source code
    * @param {CompilationOptions} options - Compilation options
-   * @returns {Promise<{success: boolean, valgrindLogFile?: string, error?: string}>} Leak detection preparation result
+   * @returns {Promise<{success: boolean, valgrindXmlFile?: string, error?: string}>} Leak detection preparation result
    */
   async prepareLeakDetection(
     env: CompilationEnvironment,
     code: string,
     options: CompilationOptions
-  ): Promise<{ success: boolean; valgrindLogFile?: string; error?: string }> {
+  ): Promise<{ success: boolean; valgrindXmlFile?: string; error?: string }> {
     try {
       // Write code to source file
-      this.writeCodeToFile(env.sourceFile, code);
-
-      // Determine compiler options
-      const compilerCmd = this.getCompilerCommand(
-        options.lang,
-        options.compiler
-      );
-      const standardOption =
-        options.standard || this.getStandardOption(options.lang);
-      const optimizationOption = options.optimization || "-O0";
+      await this.writeCodeToFile(env.sourceFile, code);
 
       // Compile with debug info
-      const compileCmd = `${compilerCmd} -g ${standardOption} ${optimizationOption} "${env.sourceFile}" -o "${env.outputFile}"`;
-
       try {
-        await this.executeCommand(compileCmd);
+        await this.buildArtifact(env, options, "binary", ["-g"]);
       } catch (error) {
         return this.handleError(error);
       }
 
-      // Create valgrind log file path
-      const valgrindLogFile = path.join(env.tmpDir.name, "valgrind.log");
+      // Create valgrind XML report path
+      const valgrindXmlFile = path.join(env.tmpDir.name, "valgrind.xml");
 
-      // Return success and the path to the valgrind log file
+      // Return success and the path to the valgrind XML report
       return {
         success: true,
-        valgrindLogFile: valgrindLogFile,
+        valgrindXmlFile: valgrindXmlFile,
       };
     } catch (error) {
       return {
@@ -427,6 +678,76 @@ export class CodeProcessingService implements ICodeProcessingService {
     }
   }
 
+  /**
+   * Prepare a sanitizer-instrumented build for fast leak and memory checks
+   * AddressSanitizer, LeakSanitizer and UBSan slow a program down about 2x,
+   * against 20-50x under Valgrind, at the cost of missing uninitialized reads
+   * @param {CompilationEnvironment} env - Compilation environment
+   * @param {string} code - Source code
+   * @param {CompilationOptions} options - Compilation options
+   * @returns {Promise<{success: boolean, sanitizerLogPath?: string, error?: string}>} Sanitizer check preparation result
+   */
+  async prepareSanitizerCheck(
+    env: CompilationEnvironment,
+    code: string,
+    options: CompilationOptions
+  ): Promise<{ success: boolean; sanitizerLogPath?: string; error?: string }> {
+    try {
+      // Write code to source file
+      await this.writeCodeToFile(env.sourceFile, code);
+
+      // Compile with debug info and instrumentation
+      try {
+        await this.buildArtifact(env, options, "binary", SANITIZER_FLAGS);
+      } catch (error) {
+        return this.handleError(error);
+      }
+
+      // Sanitizers write their reports to this path plus ".<pid>"
+      return {
+        success: true,
+        sanitizerLogPath: path.join(env.tmpDir.name, "sanitizer"),
+      };
+    } catch (error) {
+      return {
+        success: false,
+        error: `Error preparing sanitizer check: ${error}`,
+      };
+    }
+  }
+
+  /**
+   * Prepare a build for sampling profiles
+   * The optimization level is kept so the profile shows the code that runs
+   * @param {CompilationEnvironment} env - Compilation environment
+   * @param {string} code - Source code
+   * @param {CompilationOptions} options - Compilation options
+   * @returns {Promise<{success: boolean, error?: string}>} Profiling preparation result
+   */
+  async prepareProfiling(
+    env: CompilationEnvironment,
+    code: string,
+    options: CompilationOptions
+  ): Promise<{ success: boolean; error?: string }> {
+    try {
+      // Write code to source file
+      await this.writeCodeToFile(env.sourceFile, code);
+
+      try {
+        await this.buildArtifact(env, options, "binary", PROFILE_FLAGS);
+      } catch (error) {
+        return this.handleError(error);
+      }
+
+      return { success: true };
+    } catch (error) {
+      return {
+        success: false,
+        error: `Error preparing profiling session: ${error}`,
+      };
+    }
+  }
+
   // =====================================
   // UTILITY METHODS
   // =====================================
@@ -448,195 +769,946 @@ export class CodeProcessingService implements ICodeProcessingService {
       : "gcc";
   }
 
+  /**
+   * Get the flags that write optimization remarks to the remarks artifact
+   * Only the vectorizer and the inliner report, which is what loop tuning needs
+   * @param {string} compilerCmd - Compiler command
+   * @returns {string[]} Remark flags
+   * @private
+   */
+  private getRemarkFlags(compilerCmd: string): string[] {
+    return compilerCmd.startsWith("clang")
+      ? [
+          "-fsave-optimization-record",
+          `-foptimization-record-file=${REMARKS_ARTIFACT}`,
+          "-foptimization-record-passes=loop-vectorize|slp-vectorizer|inline",
+        ]
+      : [
+          `-fopt-info-vec-all=${REMARKS_ARTIFACT}`,
+          `-fopt-info-inline=${REMARKS_ARTIFACT}`,
+        ];
+  }
+
+  /**
+   * Read the optimization remarks of the last build
+   * @param {CompilationEnvironment} env - Compilation environment
+   * @param {CompilationOptions} options - Compilation options
+   * @returns {Promise<OptimizationRemark[]>} Remarks about the source file
+   * @private
+   */
+  private async readRemarks(
+    env: CompilationEnvironment,
+    options: CompilationOptions
+  ): Promise<OptimizationRemark[]> {
+    try {
+      const text = await fs.readFile(
+        path.join(env.tmpDir.name, REMARKS_ARTIFACT),
+        "utf8"
+      );
+      const sourceName = path.basename(env.sourceFile);
+      const compilerCmd = this.getCompilerCommand(
+        options.lang,
+        options.compiler
+      );
+      return compilerCmd.startsWith("clang")
+        ? parseClangRemarks(text, sourceName)
+        : parseGccRemarks(text, sourceName);
+    } catch (error) {
+      console.error("Error reading optimization remarks:", error);
+      return [];
+    }
+  }
+
+  /**
+   * Get a validated optimization option
+   * Unknown values fall back to -O0 so arbitrary flags never reach the compiler
+   * @param {string} optimization - Requested optimization level
+   * @returns {string} Optimization option
+   * @private
+   */
+  private getOptimizationOption(optimization?: string): string {
+    return optimization && OPTIMIZATION_LEVELS.includes(optimization)
+      ? optimization
+      : "-O0";
+  }
+
   /**
    * Get language standard option based on language
+   * A requested standard is used if it is one of the language's, so a C++
+   * standard does not reach the C units of a workspace
    * @param {string} lang - Programming language ('c' or 'cpp')
+   * @param {string} standard - Requested standard
    * @returns {string} Standard option
    * @private
    */
-  private getStandardOption(lang: string): string {
-    return lang === "cpp" ? "-std=c++20" : "-std=c11";
+  private getStandardOption(lang: string, standard?: string): string {
+    const language = lang === "cpp" ? "cpp" : "c";
+    return standard && LANGUAGE_STANDARDS[language].includes(standard)
+      ? standard
+      : DEFAULT_STANDARDS[language];
   }
 
   /**
-   * Execute a shell command
-   * @param {string} command - Command to execute
-   * @param {object} options - Execution options
-   * @returns {Promise<{stdout: string, stderr: string, exitCode: number}>} Promise with stdout and stderr
+   * Build an artifact through the content-addressed build cache
+   * A single compiler invocation produces both the executable and the assembly
+   * listing, so a later request for the other artifact is a cache hit.
+   * Concurrent builds of the same inputs share one compiler run.
+   * @param {CompilationEnvironment} env - Compilation environment (source file already written)
+   * @param {CompilationOptions} options - Compilation options
+   * @param {BuildArtifact} artifact - Artifact the caller needs
+   * @param {string[]} extraFlags - Additional compiler flags, e.g. debug info
+   * @returns {Promise<BuildOutcome>} Whether the cache or a precompiled header was used
    * @private
    */
-  private async executeCommand(
-    command: string,
-    options: ExecOptions & {
-      shell?: boolean | string;
-      failOnError?: boolean;
-    } = {}
-  ): Promise<ExecutionResult> {
-    return new Promise((resolve, reject) => {
-      exec(command, options, (error, stdout, stderr) => {
-        if (error && options.failOnError !== false) {
-          reject(stderr || error.message);
-          return;
-        }
-
-        const result = {
-          stdout,
-          stderr,
-          exitCode: error ? error.code || 1 : 0,
+  private async buildArtifact(
+    env: CompilationEnvironment,
+    options: CompilationOptions,
+    artifact: BuildArtifact,
+    extraFlags: string[] = []
+  ): Promise<BuildOutcome> {
+    const compilerCmd = this.getCompilerCommand(
+      options.lang,
+      options.compiler
+    );
+    // Only a standard of the language reaches the command line and the key
+    const standardOption = this.getStandardOption(
+      options.lang,
+      options.standard
+    );
+    const optimizationOption = this.getOptimizationOption(
+      options.optimization
+    );
+    const code = await fs.readFile(env.sourceFile, "utf8");
+    const pchFlags = await traceStage("pch_resolve", () =>
+      pchService.resolve(
+        compilerCmd,
+        standardOption,
+        optimizationOption,
+        extraFlags,
+        code
+      )
+    );
+
+    // A build with the precompiled header has its own entry, but the plain
+    // build of the same code (e.g. a prebuilt one) is just as good an answer
+    const [plainKey, pchKey] = await traceStage(
+      "cache_key",
+      async (): Promise<[string, string | null]> => {
+        const input = {
+          code,
+          lang: options.lang,
+          compiler: compilerCmd,
+          fingerprint: await getCompilerFingerprint(compilerCmd),
+          standard: standardOption,
+          optimization: optimizationOption,
+          flags: extraFlags,
+          pch: false,
         };
+        return [
+          buildCacheService.computeKey(input),
+          pchFlags
+            ? buildCacheService.computeKey({ ...input, pch: true })
+            : null,
+        ];
+      }
+    );
+    const key = pchKey || plainKey;
+    const remarksFile = path.join(env.tmpDir.name, REMARKS_ARTIFACT);
+    const wanted: Record<string, string> =
+      artifact === "assembly"
+        ? { [ASSEMBLY_ARTIFACT]: env.asmFile }
+        : { [BINARY_ARTIFACT]: env.outputFile };
+    // Remarks do not change the generated code, so they are not part of the
+    // key; an entry built without them misses and is rebuilt with them
+    if (options.remarks) {
+      wanted[REMARKS_ARTIFACT] = remarksFile;
+    }
 
-        resolve(result);
-      });
+    // Wait for an identical build already running in this worker
+    const restore = () =>
+      traceStage("cache_restore", () =>
+        buildCacheService.restore(
+          pchKey ? [pchKey, plainKey] : [plainKey],
+          wanted
+        )
+      );
+    const inFlight = this.inFlightBuilds.get(key);
+    if (inFlight) {
+      // A build cancelled by its own client is built again for this one
+      const outcome = await traceStage("build_shared", () =>
+        inFlight.catch((error) => {
+          if (error instanceof CancelledError) {
+            return null;
+          }
+          throw error;
+        })
+      );
+      if (outcome && (await restore())) {
+        return { ...outcome, cached: true };
+      }
+    } else if (await restore()) {
+      return { cached: true, usedPch: false, diagnostics: [] };
+    }
+
+    const build = this.runCombinedBuild(
+      env,
+      options,
+      artifact,
+      compilerCmd,
+      standardOption,
+      optimizationOption,
+      extraFlags,
+      pchFlags,
+      code
+    ).then(async (outcome) => {
+      // A build that fell back to the plain compile is stored as one
+      await traceStage("cache_store", () =>
+        buildCacheService.store(outcome.usedPch ? key : plainKey, {
+          [BINARY_ARTIFACT]: env.outputFile,
+          [ASSEMBLY_ARTIFACT]: env.asmFile,
+          [REMARKS_ARTIFACT]: remarksFile,
+        })
+      );
+      return outcome;
     });
+
+    this.inFlightBuilds.set(key, build);
+    try {
+      return await build;
+    } finally {
+      if (this.inFlightBuilds.get(key) === build) {
+        this.inFlightBuilds.delete(key);
+      }
+    }
   }
 
   /**
-   * Format output for display
-   * @param {string} text - Text to format
-   * @param {string} outputType - Type of output (default, leakDetect, style, etc.)
-   * @returns {string} Formatted HTML output
+   * Run the compiler once, keeping the assembly it generates on the way
+   * Diagnostics are parsed while the compiler runs and forwarded through
+   * options.onDiagnostic as soon as each one is complete
+   * @returns {Promise<BuildOutcome>} Build outcome with warnings
    * @private
    */
-  private formatOutput(text: string, outputType: string = "default"): string {
-    if (!text) return "";
+  private async runCombinedBuild(
+    env: CompilationEnvironment,
+    options: CompilationOptions,
+    artifact: BuildArtifact,
+    compilerCmd: string,
+    standardOption: string,
+    optimizationOption: string,
+    extraFlags: string[],
+    pchFlags: string[] | null,
+    code: string
+  ): Promise<BuildOutcome> {
+    // Compile inside the environment with relative paths so the artifact
+    // (debug info, __FILE__) does not depend on the temporary directory name.
+    // The compilation directory is still recorded in the debug info, and
+    // sandboxes are reused, so a cached debug binary would point gdb at the
+    // sources of whoever holds the directory next; map it to "."
+    const prefixMapFlag = `-ffile-prefix-map=${env.tmpDir.name}=.`;
+    const errorLimitFlag = compilerCmd.startsWith("clang")
+      ? `-ferror-limit=${MAX_COMPILER_ERRORS}`
+      : `-fmax-errors=${MAX_COMPILER_ERRORS}`;
+    // Remark flags stay out of the precompiled header lookup, which gives up
+    // on any flag but -g
+    const remarkFlags = options.remarks
+      ? this.getRemarkFlags(compilerCmd)
+      : [];
+    const buildArgs = (includeFlags: string[]) => [
+      "-save-temps=obj",
+      prefixMapFlag,
+      errorLimitFlag,
+      ...extraFlags,
+      ...remarkFlags,
+      standardOption,
+      optimizationOption,
+      ...includeFlags,
+      path.basename(env.sourceFile),
+      "-o",
+      BINARY_ARTIFACT,
+    ];
+
+    let usedPch = !!pchFlags;
+    const run = async (includeFlags: string[]) => {
+      const stream = new DiagnosticStream();
+      const diagnostics: CompilerDiagnostic[] = [];
+      // A build with the precompiled header may be retried, so its
+      // diagnostics are only forwarded once it is known to stand
+      const forward = (completed: CompilerDiagnostic[]) => {
+        for (const diagnostic of completed) {
+          options.onDiagnostic?.(
+            renderDiagnostics([diagnostic], code),
+            diagnostic
+          );
+        }
+      };
+      const emit = (completed: CompilerDiagnostic[]) => {
+        diagnostics.push(...completed);
+        if (includeFlags.length === 0) {
+          forward(completed);
+        }
+      };
 
-    // Remove file paths from error messages
-    text = text.replace(/[^:\s]+\.(cpp|c|h|hpp):/g, "");
+      let failure: string | null = null;
+      try {
+        await traceStage("compiler", () =>
+          this.executeCommand(compilerCmd, buildArgs(includeFlags), {
+            cwd: env.tmpDir.name,
+            maxBytes: COMPILER_OUTPUT_LIMIT,
+            signal: options.schedule?.signal,
+            onStderr: (chunk) => emit(stream.push(chunk)),
+          })
+        );
+      } catch (error) {
+        failure = String(error);
+      }
+      emit(stream.end());
 
-    // Only apply HTML sanitization for outputs that need it
-    if (
-      outputType === "default" ||
-      outputType === "leakDetect" ||
-      outputType === "style"
-    ) {
-      // Basic HTML sanitization
-      text = text
-        .replace(/&/g, "&amp;")
-        .replace(/</g, "&lt;")
-        .replace(/>/g, "&gt;");
-
-      // Apply common formatting for all output types
-      // Highlight error and warning messages
-      text = text
-        .replace(/error:/gi, '<span class="error-text">error:</span>')
-        .replace(/warning:/gi, '<span class="warning-text">warning:</span>')
-
-        // Highlight line and column numbers
-        .replace(
-          /(\d+):(\d+):/g,
-          '<span class="line-number">$1</span>:<span class="column-number">$2</span>:'
+      if (
+        includeFlags.length > 0 &&
+        (failure === null || !pchService.isPchFailure(failure, diagnostics))
+      ) {
+        forward(diagnostics);
+      }
+      return { diagnostics, failure };
+    };
+
+    // The slot stage includes the wait for a compile slot
+    const { diagnostics, failure } = await traceStage("compile_slot", () =>
+      compileScheduler.run(options.schedule, async () => {
+        const result = await run(pchFlags || []);
+
+        // A stale or incompatible header, or names it forces in, must never
+        // fail a build; errors of the source itself are not compiled twice
+        if (
+          pchFlags &&
+          result.failure !== null &&
+          !options.schedule?.signal?.aborted &&
+          pchService.isPchFailure(result.failure, result.diagnostics)
+        ) {
+          if (pchService.isUnusableHeader(result.failure)) {
+            pchService.markUnusable(pchFlags);
+          }
+          usedPch = false;
+          return run([]);
+        }
+        return result;
+      })
+    );
+
+    // A compile killed because its client left has no result to keep
+    if (options.schedule?.signal?.aborted) {
+      throw new CancelledError();
+    }
+
+    const hasAssembly = await traceStage("collect_temps", () =>
+      this.collectSavedTemps(env)
+    );
+    if (options.remarks && failure === null) {
+      // Code without loops or calls has no remarks; an empty file still
+      // lets the cache entry answer later requests for remarks
+      await fs.ensureFile(path.join(env.tmpDir.name, REMARKS_ARTIFACT));
+    }
+
+    if (failure !== null) {
+      // Code without main() still has a listing; only linking failed
+      if (
+        artifact === "assembly" &&
+        hasAssembly &&
+        !hasCompileErrors(diagnostics)
+      ) {
+        return { cached: false, usedPch, diagnostics };
+      }
+
+      throw new CompileError(renderDiagnostics(diagnostics, code), diagnostics);
+    }
+
+    return { cached: false, usedPch, diagnostics };
+  }
+
+  /**
+   * Bring a workspace up to date and link its program
+   * @returns {Promise<CompilationResult>} Result with the units compiled
+   * and reused
+   * @private
+   */
+  private async buildWorkspace(
+    env: CompilationEnvironment,
+    files: WorkspaceFile[],
+    options: CompilationOptions,
+    workspace: WorkspaceCache
+  ): Promise<CompilationResult> {
+    const invalid = validateWorkspace(files);
+    if (invalid) {
+      throw new Error(invalid);
+    }
+    await this.syncWorkspaceSources(workspace, files);
+
+    const contents = new Map(files.map((file) => [file.name, file.content]));
+    const units = files
+      .map((file) => file.name)
+      .filter((name) => getUnitLanguage(name));
+    const optimizationOption = this.getOptimizationOption(
+      options.optimization
+    );
+
+    const builds = await Promise.all(
+      units.map(async (unit) => {
+        const lang = getUnitLanguage(unit)!;
+        const compilerCmd = this.getCompilerCommand(lang, options.compiler);
+        const flags = [
+          compilerCmd,
+          await getCompilerFingerprint(compilerCmd),
+          this.getStandardOption(lang, options.standard),
+          optimizationOption,
+        ];
+
+        const object = workspace.objects.get(unit);
+        if (
+          object &&
+          object.key === this.hashUnit(workspace, flags, unit, object.deps) &&
+          (await fs.pathExists(
+            path.join(workspace.dir, OBJECT_DIR, `${unit}.o`)
+          ))
+        ) {
+          return { unit, compiled: false, diagnostics: [], failed: false };
+        }
+
+        workspace.objects.delete(unit);
+        return {
+          unit,
+          compiled: true,
+          ...(await traceStage("compile_unit", () =>
+            this.compileUnit(workspace, unit, flags, contents, options)
+          )),
+        };
+      })
+    );
+
+    const diagnostics: CompilerDiagnostic[] = builds.flatMap(
+      (build) => build.diagnostics
+    );
+    if (builds.some((build) => build.failed)) {
+      throw new CompileError(
+        builds
+          .filter((build) => build.diagnostics.length > 0)
+          .map((build) =>
+            renderDiagnostics(build.diagnostics, contents.get(build.unit)!)
+          )
+          .join("\n"),
+        diagnostics
+      );
+    }
+
+    // Relink only if an object changed since the last program
+    const driver = this.getCompilerCommand(
+      units.some((unit) => getUnitLanguage(unit) === "cpp") ? "cpp" : "c",
+      options.compiler
+    );
+    const linkerFlags = await this.getLinkerFlags(driver);
+    const linkKey = crypto
+      .createHash("sha256")
+      .update(
+        [
+          driver,
+          ...linkerFlags,
+          ...units.map((unit) => workspace.objects.get(unit)!.key),
+        ].join("\0")
+      )
+      .digest("hex");
+    const program = path.join(workspace.dir, BINARY_ARTIFACT);
+
+    if (workspace.linkKey !== linkKey || !(await fs.pathExists(program))) {
+      workspace.linkKey = null;
+      diagnostics.push(
+        ...(await traceStage("link", () =>
+          this.linkWorkspace(workspace, driver, linkerFlags, units, options)
+        ))
+      );
+      workspace.linkKey = linkKey;
+    }
+    await fs.copy(program, env.outputFile);
+
+    const compiled = builds.filter((build) => build.compiled).length;
+    return {
+      success: true,
+      diagnostics,
+      units: { compiled, reused: units.length - compiled },
+    };
+  }
+
+  /**
+   * Write the workspace files that changed since the last build and remove
+   * those that are gone, with their objects
+   * @param {WorkspaceCache} workspace - Object cache of the workspace
+   * @param {WorkspaceFile[]} files - Sources and headers of the workspace
+   * @private
+   */
+  private async syncWorkspaceSources(
+    workspace: WorkspaceCache,
+    files: WorkspaceFile[]
+  ): Promise<void> {
+    const names = new Set(files.map((file) => file.name));
+    for (const name of Array.from(workspace.sources.keys())) {
+      if (!names.has(name)) {
+        workspace.sources.delete(name);
+        workspace.objects.delete(name);
+        await Promise.all(
+          [name, `${OBJECT_DIR}/${name}.o`, `${OBJECT_DIR}/${name}.d`].map(
+            (file) => fs.remove(path.join(workspace.dir, file))
+          )
         );
+      }
+    }
 
-      // apply additional formatting for leak detection output
-      if (outputType === "leakDetect") {
-        text = this.formatLeakDetectOutput(text);
+    await fs.ensureDir(path.join(workspace.dir, OBJECT_DIR));
+    for (const file of files) {
+      const hash = crypto
+        .createHash("sha256")
+        .update(file.content)
+        .digest("hex");
+      if (workspace.sources.get(file.name) !== hash) {
+        await this.writeCodeToFile(
+          path.join(workspace.dir, file.name),
+          file.content
+        );
+        workspace.sources.set(file.name, hash);
       }
     }
+  }
 
-    return text;
+  /**
+   * Hash the inputs of a translation unit's object file
+   * A header that no longer exists hashes as missing, so includers rebuild
+   * @param {WorkspaceCache} workspace - Object cache of the workspace
+   * @param {string[]} flags - Compiler, its fingerprint and the options
+   * @param {string} unit - Translation unit
+   * @param {string[]} deps - Workspace headers the unit includes
+   * @returns {string} Hex hash
+   * @private
+   */
+  private hashUnit(
+    workspace: WorkspaceCache,
+    flags: string[],
+    unit: string,
+    deps: string[]
+  ): string {
+    const sources = [unit, ...deps].map(
+      (name) => `${name}=${workspace.sources.get(name) || "missing"}`
+    );
+    return crypto
+      .createHash("sha256")
+      .update([...flags, ...sources].join("\0"))
+      .digest("hex");
+  }
+
+  /**
+   * Compile a translation unit to its object file
+   * The dependency file written by -MMD records the workspace headers the
+   * unit includes; system headers are left out
+   * @param {WorkspaceCache} workspace - Object cache of the workspace
+   * @param {string} unit - Translation unit
+   * @param {string[]} flags - Compiler, its fingerprint and the options
+   * @param {Map<string, string>} contents - Workspace file contents by name
+   * @param {CompilationOptions} options - Compilation options
+   * @returns {Promise<object>} Diagnostics and whether compiling failed
+   * @private
+   */
+  private async compileUnit(
+    workspace: WorkspaceCache,
+    unit: string,
+    flags: string[],
+    contents: Map<string, string>,
+    options: CompilationOptions
+  ): Promise<{ diagnostics: CompilerDiagnostic[]; failed: boolean }> {
+    const [compilerCmd, , standardOption, optimizationOption] = flags;
+    const errorLimitFlag = compilerCmd.startsWith("clang")
+      ? `-ferror-limit=${MAX_COMPILER_ERRORS}`
+      : `-fmax-errors=${MAX_COMPILER_ERRORS}`;
+    const depFile = `${OBJECT_DIR}/${unit}.d`;
+
+    const { diagnostics, failure } = await this.runTool(
+      compilerCmd,
+      [
+        errorLimitFlag,
+        standardOption,
+        optimizationOption,
+        "-MMD",
+        "-MF",
+        depFile,
+        "-c",
+        unit,
+        "-o",
+        `${OBJECT_DIR}/${unit}.o`,
+      ],
+      workspace.dir,
+      options,
+      (diagnostic) => contents.get(diagnostic.file || unit) || ""
+    );
+    if (failure !== null) {
+      return { diagnostics, failed: true };
+    }
+
+    const deps = parseDepFile(
+      await fs.readFile(path.join(workspace.dir, depFile), "utf8")
+    ).filter((dep) => dep !== unit && workspace.sources.has(dep));
+    workspace.objects.set(unit, {
+      key: this.hashUnit(workspace, flags, unit, deps),
+      deps,
+    });
+    return { diagnostics, failed: false };
+  }
+
+  /**
+   * Link the objects of a workspace into its program
+   * @param {WorkspaceCache} workspace - Object cache of the workspace
+   * @param {string} driver - Compiler driver matching the units' languages
+   * @param {string[]} linkerFlags - Linker selection
+   * @param {string[]} units - Translation units
+   * @param {CompilationOptions} options - Compilation options
+   * @returns {Promise<CompilerDiagnostic[]>} Linker warnings
+   * @private
+   */
+  private async linkWorkspace(
+    workspace: WorkspaceCache,
+    driver: string,
+    linkerFlags: string[],
+    units: string[],
+    options: CompilationOptions
+  ): Promise<CompilerDiagnostic[]> {
+    const { diagnostics, failure } = await this.runTool(
+      driver,
+      [
+        ...linkerFlags,
+        ...units.map((unit) => `${OBJECT_DIR}/${unit}.o`),
+        "-o",
+        BINARY_ARTIFACT,
+      ],
+      workspace.dir,
+      options,
+      () => ""
+    );
+    if (failure !== null) {
+      throw new CompileError(
+        renderDiagnostics(diagnostics, "") || this.formatOutput(failure),
+        diagnostics
+      );
+    }
+    return diagnostics;
   }
 
   /**
-   * Format Valgrind memcheck output
-   * @param text - Raw memcheck text
-   * @returns Formatted memcheck text with advanced leak detection formatting applied
+   * Run a compiler or linker invocation in a compile slot
+   * Diagnostics are forwarded through options.onDiagnostic as they complete
+   * @param {string} command - Compiler driver
+   * @param {string[]} args - Arguments
+   * @param {string} cwd - Working directory
+   * @param {CompilationOptions} options - Compilation options
+   * @param {Function} sourceOf - Source a diagnostic refers to
+   * @returns {Promise<object>} Diagnostics, and the error output on failure
+   * @private
    */
-  private formatLeakDetectOutput(text: string): string {
-    // Pre-process memcheck output
-    text = text
-      // Remove valgrind prefixes
-      .replace(/==\d+== /g, "")
-      // Clean up spacing
-      .replace(/\s+from\s+/g, " from ")
+  private async runTool(
+    command: string,
+    args: string[],
+    cwd: string,
+    options: CompilationOptions,
+    sourceOf: (diagnostic: CompilerDiagnostic) => string
+  ): Promise<{ diagnostics: CompilerDiagnostic[]; failure: string | null }> {
+    const stream = new DiagnosticStream();
+    const diagnostics: CompilerDiagnostic[] = [];
+    const emit = (completed: CompilerDiagnostic[]) => {
+      for (const diagnostic of completed) {
+        diagnostics.push(diagnostic);
+        options.onDiagnostic?.(
+          renderDiagnostics([diagnostic], sourceOf(diagnostic)),
+          diagnostic
+        );
+      }
+    };
 
-      // === Handle line number formats ===
+    const failure = await compileScheduler.run(
+      options.schedule,
+      async (): Promise<string | null> => {
+        try {
+          await this.executeCommand(command, args, {
+            cwd,
+            maxBytes: COMPILER_OUTPUT_LIMIT,
+            signal: options.schedule?.signal,
+            onStderr: (chunk) => emit(stream.push(chunk)),
+          });
+          return null;
+        } catch (error) {
+          return String(error);
+        }
+      }
+    );
+    emit(stream.end());
 
-      // 1. First, standardize path formats with line numbers
-      // Remove temporary directory paths but preserve line numbers
-      .replace(/\(\/tmp\/CinCout-[^\/]+\/[^:)]+:(\d+)\)/g, "###LINE:$1###")
+    return { diagnostics, failure };
+  }
 
-      // 2. Handle various valgrind stack trace formats with line numbers
-      // Format: "by 0x1234: function_name (/tmp/CinCout-xxx/file.c:42)"
-      .replace(
-        /by 0x[0-9a-fA-F]+: (\w+) \(\/tmp\/CinCout-[^\/]+\/(?:[^:)]+):(\d+)\)/g,
-        "by 0x...: $1 ###LINE:$2###"
-      )
+  /**
+   * Get the flag selecting the fastest linker the driver can use
+   * @param {string} driver - Compiler driver
+   * @returns {Promise<string[]>} -fuse-ld flag, or nothing for the default
+   * @private
+   */
+  private async getLinkerFlags(driver: string): Promise<string[]> {
+    for (const linker of FAST_LINKERS) {
+      const flag = `-fuse-ld=${linker}`;
+      if (await isToolUsable(driver, [flag, "-Wl,--version"])) {
+        return [flag];
+      }
+    }
+    return [];
+  }
 
-      // 3. Handle the specific format: "by 0x10878B: leak_memory(int) 5)" - function with parameters
-      .replace(
-        /by (0x[0-9a-fA-F]+): ([a-zA-Z_][a-zA-Z0-9_]*\([^)]*\)) (\d+)\)/g,
-        "by $1: $2 ###LINE:$3###"
-      )
+  /**
+   * Move the saved assembly to the environment's assembly path and remove the
+   * other intermediate files left by -save-temps
+   * gcc 11+ prefixes temporaries with the output name, older gcc and clang do not
+   * @param {CompilationEnvironment} env - Compilation environment
+   * @returns {Promise<boolean>} True if an assembly listing was produced
+   * @private
+   */
+  private async collectSavedTemps(
+    env: CompilationEnvironment
+  ): Promise<boolean> {
+    const stem = path.basename(env.sourceFile, path.extname(env.sourceFile));
+    let hasAssembly = false;
+
+    for (const file of await fs.readdir(env.tmpDir.name)) {
+      const name = file.startsWith(`${BINARY_ARTIFACT}-`)
+        ? file.slice(BINARY_ARTIFACT.length + 1)
+        : file;
+      const extension = name.startsWith(`${stem}.`)
+        ? name.slice(stem.length + 1)
+        : "";
+      if (!SAVED_TEMP_EXTENSIONS.includes(extension)) {
+        continue;
+      }
 
-      // 4. Handle format: "by 0x1087C3: leak_memory 7)"
-      .replace(
-        /by (0x[0-9a-fA-F]+): ([a-zA-Z_][a-zA-Z0-9_]*) (\d+)\)/g,
-        "by $1: $2 ###LINE:$3###"
-      )
+      const tempPath = path.join(env.tmpDir.name, file);
+      if (extension === "s") {
+        if (tempPath !== env.asmFile) {
+          await fs.move(tempPath, env.asmFile, { overwrite: true });
+        }
+        hasAssembly = true;
+      } else {
+        await fs.remove(tempPath);
+      }
+    }
 
-      // 5. Handle any remaining standard program file references
-      .replace(/\((?:program\.c|program\.cpp):(\d+)\)/g, "###LINE:$1###")
+    return hasAssembly;
+  }
 
-      // 6. Handle any remaining format: "function_name 42)"
-      .replace(/: ([a-zA-Z_][a-zA-Z0-9_]*) (\d+)\)/g, ": $1 ###LINE:$2###")
+  /**
+   * Demangle the function names and instructions of a listing in place
+   * The listing stays mangled if c++filt is unavailable
+   * @param {StructuredAssembly} structured - Filtered listing
+   * @private
+   */
+  private async demangleAssembly(
+    structured: StructuredAssembly
+  ): Promise<void> {
+    const rows = structured.functions.flatMap((fn) => fn.instructions);
+    const lines = [
+      ...structured.functions.map((fn) => fn.name),
+      ...rows.map((row) => row.text),
+    ];
+    if (!lines.some((line) => line.includes("_Z"))) {
+      return;
+    }
 
-      // === Clean up and additional formatting ===
+    try {
+      const input = lines.join("\n") + "\n";
+      const { stdout } = await this.executeCommand("c++filt", [], {
+        input,
+        maxBytes: Math.max(DEFAULT_OUTPUT_LIMIT, input.length * 4),
+      });
+      const demangled = stdout.split("\n");
+      if (demangled.length < lines.length) {
+        return;
+      }
 
-      // Remove all other path references
-      .replace(/in \/.*?\/([^\/]+)\)/g, "in $1)")
+      structured.functions.forEach((fn, index) => {
+        fn.name = demangled[index];
+      });
+      rows.forEach((row, index) => {
+        row.text = demangled[structured.functions.length + index];
+      });
+    } catch (error) {
+      console.error("Error demangling assembly:", error);
+    }
+  }
 
-      // Clean up whitespace
-      .replace(/^\s*\n/g, "")
-      .replace(/\n\s*\n/g, "\n")
-      // Mark memory leaks and fix potential comma formatting issues in byte counts
-      .replace(
-        /([\d,]+ bytes? in \d+ blocks? are definitely lost.*?)(?=\s*at|$)/g,
-        function (_, leakText) {
-          // Clean up any commas in numbers and trim whitespace
-          return (
-            "###LEAK:" + leakText.replace(/(\d),(\d)/g, "$1$2").trim() + "###"
-          );
+  /**
+   * Run a command without a shell and collect its output
+   * Output is streamed as it arrives and capped at a byte limit; once the cap
+   * is reached the process is killed and the result is marked as truncated
+   * A run that exceeds the time limit or is aborted is killed with every
+   * process it started
+   * @param {string} command - Executable
+   * @param {string[]} args - Arguments
+   * @param {object} options - Working directory, standard input, output limit and callbacks
+   * @returns {Promise<ExecutionResult>} Promise with stdout and stderr
+   * @private
+   */
+  private async executeCommand(
+    command: string,
+    args: string[],
+    options: {
+      cwd?: string;
+      input?: string;
+      failOnError?: boolean;
+      maxBytes?: number;
+      signal?: AbortSignal; // Kills the command when aborted
+      timeoutMs?: number; // Kills the command after this long
+      onStderr?: (chunk: string) => void;
+    } = {}
+  ): Promise<ExecutionResult> {
+    const maxBytes = options.maxBytes || DEFAULT_OUTPUT_LIMIT;
+
+    const timeoutMs = options.timeoutMs || TOOL_TIMEOUT_MS;
+
+    return new Promise((resolve, reject) => {
+      // Detached into its own process group, so a kill also reaches the
+      // compiler passes and assembler the driver started
+      const child = spawn(command, args, {
+        cwd: options.cwd,
+        detached: true,
+        stdio: [
+          options.input === undefined ? "ignore" : "pipe",
+          "pipe",
+          "pipe",
+        ],
+      });
+      const killGroup = () => {
+        try {
+          process.kill(-child.pid!, "SIGKILL");
+        } catch {
+          // Already exited
         }
-      )
+      };
+
+      // Pathological sources (template or constexpr blow-ups) must not hold
+      // a compile slot forever
+      let timedOut = false;
+      const timer = setTimeout(() => {
+        timedOut = true;
+        killGroup();
+      }, timeoutMs);
+      if (options.signal?.aborted) {
+        killGroup();
+      }
+      options.signal?.addEventListener("abort", killGroup, { once: true });
+      if (child.stdin) {
+        // A command that exits early closes its input; the exit is reported
+        child.stdin.on("error", () => {});
+        child.stdin.end(options.input);
+      }
+      const stdout: string[] = [];
+      const stderr: string[] = [];
+      let bytes = 0;
+      let truncated = false;
+
+      const collect =
+        (target: string[], onChunk?: (chunk: string) => void) =>
+        (data: Buffer) => {
+          if (truncated) {
+            return;
+          }
+
+          let chunk = data;
+          if (bytes + chunk.length > maxBytes) {
+            chunk = chunk.subarray(0, maxBytes - bytes);
+            truncated = true;
+            killGroup();
+          }
+          bytes += chunk.length;
+
+          const text = chunk.toString("utf8");
+          target.push(text);
+          onChunk?.(text);
+        };
+
+      child.stdout.on("data", collect(stdout));
+      child.stderr.on("data", collect(stderr, options.onStderr));
 
-      // Mark error summary for formatting
-      .replace(
-        /(ERROR SUMMARY:\s*(\d+) errors from \d+ contexts.*)/g,
-        function (_, text, errorCount) {
-          const count = parseInt(errorCount, 10);
-          // If there are errors, mark with ERROR_SUMMARY tag, otherwise mark with OK_SUMMARY tag
-          return count > 0
-            ? "###ERROR_SUMMARY:" + text + "###"
-            : "###OK_SUMMARY:" + text + "###";
+      child.on("error", (error) => {
+        clearTimeout(timer);
+        options.signal?.removeEventListener("abort", killGroup);
+        reject(error.message);
+      });
+      child.on("close", (code, signal) => {
+        clearTimeout(timer);
+        options.signal?.removeEventListener("abort", killGroup);
+        if (timedOut) {
+          reject(`${command} was stopped after ${timeoutMs / 1000} seconds`);
+          return;
         }
-      )
 
-      // Replace line number markers with formatted HTML
-      .replace(
-        /###LINE:(\d+)###/g,
-        '(line: <span class="line-number">$1</span>)'
-      )
+        const result: ExecutionResult = {
+          stdout: stdout.join(""),
+          stderr: stderr.join(""),
+          exitCode: code ?? 1,
+          truncated,
+        };
 
-      .replace(/###LEAK:(.*?)###/g, function (_, leakText) {
-        // style the leak text with a red border and background - without extra indentation
-        return `<div style="border-left: 2px solid #ef4444; background: rgba(239, 68, 68, 0.05); padding: 6px; margin: 6px 0; border-radius: 4px; box-shadow: 0 1px 2px rgba(0, 0, 0, 0.1); position: relative;"><span style="color: #FF5555; font-weight: bold;">&#9888; Memory Leak:</span> ${leakText}</div>`;
-      })
+        if (truncated) {
+          result.stderr += `\nOutput truncated after ${maxBytes} bytes`;
+        }
 
-      // Format error summary - using red color for errors with proper styling
-      .replace(
-        /###ERROR_SUMMARY:(.*?)###/g,
-        '<div style="color: #FF5555; font-weight: bold; margin-top: 10px; border-top: 1px dashed rgba(255,85,85,0.3); padding-top: 8px;">$1</div>'
-      )
+        const failed = truncated || code !== 0;
+        if (failed && options.failOnError !== false) {
+          reject(
+            result.stderr ||
+              result.stdout ||
+              `${command} exited with ${signal || code}`
+          );
+          return;
+        }
 
-      // Format ok summary - using green color for no errors
-      .replace(
-        /###OK_SUMMARY:(.*?)###/g,
-        '<div style="color: #50fa7b; font-weight: bold; margin-top: 8px;"><i class="fas fa-check-circle"></i> $1</div>'
-      )
+        resolve(result);
+      });
+    });
+  }
+
+  /**
+   * Format output for display
+   * @param {string} text - Text to format
+   * @param {string} outputType - Type of output (default, style, etc.)
+   * @returns {string} Formatted HTML output
+   * @private
+   */
+  private formatOutput(text: string, outputType: string = "default"): string {
+    if (!text) return "";
 
-      .trim() // Remove leading and trailing whitespace
-      .replace(/\n{2,}/g, "\n") // Remove multiple newlines
-      .replace(/^.*malloc.*\n?/gm, "");
+    // Only apply HTML sanitization for outputs that need it
+    if (outputType === "default" || outputType === "style") {
+      // Single pass: remove file paths, escape HTML and highlight severities
+      // and line:column locations
+      text = text.replace(OUTPUT_TOKENS, (token, line, column) => {
+        if (line !== undefined) {
+          return `<span class="line-number">${line}</span>:<span class="column-number">${column}</span>:`;
+        }
+        switch (token.toLowerCase()) {
+          case "&":
+            return "&amp;";
+          case "<":
+            return "&lt;";
+          case ">":
+            return "&gt;";
+          case "error:":
+            return '<span class="error-text">error:</span>';
+          case "warning:":
+            return '<span class="warning-text">warning:</span>';
+          default:
+            return "";
+        }
+      });
+    }
 
     return text;
   }
@@ -649,6 +1721,15 @@ export class CodeProcessingService implements ICodeProcessingService {
    * @private
    */
   private handleError(error: any, prefix?: string): any {
+    // Compiler failures are already rendered from their diagnostics
+    if (error instanceof CompileError) {
+      return {
+        success: false,
+        error: prefix ? `${prefix}: ${error.message}` : error.message,
+        diagnostics: error.diagnostics,
+      };
+    }
+
     // Convert error to string safely
     const errorStr =
       typeof error === "string"
@@ -0,0 +1,437 @@
+/**
+ * Compile Scheduler
+ * Bounds the number of concurrent compiler processes across all cluster workers
+ * The slot pool lives in the cluster primary; workers acquire slots over IPC
+ * Other cluster-wide slot pools (benchmark CPUs) use the same classes on
+ * their own IPC channel
+ */
+import os from "os";
+import { Worker } from "cluster";
+import {
+  CancelledError,
+  CompilePriority,
+  CompileScheduleOptions,
+  CompileSchedulerStats,
+} from "../types";
+import { clusterIpc } from "./clusterIpc";
+import { metrics } from "./metrics";
+
+const PRIORITIES: CompilePriority[] = ["interactive", "background"];
+
+const slotWait = metrics.histogram(
+  "cincout_slot_wait_seconds",
+  "Time a request waited for a slot, by pool"
+);
+
+/**
+ * A request waiting for a compile slot
+ */
+interface QueuedTicket {
+  worker: Worker | null;
+  ticket: number;
+  clientId: string;
+  enqueuedAt: number;
+  position: number;
+}
+
+/**
+ * Compile Slot Pool Implementation (primary side)
+ * Grants slots in priority order, round-robin across clients within a priority
+ * so one busy client cannot starve the others
+ */
+export class CompileSlotPool {
+  private readonly capacity: number;
+  private readonly channel: string;
+  private readonly queues = new Map<
+    CompilePriority,
+    Map<string, QueuedTicket[]>
+  >();
+  // Slot index held by each running ticket
+  private readonly running = new Map<string, number>();
+  private granted = 0;
+  private totalWaitMs = 0;
+  private maxWaitMs = 0;
+
+  /**
+   * Create a new CompileSlotPool
+   * @param {number} capacity - Number of concurrent compile slots
+   * @param {string} channel - IPC channel prefix
+   */
+  constructor(capacity: number, channel = "compile") {
+    this.capacity = Math.max(1, capacity);
+    this.channel = channel;
+    PRIORITIES.forEach((priority) => this.queues.set(priority, new Map()));
+  }
+
+  /**
+   * Queue a slot request
+   * @param {Worker | null} worker - Requesting worker (null for the local process)
+   * @param {number} ticket - Ticket number, unique per worker
+   * @param {string} clientId - Client identifier used for fairness
+   * @param {CompilePriority} priority - Request priority
+   */
+  enqueue(
+    worker: Worker | null,
+    ticket: number,
+    clientId: string,
+    priority: CompilePriority
+  ): void {
+    const clients =
+      this.queues.get(priority) || this.queues.get("background")!;
+    const queue = clients.get(clientId) || [];
+    queue.push({
+      worker,
+      ticket,
+      clientId,
+      enqueuedAt: Date.now(),
+      position: 0,
+    });
+    clients.set(clientId, queue);
+
+    this.dispatch();
+  }
+
+  /**
+   * Release a running slot or cancel a queued request
+   * @param {Worker | null} worker - Owning worker
+   * @param {number} ticket - Ticket number
+   */
+  release(worker: Worker | null, ticket: number): void {
+    const key = this.ticketKey(worker, ticket);
+
+    if (this.running.delete(key)) {
+      this.dispatch();
+      return;
+    }
+
+    this.removeQueued(
+      (queued) => this.ticketKey(queued.worker, queued.ticket) === key
+    );
+    this.dispatch();
+  }
+
+  /**
+   * Release everything held by a worker that exited
+   * @param {Worker} worker - Exited worker
+   */
+  releaseWorker(worker: Worker): void {
+    const prefix = `${worker.id}:`;
+    for (const key of Array.from(this.running.keys())) {
+      if (key.startsWith(prefix)) {
+        this.running.delete(key);
+      }
+    }
+
+    this.removeQueued((queued) => queued.worker === worker);
+    this.dispatch();
+  }
+
+  /**
+   * Get pool statistics
+   * @returns {CompileSchedulerStats} Slots, queue depth and wait times
+   */
+  getStats(): CompileSchedulerStats {
+    return {
+      capacity: this.capacity,
+      running: this.running.size,
+      queued: this.getDispatchOrder().length,
+      granted: this.granted,
+      averageWaitMs: this.granted > 0 ? this.totalWaitMs / this.granted : 0,
+      maxWaitMs: this.maxWaitMs,
+    };
+  }
+
+  /**
+   * Grant free slots and report queue positions to waiting requests
+   * @private
+   */
+  private dispatch(): void {
+    while (this.running.size < this.capacity) {
+      const next = this.getDispatchOrder()[0];
+      if (!next) {
+        break;
+      }
+      this.removeQueued((queued) => queued === next);
+
+      const waitMs = Date.now() - next.enqueuedAt;
+      this.granted++;
+      this.totalWaitMs += waitMs;
+      this.maxWaitMs = Math.max(this.maxWaitMs, waitMs);
+
+      const slot = this.freeSlot();
+      this.running.set(this.ticketKey(next.worker, next.ticket), slot);
+      clusterIpc.sendToWorker(next.worker, `${this.channel}:granted`, {
+        ticket: next.ticket,
+        waitMs,
+        slot,
+      });
+    }
+
+    // Only tell clients about positions that actually changed
+    this.getDispatchOrder().forEach((queued, index) => {
+      if (queued.position !== index + 1) {
+        queued.position = index + 1;
+        clusterIpc.sendToWorker(queued.worker, `${this.channel}:queued`, {
+          ticket: queued.ticket,
+          position: queued.position,
+        });
+      }
+    });
+  }
+
+  /**
+   * Find the lowest slot index not held by a running ticket
+   * @returns {number} Slot index
+   * @private
+   */
+  private freeSlot(): number {
+    const used = new Set(this.running.values());
+    let slot = 0;
+    while (used.has(slot)) {
+      slot++;
+    }
+    return slot;
+  }
+
+  /**
+   * Compute the order in which queued requests will be granted
+   * @returns {QueuedTicket[]} Queued requests, next to run first
+   * @private
+   */
+  private getDispatchOrder(): QueuedTicket[] {
+    const order: QueuedTicket[] = [];
+
+    for (const priority of PRIORITIES) {
+      const queues = Array.from(this.queues.get(priority)!.values());
+      for (
+        let round = 0;
+        queues.some((queue) => queue.length > round);
+        round++
+      ) {
+        for (const queue of queues) {
+          if (queue.length > round) {
+            order.push(queue[round]);
+          }
+        }
+      }
+    }
+
+    return order;
+  }
+
+  /**
+   * Remove queued requests matching a predicate
+   * Clients keep their round-robin turn by moving to the back once served
+   * @private
+   */
+  private removeQueued(predicate: (queued: QueuedTicket) => boolean): void {
+    for (const clients of this.queues.values()) {
+      for (const [clientId, queue] of Array.from(clients.entries())) {
+        const index = queue.findIndex(predicate);
+        if (index === -1) {
+          continue;
+        }
+
+        queue.splice(index, 1);
+        clients.delete(clientId);
+        if (queue.length > 0) {
+          clients.set(clientId, queue);
+        }
+      }
+    }
+  }
+
+  /**
+   * Build a key identifying a ticket across workers
+   * @private
+   */
+  private ticketKey(worker: Worker | null, ticket: number): string {
+    return `${worker ? worker.id : "local"}:${ticket}`;
+  }
+}
+
+/**
+ * Pending slot request on the worker side
+ */
+interface PendingRequest {
+  resolve: (slot: number) => void;
+  onQueued?: (position: number) => void;
+}
+
+/**
+ * Compile Scheduler Implementation (worker side)
+ */
+export class CompileScheduler {
+  private readonly channel: string;
+  private nextTicket = 1;
+  private pending = new Map<number, PendingRequest>();
+
+  /**
+   * Create a new CompileScheduler
+   * @param {string} channel - IPC channel prefix of the slot pool
+   */
+  constructor(channel = "compile") {
+    this.channel = channel;
+
+    clusterIpc.on(
+      `${channel}:granted`,
+      ({
+        ticket,
+        waitMs,
+        slot,
+      }: {
+        ticket: number;
+        waitMs: number;
+        slot: number;
+      }) => {
+        const request = this.pending.get(ticket);
+        if (request) {
+          this.pending.delete(ticket);
+          slotWait.observe({ pool: channel }, waitMs / 1000);
+          request.resolve(slot);
+        }
+      }
+    );
+
+    clusterIpc.on(
+      `${channel}:queued`,
+      ({ ticket, position }: { ticket: number; position: number }) => {
+        this.pending.get(ticket)?.onQueued?.(position);
+      }
+    );
+  }
+
+  /**
+   * Run a task while holding a compile slot
+   * A request aborted while queued gives up its place and rejects with a
+   * CancelledError; once running, the task has to watch the signal itself
+   * @param {CompileScheduleOptions} options - Client, priority, queue callback and abort signal
+   * @param {Function} task - Task to run once a slot is granted; receives
+   * the index of the granted slot
+   * @returns {Promise<T>} Result of the task
+   */
+  async run<T>(
+    options: CompileScheduleOptions | undefined,
+    task: (slot: number) => Promise<T>
+  ): Promise<T> {
+    const { slot, release } = await this.request(options);
+    try {
+      return await task(slot);
+    } finally {
+      release();
+    }
+  }
+
+  /**
+   * Acquire a compile slot
+   * @param {CompileScheduleOptions} options - Client, priority and queue callback
+   * @returns {Promise<Function>} Resolves with a release function once granted
+   */
+  async acquire(options?: CompileScheduleOptions): Promise<() => void> {
+    return (await this.request(options)).release;
+  }
+
+  /**
+   * Request a slot
+   * @private
+   */
+  private request(
+    options: CompileScheduleOptions = {}
+  ): Promise<{ slot: number; release: () => void }> {
+    const ticket = this.nextTicket++;
+    let released = false;
+    const release = () => {
+      if (!released) {
+        released = true;
+        clusterIpc.notify(`${this.channel}:release`, { ticket });
+      }
+    };
+
+    return new Promise((resolve, reject) => {
+      const signal = options.signal;
+      if (signal?.aborted) {
+        reject(new CancelledError());
+        return;
+      }
+
+      // The primary drops the queued ticket on release
+      const cancel = () => {
+        this.pending.delete(ticket);
+        release();
+        reject(new CancelledError());
+      };
+      signal?.addEventListener("abort", cancel, { once: true });
+
+      this.pending.set(ticket, {
+        resolve: (slot) => {
+          signal?.removeEventListener("abort", cancel);
+          resolve({ slot, release });
+        },
+        onQueued: options.onQueued,
+      });
+
+      clusterIpc.notify(`${this.channel}:acquire`, {
+        ticket,
+        clientId: options.clientId || "anonymous",
+        priority: options.priority || "interactive",
+      });
+    });
+  }
+}
+
+/**
+ * Create a slot pool and register its handlers in the process owning it
+ * The pool is owned by the primary (or the only process when not clustered)
+ * @param {string} channel - IPC channel prefix
+ * @param {number} capacity - Number of slots
+ * @returns {CompileSlotPool | null} Pool, or null in cluster workers
+ */
+export const createSlotPool = (
+  channel: string,
+  capacity: number
+): CompileSlotPool | null => {
+  if (clusterIpc.isWorker()) {
+    return null;
+  }
+
+  const pool = new CompileSlotPool(capacity, channel);
+  clusterIpc.handle(
+    `${channel}:acquire`,
+    (
+      {
+        ticket,
+        clientId,
+        priority,
+      }: { ticket: number; clientId: string; priority: CompilePriority },
+      worker
+    ) => pool.enqueue(worker, ticket, clientId, priority)
+  );
+
+  clusterIpc.handle(
+    `${channel}:release`,
+    ({ ticket }: { ticket: number }, worker) => pool.release(worker, ticket)
+  );
+
+  metrics.collect(
+    "cincout_slots",
+    "Slots of the cluster-wide pools, by pool and state",
+    "gauge",
+    () => {
+      const { capacity, running, queued } = pool.getStats();
+      return [
+        { labels: { pool: channel, state: "capacity" }, value: capacity },
+        { labels: { pool: channel, state: "running" }, value: running },
+        { labels: { pool: channel, state: "queued" }, value: queued },
+      ];
+    }
+  );
+  return pool;
+};
+
+export const compileSlotPool = createSlotPool(
+  "compile",
+  parseInt(process.env.CINCOUT_COMPILE_SLOTS || String(os.cpus().length), 10)
+);
+
+// Create singleton instance
+export const compileScheduler = new CompileScheduler();
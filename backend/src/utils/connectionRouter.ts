@@ -0,0 +1,189 @@
+/**
+ * Connection Router
+ * Hands incoming connections to the cluster worker with the fewest active
+ * sessions instead of distributing them round-robin
+ * The primary accepts connections; workers report their session counts over IPC
+ */
+import net from "net";
+import cluster, { Worker } from "cluster";
+import { Server } from "http";
+import { clusterIpc } from "./clusterIpc";
+import { metrics } from "./metrics";
+
+// Workers re-report periodically so connections that never became sessions
+// stop counting against them
+const REPORT_INTERVAL_MS = 5000;
+
+/**
+ * Load of a worker as seen by the primary
+ */
+interface WorkerLoad {
+  sessions: number; // Sessions at the last report
+  assigned: number; // Connections handed over since the last report
+}
+
+/**
+ * Connection Router Implementation
+ */
+export class ConnectionRouter {
+  private readonly enabled: boolean;
+  private readonly loads = new Map<number, WorkerLoad>();
+  // Workers finishing their sessions before they exit
+  private readonly draining = new Set<number>();
+  private nextStart = 0;
+
+  /**
+   * Create a new ConnectionRouter
+   * @param {boolean} enabled - Route by load; otherwise the cluster default
+   */
+  constructor(enabled: boolean) {
+    this.enabled = enabled;
+  }
+
+  /**
+   * Whether connections are accepted by the primary and handed to workers
+   * @returns {boolean} True if routing by load
+   */
+  isEnabled(): boolean {
+    return this.enabled;
+  }
+
+  /**
+   * Accept connections in the primary and route them (primary side)
+   * @param {number} port - Port to listen on
+   * @returns {net.Server} Listening server
+   */
+  listen(port: number): net.Server {
+    clusterIpc.handle(
+      "sessions:count",
+      ({ count }: { count: number }, worker: Worker | null) => {
+        if (worker && !this.draining.has(worker.id)) {
+          this.loads.set(worker.id, { sessions: count, assigned: 0 });
+        }
+      }
+    );
+    cluster.on("exit", (worker: Worker) => {
+      this.loads.delete(worker.id);
+      this.draining.delete(worker.id);
+    });
+    metrics.collect(
+      "cincout_worker_sessions",
+      "Sessions of each worker at its last report to the connection router",
+      "gauge",
+      () =>
+        Array.from(this.getLoads(), ([id, sessions]) => ({
+          labels: { worker: String(id) },
+          value: sessions,
+        }))
+    );
+
+    const server = net.createServer({ pauseOnConnect: true }, (socket) =>
+      this.route(socket)
+    );
+    server.listen(port);
+    return server;
+  }
+
+  /**
+   * Serve connections handed over by the primary (worker side)
+   * @param {Server} server - HTTP server of the worker
+   * @param {Function} getSessionCount - Returns the worker's session count
+   */
+  attach(server: Server, getSessionCount: () => number): void {
+    clusterIpc.on(
+      "connection:handoff",
+      (_payload: any, handle?: net.Socket) => {
+        if (handle) {
+          server.emit("connection", handle);
+          handle.resume();
+        }
+      }
+    );
+
+    // The first report tells the primary this worker accepts connections
+    this.reportSessions(getSessionCount());
+    setInterval(
+      () => this.reportSessions(getSessionCount()),
+      REPORT_INTERVAL_MS
+    ).unref();
+  }
+
+  /**
+   * Report the worker's session count to the primary (worker side)
+   * @param {number} count - Active sessions
+   */
+  reportSessions(count: number): void {
+    if (this.enabled && clusterIpc.isWorker()) {
+      clusterIpc.notify("sessions:count", { count });
+    }
+  }
+
+  /**
+   * Stop handing connections to a worker that is draining (primary side)
+   * @param {Worker} worker - Draining worker
+   */
+  drain(worker: Worker): void {
+    this.draining.add(worker.id);
+    this.loads.delete(worker.id);
+  }
+
+  /**
+   * Get the load of every ready worker (primary side)
+   * @returns {Map<number, number>} Active sessions by worker ID
+   */
+  getLoads(): Map<number, number> {
+    const loads = new Map<number, number>();
+    this.loads.forEach((load, id) => loads.set(id, load.sessions));
+    return loads;
+  }
+
+  /**
+   * Hand a connection to the least loaded worker
+   * @param {net.Socket} socket - Paused connection
+   * @private
+   */
+  private route(socket: net.Socket): void {
+    const worker = this.pickWorker();
+    if (!worker) {
+      socket.destroy();
+      return;
+    }
+
+    this.loads.get(worker.id)!.assigned++;
+    clusterIpc.sendToWorker(worker, "connection:handoff", {}, socket);
+  }
+
+  /**
+   * Pick the ready worker with the fewest sessions
+   * Ties go round-robin so idle workers share the load evenly
+   * @returns {Worker | null} Worker, or null if none is ready
+   * @private
+   */
+  private pickWorker(): Worker | null {
+    const workers = Object.values(cluster.workers || {}).filter(
+      (worker): worker is Worker =>
+        !!worker && worker.isConnected() && this.loads.has(worker.id)
+    );
+    if (workers.length === 0) {
+      return null;
+    }
+
+    const start = this.nextStart++ % workers.length;
+    let best: Worker | null = null;
+    let bestLoad = Infinity;
+    for (let i = 0; i < workers.length; i++) {
+      const worker = workers[(start + i) % workers.length];
+      const load = this.loads.get(worker.id)!;
+      if (load.sessions + load.assigned < bestLoad) {
+        best = worker;
+        bestLoad = load.sessions + load.assigned;
+      }
+    }
+    return best;
+  }
+}
+
+// Create singleton instance
+export const connectionRouter = new ConnectionRouter(
+  process.env.CINCOUT_CONNECTION_ROUTING !== "round-robin"
+);
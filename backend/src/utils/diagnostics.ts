@@ -0,0 +1,249 @@
+/**
+ * Compiler Diagnostics
+ * Parses compiler output into structured diagnostics and renders them as HTML
+ */
+import * as path from "path";
+import { CompilerDiagnostic } from "../types";
+
+// "file:line:column: severity: message" as printed by gcc, clang and ld;
+// gcc context lines ("required from here") have no severity
+const TEXT_DIAGNOSTIC =
+  /^(?:(.*?):)?(\d+):(\d+):\s+(?:(fatal error|error|warning|note|remark): )?(.*)$/;
+
+// "2 errors generated." printed by clang after its diagnostics
+const SUMMARY_LINE = /^\d+ (error|warning)s?( and \d+ \w+)? generated\.$/;
+
+/**
+ * Incremental compiler output parser
+ * Accepts stderr in arbitrary chunks and hands out each diagnostic as soon as
+ * it is complete, i.e. once the next one starts (notes attach to their parent)
+ */
+export class DiagnosticStream {
+  private remainder = "";
+  private current: CompilerDiagnostic | null = null;
+  // Text diagnostics are followed by a source excerpt and caret line
+  private inExcerpt = false;
+
+  /**
+   * Feed a chunk of compiler output
+   * @param {string} chunk - Output chunk
+   * @returns {CompilerDiagnostic[]} Diagnostics completed by this chunk
+   */
+  push(chunk: string): CompilerDiagnostic[] {
+    const lines = (this.remainder + chunk).split("\n");
+    this.remainder = lines.pop() || "";
+
+    const completed: CompilerDiagnostic[] = [];
+    for (const line of lines) {
+      this.parseLine(line.trimEnd(), completed);
+    }
+    return completed;
+  }
+
+  /**
+   * Signal the end of the output
+   * @returns {CompilerDiagnostic[]} Remaining diagnostics
+   */
+  end(): CompilerDiagnostic[] {
+    const completed: CompilerDiagnostic[] = [];
+    this.parseLine(this.remainder.trimEnd(), completed);
+    this.remainder = "";
+
+    if (this.current) {
+      completed.push(this.current);
+      this.current = null;
+    }
+    return completed;
+  }
+
+  /**
+   * Parse a single output line
+   * @private
+   */
+  private parseLine(line: string, completed: CompilerDiagnostic[]): void {
+    if (!line) {
+      return;
+    }
+
+    const match = line.match(TEXT_DIAGNOSTIC);
+    if (match) {
+      // clang appends the enabling warning option to the message
+      const option = match[5].match(/^(.*) \[(-W[^\]]+)\]$/);
+      const diagnostic: CompilerDiagnostic = {
+        kind: match[4] || "note",
+        message: option ? option[1] : match[5].trim(),
+        file: match[1] ? path.basename(match[1]) : undefined,
+        line: parseInt(match[2], 10),
+        column: parseInt(match[3], 10),
+        option: option ? option[2] : undefined,
+        children: [],
+      };
+
+      // Attach notes to the diagnostic they explain
+      if (
+        match[4] === "note" &&
+        this.current &&
+        this.current.kind !== "note"
+      ) {
+        this.current.children.push(diagnostic);
+      } else {
+        this.start(diagnostic, completed);
+      }
+      this.inExcerpt = true;
+      return;
+    }
+
+    // Summaries such as "1 error generated." carry no information
+    if (SUMMARY_LINE.test(line)) {
+      this.inExcerpt = false;
+      return;
+    }
+
+    // Tool messages (ld, collect2, clang) and gcc context lines end an excerpt
+    const isToolMessage = /^(In file included from|[\w\/.+-]+: )/.test(line);
+    if (isToolMessage) {
+      this.inExcerpt = false;
+    }
+
+    // Source excerpts are re-rendered from the source
+    if (
+      (this.inExcerpt && !isToolMessage) ||
+      /^\s*(\d+\s*)?\|/.test(line) ||
+      /^[\s~^]*\^[\s~^]*$/.test(line)
+    ) {
+      return;
+    }
+
+    // Keep only file names so sandbox directories never reach the client,
+    // and drop the source file prefix of "program.c: In function 'main':"
+    const message = line
+      .replace(/(?:\/[^\s:\/]+)+\/([^\s:\/]+)/g, "$1")
+      .replace(/^program\.(c|cpp): /, "");
+    this.start(
+      {
+        kind: /error/i.test(message) ? "error" : "note",
+        message,
+        children: [],
+      },
+      completed
+    );
+  }
+
+  /**
+   * Start a new top-level diagnostic, completing the previous one
+   * @private
+   */
+  private start(
+    diagnostic: CompilerDiagnostic,
+    completed: CompilerDiagnostic[]
+  ): void {
+    if (this.current) {
+      completed.push(this.current);
+    }
+    this.current = diagnostic;
+  }
+}
+
+/**
+ * Parse compiler output into structured diagnostics
+ * @param {string} output - Compiler stderr
+ * @returns {CompilerDiagnostic[]} Diagnostics in output order
+ */
+export const parseCompilerOutput = (output: string): CompilerDiagnostic[] => {
+  const stream = new DiagnosticStream();
+  return [...stream.push(output), ...stream.end()];
+};
+
+/**
+ * Check whether diagnostics contain errors reported by the compiler proper
+ * Location-less errors come from the linker
+ * @param {CompilerDiagnostic[]} diagnostics - Parsed diagnostics
+ * @returns {boolean} True if compilation (not linking) failed
+ */
+export const hasCompileErrors = (diagnostics: CompilerDiagnostic[]): boolean =>
+  diagnostics.some(
+    (diagnostic) =>
+      diagnostic.kind.includes("error") && diagnostic.line !== undefined
+  );
+
+/**
+ * Escape text for HTML output
+ * @param {string} text - Raw text
+ * @returns {string} Escaped text
+ */
+const escapeHtml = (text: string): string =>
+  text.replace(/&/g, "&amp;").replace(/</g, "&lt;").replace(/>/g, "&gt;");
+
+/**
+ * Render a single diagnostic and its children
+ * @private
+ */
+const renderDiagnostic = (
+  diagnostic: CompilerDiagnostic,
+  sourceLines: string[],
+  indent: string
+): string => {
+  const severityClass = diagnostic.kind.includes("error")
+    ? "error-text"
+    : diagnostic.kind === "warning"
+    ? "warning-text"
+    : "";
+  const severity = severityClass
+    ? `<span class="${severityClass}">${diagnostic.kind}:</span>`
+    : `${diagnostic.kind}:`;
+
+  // Diagnostics in the user's source are shown without a file name
+  const inSource = !diagnostic.file || diagnostic.file.startsWith("program.");
+  let location = "";
+  if (diagnostic.line !== undefined) {
+    location = `<span class="line-number">${diagnostic.line}</span>:<span class="column-number">${diagnostic.column}</span>: `;
+    if (!inSource) {
+      location = `${escapeHtml(diagnostic.file!)}:${location}`;
+    }
+  }
+
+  // Location-less entries (linker output) are shown verbatim
+  if (!location && !diagnostic.file) {
+    return `${indent}${escapeHtml(diagnostic.message)}\n`;
+  }
+
+  const option = diagnostic.option ? ` [${escapeHtml(diagnostic.option)}]` : "";
+  let text = `${indent}${location}${severity} ${escapeHtml(
+    diagnostic.message
+  )}${option}\n`;
+
+  // Show the offending source line with a caret under the column
+  const sourceLine =
+    diagnostic.line !== undefined && inSource
+      ? sourceLines[diagnostic.line - 1]
+      : undefined;
+  if (sourceLine !== undefined && diagnostic.kind !== "note") {
+    const gutter = String(diagnostic.line).padStart(5);
+    const caretPad = " ".repeat(Math.max(0, (diagnostic.column || 1) - 1));
+    text += `${indent}${gutter} | ${escapeHtml(sourceLine)}\n`;
+    text += `${indent}${" ".repeat(gutter.length)} | ${caretPad}^\n`;
+  }
+
+  for (const child of diagnostic.children) {
+    text += renderDiagnostic(child, sourceLines, indent + "  ");
+  }
+
+  return text;
+};
+
+/**
+ * Render diagnostics as HTML for the output panel
+ * @param {CompilerDiagnostic[]} diagnostics - Diagnostics to render
+ * @param {string} code - Source code the diagnostics refer to
+ * @returns {string} HTML text
+ */
+export const renderDiagnostics = (
+  diagnostics: CompilerDiagnostic[],
+  code: string
+): string => {
+  const sourceLines = code.split("\n");
+  return diagnostics
+    .map((diagnostic) => renderDiagnostic(diagnostic, sourceLines, ""))
+    .join("")
+    .trimEnd();
+};
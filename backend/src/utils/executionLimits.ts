@@ -0,0 +1,582 @@
+/**
+ * Execution Limits
+ * Confines each user program to its own cgroup (v2) with CPU, memory and
+ * process limits plus a wall-clock deadline, and reports what it consumed
+ * Without a writable cgroup v2 hierarchy, shell ulimits are used instead;
+ * they cap CPU time, the process count and, loosely, address space
+ */
+import * as fs from "fs-extra";
+import * as path from "path";
+import {
+  ExecutionProfile,
+  ExecutionProfileName,
+  ExecutionStats,
+  KillReason,
+} from "../types";
+import { metrics } from "./metrics";
+
+const executionDuration = metrics.histogram(
+  "cincout_execution_duration_seconds",
+  "Wall time of limited process trees (runs, valgrind, strace...) by profile"
+);
+
+/**
+ * Limits for each kind of session
+ */
+export const EXECUTION_PROFILES: Record<ExecutionProfileName, ExecutionProfile> =
+  {
+    run: {
+      cpuPercent: 50,
+      memoryMB: 256,
+      pids: 64,
+      wallClockSeconds: 300,
+      limitAddressSpace: true,
+    },
+    debug: {
+      cpuPercent: 50,
+      memoryMB: 512,
+      pids: 64,
+      wallClockSeconds: 900,
+      limitAddressSpace: false, // gdb maps far more than it uses
+    },
+    trace: {
+      cpuPercent: 50,
+      memoryMB: 256,
+      pids: 64,
+      wallClockSeconds: 120,
+      limitAddressSpace: true,
+    },
+    memcheck: {
+      cpuPercent: 100,
+      memoryMB: 1024,
+      pids: 64,
+      wallClockSeconds: 300,
+      limitAddressSpace: false, // valgrind and sanitizers reserve huge ranges
+    },
+    benchmark: {
+      cpuPercent: 100, // Throttling would distort the timings
+      memoryMB: 256,
+      pids: 64,
+      wallClockSeconds: 120,
+      limitAddressSpace: true,
+    },
+    profile: {
+      cpuPercent: 50,
+      memoryMB: 512,
+      pids: 64,
+      wallClockSeconds: 120,
+      limitAddressSpace: false, // perf maps a sample buffer per CPU
+    },
+  };
+
+// Address space the ulimit fallback allows beyond the memory limit; glibc
+// reserves 64 MB per malloc arena and every thread has its own stack, so a
+// cap near the memory limit breaks ordinary multithreaded programs
+const ADDRESS_SPACE_HEADROOM_MB = 4096;
+
+// Environment user programs run with; nothing from the server leaks through
+const BASE_ENV: { [key: string]: string } = {
+  PATH: "/usr/local/bin:/usr/bin:/bin",
+  LANG: "C.UTF-8",
+  TERM: "xterm-256color",
+};
+
+/**
+ * Build the environment user programs run with
+ * @param {string} home - Home directory (the sandbox)
+ * @returns {object} Environment variables
+ */
+export const minimalEnv = (home: string): { [key: string]: string } => ({
+  ...BASE_ENV,
+  HOME: home,
+  TMPDIR: home,
+});
+
+const CPU_PERIOD_US = 100000;
+const SIGXCPU = 24;
+
+/**
+ * A single limited process tree
+ */
+export class LimitedExecution {
+  readonly profile: ExecutionProfile;
+  private readonly profileName: ExecutionProfileName | null;
+  private readonly cgroupDir: string | null;
+  private killer: (() => void) | null = null;
+  private deadline: NodeJS.Timeout | null = null;
+  private startedAt = 0;
+  private killReason: KillReason | null = null;
+  private stats: Promise<ExecutionStats> | null = null;
+  private readonly processLimit: number | null;
+
+  /**
+   * Create a new LimitedExecution
+   * @param {ExecutionProfile} profile - Limits to apply
+   * @param {string | null} cgroupDir - Dedicated cgroup, or null for ulimits
+   * @param {ExecutionProfileName} profileName - Profile name in the metrics
+   * @param {number | null} processLimit - RLIMIT_NPROC for the ulimits
+   */
+  constructor(
+    profile: ExecutionProfile,
+    cgroupDir: string | null,
+    profileName: ExecutionProfileName | null = null,
+    processLimit: number | null = null
+  ) {
+    this.profile = profile;
+    this.cgroupDir = cgroupDir;
+    this.profileName = profileName;
+    this.processLimit = processLimit;
+  }
+
+  /**
+   * Wrap a shell command so it runs under the limits
+   * The shell moves itself into the cgroup (or sets ulimits) and then execs
+   * the command, so every descendant inherits the limits
+   * @param {string} command - Shell command
+   * @returns {string} Wrapped command
+   */
+  wrapCommand(command: string): string {
+    if (this.cgroupDir) {
+      return `echo $$ > "${path.join(
+        this.cgroupDir,
+        "cgroup.procs"
+      )}" && exec ${command}`;
+    }
+
+    const cpuSeconds = Math.ceil(
+      (this.profile.wallClockSeconds * this.profile.cpuPercent) / 100
+    );
+    const limits = [`ulimit -t ${cpuSeconds}`];
+    if (this.processLimit) {
+      // bash spells it -u, dash -p
+      limits.push(
+        `ulimit -u ${this.processLimit} 2>/dev/null || ulimit -p ${this.processLimit}`
+      );
+    }
+    if (this.profile.limitAddressSpace) {
+      limits.push(
+        `ulimit -v ${
+          (this.profile.memoryMB + ADDRESS_SPACE_HEADROOM_MB) * 1024
+        }`
+      );
+    }
+    return `${limits.join(" 2>/dev/null; ")} 2>/dev/null; exec ${command}`;
+  }
+
+  /**
+   * Build the environment for the process
+   * @param {string} home - Home directory (the sandbox)
+   * @returns {object} Environment variables
+   */
+  getEnv(home: string): { [key: string]: string } {
+    return minimalEnv(home);
+  }
+
+  /**
+   * Move an already running process into the cgroup
+   * Used for pre-started processes; children forked afterwards inherit it
+   * @param {number} pid - Process ID
+   * @returns {Promise<boolean>} True if the process is now in the cgroup
+   */
+  async adopt(pid: number): Promise<boolean> {
+    if (!this.cgroupDir) {
+      return false;
+    }
+    try {
+      await fs.writeFile(
+        path.join(this.cgroupDir, "cgroup.procs"),
+        String(pid)
+      );
+      return true;
+    } catch (error) {
+      console.error(`Failed to move process ${pid} into cgroup:`, error);
+      return false;
+    }
+  }
+
+  /**
+   * Arm the wall-clock deadline once the process is running
+   * @param {Function} killer - Kills the process
+   */
+  start(killer: () => void): void {
+    this.killer = killer;
+    this.startedAt = Date.now();
+    this.deadline = setTimeout(
+      () => this.kill("timeout"),
+      this.profile.wallClockSeconds * 1000
+    );
+  }
+
+  /**
+   * Kill the whole process tree
+   * @param {KillReason} reason - Why the process is killed
+   */
+  kill(reason: KillReason): void {
+    if (this.stats) {
+      return;
+    }
+
+    this.killReason = this.killReason || reason;
+    this.writeControl("cgroup.kill", "1");
+    try {
+      this.killer?.();
+    } catch {
+      // Already gone
+    }
+  }
+
+  /**
+   * Collect resource usage after the process exited and release the cgroup
+   * Calling it again returns the same statistics
+   * @param {number} signal - Signal that terminated the process, if any
+   * @returns {Promise<ExecutionStats>} Resource usage and kill reason
+   */
+  finish(signal?: number): Promise<ExecutionStats> {
+    if (!this.stats) {
+      this.stats = this.collect(signal);
+    }
+    return this.stats;
+  }
+
+  /**
+   * Read the resource usage, then release the cgroup
+   * @param {number} signal - Signal that terminated the process, if any
+   * @returns {Promise<ExecutionStats>} Resource usage and kill reason
+   * @private
+   */
+  private async collect(signal?: number): Promise<ExecutionStats> {
+    const finishedAt = Date.now();
+    if (this.deadline) {
+      clearTimeout(this.deadline);
+      this.deadline = null;
+    }
+
+    const [oomKills, usageUsec, peakText] = await Promise.all([
+      this.readKeyed("memory.events", "oom_kill"),
+      this.readKeyed("cpu.stat", "usage_usec"),
+      this.readControl("memory.peak"),
+    ]);
+    const peak = parseInt(peakText || "", 10);
+
+    let killReason = this.killReason;
+    if (!killReason && oomKills > 0) {
+      killReason = "memory";
+    }
+    if (!killReason && signal === SIGXCPU) {
+      killReason = "cpu";
+    }
+
+    const stats: ExecutionStats = {
+      wallTimeMs: this.startedAt ? finishedAt - this.startedAt : 0,
+      cpuTimeMs: usageUsec >= 0 ? Math.round(usageUsec / 1000) : null,
+      peakMemoryBytes: Number.isFinite(peak) ? peak : null,
+      killReason,
+    };
+    if (this.profileName && this.startedAt) {
+      executionDuration.observe(
+        { profile: this.profileName, outcome: killReason || "exited" },
+        stats.wallTimeMs / 1000
+      );
+    }
+
+    await this.release();
+    return stats;
+  }
+
+  /**
+   * Remove the cgroup, killing stragglers first
+   * @private
+   */
+  private async release(): Promise<void> {
+    if (!this.cgroupDir) {
+      return;
+    }
+
+    const dir = this.cgroupDir;
+    try {
+      await fs.rmdir(dir);
+    } catch {
+      // Descendants still running: kill them and retry shortly
+      await this.writeControl("cgroup.kill", "1");
+      setTimeout(() => {
+        fs.rmdir(dir).catch((error) => {
+          console.error(`Failed to remove cgroup ${dir}:`, error);
+        });
+      }, 100);
+    }
+  }
+
+  /**
+   * Read a value from a "key value" cgroup file
+   * @returns {Promise<number>} Value, or -1 when unavailable
+   * @private
+   */
+  private async readKeyed(file: string, key: string): Promise<number> {
+    const line = ((await this.readControl(file)) || "")
+      .split("\n")
+      .find((entry) => entry.startsWith(`${key} `));
+    return line ? parseInt(line.split(" ")[1], 10) : -1;
+  }
+
+  /**
+   * Read a cgroup control file
+   * @private
+   */
+  private async readControl(file: string): Promise<string | null> {
+    if (!this.cgroupDir) {
+      return null;
+    }
+    try {
+      const text = await fs.readFile(path.join(this.cgroupDir, file), "utf8");
+      return text.trim();
+    } catch {
+      return null;
+    }
+  }
+
+  /**
+   * Write a cgroup control file, ignoring unsupported files
+   * @private
+   */
+  private async writeControl(file: string, value: string): Promise<void> {
+    if (!this.cgroupDir) {
+      return;
+    }
+    try {
+      await fs.writeFile(path.join(this.cgroupDir, file), value);
+    } catch {
+      // Not supported by this kernel
+    }
+  }
+}
+
+/**
+ * Execution Limiter Implementation
+ * Creates a child cgroup under a delegated parent for every process tree
+ */
+export class ExecutionLimiter {
+  private readonly parentDir: string | null;
+  private nextId = 1;
+
+  /**
+   * Create a new ExecutionLimiter
+   * @param {string | null} parentDir - Delegated cgroup v2 directory, or null
+   */
+  constructor(parentDir: string | null) {
+    this.parentDir = parentDir && this.prepareParent(parentDir);
+    if (!this.parentDir) {
+      console.warn(
+        "Sessions run under ulimits without cgroups: no memory limit, only CPU time, a per-user process count and a loose address space cap"
+      );
+    }
+  }
+
+  /**
+   * Create a limited execution for a session
+   * @param {ExecutionProfileName} profileName - Profile to apply
+   * @param {string} sessionId - Session ID, used to name the cgroup
+   * @returns {Promise<LimitedExecution>} Limited execution
+   */
+  async create(
+    profileName: ExecutionProfileName,
+    sessionId: string
+  ): Promise<LimitedExecution> {
+    const profile = EXECUTION_PROFILES[profileName];
+    if (!this.parentDir) {
+      return this.createUnconfined(profile, profileName);
+    }
+
+    const dir = path.join(
+      this.parentDir,
+      `${profileName}-${process.pid}-${this.nextId++}-${sessionId.slice(0, 8)}`
+    );
+    try {
+      await fs.mkdir(dir);
+      await Promise.all([
+        fs.writeFile(
+          path.join(dir, "cpu.max"),
+          `${(CPU_PERIOD_US * profile.cpuPercent) / 100} ${CPU_PERIOD_US}`
+        ),
+        fs.writeFile(
+          path.join(dir, "memory.max"),
+          String(profile.memoryMB * 1024 * 1024)
+        ),
+        fs.writeFile(path.join(dir, "pids.max"), String(profile.pids)),
+        fs.writeFile(path.join(dir, "memory.swap.max"), "0").catch(() => {
+          // No swap accounting
+        }),
+      ]);
+      return new LimitedExecution(profile, dir, profileName);
+    } catch (error) {
+      console.error(`Failed to create cgroup ${dir}, using ulimits:`, error);
+      fs.rmdir(dir).catch(() => {});
+      return this.createUnconfined(profile, profileName);
+    }
+  }
+
+  /**
+   * Create a limited execution that relies on ulimits
+   * RLIMIT_NPROC counts every process (and thread) of the server's user, not
+   * just the session's, so the limit is the user's current count plus the
+   * profile's allowance: a fork bomb stops there without starving the server,
+   * whose own processes keep their unlimited RLIMIT_NPROC
+   * @param {ExecutionProfile} profile - Limits to apply
+   * @param {ExecutionProfileName} profileName - Profile name in the metrics
+   * @returns {Promise<LimitedExecution>} Limited execution
+   * @private
+   */
+  private async createUnconfined(
+    profile: ExecutionProfile,
+    profileName: ExecutionProfileName
+  ): Promise<LimitedExecution> {
+    const current = await countUserTasks();
+    return new LimitedExecution(
+      profile,
+      null,
+      profileName,
+      current === null ? null : current + profile.pids
+    );
+  }
+
+  /**
+   * Kill and remove the cgroups of a process that exited without releasing
+   * them; cgroups are named after their owning process for this purpose
+   * @param {number} pid - Process ID of the exited worker
+   */
+  async removeOrphans(pid: number): Promise<void> {
+    if (!this.parentDir) {
+      return;
+    }
+
+    const parentDir = this.parentDir;
+    const names = await fs.readdir(parentDir).catch(() => [] as string[]);
+    await Promise.all(
+      names
+        .filter((name) => name.split("-")[1] === String(pid))
+        .map(async (name) => {
+          const dir = path.join(parentDir, name);
+          await fs.writeFile(path.join(dir, "cgroup.kill"), "1").catch(() => {
+            // Not supported by this kernel, or already empty
+          });
+          setTimeout(() => {
+            fs.rmdir(dir).catch((error) => {
+              console.error(`Failed to remove cgroup ${dir}:`, error);
+            });
+          }, 100);
+        })
+    );
+  }
+
+  /**
+   * Whether processes are confined by cgroups
+   * @returns {boolean} True when cgroup v2 limits are in use
+   */
+  usesCgroups(): boolean {
+    return this.parentDir !== null;
+  }
+
+  /**
+   * Make sure the parent cgroup exists and delegates the needed controllers
+   * A controller is only available in a cgroup when its parent enables it
+   * for its children, so they are enabled top-down from the root. Runs once
+   * at startup, before any request is served
+   * @param {string} dir - Parent cgroup directory
+   * @returns {string | null} The directory, or null when unusable
+   * @private
+   */
+  private prepareParent(dir: string): string | null {
+    try {
+      const root = "/sys/fs/cgroup";
+      if (!fs.existsSync(path.join(root, "cgroup.controllers"))) {
+        return null;
+      }
+
+      fs.ensureDirSync(dir);
+      const relative = path.relative(root, path.resolve(dir));
+      if (relative.startsWith("..")) {
+        throw new Error(`${dir} is not under ${root}`);
+      }
+
+      // Ancestors may already delegate them, or belong to someone else
+      let ancestor = root;
+      for (const part of relative.split(path.sep).filter(Boolean)) {
+        enableControllers(ancestor, false);
+        ancestor = path.join(ancestor, part);
+      }
+      enableControllers(dir, true);
+      return dir;
+    } catch (error) {
+      console.warn(
+        `cgroup v2 limits unavailable (${
+          (error as Error).message
+        }), using ulimits`
+      );
+      return null;
+    }
+  }
+}
+
+/**
+ * Let the children of a cgroup use the cpu, memory and pids controllers
+ * @param {string} dir - cgroup directory
+ * @param {boolean} required - Throw instead of logging when it fails
+ */
+const enableControllers = (dir: string, required: boolean): void => {
+  try {
+    fs.writeFileSync(
+      path.join(dir, "cgroup.subtree_control"),
+      "+cpu +memory +pids"
+    );
+  } catch (error) {
+    if (required) {
+      throw error;
+    }
+    console.warn(
+      `Failed to enable cgroup controllers in ${dir}: ${
+        (error as Error).message
+      }`
+    );
+  }
+};
+
+/**
+ * Count the processes and threads of the server's user, which is what
+ * RLIMIT_NPROC is checked against
+ * @returns {Promise<number | null>} Count, or null when /proc is unreadable
+ */
+const countUserTasks = async (): Promise<number | null> => {
+  const uid = process.getuid?.();
+  if (uid === undefined) {
+    return null;
+  }
+
+  try {
+    const pids = (await fs.readdir("/proc")).filter((name) =>
+      /^\d+$/.test(name)
+    );
+    const counts = await Promise.all(
+      pids.map(async (pid) => {
+        try {
+          const status = await fs.readFile(`/proc/${pid}/status`, "utf8");
+          const owner = /^Uid:\s+(\d+)/m.exec(status);
+          const threads = /^Threads:\s+(\d+)/m.exec(status);
+          return owner && Number(owner[1]) === uid && threads
+            ? Number(threads[1])
+            : 0;
+        } catch {
+          return 0; // Exited meanwhile
+        }
+      })
+    );
+    return counts.reduce((total, count) => total + count, 0);
+  } catch {
+    return null;
+  }
+};
+
+// Create singleton instance
+export const executionLimiter = new ExecutionLimiter(
+  process.env.CINCOUT_CGROUP_DIR === "off"
+    ? null
+    : process.env.CINCOUT_CGROUP_DIR || "/sys/fs/cgroup/cincout"
+);
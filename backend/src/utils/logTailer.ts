@@ -0,0 +1,114 @@
+/**
+ * Log Tailer
+ * Follows a file another process is writing and hands out what was appended,
+ * reading a bounded amount per poll so memory stays flat however large the
+ * file grows
+ */
+import * as fs from "fs-extra";
+import { StringDecoder } from "string_decoder";
+
+const POLL_INTERVAL_MS = 100;
+const CHUNK_SIZE = 64 * 1024;
+const MAX_BYTES_PER_POLL = 1024 * 1024;
+
+/**
+ * Log Tailer Implementation
+ */
+export class LogTailer {
+  private readonly file: string;
+  private readonly onData: (chunk: string) => void;
+  private readonly decoder = new StringDecoder("utf8");
+  private readonly buffer = Buffer.alloc(CHUNK_SIZE);
+  private position = 0;
+  private timer: NodeJS.Timeout | null = null;
+  private reading: Promise<void> = Promise.resolve();
+  private stopped = false;
+
+  /**
+   * Create a new LogTailer
+   * @param {string} file - File to follow; it may not exist yet
+   * @param {Function} onData - Receives appended text in order
+   */
+  constructor(file: string, onData: (chunk: string) => void) {
+    this.file = file;
+    this.onData = onData;
+  }
+
+  /**
+   * Start polling the file
+   */
+  start(): void {
+    const poll = () => {
+      this.reading = this.reading
+        .then(() => this.read(MAX_BYTES_PER_POLL))
+        .finally(() => {
+          if (!this.stopped) {
+            this.timer = setTimeout(poll, POLL_INTERVAL_MS);
+          }
+        });
+    };
+    this.timer = setTimeout(poll, POLL_INTERVAL_MS);
+  }
+
+  /**
+   * Stop polling and read everything that is left
+   * Call once the writer has exited
+   * @returns {Promise<void>} Resolves after the last chunk was delivered
+   */
+  async stop(): Promise<void> {
+    this.stopped = true;
+    if (this.timer) {
+      clearTimeout(this.timer);
+      this.timer = null;
+    }
+
+    await this.reading;
+    await this.read(Infinity);
+
+    const rest = this.decoder.end();
+    if (rest) {
+      this.onData(rest);
+    }
+  }
+
+  /**
+   * Read up to a number of new bytes
+   * @param {number} limit - Maximum bytes to read
+   * @private
+   */
+  private async read(limit: number): Promise<void> {
+    let fd: number;
+    try {
+      fd = await fs.open(this.file, "r");
+    } catch {
+      return; // Not created yet
+    }
+
+    try {
+      let total = 0;
+      while (total < limit) {
+        const { bytesRead } = await fs.read(
+          fd,
+          this.buffer,
+          0,
+          CHUNK_SIZE,
+          this.position
+        );
+        if (bytesRead === 0) {
+          break;
+        }
+
+        this.position += bytesRead;
+        total += bytesRead;
+        const text = this.decoder.write(this.buffer.subarray(0, bytesRead));
+        if (text) {
+          this.onData(text);
+        }
+      }
+    } catch (error) {
+      console.error(`Error reading ${this.file}:`, error);
+    } finally {
+      await fs.close(fd).catch(() => {});
+    }
+  }
+}
@@ -0,0 +1,272 @@
+/**
+ * Memcheck Parser
+ * Stream-parses valgrind --xml=yes output into typed error and leak records
+ * Only the elements of the memcheck XML protocol that are reported are kept;
+ * identical records (same kind and stack) are merged as they arrive
+ * LeakRecordSet is shared with the sanitizer report parser
+ */
+import * as path from "path";
+import { MemcheckFrame, MemcheckRecord, MemcheckSummary } from "../types";
+
+// Distinct records beyond this are only counted in the summary
+const MAX_RECORDS = 200;
+// Frames shown per stack; the rest are libc and loader internals
+const MAX_FRAMES = 12;
+
+const ENTITIES: Record<string, string> = {
+  lt: "<",
+  gt: ">",
+  amp: "&",
+  quot: '"',
+  apos: "'",
+};
+
+const LEAK_KINDS: Record<string, keyof MemcheckSummary> = {
+  Leak_DefinitelyLost: "definitelyLost",
+  Leak_IndirectlyLost: "indirectlyLost",
+  Leak_PossiblyLost: "possiblyLost",
+  Leak_StillReachable: "stillReachable",
+};
+
+/**
+ * Element of the XML tree below <error>
+ */
+interface XmlElement {
+  name: string;
+  text: string;
+  children: XmlElement[];
+}
+
+/**
+ * Decode XML character entities
+ * @param {string} text - Raw text
+ * @returns {string} Decoded text
+ */
+const decodeEntities = (text: string): string =>
+  text.replace(/&(#x[0-9a-f]+|#\d+|\w+);/gi, (entity, name: string) => {
+    if (name[0] === "#") {
+      return String.fromCodePoint(
+        name[1] === "x" || name[1] === "X"
+          ? parseInt(name.slice(2), 16)
+          : parseInt(name.slice(1), 10)
+      );
+    }
+    return ENTITIES[name] ?? entity;
+  });
+
+/**
+ * Find the text of a direct child element
+ * @private
+ */
+const childText = (element: XmlElement, name: string): string | undefined =>
+  element.children.find((child) => child.name === name)?.text;
+
+/**
+ * Convert a <stack> element into frames
+ * @private
+ */
+const toFrames = (stack: XmlElement): MemcheckFrame[] =>
+  stack.children
+    .filter((frame) => frame.name === "frame")
+    .map((frame) => {
+      const file = childText(frame, "file");
+      const line = childText(frame, "line");
+      const obj = childText(frame, "obj");
+      return {
+        fn: childText(frame, "fn"),
+        file,
+        line: line ? parseInt(line, 10) : undefined,
+        // Shared objects only matter when there is no source location
+        obj: !file && obj ? path.basename(obj) : undefined,
+      };
+    });
+
+/**
+ * Error and leak records of a run, merged by kind and stack
+ */
+export class LeakRecordSet {
+  private readonly records = new Map<string, MemcheckRecord>();
+  private readonly summary: MemcheckSummary = {
+    errors: 0,
+    definitelyLost: 0,
+    indirectlyLost: 0,
+    possiblyLost: 0,
+    stillReachable: 0,
+  };
+  private dropped = 0;
+
+  /**
+   * Get the parsed records
+   * @returns {MemcheckRecord[]} Errors in order of appearance, then leaks
+   * by severity
+   */
+  getRecords(): MemcheckRecord[] {
+    const severity = Object.keys(LEAK_KINDS);
+    return Array.from(this.records.values()).sort(
+      (a, b) => severity.indexOf(a.kind) - severity.indexOf(b.kind)
+    );
+  }
+
+  /**
+   * Get the run totals
+   * @returns {MemcheckSummary} Error count and leaked bytes by kind
+   */
+  getSummary(): MemcheckSummary {
+    return { ...this.summary };
+  }
+
+  /**
+   * Number of distinct records that were only counted
+   * @returns {number} Records beyond the record limit
+   */
+  getDroppedCount(): number {
+    return this.dropped;
+  }
+
+  /**
+   * Add a record, merging it into an earlier one with the same kind and stack
+   * @param {MemcheckRecord} record - Record with a count of 1
+   * @protected
+   */
+  protected addRecord(record: MemcheckRecord): void {
+    const leakKind = LEAK_KINDS[record.kind];
+    if (leakKind) {
+      this.summary[leakKind] += record.bytes || 0;
+    } else {
+      this.summary.errors++;
+    }
+
+    const stack = record.stack.slice(0, MAX_FRAMES);
+    const signature = `${record.kind}|${stack
+      .map((frame) => `${frame.fn}@${frame.file}:${frame.line}`)
+      .join("|")}`;
+
+    const existing = this.records.get(signature);
+    if (existing) {
+      existing.count++;
+      if (leakKind) {
+        existing.bytes = (existing.bytes || 0) + (record.bytes || 0);
+        existing.blocks = (existing.blocks || 0) + (record.blocks || 0);
+      }
+      return;
+    }
+
+    if (this.records.size >= MAX_RECORDS) {
+      this.dropped++;
+      return;
+    }
+
+    this.records.set(signature, {
+      ...record,
+      stack,
+      auxStack: record.auxStack?.slice(0, MAX_FRAMES),
+    });
+  }
+}
+
+/**
+ * Incremental memcheck XML parser
+ */
+export class MemcheckStream extends LeakRecordSet {
+  private remainder = "";
+  // Open elements inside the current <error>, outermost first
+  private open: XmlElement[] = [];
+
+  /**
+   * Feed a chunk of the XML output
+   * @param {string} chunk - XML chunk
+   */
+  push(chunk: string): void {
+    const text = this.remainder + chunk;
+
+    // Keep an incomplete trailing tag for the next chunk
+    const lastOpen = text.lastIndexOf("<");
+    const complete =
+      lastOpen > text.lastIndexOf(">") ? text.slice(0, lastOpen) : text;
+    this.remainder = text.slice(complete.length);
+
+    const tokens = /<([^>]*)>|([^<]+)/g;
+    let match: RegExpExecArray | null;
+    while ((match = tokens.exec(complete))) {
+      if (match[2] !== undefined) {
+        this.onText(match[2]);
+      } else {
+        this.onTag(match[1]);
+      }
+    }
+  }
+
+  /**
+   * Handle a tag
+   * @private
+   */
+  private onTag(tag: string): void {
+    // Declarations, comments and anything outside an <error> are ignored
+    if (tag[0] === "?" || tag[0] === "!") {
+      return;
+    }
+
+    if (tag[0] === "/") {
+      const element = this.open.pop();
+      if (!element) {
+        return;
+      }
+      element.text = decodeEntities(element.text).trim();
+      if (this.open.length === 0) {
+        this.addError(element);
+      }
+      return;
+    }
+
+    const name = tag.split(/[\s/]/, 1)[0];
+    if (this.open.length === 0 && name !== "error") {
+      return;
+    }
+
+    const element: XmlElement = { name, text: "", children: [] };
+    this.open[this.open.length - 1]?.children.push(element);
+    if (!tag.endsWith("/")) {
+      this.open.push(element);
+    }
+  }
+
+  /**
+   * Handle character data; it is decoded once the element closes
+   * @private
+   */
+  private onText(text: string): void {
+    const element = this.open[this.open.length - 1];
+    if (element) {
+      element.text += text;
+    }
+  }
+
+  /**
+   * Merge a completed <error> element into the records
+   * @private
+   */
+  private addError(error: XmlElement): void {
+    const kind = childText(error, "kind") || "Unknown";
+    const xwhat = error.children.find((child) => child.name === "xwhat");
+    const stacks = error.children.filter((child) => child.name === "stack");
+
+    const leaked = (name: string): number =>
+      parseInt((xwhat && childText(xwhat, name)) || "0", 10);
+    const leak = kind in LEAK_KINDS;
+
+    // Loss record numbers differ between otherwise identical leaks
+    const message =
+      (xwhat ? childText(xwhat, "text") : childText(error, "what")) || kind;
+
+    this.addRecord({
+      kind,
+      message: message.replace(/ in loss record \d+ of \d+$/, ""),
+      bytes: leak ? leaked("leakedbytes") : undefined,
+      blocks: leak ? leaked("leakedblocks") : undefined,
+      stack: stacks[0] ? toFrames(stacks[0]) : [],
+      auxMessage: childText(error, "auxwhat"),
+      auxStack: stacks[1] ? toFrames(stacks[1]) : undefined,
+      count: 1,
+    });
+  }
+}
@@ -0,0 +1,273 @@
+/**
+ * Memory Guard
+ * Recycles a worker whose memory grows past a soft limit without dropping
+ * its sessions: the primary forks the replacement first, then the worker
+ * stops taking connections, sheds caches, lets its sessions finish up to a
+ * deadline and exits. A heap snapshot taken at the breach, if enabled,
+ * shows what grew. Crossing the hard limit still exits at once
+ * The limits default to shares of the memory the server may use, so a
+ * worker is recycled well before the kernel kills anything; it is the only
+ * memory based restart, PM2 does not restart the server on memory
+ */
+import cluster, { Worker } from "cluster";
+import fs from "fs-extra";
+import os from "os";
+import path from "path";
+import v8 from "v8";
+import { Server } from "http";
+import { ResultCache } from "./resultCache";
+import { clusterIpc } from "./clusterIpc";
+import { connectionRouter } from "./connectionRouter";
+import { sessionService } from "./sessionService";
+import { debuggerPool, launcherPool } from "./warmPool";
+import { metrics } from "./metrics";
+import { webSocketManager } from "../ws/webSocketManager";
+
+const CHECK_INTERVAL_MS = 30 * 1000;
+const DRAIN_POLL_MS = 1000;
+// Output limit of sessions still running on a draining worker
+const DRAINING_OUTPUT_BYTES = 64 * 1024;
+// Snapshots kept in the snapshot directory, newest first
+const MAX_HEAP_SNAPSHOTS = 4;
+// Default limits as shares of a worker's part of the memory budget; the
+// rest is for the primary, programs run by sessions and, while a worker
+// drains, its replacement
+const SOFT_LIMIT_SHARE = 0.35;
+const HARD_LIMIT_SHARE = 0.5;
+const CGROUP_DIR = "/sys/fs/cgroup";
+const MB = 1024 * 1024;
+
+/**
+ * Memory limits and draining policy
+ */
+interface MemoryGuardOptions {
+  softLimitMB: number; // Start draining
+  hardLimitMB: number; // Exit at once
+  drainDeadlineMs: number; // Sessions still running then are terminated
+  heapSnapshotDir: string | null; // null disables heap snapshots
+}
+
+const drains = metrics.counter(
+  "cincout_worker_drains_total",
+  "Workers recycled after crossing the soft memory limit"
+);
+
+/**
+ * Read a memory value of the server's cgroup (v2)
+ * @param {string} file - Interface file, e.g. memory.max
+ * @returns {number | null} Bytes, or null without a limit or cgroup
+ */
+const readCgroupBytes = (file: string): number | null => {
+  try {
+    const value = parseInt(
+      fs.readFileSync(path.join(CGROUP_DIR, file), "utf8"),
+      10
+    );
+    return value > 0 ? value : null; // "max" parses as NaN
+  } catch {
+    return null;
+  }
+};
+
+/**
+ * Memory the server may use in megabytes: its cgroup limit, e.g. the
+ * container's, or the machine's memory
+ * @returns {number} Memory budget
+ */
+const getMemoryBudgetMB = (): number =>
+  Math.min(readCgroupBytes("memory.max") ?? Infinity, os.totalmem()) / MB;
+
+/**
+ * Memory still free for the server in megabytes
+ * @returns {number} Free memory
+ */
+const getFreeMemoryMB = (): number => {
+  const used = readCgroupBytes("memory.current");
+  const cgroupFree =
+    used === null ? Infinity : getMemoryBudgetMB() - used / MB;
+  return Math.min(cgroupFree, os.freemem() / MB);
+};
+
+/**
+ * Read a limit in megabytes, defaulting to a share of a worker's budget
+ * @param {string | undefined} value - Configured limit
+ * @param {number} share - Share of the worker's budget
+ * @returns {number} Limit
+ */
+const readLimitMB = (value: string | undefined, share: number): number =>
+  parseInt(value || "", 10) ||
+  Math.round((getMemoryBudgetMB() / os.cpus().length) * share);
+
+/**
+ * Memory Guard Implementation
+ */
+export class MemoryGuard {
+  private readonly options: MemoryGuardOptions;
+  private draining = false;
+  // Workers already replaced by the primary, which must not fork again
+  private readonly replaced = new Set<number>();
+
+  /**
+   * Create a new MemoryGuard
+   * @param {MemoryGuardOptions} options - Limits and draining policy
+   */
+  constructor(options: MemoryGuardOptions) {
+    this.options = options;
+  }
+
+  /**
+   * Replace workers that start draining (primary side)
+   */
+  supervise(): void {
+    clusterIpc.handle("memory:draining", (_payload, worker) => {
+      if (!worker || this.replaced.has(worker.id)) {
+        return;
+      }
+      this.replaced.add(worker.id);
+      drains.inc();
+
+      // The replacement warms up while the old worker finishes its sessions
+      connectionRouter.drain(worker);
+      cluster.fork();
+    });
+  }
+
+  /**
+   * Whether an exited worker was already replaced (primary side)
+   * @param {Worker} worker - Exited worker
+   * @returns {boolean} True if no replacement must be forked
+   */
+  wasReplaced(worker: Worker): boolean {
+    return this.replaced.delete(worker.id);
+  }
+
+  /**
+   * Check the memory of this worker periodically (worker side)
+   * @param {Server} server - HTTP server of the worker
+   */
+  watch(server: Server): void {
+    setInterval(() => {
+      const mbUsed = process.memoryUsage().rss / 1024 / 1024;
+
+      if (mbUsed > this.options.hardLimitMB) {
+        console.error(
+          `Worker ${process.pid} memory usage critical (${Math.round(
+            mbUsed
+          )} MB), exiting for restart`
+        );
+        process.exit(1); // Exit with error code so cluster manager will restart
+      }
+
+      if (mbUsed > this.options.softLimitMB && !this.draining) {
+        console.warn(
+          `Worker ${process.pid} memory usage high (${Math.round(
+            mbUsed
+          )} MB), draining for restart`
+        );
+        this.drain(server);
+      }
+    }, CHECK_INTERVAL_MS).unref();
+  }
+
+  /**
+   * Drain this worker and exit once its sessions are done
+   * @param {Server} server - HTTP server of the worker
+   * @private
+   */
+  private drain(server: Server): void {
+    this.draining = true;
+    this.writeHeapSnapshot();
+
+    // Have the replacement forked, then take no new connections
+    clusterIpc.notify("memory:draining", {});
+    webSocketManager.stopAccepting();
+    if (!connectionRouter.isEnabled()) {
+      server.close();
+    }
+
+    // Nothing new will run here
+    ResultCache.clearAll();
+    debuggerPool.shutdown();
+    launcherPool.shutdown();
+    sessionService.shedMemory(DRAINING_OUTPUT_BYTES);
+
+    const deadline = Date.now() + this.options.drainDeadlineMs;
+    const poll = setInterval(() => {
+      const sessions = sessionService.getActiveSessions();
+      if (sessions.size > 0 && Date.now() < deadline) {
+        return;
+      }
+
+      clearInterval(poll);
+      if (sessions.size > 0) {
+        console.warn(
+          `Worker ${process.pid} terminating ${sessions.size} sessions at the drain deadline`
+        );
+        Array.from(sessions.keys()).forEach((sessionId) =>
+          sessionService.terminateSession(sessionId)
+        );
+      }
+      console.log(`Worker ${process.pid} drained, exiting`);
+      process.exit(0);
+    }, DRAIN_POLL_MS);
+  }
+
+  /**
+   * Write a heap snapshot, keeping only the most recent ones
+   * Writing blocks the worker for a few seconds and needs memory on the
+   * order of the heap size, which is why it happens only once per worker,
+   * and not at all when that much memory is not free
+   * @private
+   */
+  private writeHeapSnapshot(): void {
+    const dir = this.options.heapSnapshotDir;
+    if (!dir) {
+      return;
+    }
+
+    const heapMB = v8.getHeapStatistics().used_heap_size / MB;
+    const freeMB = getFreeMemoryMB();
+    if (freeMB < heapMB * 2) {
+      console.warn(
+        `Skipping heap snapshot: ${Math.round(freeMB)} MB free ` +
+          `for a ${Math.round(heapMB)} MB heap`
+      );
+      return;
+    }
+
+    try {
+      fs.ensureDirSync(dir);
+      const file = v8.writeHeapSnapshot(
+        path.join(dir, `worker-${process.pid}-${Date.now()}.heapsnapshot`)
+      );
+      console.warn(`Heap snapshot written to ${file}`);
+
+      const snapshots = fs
+        .readdirSync(dir)
+        .filter((name) => name.endsWith(".heapsnapshot"))
+        .map((name) => path.join(dir, name))
+        .sort((a, b) => fs.statSync(b).mtimeMs - fs.statSync(a).mtimeMs);
+      snapshots
+        .slice(MAX_HEAP_SNAPSHOTS)
+        .forEach((snapshot) => fs.removeSync(snapshot));
+    } catch (error) {
+      console.error("Error writing heap snapshot:", error);
+    }
+  }
+}
+
+// Create singleton instance; heap snapshots are taken only if a directory
+// is configured
+export const memoryGuard = new MemoryGuard({
+  softLimitMB: readLimitMB(
+    process.env.CINCOUT_MEMORY_SOFT_MB,
+    SOFT_LIMIT_SHARE
+  ),
+  hardLimitMB: readLimitMB(
+    process.env.CINCOUT_MEMORY_HARD_MB,
+    HARD_LIMIT_SHARE
+  ),
+  drainDeadlineMs:
+    parseInt(process.env.CINCOUT_DRAIN_DEADLINE_S || "300", 10) * 1000,
+  heapSnapshotDir: process.env.CINCOUT_HEAP_SNAPSHOT_DIR || null,
+});
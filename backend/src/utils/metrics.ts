@@ -0,0 +1,541 @@
+/**
+ * Metrics
+ * Prometheus counters and histograms recorded in every process and merged
+ * by the cluster primary, so one scrape of /metrics covers all workers
+ * Values that other modules already count (cache statistics, slot pools)
+ * are read when a scrape happens instead of being recorded twice
+ */
+import cluster, { Worker } from "cluster";
+import { performance } from "perf_hooks";
+import { clusterIpc } from "./clusterIpc";
+
+// Workers that do not answer in time are left out of a scrape
+const GATHER_TIMEOUT_MS = 2000;
+const EVENT_LOOP_INTERVAL_MS = 500;
+
+// Bucket upper bounds in seconds, from a cache hit to a slow valgrind run
+export const LATENCY_BUCKETS = [
+  0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60,
+];
+// Bucket upper bounds in bytes
+export const SIZE_BUCKETS = [
+  0, 256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304, 16777216,
+];
+
+export type MetricLabels = Record<string, string>;
+type MetricType = "counter" | "gauge" | "histogram";
+
+/**
+ * One labelled time series of a metric family
+ * Histograms keep per-bucket (not cumulative) counts
+ */
+interface MetricSeries {
+  labels: MetricLabels;
+  value: number; // Counter or gauge value, histogram sum
+  buckets?: number[];
+  count?: number;
+}
+
+/**
+ * A metric family as sent between processes
+ */
+export interface MetricFamily {
+  name: string;
+  help: string;
+  type: MetricType;
+  buckets?: number[]; // Histogram upper bounds
+  series: MetricSeries[];
+}
+
+/**
+ * A value read at scrape time
+ */
+export interface MetricSample {
+  labels: MetricLabels;
+  value: number;
+}
+
+/**
+ * Key identifying a label set, independent of label order
+ * @private
+ */
+const seriesKey = (labels: MetricLabels): string =>
+  JSON.stringify(
+    Object.keys(labels)
+      .sort()
+      .map((name) => [name, labels[name]])
+  );
+
+/**
+ * Escape a label value for the text exposition format
+ * @private
+ */
+const escapeLabel = (value: string): string =>
+  value.replace(/\\/g, "\\\\").replace(/\n/g, "\\n").replace(/"/g, '\\"');
+
+/**
+ * Format a label set, e.g. {lang="cpp",le="0.5"}
+ * @private
+ */
+const formatLabels = (labels: MetricLabels): string => {
+  const pairs = Object.keys(labels).map(
+    (name) => `${name}="${escapeLabel(labels[name])}"`
+  );
+  return pairs.length > 0 ? `{${pairs.join(",")}}` : "";
+};
+
+/**
+ * Counter
+ * Monotonically increasing value per label set
+ */
+export class Counter {
+  readonly family: MetricFamily;
+  private readonly series = new Map<string, MetricSeries>();
+
+  /**
+   * Create a new Counter
+   * @param {string} name - Metric name
+   * @param {string} help - Description
+   */
+  constructor(name: string, help: string) {
+    this.family = { name, help, type: "counter", series: [] };
+  }
+
+  /**
+   * Add to the counter
+   * @param {MetricLabels} labels - Labels of the series
+   * @param {number} value - Amount to add
+   */
+  inc(labels: MetricLabels = {}, value: number = 1): void {
+    const key = seriesKey(labels);
+    let series = this.series.get(key);
+    if (!series) {
+      series = { labels, value: 0 };
+      this.series.set(key, series);
+      this.family.series.push(series);
+    }
+    series.value += value;
+  }
+}
+
+/**
+ * Histogram
+ * Distribution of observed values per label set
+ */
+export class Histogram {
+  readonly family: MetricFamily;
+  private readonly series = new Map<string, MetricSeries>();
+
+  /**
+   * Create a new Histogram
+   * @param {string} name - Metric name
+   * @param {string} help - Description
+   * @param {number[]} buckets - Ascending bucket upper bounds
+   */
+  constructor(name: string, help: string, buckets: number[]) {
+    this.family = { name, help, type: "histogram", buckets, series: [] };
+  }
+
+  /**
+   * Record a value
+   * @param {MetricLabels} labels - Labels of the series
+   * @param {number} value - Observed value, seconds for durations
+   */
+  observe(labels: MetricLabels, value: number): void {
+    const bounds = this.family.buckets!;
+    const key = seriesKey(labels);
+    let series = this.series.get(key);
+    if (!series) {
+      series = {
+        labels,
+        value: 0,
+        buckets: bounds.map(() => 0),
+        count: 0,
+      };
+      this.series.set(key, series);
+      this.family.series.push(series);
+    }
+
+    const index = bounds.findIndex((bound) => value <= bound);
+    if (index >= 0) {
+      series.buckets![index]++;
+    }
+    series.value += value;
+    series.count = (series.count || 0) + 1;
+  }
+
+  /**
+   * Start timing a duration
+   * @param {MetricLabels} labels - Labels of the series
+   * @returns {Function} Records the elapsed seconds, with extra labels known
+   * only at the end; returns the seconds recorded
+   */
+  startTimer(labels: MetricLabels = {}): (extra?: MetricLabels) => number {
+    const started = performance.now();
+    return (extra = {}) => {
+      const seconds = (performance.now() - started) / 1000;
+      this.observe({ ...labels, ...extra }, seconds);
+      return seconds;
+    };
+  }
+}
+
+/**
+ * Collected family whose values come from readers at scrape time
+ */
+interface CollectedFamily {
+  help: string;
+  type: "counter" | "gauge";
+  readers: (() => MetricSample[])[];
+}
+
+/**
+ * A scrape in progress on the primary
+ */
+interface PendingGather {
+  families: MetricFamily[][];
+  remaining: number;
+  timer: NodeJS.Timeout;
+  worker: Worker | null;
+  ticket: number;
+}
+
+/**
+ * Metrics Registry Implementation
+ * The primary answers scrapes by asking every worker for its families
+ */
+export class MetricsRegistry {
+  private readonly recorded = new Map<string, MetricFamily>();
+  private readonly collected = new Map<string, CollectedFamily>();
+  private readonly gathers = new Map<number, PendingGather>();
+  private readonly scrapes = new Map<
+    number,
+    (families: MetricFamily[]) => void
+  >();
+  private nextGather = 1;
+  private nextTicket = 1;
+
+  constructor() {
+    if (clusterIpc.isWorker()) {
+      clusterIpc.on("metrics:report", ({ gather }: { gather: number }) =>
+        clusterIpc.notify("metrics:reported", {
+          gather,
+          families: this.snapshot(),
+        })
+      );
+    } else {
+      clusterIpc.handle("metrics:gather", ({ ticket }, worker) =>
+        this.startGather(worker, ticket)
+      );
+      clusterIpc.handle("metrics:reported", ({ gather, families }) =>
+        this.addReport(gather, families)
+      );
+    }
+
+    clusterIpc.on(
+      "metrics:gathered",
+      ({ ticket, families }: { ticket: number; families: MetricFamily[] }) => {
+        const resolve = this.scrapes.get(ticket);
+        if (resolve) {
+          this.scrapes.delete(ticket);
+          resolve(families);
+        }
+      }
+    );
+  }
+
+  /**
+   * Register a counter
+   * @param {string} name - Metric name
+   * @param {string} help - Description
+   * @returns {Counter} Counter
+   */
+  counter(name: string, help: string): Counter {
+    const counter = new Counter(name, help);
+    this.recorded.set(name, counter.family);
+    return counter;
+  }
+
+  /**
+   * Register a histogram
+   * @param {string} name - Metric name
+   * @param {string} help - Description
+   * @param {number[]} buckets - Ascending bucket upper bounds
+   * @returns {Histogram} Histogram
+   */
+  histogram(
+    name: string,
+    help: string,
+    buckets: number[] = LATENCY_BUCKETS
+  ): Histogram {
+    const histogram = new Histogram(name, help, buckets);
+    this.recorded.set(name, histogram.family);
+    return histogram;
+  }
+
+  /**
+   * Register a family read at scrape time; several readers may share one
+   * family, each with its own labels
+   * @param {string} name - Metric name
+   * @param {string} help - Description
+   * @param {string} type - "counter" for totals, "gauge" for current values
+   * @param {Function} read - Returns the current samples
+   */
+  collect(
+    name: string,
+    help: string,
+    type: "counter" | "gauge",
+    read: () => MetricSample[]
+  ): void {
+    const family = this.collected.get(name) || { help, type, readers: [] };
+    family.readers.push(read);
+    this.collected.set(name, family);
+  }
+
+  /**
+   * Report the lookups of a cache in cincout_cache_lookups_total
+   * @param {string} cache - Cache name
+   * @param {Function} getStats - Returns the hit and miss counters
+   */
+  trackCache(
+    cache: string,
+    getStats: () => { hits: number; misses: number }
+  ): void {
+    this.collect(
+      "cincout_cache_lookups_total",
+      "Cache lookups by cache and result",
+      "counter",
+      () => {
+        const { hits, misses } = getStats();
+        return [
+          { labels: { cache, result: "hit" }, value: hits },
+          { labels: { cache, result: "miss" }, value: misses },
+        ];
+      }
+    );
+  }
+
+  /**
+   * Record the event loop lag and memory of this process
+   * A timer measures how late it fires; the lag is how long other work kept
+   * the loop busy
+   */
+  monitorProcess(): void {
+    this.collect(
+      "cincout_resident_memory_bytes",
+      "Resident memory of the worker processes",
+      "gauge",
+      () => [{ labels: {}, value: process.memoryUsage().rss }]
+    );
+
+    const lag = this.histogram(
+      "cincout_event_loop_lag_seconds",
+      "Delay of a timer behind its schedule"
+    );
+    let expected = performance.now() + EVENT_LOOP_INTERVAL_MS;
+    setInterval(() => {
+      const now = performance.now();
+      lag.observe({}, Math.max(0, now - expected) / 1000);
+      expected = now + EVENT_LOOP_INTERVAL_MS;
+    }, EVENT_LOOP_INTERVAL_MS).unref();
+  }
+
+  /**
+   * Get the families of this process
+   * @returns {MetricFamily[]} Recorded and collected families
+   */
+  snapshot(): MetricFamily[] {
+    const families = Array.from(this.recorded.values()).filter(
+      (family) => family.series.length > 0
+    );
+
+    this.collected.forEach(({ help, type, readers }, name) => {
+      const series: MetricSeries[] = [];
+      for (const read of readers) {
+        try {
+          series.push(...read());
+        } catch (error) {
+          console.error(`Error collecting metric ${name}:`, error);
+        }
+      }
+      if (series.length > 0) {
+        families.push({ name, help, type, series });
+      }
+    });
+
+    return families;
+  }
+
+  /**
+   * Get the families of the whole cluster in the text exposition format
+   * Falls back to this process alone if the primary does not answer
+   * @returns {Promise<string>} Prometheus text
+   */
+  async scrape(): Promise<string> {
+    const ticket = this.nextTicket++;
+    const families = await new Promise<MetricFamily[]>((resolve) => {
+      const timer = setTimeout(() => {
+        this.scrapes.delete(ticket);
+        resolve(this.snapshot());
+      }, GATHER_TIMEOUT_MS * 2);
+      this.scrapes.set(ticket, (gathered) => {
+        clearTimeout(timer);
+        resolve(gathered);
+      });
+      clusterIpc.notify("metrics:gather", { ticket });
+    });
+    return MetricsRegistry.render(families);
+  }
+
+  /**
+   * Merge the families of several processes
+   * Series with the same name and labels are added up
+   * @param {MetricFamily[][]} reports - Families of each process
+   * @returns {MetricFamily[]} Merged families
+   */
+  static merge(reports: MetricFamily[][]): MetricFamily[] {
+    const merged = new Map<string, MetricFamily>();
+    const series = new Map<string, MetricSeries>();
+
+    for (const families of reports) {
+      for (const family of families) {
+        let target = merged.get(family.name);
+        if (!target) {
+          target = { ...family, series: [] };
+          merged.set(family.name, target);
+        }
+
+        for (const source of family.series) {
+          const key = `${family.name}${seriesKey(source.labels)}`;
+          const existing = series.get(key);
+          if (!existing) {
+            const copy = { ...source, buckets: source.buckets?.slice() };
+            series.set(key, copy);
+            target.series.push(copy);
+            continue;
+          }
+          existing.value += source.value;
+          if (existing.buckets && source.buckets) {
+            existing.count = (existing.count || 0) + (source.count || 0);
+            source.buckets.forEach((count, index) => {
+              existing.buckets![index] += count;
+            });
+          }
+        }
+      }
+    }
+
+    return Array.from(merged.values());
+  }
+
+  /**
+   * Render families in the Prometheus text exposition format
+   * @param {MetricFamily[]} families - Families to render
+   * @returns {string} Prometheus text
+   */
+  static render(families: MetricFamily[]): string {
+    const lines: string[] = [];
+
+    for (const family of families) {
+      lines.push(`# HELP ${family.name} ${family.help}`);
+      lines.push(`# TYPE ${family.name} ${family.type}`);
+
+      for (const series of family.series) {
+        if (family.type !== "histogram") {
+          lines.push(
+            `${family.name}${formatLabels(series.labels)} ${series.value}`
+          );
+          continue;
+        }
+
+        // Bucket counts are cumulative in the exposition format
+        let cumulative = 0;
+        family.buckets!.forEach((bound, index) => {
+          cumulative += series.buckets![index];
+          lines.push(
+            `${family.name}_bucket${formatLabels({
+              ...series.labels,
+              le: String(bound),
+            })} ${cumulative}`
+          );
+        });
+        lines.push(
+          `${family.name}_bucket${formatLabels({
+            ...series.labels,
+            le: "+Inf",
+          })} ${series.count}`
+        );
+        lines.push(
+          `${family.name}_sum${formatLabels(series.labels)} ${series.value}`
+        );
+        lines.push(
+          `${family.name}_count${formatLabels(series.labels)} ${series.count}`
+        );
+      }
+    }
+
+    return `${lines.join("\n")}\n`;
+  }
+
+  /**
+   * Ask every worker for its families (primary side)
+   * @private
+   */
+  private startGather(worker: Worker | null, ticket: number): void {
+    const workers = Object.values(cluster.workers || {}).filter(
+      (candidate): candidate is Worker =>
+        !!candidate && candidate.isConnected()
+    );
+    const gather = this.nextGather++;
+    this.gathers.set(gather, {
+      families: [this.snapshot()],
+      remaining: workers.length,
+      timer: setTimeout(() => this.finishGather(gather), GATHER_TIMEOUT_MS),
+      worker,
+      ticket,
+    });
+
+    workers.forEach((target) =>
+      clusterIpc.sendToWorker(target, "metrics:report", { gather })
+    );
+    if (workers.length === 0) {
+      this.finishGather(gather);
+    }
+  }
+
+  /**
+   * Add the families a worker reported (primary side)
+   * @private
+   */
+  private addReport(gather: number, families: MetricFamily[]): void {
+    const pending = this.gathers.get(gather);
+    if (!pending) {
+      return;
+    }
+    pending.families.push(families);
+    if (--pending.remaining <= 0) {
+      this.finishGather(gather);
+    }
+  }
+
+  /**
+   * Send the merged families to the worker serving the scrape (primary side)
+   * @private
+   */
+  private finishGather(gather: number): void {
+    const pending = this.gathers.get(gather);
+    if (!pending) {
+      return;
+    }
+    this.gathers.delete(gather);
+    clearTimeout(pending.timer);
+
+    clusterIpc.sendToWorker(pending.worker, "metrics:gathered", {
+      ticket: pending.ticket,
+      families: MetricsRegistry.merge(pending.families),
+    });
+  }
+}
+
+// Create singleton instance
+export const metrics = new MetricsRegistry();
@@ -0,0 +1,81 @@
+/**
+ * Node Role
+ * Splits a multi-node deployment into a web tier, serving static files and
+ * the HTTP API, and a runner tier holding the PTY-heavy Socket.IO sessions
+ * Web nodes send Socket.IO connections on to the runner app with a Fly
+ * replay, which Fly's proxy balances across runner machines by load
+ */
+import { Server, IncomingMessage } from "http";
+import { Duplex } from "stream";
+
+/**
+ * Responsibilities of a node
+ * - all: web and runner in one node (default)
+ * - web: static files and HTTP API; sessions are replayed to the runner app
+ * - runner: Socket.IO sessions (and the HTTP API, for replayed requests)
+ */
+export type NodeRole = "all" | "web" | "runner";
+
+const SOCKET_PATH = "/socket.io/";
+
+/**
+ * Node Role Implementation
+ */
+export class NodeRoleConfig {
+  readonly role: NodeRole;
+  private readonly runnerApp: string;
+
+  /**
+   * Create a new NodeRoleConfig
+   * @param {string} role - CINCOUT_ROLE
+   * @param {string} runnerApp - Fly app of the runner tier (CINCOUT_RUNNER_APP)
+   */
+  constructor(role: string, runnerApp: string) {
+    this.runnerApp = runnerApp;
+    // A web node without a runner app to replay to has to run sessions itself
+    this.role =
+      role === "runner" || (role === "web" && runnerApp)
+        ? (role as NodeRole)
+        : "all";
+    if (role === "web" && !runnerApp) {
+      console.warn("CINCOUT_ROLE=web needs CINCOUT_RUNNER_APP, running all");
+    }
+  }
+
+  /**
+   * Whether this node hosts code execution sessions
+   * @returns {boolean} True unless this is a web node
+   */
+  runsSessions(): boolean {
+    return this.role !== "web";
+  }
+
+  /**
+   * Answer Socket.IO connections with a replay to the runner app (web side)
+   * Fly replays the upgrade request on a runner machine, which then holds
+   * the WebSocket for its lifetime; Socket.IO runs over WebSocket only, so
+   * no later request has to find its way back to the same machine
+   * @param {Server} server - HTTP server of the worker
+   */
+  replaySessions(server: Server): void {
+    server.on("upgrade", (req: IncomingMessage, socket: Duplex) => {
+      if (!req.url?.startsWith(SOCKET_PATH)) {
+        socket.destroy();
+        return;
+      }
+
+      socket.end(
+        "HTTP/1.1 307 Temporary Redirect\r\n" +
+          `fly-replay: app=${this.runnerApp}\r\n` +
+          "Content-Length: 0\r\n" +
+          "Connection: close\r\n\r\n"
+      );
+    });
+  }
+}
+
+// Create singleton instance
+export const nodeRole = new NodeRoleConfig(
+  process.env.CINCOUT_ROLE || "all",
+  process.env.CINCOUT_RUNNER_APP || ""
+);
@@ -0,0 +1,191 @@
+/**
+ * Optimization Remarks Parser
+ * Parses the vectorization and inlining reports written by gcc (-fopt-info)
+ * and clang (-fsave-optimization-record) into remarks about source lines
+ */
+import { OptimizationRemark, OptimizationRemarkKind } from "../types";
+
+// Remarks beyond this are dropped, keeping the earliest lines
+const MAX_REMARKS = 500;
+
+// "program.cpp:6:21: optimized: loop vectorized using 16 byte vectors"
+const GCC_REMARK = /^(.*?):(\d+):(\d+): (optimized|missed|note): (.*)$/;
+// "DebugLoc: { File: program.cpp, Line: 6, Column: 3 }"
+const CLANG_LOCATION =
+  /File:\s*('(?:[^']|'')*'|"[^"]*"|[^,}]+),\s*Line:\s*(\d+),\s*Column:\s*(\d+)/;
+// "  - String: 'vectorized loop (vectorization width: '"
+const CLANG_ARGUMENT = /^ {2}- [\w.]+:\s*(.*)$/;
+
+const GCC_KINDS: Record<string, OptimizationRemarkKind> = {
+  optimized: "passed",
+  missed: "missed",
+  note: "analysis",
+};
+
+/**
+ * Whether a reported file is the program's source file
+ * @private
+ */
+const isSourceFile = (file: string, sourceName: string): boolean =>
+  file === sourceName || file.endsWith(`/${sourceName}`);
+
+/**
+ * Short name of the optimization a remark comes from
+ * @private
+ */
+const passName = (pass: string): string =>
+  /vector/.test(pass) ? "vectorize" : /inlin/.test(pass) ? "inline" : pass;
+
+/**
+ * Remove duplicates, which template instantiations and unrolled copies of
+ * the same code produce, and order remarks by position
+ * @private
+ */
+const finalize = (remarks: OptimizationRemark[]): OptimizationRemark[] => {
+  const seen = new Set<string>();
+  return remarks
+    .filter((remark) => {
+      const key = `${remark.line}:${remark.column}:${remark.kind}:${remark.message}`;
+      if (seen.has(key)) {
+        return false;
+      }
+      seen.add(key);
+      return true;
+    })
+    .sort((a, b) => a.line - b.line || a.column - b.column)
+    .slice(0, MAX_REMARKS);
+};
+
+/**
+ * Parse gcc -fopt-info output
+ * Lines that do not start with a location continue the previous remark
+ * @param {string} text - Output of -fopt-info
+ * @param {string} sourceName - Name of the source file as passed to the compiler
+ * @returns {OptimizationRemark[]} Remarks about the source file
+ */
+export const parseGccRemarks = (
+  text: string,
+  sourceName: string
+): OptimizationRemark[] => {
+  const remarks: OptimizationRemark[] = [];
+  let previous: OptimizationRemark | null = null;
+
+  for (const line of text.split("\n")) {
+    const match = line.match(GCC_REMARK);
+    if (!match) {
+      if (previous && line.trim()) {
+        previous.message += ` ${line.trim()}`;
+      }
+      continue;
+    }
+
+    const [, file, row, column, severity, message] = match;
+    previous = null;
+    // "***** Analysis failed with vector mode V4SF" traces the vectorizer's
+    // retries with other vector sizes
+    if (!isSourceFile(file, sourceName) || message.startsWith("*****")) {
+      continue;
+    }
+
+    previous = {
+      line: parseInt(row, 10),
+      column: parseInt(column, 10),
+      kind: GCC_KINDS[severity],
+      // Only the vectorizer and the inliner report
+      pass: /inlin/i.test(message) ? "inline" : "vectorize",
+      message: message.trim(),
+    };
+    remarks.push(previous);
+  }
+
+  return finalize(remarks);
+};
+
+/**
+ * Decode a scalar of clang's YAML remark records
+ * @private
+ */
+const unquote = (value: string): string => {
+  const text = value.trim();
+  if (text.startsWith("'") && text.endsWith("'")) {
+    return text.slice(1, -1).replace(/''/g, "'");
+  }
+  if (text.startsWith('"')) {
+    try {
+      return JSON.parse(text);
+    } catch {
+      return text.slice(1, -1);
+    }
+  }
+  return text;
+};
+
+/**
+ * Parse a clang optimization record
+ * Each remark is a YAML document ("--- !Passed" ... "..."); its message is
+ * the concatenation of its arguments
+ * @param {string} yaml - Contents of the record file
+ * @param {string} sourceName - Name of the source file as passed to the compiler
+ * @returns {OptimizationRemark[]} Remarks about the source file
+ */
+export const parseClangRemarks = (
+  yaml: string,
+  sourceName: string
+): OptimizationRemark[] => {
+  const remarks: OptimizationRemark[] = [];
+
+  let kind: OptimizationRemarkKind | null = null;
+  let pass = "";
+  let location: RegExpMatchArray | null = null;
+  let message: string[] = [];
+  let inArgs = false;
+
+  const flush = () => {
+    if (kind && location && isSourceFile(unquote(location[1]), sourceName)) {
+      remarks.push({
+        line: parseInt(location[2], 10),
+        column: parseInt(location[3], 10),
+        kind,
+        pass: passName(pass),
+        message: message.join("").trim(),
+      });
+    }
+    kind = null;
+    location = null;
+  };
+
+  for (const line of yaml.split("\n")) {
+    if (line.startsWith("--- !")) {
+      flush();
+      const tag = line.slice(5).trim();
+      kind =
+        tag === "Passed"
+          ? "passed"
+          : tag === "Missed" || tag === "Failure"
+          ? "missed"
+          : "analysis";
+      pass = "";
+      message = [];
+      inArgs = false;
+    } else if (line.startsWith("...")) {
+      flush();
+    } else if (line.startsWith("Pass:")) {
+      pass = unquote(line.slice(5));
+    } else if (line.startsWith("DebugLoc:")) {
+      location = line.match(CLANG_LOCATION);
+    } else if (line.startsWith("Args:")) {
+      inArgs = true;
+    } else if (inArgs) {
+      // Nested keys, such as the location of a callee, are indented further
+      const argument = line.match(CLANG_ARGUMENT);
+      if (argument) {
+        message.push(unquote(argument[1]));
+      } else if (!line.startsWith("    ")) {
+        inArgs = false;
+      }
+    }
+  }
+  flush();
+
+  return finalize(remarks);
+};
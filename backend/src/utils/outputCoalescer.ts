@@ -0,0 +1,180 @@
+/**
+ * Output Coalescer
+ * Batches PTY output into a few larger frames and bounds how much output a
+ * single session can send, so a chatty program costs the same as a quiet one
+ */
+import { OutputCoalescerOptions } from "../types";
+
+const TRUNCATION_MARKER = "\r\n\x1b[33m[output truncated]\x1b[0m\r\n";
+
+const DEFAULT_OPTIONS: OutputCoalescerOptions = {
+  flushIntervalMs: 12,
+  maxBatchBytes: 16 * 1024,
+  maxTotalBytes: 1024 * 1024,
+  maxBytesPerSecond: 256 * 1024,
+};
+
+/**
+ * Output Coalescer Implementation
+ * Output is flushed when the time window elapses or the batch reaches its byte
+ * threshold, whichever comes first. Above the rate limit the source is paused
+ * (the program blocks on write); above the volume limit output is cut off
+ */
+export class OutputCoalescer {
+  private readonly options: OutputCoalescerOptions;
+  private readonly send: (chunk: Buffer) => void;
+  private readonly onPause?: () => void;
+  private readonly onResume?: () => void;
+  private readonly onTruncate?: () => void;
+  private pending: string[] = [];
+  private pendingBytes = 0;
+  private totalBytes = 0;
+  private windowStart = Date.now();
+  private windowBytes = 0;
+  private flushTimer: NodeJS.Timeout | null = null;
+  private resumeTimer: NodeJS.Timeout | null = null;
+  private truncated = false;
+
+  /**
+   * Create a new OutputCoalescer
+   * @param {Function} send - Receives each coalesced frame
+   * @param {object} hooks - Flow control callbacks for the output source
+   * @param {Partial<OutputCoalescerOptions>} options - Batching and limits
+   */
+  constructor(
+    send: (chunk: Buffer) => void,
+    hooks: {
+      onPause?: () => void;
+      onResume?: () => void;
+      onTruncate?: () => void;
+    } = {},
+    options: Partial<OutputCoalescerOptions> = {}
+  ) {
+    this.send = send;
+    this.onPause = hooks.onPause;
+    this.onResume = hooks.onResume;
+    this.onTruncate = hooks.onTruncate;
+    this.options = { ...DEFAULT_OPTIONS, ...options };
+  }
+
+  /**
+   * Queue output for sending
+   * @param {string} data - Output chunk
+   */
+  write(data: string): void {
+    if (this.truncated) {
+      return;
+    }
+
+    let bytes = Buffer.byteLength(data);
+    if (this.totalBytes + bytes > this.options.maxTotalBytes) {
+      data = Buffer.from(data)
+        .subarray(0, this.options.maxTotalBytes - this.totalBytes)
+        .toString("utf8");
+      bytes = Buffer.byteLength(data);
+      this.truncated = true;
+    }
+
+    this.pending.push(data);
+    this.pendingBytes += bytes;
+    this.totalBytes += bytes;
+    this.throttle(bytes);
+
+    if (this.truncated) {
+      this.pending.push(TRUNCATION_MARKER);
+      this.flush();
+      this.onTruncate?.();
+      return;
+    }
+
+    if (this.pendingBytes >= this.options.maxBatchBytes) {
+      this.flush();
+    } else if (!this.flushTimer) {
+      this.flushTimer = setTimeout(
+        () => this.flush(),
+        this.options.flushIntervalMs
+      );
+    }
+  }
+
+  /**
+   * Send everything queued so far
+   */
+  flush(): void {
+    if (this.flushTimer) {
+      clearTimeout(this.flushTimer);
+      this.flushTimer = null;
+    }
+
+    if (this.pending.length === 0) {
+      return;
+    }
+
+    const chunk = Buffer.from(this.pending.join(""), "utf8");
+    this.pending = [];
+    this.pendingBytes = 0;
+    this.send(chunk);
+  }
+
+  /**
+   * Flush remaining output and stop all timers
+   * Call before reporting that the source exited so no output arrives late
+   */
+  end(): void {
+    this.flush();
+    if (this.resumeTimer) {
+      clearTimeout(this.resumeTimer);
+      this.resumeTimer = null;
+    }
+  }
+
+  /**
+   * Lower the volume limit, e.g. while the worker is short of memory
+   * Output already sent stays within the new limit
+   * @param {number} maxTotalBytes - New limit; a higher one is ignored
+   */
+  restrict(maxTotalBytes: number): void {
+    this.options.maxTotalBytes = Math.min(
+      this.options.maxTotalBytes,
+      Math.max(this.totalBytes, maxTotalBytes)
+    );
+  }
+
+  /**
+   * Whether output was cut off at the volume limit
+   * @returns {boolean} True once the limit was reached
+   */
+  isTruncated(): boolean {
+    return this.truncated;
+  }
+
+  /**
+   * Pause the source until the next one-second window once it exceeds the rate
+   * @param {number} bytes - Bytes just written
+   * @private
+   */
+  private throttle(bytes: number): void {
+    const now = Date.now();
+    if (now - this.windowStart >= 1000) {
+      this.windowStart = now;
+      this.windowBytes = 0;
+    }
+    this.windowBytes += bytes;
+
+    if (
+      this.windowBytes <= this.options.maxBytesPerSecond ||
+      this.resumeTimer ||
+      !this.onPause
+    ) {
+      return;
+    }
+
+    this.onPause();
+    this.resumeTimer = setTimeout(() => {
+      this.resumeTimer = null;
+      this.windowStart = Date.now();
+      this.windowBytes = 0;
+      this.onResume?.();
+    }, 1000 - (now - this.windowStart));
+  }
+}
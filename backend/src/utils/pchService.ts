@@ -0,0 +1,355 @@
+/**
+ * Precompiled Header Service
+ * Builds precompiled headers for a curated set of C++ standard library headers
+ * and resolves the flags needed to inject them into a compile
+ * The header brings in the whole set, not just what the source includes, so
+ * a build that fails because of it is retried without it
+ */
+import * as fs from "fs-extra";
+import * as path from "path";
+import * as os from "os";
+import { execFile } from "child_process";
+import { getCompilerFingerprint, OPTIMIZATION_LEVELS } from "./toolchain";
+import { compileScheduler } from "./compileScheduler";
+import { CompilerDiagnostic } from "../types";
+
+/**
+ * Standard library headers covered by the precompiled header
+ * <cassert> is deliberately absent because its meaning depends on NDEBUG
+ */
+const COMMON_HEADERS = [
+  "algorithm",
+  "array",
+  "bitset",
+  "chrono",
+  "climits",
+  "cmath",
+  "cstdio",
+  "cstdlib",
+  "cstring",
+  "deque",
+  "exception",
+  "forward_list",
+  "functional",
+  "iomanip",
+  "iostream",
+  "iterator",
+  "limits",
+  "list",
+  "map",
+  "memory",
+  "numeric",
+  "optional",
+  "queue",
+  "random",
+  "ranges",
+  "set",
+  "sstream",
+  "stack",
+  "stdexcept",
+  "string",
+  "string_view",
+  "tuple",
+  "type_traits",
+  "unordered_map",
+  "unordered_set",
+  "utility",
+  "variant",
+  "vector",
+];
+
+const PCH_COMPILERS = ["g++", "clang++"];
+const PCH_STANDARDS = ["-std=c++20"];
+const HEADER_NAME = "common.hpp";
+// Compiler errors about the precompiled header file itself
+const PCH_ERROR = /precompiled header|PCH file|AST file|\.(?:pch|gch)\b/i;
+// Names the header brings in can clash with those of the source, e.g. a
+// global declared after "using namespace std"
+const NAME_CLASH = /is ambiguous/;
+
+/**
+ * A compiler configuration a precompiled header is built for
+ */
+interface PchVariant {
+  compiler: string;
+  standard: string;
+  optimization: string;
+  debug: boolean;
+}
+
+/**
+ * Precompiled Header Service Implementation
+ */
+export class PchService {
+  private readonly pchDir: string;
+  private readonly enabled: boolean;
+  private readonly available = new Set<string>();
+  // Headers that failed to load, e.g. after a compiler update
+  private readonly unusable = new Set<string>();
+
+  /**
+   * Create a new PchService
+   * @param {string} pchDir - Directory holding the precompiled headers
+   * @param {boolean} enabled - Whether precompiled headers are used at all
+   */
+  constructor(pchDir: string, enabled: boolean = true) {
+    this.pchDir = pchDir;
+    this.enabled = enabled;
+  }
+
+  /**
+   * Build precompiled headers for every supported variant
+   * Variants are built one at a time so startup does not saturate the machine;
+   * already built headers are kept
+   */
+  async buildAll(): Promise<void> {
+    if (!this.enabled) {
+      return;
+    }
+
+    // Release builds first, they are what most Run clicks use
+    const variants: PchVariant[] = [];
+    for (const debug of [false, true]) {
+      for (const compiler of PCH_COMPILERS) {
+        for (const standard of PCH_STANDARDS) {
+          for (const optimization of debug ? ["-O0"] : OPTIMIZATION_LEVELS) {
+            variants.push({ compiler, standard, optimization, debug });
+          }
+        }
+      }
+    }
+
+    for (const variant of variants) {
+      try {
+        await this.buildVariant(variant);
+      } catch (error) {
+        console.error(
+          `Failed to build precompiled header for ${this.describe(variant)}:`,
+          error
+        );
+      }
+    }
+  }
+
+  /**
+   * Resolve the flags injecting a precompiled header into a compile
+   * @param {string} compiler - Resolved compiler command
+   * @param {string} standard - Language standard option
+   * @param {string} optimization - Optimization option
+   * @param {string[]} extraFlags - Additional compile flags
+   * @param {string} code - Source code
+   * @returns {Promise<string[] | null>} Flags to add, or null when no header applies
+   */
+  async resolve(
+    compiler: string,
+    standard: string,
+    optimization: string,
+    extraFlags: string[],
+    code: string
+  ): Promise<string[] | null> {
+    if (
+      !this.enabled ||
+      !PCH_COMPILERS.includes(compiler) ||
+      extraFlags.some((flag) => flag !== "-g") ||
+      !this.usesOnlyCommonHeaders(code)
+    ) {
+      return null;
+    }
+
+    const variant: PchVariant = {
+      compiler,
+      standard,
+      optimization,
+      debug: extraFlags.includes("-g"),
+    };
+    const dir = await this.getVariantDir(variant);
+    const pchFile = this.getPchFile(variant, dir);
+    if (this.unusable.has(pchFile)) {
+      return null;
+    }
+
+    if (!this.available.has(pchFile)) {
+      if (!(await fs.pathExists(pchFile))) {
+        return null;
+      }
+      this.available.add(pchFile);
+    }
+
+    return compiler === "clang++"
+      ? ["-include-pch", pchFile]
+      : ["-include", path.join(dir, HEADER_NAME)];
+  }
+
+  /**
+   * Check whether a build with the precompiled header failed because of it
+   * Ordinary errors in the source fail the same way without the header, so
+   * only a header that could not be used, errors inside it and names it made
+   * ambiguous lead to a retry
+   * @param {string} failure - Compiler error output
+   * @param {CompilerDiagnostic[]} diagnostics - Diagnostics of the build
+   * @returns {boolean} True if the compile should be retried without the header
+   */
+  isPchFailure(failure: string, diagnostics: CompilerDiagnostic[]): boolean {
+    return (
+      this.isUnusableHeader(failure) ||
+      diagnostics
+        .flatMap((diagnostic) => [diagnostic, ...diagnostic.children])
+        .some(
+          (diagnostic) =>
+            diagnostic.file === HEADER_NAME ||
+            NAME_CLASH.test(diagnostic.message)
+        )
+    );
+  }
+
+  /**
+   * Check whether the compiler could not load the precompiled header
+   * @param {string} failure - Compiler error output
+   * @returns {boolean} True if the header itself is unusable
+   */
+  isUnusableHeader(failure: string): boolean {
+    return PCH_ERROR.test(failure);
+  }
+
+  /**
+   * Stop injecting a precompiled header that failed to load
+   * @param {string[]} flags - Flags returned by resolve
+   */
+  markUnusable(flags: string[]): void {
+    const pchFile =
+      flags[0] === "-include-pch" ? flags[1] : `${flags[1]}.gch`;
+    console.warn(`Precompiled header ${pchFile} is unusable, no longer used`);
+    this.unusable.add(pchFile);
+  }
+
+  /**
+   * Build the precompiled header for a single variant
+   * @param {PchVariant} variant - Variant to build
+   * @private
+   */
+  private async buildVariant(variant: PchVariant): Promise<void> {
+    const dir = await this.getVariantDir(variant);
+    const pchFile = this.getPchFile(variant, dir);
+
+    if (await fs.pathExists(pchFile)) {
+      return;
+    }
+
+    // The header must stay at its final path: clang records it in the PCH
+    const headerFile = path.join(dir, HEADER_NAME);
+    const stagingFile = `${pchFile}.tmp-${process.pid}`;
+    await fs.ensureDir(dir);
+    await fs.writeFile(
+      headerFile,
+      COMMON_HEADERS.map((header) => `#include <${header}>`).join("\n") + "\n",
+      "utf8"
+    );
+
+    const args = [
+      ...(variant.debug ? ["-g"] : []),
+      variant.standard,
+      variant.optimization,
+      "-x",
+      "c++-header",
+      headerFile,
+      "-o",
+      stagingFile,
+    ];
+
+    // Share the compile slots with user builds, but never ahead of them
+    await compileScheduler.run(
+      { clientId: "pch", priority: "background" },
+      () =>
+        new Promise<void>((resolve, reject) => {
+          execFile(variant.compiler, args, (error, _stdout, stderr) => {
+            if (error) {
+              reject(stderr || error.message);
+              return;
+            }
+            resolve();
+          });
+        })
+    );
+
+    await fs.rename(stagingFile, pchFile);
+    this.available.add(pchFile);
+  }
+
+  /**
+   * Check that every include in the source is a covered standard header
+   * Any other directive before the last include disqualifies the source, since
+   * macros defined there could change what the headers mean
+   * @param {string} code - Source code
+   * @returns {boolean} True when the precompiled header can replace the includes
+   * @private
+   */
+  private usesOnlyCommonHeaders(code: string): boolean {
+    let includeCount = 0;
+    let sawOtherDirective = false;
+
+    for (const line of code.split("\n")) {
+      const directive = line.match(/^\s*#\s*(\w+)\s*(.*)$/);
+      if (!directive) {
+        continue;
+      }
+
+      if (directive[1] !== "include") {
+        sawOtherDirective = true;
+        continue;
+      }
+
+      const header = directive[2].match(/^<([^>]+)>/);
+      if (sawOtherDirective || !header || !COMMON_HEADERS.includes(header[1])) {
+        return false;
+      }
+
+      includeCount++;
+    }
+
+    return includeCount > 0;
+  }
+
+  /**
+   * Get the directory for a variant, keyed by compiler version
+   * @param {PchVariant} variant - Variant
+   * @returns {Promise<string>} Directory path
+   * @private
+   */
+  private async getVariantDir(variant: PchVariant): Promise<string> {
+    const fingerprint = await getCompilerFingerprint(variant.compiler);
+    return path.join(
+      this.pchDir,
+      `${this.describe(variant)}-${fingerprint}`.replace(/[^\w.+-]/g, "_")
+    );
+  }
+
+  /**
+   * Get the precompiled header file for a variant
+   * @param {PchVariant} variant - Variant
+   * @param {string} dir - Variant directory
+   * @returns {string} File path
+   * @private
+   */
+  private getPchFile(variant: PchVariant, dir: string): string {
+    const extension = variant.compiler === "clang++" ? "pch" : "gch";
+    return path.join(dir, `${HEADER_NAME}.${extension}`);
+  }
+
+  /**
+   * Describe a variant for logs and directory names
+   * @param {PchVariant} variant - Variant
+   * @returns {string} Description
+   * @private
+   */
+  private describe(variant: PchVariant): string {
+    return `${variant.compiler}${variant.standard}${variant.optimization}${
+      variant.debug ? "-g" : ""
+    }`;
+  }
+}
+
+// Create singleton instance
+export const pchService = new PchService(
+  process.env.CINCOUT_PCH_DIR || path.join(os.tmpdir(), "CinCout-pch"),
+  process.env.CINCOUT_PCH !== "off"
+);
@@ -0,0 +1,183 @@
+/**
+ * Pipe Process
+ * Runs a program with plain pipes instead of a PTY, for programs that are
+ * not expected to read input: there is no terminal to set up, and output is
+ * forwarded as soon as it reaches the pipe. The program sees no terminal, so
+ * callers have it line buffered. Exposes the part of the node-pty interface
+ * that sessions use
+ */
+import * as os from "os";
+import { spawn, ChildProcess } from "child_process";
+import { EventEmitter } from "events";
+import { StringDecoder } from "string_decoder";
+import { IDisposable } from "node-pty";
+import { SessionProcess } from "../types";
+
+/**
+ * Pipe Process Implementation
+ * Standard output and error are merged into one data stream with terminal
+ * line endings, as a PTY would deliver them. Input is handled like a
+ * terminal in canonical mode: echoed, editable with backspace and passed on
+ * a line at a time, with Ctrl-D ending it and Ctrl-C interrupting
+ */
+export class PipeProcess implements SessionProcess {
+  readonly pid: number;
+  private readonly child: ChildProcess;
+  private readonly events = new EventEmitter();
+  private exited = false;
+  private line: string[] = []; // Characters typed since the last newline
+
+  /**
+   * Spawn a process
+   * @param {string} command - Executable
+   * @param {string[]} args - Arguments
+   * @param {object} options - Working directory and environment
+   */
+  constructor(
+    command: string,
+    args: string[],
+    options: { cwd: string; env: { [key: string]: string } }
+  ) {
+    this.child = spawn(command, args, {
+      cwd: options.cwd,
+      env: options.env,
+      stdio: ["pipe", "pipe", "pipe"],
+    });
+    this.pid = this.child.pid ?? -1;
+
+    // Writes after the program closed its input fail with EPIPE
+    this.child.stdin!.on("error", () => {});
+
+    for (const stream of [this.child.stdout!, this.child.stderr!]) {
+      // Multi-byte characters may be split across reads
+      const decoder = new StringDecoder("utf8");
+      stream.on("data", (data: Buffer) => {
+        const text = decoder.write(data);
+        if (text) {
+          this.events.emit("data", text.replace(/\r?\n/g, "\r\n"));
+        }
+      });
+    }
+
+    // "close" follows the end of both output streams, so no output is lost
+    this.child.on("close", (code, signal) => {
+      const signalNumber = signal ? os.constants.signals[signal] : undefined;
+      this.exit(code ?? 128 + (signalNumber || 0), signalNumber);
+    });
+    this.child.on("error", (error) => {
+      console.error(`Error running ${command}:`, error);
+      this.exit(127);
+    });
+  }
+
+  /**
+   * Handle terminal input, as the line discipline of a PTY would
+   * @param {string} data - Keystrokes
+   */
+  write(data: string): void {
+    const stdin = this.child.stdin!;
+    if (this.exited || !stdin.writable) {
+      return;
+    }
+
+    let echo = "";
+    for (const char of data) {
+      if (char === "\r" || char === "\n") {
+        stdin.write(this.line.join("") + "\n");
+        this.line = [];
+        echo += "\r\n";
+      } else if (char === "\x7f" || char === "\b") {
+        if (this.line.pop() !== undefined) {
+          echo += "\b \b";
+        }
+      } else if (char === "\x04") {
+        // Ctrl-D sends the pending line; on an empty line it ends the input
+        if (this.line.length > 0) {
+          stdin.write(this.line.join(""));
+          this.line = [];
+        } else {
+          stdin.end();
+          break;
+        }
+      } else if (char === "\x03") {
+        this.line = [];
+        echo += "^C\r\n";
+        this.kill("SIGINT");
+      } else {
+        this.line.push(char);
+        echo += char;
+      }
+    }
+
+    if (echo) {
+      this.events.emit("data", echo);
+    }
+  }
+
+  /**
+   * Send a signal to the process
+   * @param {string} signal - Signal name, SIGHUP like node-pty by default
+   */
+  kill(signal: string = "SIGHUP"): void {
+    this.child.kill(signal as NodeJS.Signals);
+  }
+
+  /**
+   * Stop reading output; the program blocks once the pipes are full
+   */
+  pause(): void {
+    this.child.stdout?.pause();
+    this.child.stderr?.pause();
+  }
+
+  /**
+   * Continue reading output
+   */
+  resume(): void {
+    this.child.stdout?.resume();
+    this.child.stderr?.resume();
+  }
+
+  /**
+   * Listen for output
+   * @param {Function} listener - Receives each output chunk
+   * @returns {IDisposable} Removes the listener
+   */
+  onData(listener: (data: string) => void): IDisposable {
+    return this.subscribe("data", listener);
+  }
+
+  /**
+   * Listen for the exit of the process
+   * @param {Function} listener - Receives the exit code and signal number
+   * @returns {IDisposable} Removes the listener
+   */
+  onExit(
+    listener: (e: { exitCode: number; signal?: number }) => void
+  ): IDisposable {
+    return this.subscribe("exit", listener);
+  }
+
+  /**
+   * Report the exit once, whether the process ended or never started
+   * @private
+   */
+  private exit(exitCode: number, signal?: number): void {
+    if (!this.exited) {
+      this.exited = true;
+      this.events.emit("exit", { exitCode, signal });
+    }
+  }
+
+  /**
+   * Add an event listener that can be disposed of
+   * @private
+   */
+  private subscribe(
+    event: string,
+    listener: (...args: any[]) => void
+  ): IDisposable {
+    this.events.on(event, listener);
+    return { dispose: () => this.events.off(event, listener) };
+  }
+}
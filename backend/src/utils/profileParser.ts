@@ -0,0 +1,246 @@
+/**
+ * Profile Parser
+ * Parses perf script output and sampler logs into raw call stacks, and folds
+ * symbolized stacks into the collapsed format flame graphs are drawn from
+ */
+import {
+  ProfileHotspot,
+  ProfileReport,
+  ProfileStack,
+  ProfilerMode,
+} from "../types";
+
+// Distinct stacks beyond this are only counted
+const MAX_STACKS = 500;
+const MAX_HOTSPOTS = 50;
+
+// "\t          401136 work (/tmp/x/program.out)"
+const PERF_FRAME = /^\s+([0-9a-f]+)\s+(.*?)\s+\((.*)\)$/;
+// "00400000-00401000 r-xp 00001000 fe:00 1234   /tmp/x/program.out"
+const MAPS_LINE = /^([0-9a-f]+)-([0-9a-f]+)\s+\S+\s+[0-9a-f]+\s+\S+\s+\d+\s*(.*)$/;
+
+/**
+ * A frame as sampled, before symbolization
+ */
+export interface SampledFrame {
+  address: string; // Hex, without a prefix
+  symbol?: string; // Symbol name, when the sampler knew it
+  dso?: string; // Path of the mapped object
+}
+
+/**
+ * A symbolized frame
+ */
+export interface ResolvedFrame {
+  fn: string;
+  file?: string; // Source file, only for lines of the program itself
+  line?: number;
+}
+
+/**
+ * A mapped range of the sampled process
+ */
+interface MappedRegion {
+  start: number;
+  end: number;
+  path: string;
+}
+
+/**
+ * Incremental perf script parser
+ * Expects the "comm,ip,sym,dso" fields; each sample is a header line, its
+ * frames innermost first and a blank line
+ */
+export class PerfScriptStream {
+  private remainder = "";
+  private current: SampledFrame[] = [];
+
+  /**
+   * Feed a chunk of the output
+   * @param {string} chunk - Output chunk
+   * @returns {SampledFrame[][]} Stacks completed by this chunk
+   */
+  push(chunk: string): SampledFrame[][] {
+    const lines = (this.remainder + chunk).split("\n");
+    this.remainder = lines.pop() || "";
+
+    const stacks: SampledFrame[][] = [];
+    for (const line of lines) {
+      this.parseLine(line, stacks);
+    }
+    return stacks;
+  }
+
+  /**
+   * Signal the end of the output
+   * @returns {SampledFrame[][]} The last stack, if any
+   */
+  end(): SampledFrame[][] {
+    const stacks: SampledFrame[][] = [];
+    this.parseLine(this.remainder, stacks);
+    this.parseLine("", stacks);
+    this.remainder = "";
+    return stacks;
+  }
+
+  /**
+   * Parse a single output line
+   * @private
+   */
+  private parseLine(line: string, stacks: SampledFrame[][]): void {
+    const frame = line.match(PERF_FRAME);
+    if (frame) {
+      // perf ends some user stacks with an all-ones marker
+      if (/^f+$/.test(frame[1])) {
+        return;
+      }
+      this.current.push({
+        address: frame[1],
+        symbol: frame[2] === "[unknown]" ? undefined : frame[2],
+        dso: frame[3] === "[unknown]" ? undefined : frame[3],
+      });
+      return;
+    }
+
+    // A blank line or the next header ends the sample
+    if (this.current.length > 0) {
+      stacks.push(this.current);
+      this.current = [];
+    }
+  }
+}
+
+/**
+ * Parse the log of the built-in sampler
+ * Lines are "l <lost samples>", "s <address>..." (innermost first),
+ * "y <address> <symbol>" for exported symbols and "m <line of /proc/self/maps>"
+ * @param {string} log - Log of a single process
+ * @returns {object} Stacks and the number of samples that did not fit
+ */
+export const parseSamplerLog = (
+  log: string
+): { stacks: SampledFrame[][]; lost: number } => {
+  const regions: MappedRegion[] = [];
+  const symbols = new Map<string, string>();
+  const raw: string[][] = [];
+  let lost = 0;
+
+  for (const line of log.split("\n")) {
+    const body = line.slice(2);
+    switch (line[0]) {
+      case "s":
+        raw.push(body.split(" ").filter(Boolean));
+        break;
+      case "y": {
+        const [address, symbol] = body.split(" ");
+        symbols.set(address, symbol);
+        break;
+      }
+      case "m": {
+        const region = body.match(MAPS_LINE);
+        if (region && region[3].startsWith("/")) {
+          regions.push({
+            start: parseInt(region[1], 16),
+            end: parseInt(region[2], 16),
+            path: region[3].trim(),
+          });
+        }
+        break;
+      }
+      case "l":
+        lost = parseInt(body, 10) || 0;
+        break;
+    }
+  }
+
+  const regionOf = (address: number): MappedRegion | undefined =>
+    regions.find((region) => address >= region.start && address < region.end);
+
+  return {
+    stacks: raw.map((addresses) =>
+      addresses.map((address) => ({
+        address,
+        symbol: symbols.get(address),
+        dso: regionOf(parseInt(address, 16))?.path,
+      }))
+    ),
+    lost,
+  };
+};
+
+/**
+ * Symbolized samples of a run, merged by stack
+ */
+export class StackProfile {
+  private readonly stacks = new Map<string, number>();
+  private readonly hotspots = new Map<string, ProfileHotspot>();
+  private samples = 0;
+
+  /**
+   * Add a sampled stack
+   * Samples in library code count towards the program line that called it
+   * @param {ResolvedFrame[]} frames - Frames, innermost first
+   * @param {number} samples - Times the stack was sampled
+   */
+  add(frames: ResolvedFrame[], samples: number = 1): void {
+    if (frames.length === 0) {
+      return;
+    }
+    this.samples += samples;
+
+    // Symbolized stacks can coincide even where the addresses differed
+    const stack = frames
+      .map((frame) => frame.fn.replace(/;/g, ":"))
+      .reverse()
+      .join(";");
+    this.stacks.set(stack, (this.stacks.get(stack) || 0) + samples);
+
+    const source = frames.find((frame) => frame.file && frame.line);
+    if (source) {
+      const key = `${source.file}:${source.line}`;
+      const hotspot = this.hotspots.get(key);
+      if (hotspot) {
+        hotspot.samples += samples;
+      } else {
+        this.hotspots.set(key, {
+          file: source.file!,
+          line: source.line!,
+          function: source.fn,
+          samples,
+          percent: 0,
+        });
+      }
+    }
+  }
+
+  /**
+   * Build the report
+   * @param {ProfilerMode} mode - How the samples were taken
+   * @param {number} lost - Samples the sampler had no room for
+   * @returns {ProfileReport} Collapsed stacks and hotspots
+   */
+  getReport(mode: ProfilerMode, lost: number): ProfileReport {
+    const sorted: ProfileStack[] = Array.from(
+      this.stacks,
+      ([stack, samples]) => ({ stack, samples })
+    ).sort((a, b) => b.samples - a.samples);
+    const kept = sorted.slice(0, MAX_STACKS);
+
+    const percent = (samples: number): number =>
+      this.samples > 0 ? Math.round((samples / this.samples) * 10000) / 100 : 0;
+
+    return {
+      mode,
+      samples: this.samples,
+      lost,
+      stacks: kept,
+      dropped: sorted
+        .slice(MAX_STACKS)
+        .reduce((sum, entry) => sum + entry.samples, 0),
+      hotspots: Array.from(this.hotspots.values())
+        .sort((a, b) => b.samples - a.samples)
+        .slice(0, MAX_HOTSPOTS)
+        .map((hotspot) => ({ ...hotspot, percent: percent(hotspot.samples) })),
+    };
+  }
+}
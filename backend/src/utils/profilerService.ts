@@ -0,0 +1,509 @@
+/**
+ * Profiler Service
+ * Samples where a program spends its CPU time, with perf record where the
+ * kernel allows it and otherwise with a small SIGPROF sampler preloaded into
+ * the program, then symbolizes the samples against the program's debug info
+ */
+import * as fs from "fs-extra";
+import * as path from "path";
+import * as os from "os";
+import * as crypto from "crypto";
+import { execFile, spawn } from "child_process";
+import { ProfileReport, ProfilerMode } from "../types";
+import { isToolUsable } from "./toolchain";
+import {
+  PerfScriptStream,
+  ResolvedFrame,
+  SampledFrame,
+  StackProfile,
+  parseSamplerLog,
+} from "./profileParser";
+
+// Off the timer tick, so samples do not alias with periodic work
+const SAMPLE_FREQUENCY = 999;
+// A software event: works in VMs without a PMU and at perf_event_paranoid 2
+const PERF_EVENT = "cpu-clock:u";
+const PERF_DATA = "perf.data";
+const SAMPLER_LOG = "profile-samples";
+
+/**
+ * Fallback sampler, preloaded into the program when perf is unusable
+ * ITIMER_PROF fires on consumed CPU time (at most once per kernel tick); each
+ * sample is a backtrace() into a preallocated buffer, written out with the
+ * process maps and exported symbol names when the process exits normally
+ */
+const SAMPLER_SOURCE = String.raw`#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define MAX_SAMPLES 20000
+#define MAX_DEPTH 64
+#define SKIP_FRAMES 2 /* The signal handler and the signal trampoline */
+#define INTERVAL_US 1000
+
+static void *stacks[MAX_SAMPLES][MAX_DEPTH];
+static int depths[MAX_SAMPLES];
+static int taken;
+
+static void on_sample(int sig) {
+  int saved = errno;
+  int slot = __atomic_fetch_add(&taken, 1, __ATOMIC_RELAXED);
+  (void)sig;
+  if (slot < MAX_SAMPLES) {
+    depths[slot] = backtrace(stacks[slot], MAX_DEPTH);
+  }
+  errno = saved;
+}
+
+static void arm(void) {
+  struct itimerval timer = {{0, INTERVAL_US}, {0, INTERVAL_US}};
+  setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+/* Timers are not inherited and the parent's samples are not the child's */
+static void reset_child(void) {
+  taken = 0;
+  arm();
+}
+
+static int compare(const void *a, const void *b) {
+  void *x = *(void *const *)a, *y = *(void *const *)b;
+  return x < y ? -1 : x > y;
+}
+
+__attribute__((constructor)) static void start(void) {
+  struct sigaction action;
+  void *warmup[1];
+  if (!getenv("CINCOUT_PROFILE_OUT")) {
+    return;
+  }
+  backtrace(warmup, 1); /* Loads the unwinder outside the handler */
+  memset(&action, 0, sizeof action);
+  action.sa_handler = on_sample;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, NULL);
+  pthread_atfork(NULL, NULL, reset_child);
+  arm();
+}
+
+__attribute__((destructor)) static void finish(void) {
+  struct itimerval off = {{0, 0}, {0, 0}};
+  const char *out = getenv("CINCOUT_PROFILE_OUT");
+  char path[4096], line[4096];
+  size_t count, unique = 0, i;
+  int j;
+  void **addresses;
+  FILE *file, *maps;
+
+  if (!out) {
+    return;
+  }
+  setitimer(ITIMER_PROF, &off, NULL);
+  signal(SIGPROF, SIG_IGN);
+  snprintf(path, sizeof path, "%s.%d", out, (int)getpid());
+  if (!(file = fopen(path, "w"))) {
+    return;
+  }
+
+  count = taken < MAX_SAMPLES ? (size_t)taken : MAX_SAMPLES;
+  fprintf(file, "l %d\n", taken - (int)count);
+  for (i = 0; i < count; i++) {
+    fputc('s', file);
+    for (j = SKIP_FRAMES; j < depths[i]; j++) {
+      fprintf(file, " %lx", (unsigned long)stacks[i][j]);
+    }
+    fputc('\n', file);
+  }
+
+  /* Names of exported symbols; the program itself is left to addr2line */
+  addresses = malloc(sizeof(void *) * MAX_DEPTH * (count + 1));
+  for (i = 0; addresses && i < count; i++) {
+    for (j = SKIP_FRAMES; j < depths[i]; j++) {
+      addresses[unique++] = stacks[i][j];
+    }
+  }
+  if (addresses) {
+    qsort(addresses, unique, sizeof(void *), compare);
+    for (i = 0; i < unique; i++) {
+      Dl_info symbol;
+      if ((i > 0 && addresses[i] == addresses[i - 1]) ||
+          !dladdr(addresses[i], &symbol) || !symbol.dli_sname) {
+        continue;
+      }
+      fprintf(file, "y %lx %s\n", (unsigned long)addresses[i],
+              symbol.dli_sname);
+    }
+    free(addresses);
+  }
+
+  if ((maps = fopen("/proc/self/maps", "r"))) {
+    while (fgets(line, sizeof line, maps)) {
+      fprintf(file, "m %s", line);
+    }
+    fclose(maps);
+  }
+  fclose(file);
+}
+`;
+
+/**
+ * How a program is profiled and its samples collected
+ */
+export interface ProfileRun {
+  mode: ProfilerMode;
+  command: string; // Shell command running the program under the profiler
+  collect: () => Promise<ProfileReport>; // Report after exit
+}
+
+/**
+ * Distinct raw stacks with their sample counts
+ */
+type StackCounts = Map<string, { frames: SampledFrame[]; samples: number }>;
+
+/**
+ * Count raw stacks, merging identical ones before symbolization
+ * @private
+ */
+const countStacks = (counts: StackCounts, stacks: SampledFrame[][]): void => {
+  for (const frames of stacks) {
+    const key = frames.map((frame) => frame.address).join(" ");
+    const entry = counts.get(key);
+    if (entry) {
+      entry.samples++;
+    } else {
+      counts.set(key, { frames, samples: 1 });
+    }
+  }
+};
+
+/**
+ * Profiler Service Implementation
+ */
+export class ProfilerService {
+  private readonly libraryDir: string;
+  private library: Promise<string> | null = null;
+
+  /**
+   * Create a new ProfilerService
+   * @param {string} libraryDir - Directory the sampler library is built in
+   */
+  constructor(libraryDir: string) {
+    this.libraryDir = libraryDir;
+  }
+
+  /**
+   * Prepare profiling of a compiled program
+   * The program must be built with frame pointers and without PIE
+   * @param {string} binary - Program to profile
+   * @param {string} workDir - Working directory (the sandbox)
+   * @returns {Promise<ProfileRun>} Command to run and how to collect the report
+   */
+  async prepare(binary: string, workDir: string): Promise<ProfileRun> {
+    if (await this.isPerfUsable()) {
+      const data = path.join(workDir, PERF_DATA);
+      return {
+        mode: "perf",
+        command: `perf record -q -e ${PERF_EVENT} -F ${SAMPLE_FREQUENCY} -g -o "${data}" -- "${binary}"`,
+        collect: () => this.collectPerf(binary, workDir, data),
+      };
+    }
+
+    const library = await this.getSamplerLibrary();
+    const log = path.join(workDir, SAMPLER_LOG);
+    return {
+      mode: "sampler",
+      command: `env LD_PRELOAD="${library}" CINCOUT_PROFILE_OUT="${log}" "${binary}"`,
+      collect: () => this.collectSampler(binary, workDir),
+    };
+  }
+
+  /**
+   * Check whether perf can sample user programs
+   * CINCOUT_PROFILER=sampler forces the built-in sampler
+   * @returns {Promise<boolean>} True if perf record works
+   * @private
+   */
+  private async isPerfUsable(): Promise<boolean> {
+    return (
+      process.env.CINCOUT_PROFILER !== "sampler" &&
+      isToolUsable("perf", [
+        "record",
+        "-q",
+        "-e",
+        PERF_EVENT,
+        "-o",
+        "/dev/null",
+        "--",
+        "true",
+      ])
+    );
+  }
+
+  /**
+   * Read the stacks perf recorded
+   * @private
+   */
+  private async collectPerf(
+    binary: string,
+    workDir: string,
+    data: string
+  ): Promise<ProfileReport> {
+    if (!(await fs.pathExists(data))) {
+      throw new Error("perf did not write a profile");
+    }
+
+    const counts: StackCounts = new Map();
+    const parser = new PerfScriptStream();
+    await new Promise<void>((resolve, reject) => {
+      const script = spawn(
+        "perf",
+        ["script", "-i", data, "-F", "comm,ip,sym,dso"],
+        { cwd: workDir, stdio: ["ignore", "pipe", "ignore"] }
+      );
+      script.stdout.setEncoding("utf8");
+      script.stdout.on("data", (chunk: string) =>
+        countStacks(counts, parser.push(chunk))
+      );
+      script.on("error", reject);
+      script.on("close", (code) => {
+        countStacks(counts, parser.end());
+        if (code === 0) {
+          resolve();
+        } else {
+          reject(new Error(`perf script exited with code ${code}`));
+        }
+      });
+    });
+
+    return this.buildReport(binary, workDir, counts, "perf", 0);
+  }
+
+  /**
+   * Read the logs the sampler wrote, one per process
+   * @private
+   */
+  private async collectSampler(
+    binary: string,
+    workDir: string
+  ): Promise<ProfileReport> {
+    const logs = (await fs.readdir(workDir)).filter((name) =>
+      name.startsWith(`${SAMPLER_LOG}.`)
+    );
+    if (logs.length === 0) {
+      throw new Error(
+        "No samples were written; the profile is saved when the program exits normally"
+      );
+    }
+
+    const counts: StackCounts = new Map();
+    let lost = 0;
+    for (const log of logs) {
+      const parsed = parseSamplerLog(
+        await fs.readFile(path.join(workDir, log), "utf8")
+      );
+      countStacks(counts, parsed.stacks);
+      lost += parsed.lost;
+    }
+
+    return this.buildReport(binary, workDir, counts, "sampler", lost);
+  }
+
+  /**
+   * Symbolize the stacks and fold them into a report
+   * Frames in the program get function names and source lines from its debug
+   * info; frames in libraries keep their symbol or the library name
+   * @private
+   */
+  private async buildReport(
+    binary: string,
+    workDir: string,
+    counts: StackCounts,
+    mode: ProfilerMode,
+    lost: number
+  ): Promise<ProfileReport> {
+    const program = await fs.realpath(binary);
+    const sandbox = await fs.realpath(workDir);
+    const inProgram = (frame: SampledFrame): boolean =>
+      frame.dso === program || frame.dso === binary;
+
+    // Return addresses point after the call; step back into it
+    const lookup = (frame: SampledFrame, index: number): string =>
+      index === 0
+        ? frame.address
+        : (parseInt(frame.address, 16) - 1).toString(16);
+
+    const addresses = new Set<string>();
+    counts.forEach(({ frames }) =>
+      frames.forEach((frame, index) => {
+        if (inProgram(frame)) {
+          addresses.add(lookup(frame, index));
+        }
+      })
+    );
+    const symbols = await this.symbolize(binary, Array.from(addresses));
+
+    const profile = new StackProfile();
+    counts.forEach(({ frames, samples }) => {
+      const resolved = frames.flatMap((frame, index): ResolvedFrame[] => {
+        if (!inProgram(frame)) {
+          return [
+            {
+              fn:
+                frame.symbol ||
+                (frame.dso ? `[${path.basename(frame.dso)}]` : "[unknown]"),
+            },
+          ];
+        }
+
+        const inlined = symbols.get(lookup(frame, index));
+        if (!inlined) {
+          return [{ fn: frame.symbol || `[${path.basename(binary)}]` }];
+        }
+        return inlined.map((symbol) => {
+          const own = symbol.file && path.dirname(symbol.file) === sandbox;
+          return {
+            fn: symbol.fn || frame.symbol || `[${path.basename(binary)}]`,
+            file: own ? path.basename(symbol.file!) : undefined,
+            line: own ? symbol.line : undefined,
+          };
+        });
+      });
+      profile.add(resolved, samples);
+    });
+
+    return profile.getReport(mode, lost);
+  }
+
+  /**
+   * Resolve program addresses to functions and source lines with addr2line
+   * @param {string} binary - Program with debug info
+   * @param {string[]} addresses - Hex addresses
+   * @returns {Promise<Map<string, ResolvedFrame[]>>} Frames by address,
+   * innermost inlined function first
+   * @private
+   */
+  private symbolize(
+    binary: string,
+    addresses: string[]
+  ): Promise<Map<string, ResolvedFrame[]>> {
+    const symbols = new Map<string, ResolvedFrame[]>();
+    if (addresses.length === 0) {
+      return Promise.resolve(symbols);
+    }
+
+    return new Promise((resolve) => {
+      const child = execFile(
+        "addr2line",
+        ["-a", "-i", "-f", "-C", "-e", binary],
+        { maxBuffer: 64 * 1024 * 1024 },
+        (error, stdout) => {
+          if (error) {
+            // Frames fall back to the symbols the sampler knew
+            resolve(symbols);
+            return;
+          }
+
+          // "0x<address>", then function and "file:line" for each inlined
+          // function, innermost first
+          let current: ResolvedFrame[] = [];
+          const lines = stdout.split("\n");
+          for (let i = 0; i < lines.length; i++) {
+            if (lines[i].startsWith("0x")) {
+              current = [];
+              symbols.set(parseInt(lines[i], 16).toString(16), current);
+              continue;
+            }
+            if (!lines[i]) {
+              continue;
+            }
+
+            const fn = lines[i];
+            const location = lines[++i]?.match(/^(.*):(\d+)/);
+            const known = location && location[1] !== "??";
+            current.push({
+              fn: fn !== "??" ? fn : "",
+              file: known ? location![1] : undefined,
+              line: known ? parseInt(location![2], 10) || undefined : undefined,
+            });
+          }
+          resolve(symbols);
+        }
+      );
+      child.stdin?.on("error", () => {});
+      child.stdin?.end(addresses.join("\n") + "\n");
+    });
+  }
+
+  /**
+   * Get the sampler library, building it on first use
+   * @returns {Promise<string>} Path of the shared library
+   * @private
+   */
+  private getSamplerLibrary(): Promise<string> {
+    if (!this.library) {
+      this.library = this.buildSamplerLibrary().catch((error) => {
+        this.library = null; // Try again on the next request
+        throw error;
+      });
+    }
+    return this.library;
+  }
+
+  /**
+   * Build the sampler library
+   * The file name carries a hash of the source, so workers share one build
+   * and a changed sampler is rebuilt
+   * @private
+   */
+  private async buildSamplerLibrary(): Promise<string> {
+    const hash = crypto
+      .createHash("sha256")
+      .update(SAMPLER_SOURCE)
+      .digest("hex")
+      .slice(0, 12);
+    const library = path.join(this.libraryDir, `sampler-${hash}.so`);
+    if (await fs.pathExists(library)) {
+      return library;
+    }
+
+    await fs.ensureDir(this.libraryDir);
+    const source = path.join(this.libraryDir, `sampler-${hash}.c`);
+    const staging = `${library}.tmp-${process.pid}`;
+    await fs.writeFile(source, SAMPLER_SOURCE, "utf8");
+
+    await new Promise<void>((resolve, reject) => {
+      execFile(
+        "gcc",
+        ["-shared", "-fPIC", "-O2", source, "-o", staging, "-ldl"],
+        (error, _stdout, stderr) => {
+          if (error) {
+            reject(
+              new Error(
+                `Failed to build the sampler: ${stderr || error.message}`
+              )
+            );
+            return;
+          }
+          resolve();
+        }
+      );
+    });
+
+    await fs.rename(staging, library);
+    return library;
+  }
+}
+
+// Create singleton instance
+export const profilerService = new ProfilerService(
+  process.env.CINCOUT_PROFILER_DIR || path.join(os.tmpdir(), "CinCout-profiler")
+);
@@ -0,0 +1,300 @@
+/**
+ * Rate Limiter
+ * Cluster-wide token buckets per client, charged by what a request costs,
+ * and admission control that sheds expensive requests while the node is
+ * saturated. The buckets live in the cluster primary; workers charge
+ * requests over IPC
+ */
+import os from "os";
+import { Context, Next } from "koa";
+import { AppError, RateDecision } from "../types";
+import { clusterIpc } from "./clusterIpc";
+import { compileSlotPool } from "./compileScheduler";
+import { getRequestClientAddress } from "./clientAddress";
+
+// Bucket size in tokens and refill rate in tokens per second
+const BUCKET_CAPACITY = parseInt(
+  process.env.CINCOUT_RATE_CAPACITY || "300",
+  10
+);
+const REFILL_PER_SECOND = parseFloat(process.env.CINCOUT_RATE_REFILL || "5");
+
+// Requests costing at least this much are shed while the node is saturated
+const SHED_MIN_COST = 10;
+// Saturation: queued compiles per compile slot, or 1-minute load per CPU
+const SHED_QUEUE_PER_SLOT = parseFloat(process.env.CINCOUT_SHED_QUEUE || "4");
+const SHED_LOAD_PER_CPU = parseFloat(process.env.CINCOUT_SHED_LOAD || "2");
+const SHED_RETRY_MS = 5000;
+
+// Workers let requests through if the primary does not answer in time
+const DECISION_TIMEOUT_MS = 1000;
+// Buckets that refilled completely are forgotten
+const PRUNE_INTERVAL_MS = 60 * 1000;
+
+/**
+ * Cost of each kind of request in tokens
+ * A template fetch costs 1; runs cost by how long they hold CPU and memory
+ */
+export const REQUEST_COSTS = {
+  template: 1,
+  format: 2,
+  lint: 5,
+  assembly: 5,
+  assemblyDiff: 10,
+  compile: 10,
+  matrixCell: 15,
+  debug: 20,
+  syscall: 20,
+  leakCheckAsan: 20,
+  benchmarkVariant: 20,
+  profile: 30,
+  leakCheckValgrind: 50,
+};
+
+// Cost of API routes by path prefix, most specific first
+const ROUTE_COSTS: [string, number][] = [
+  ["/api/assembly/diff", REQUEST_COSTS.assemblyDiff],
+  ["/api/assembly", REQUEST_COSTS.assembly],
+  ["/api/lintCode", REQUEST_COSTS.lint],
+  ["/api/format", REQUEST_COSTS.format],
+  ["/api/templates", REQUEST_COSTS.template],
+];
+
+/**
+ * Token bucket of a client
+ */
+interface Bucket {
+  tokens: number;
+  updatedAt: number;
+}
+
+/**
+ * Token Bucket Store Implementation (primary side)
+ */
+export class TokenBucketStore {
+  private readonly buckets = new Map<string, Bucket>();
+  private readonly capacity: number;
+  private readonly refillPerSecond: number;
+
+  /**
+   * Create a new TokenBucketStore
+   * @param {number} capacity - Tokens a full bucket holds
+   * @param {number} refillPerSecond - Tokens added per second
+   */
+  constructor(capacity: number, refillPerSecond: number) {
+    this.capacity = Math.max(1, capacity);
+    this.refillPerSecond = Math.max(0.001, refillPerSecond);
+  }
+
+  /**
+   * Charge a request to a client's bucket
+   * A request costing more than a full bucket can still run once it is full
+   * @param {string} clientId - Client identifier (IP address)
+   * @param {number} cost - Tokens the request costs
+   * @param {number} now - Current time in milliseconds
+   * @returns {RateDecision} Whether the request may proceed
+   */
+  take(clientId: string, cost: number, now: number = Date.now()): RateDecision {
+    const bucket = this.refill(clientId, now);
+    const charge = Math.min(cost, this.capacity);
+
+    if (bucket.tokens >= charge) {
+      bucket.tokens -= charge;
+      return {
+        allowed: true,
+        remaining: Math.floor(bucket.tokens),
+        retryAfterMs: 0,
+      };
+    }
+
+    return {
+      allowed: false,
+      reason: "rate",
+      remaining: Math.floor(bucket.tokens),
+      retryAfterMs: Math.ceil(
+        ((charge - bucket.tokens) / this.refillPerSecond) * 1000
+      ),
+    };
+  }
+
+  /**
+   * Get the tokens left in a client's bucket without charging it
+   * @param {string} clientId - Client identifier
+   * @returns {number} Remaining tokens
+   */
+  peek(clientId: string): number {
+    return Math.floor(this.refill(clientId, Date.now()).tokens);
+  }
+
+  /**
+   * Forget buckets that refilled completely, they behave like new ones
+   * @param {number} now - Current time in milliseconds
+   */
+  prune(now: number = Date.now()): void {
+    for (const [clientId, bucket] of Array.from(this.buckets.entries())) {
+      const elapsed = (now - bucket.updatedAt) / 1000;
+      if (bucket.tokens + elapsed * this.refillPerSecond >= this.capacity) {
+        this.buckets.delete(clientId);
+      }
+    }
+  }
+
+  /**
+   * Get the number of tracked clients
+   * @returns {number} Clients with a partially used bucket
+   */
+  size(): number {
+    return this.buckets.size;
+  }
+
+  /**
+   * Bring a bucket up to date
+   * @private
+   */
+  private refill(clientId: string, now: number): Bucket {
+    const bucket = this.buckets.get(clientId) || {
+      tokens: this.capacity,
+      updatedAt: now,
+    };
+    bucket.tokens = Math.min(
+      this.capacity,
+      bucket.tokens +
+        (Math.max(0, now - bucket.updatedAt) / 1000) * this.refillPerSecond
+    );
+    bucket.updatedAt = now;
+    this.buckets.set(clientId, bucket);
+    return bucket;
+  }
+}
+
+/**
+ * Whether the node is too busy to admit expensive requests
+ * @returns {boolean} True if compiles queue up or the CPUs are overloaded
+ */
+const isSaturated = (): boolean => {
+  const stats = compileSlotPool?.getStats();
+  const queuePerSlot = stats ? stats.queued / stats.capacity : 0;
+  const loadPerCpu = os.loadavg()[0] / os.cpus().length;
+  return queuePerSlot > SHED_QUEUE_PER_SLOT || loadPerCpu > SHED_LOAD_PER_CPU;
+};
+
+/**
+ * Rate Limiter Implementation (worker side)
+ */
+export class RateLimiter {
+  private nextTicket = 1;
+  private pending = new Map<number, (decision: RateDecision) => void>();
+
+  constructor() {
+    clusterIpc.on(
+      "ratelimit:decision",
+      ({ ticket, decision }: { ticket: number; decision: RateDecision }) => {
+        const resolve = this.pending.get(ticket);
+        if (resolve) {
+          this.pending.delete(ticket);
+          resolve(decision);
+        }
+      }
+    );
+  }
+
+  /**
+   * Charge a request to its client
+   * @param {string} clientId - Client identifier (IP address)
+   * @param {number} cost - Tokens the request costs
+   * @returns {Promise<RateDecision>} Whether the request may proceed
+   */
+  consume(clientId: string, cost: number): Promise<RateDecision> {
+    const ticket = this.nextTicket++;
+
+    return new Promise((resolve) => {
+      // Limiting is best effort; an unresponsive primary must not block users
+      const timer = setTimeout(() => {
+        this.pending.delete(ticket);
+        resolve({ allowed: true, remaining: 0, retryAfterMs: 0 });
+      }, DECISION_TIMEOUT_MS);
+
+      this.pending.set(ticket, (decision) => {
+        clearTimeout(timer);
+        resolve(decision);
+      });
+      clusterIpc.notify("ratelimit:take", { ticket, clientId, cost });
+    });
+  }
+
+  /**
+   * Koa middleware charging API requests by route
+   * Static files are not charged
+   * @returns {Function} Koa middleware
+   */
+  middleware(): (ctx: Context, next: Next) => Promise<void> {
+    return async (ctx: Context, next: Next) => {
+      if (!ctx.path.startsWith("/api/")) {
+        await next();
+        return;
+      }
+
+      const cost =
+        ROUTE_COSTS.find(([prefix]) => ctx.path.startsWith(prefix))?.[1] ??
+        REQUEST_COSTS.template;
+      const decision = await this.consume(getRequestClientAddress(ctx), cost);
+      ctx.set("X-RateLimit-Remaining", String(decision.remaining));
+
+      if (!decision.allowed) {
+        ctx.set("Retry-After", String(Math.ceil(decision.retryAfterMs / 1000)));
+        throw decision.reason === "load"
+          ? new AppError("Server is busy, please retry shortly", 503)
+          : new AppError("Rate limit exceeded", 429);
+      }
+
+      await next();
+    };
+  }
+}
+
+/**
+ * Create the bucket store and register its handler in the process owning it
+ * The store is owned by the primary (or the only process when not clustered)
+ * @returns {TokenBucketStore | null} Store, or null in cluster workers
+ */
+export const createBucketStore = (): TokenBucketStore | null => {
+  if (clusterIpc.isWorker()) {
+    return null;
+  }
+
+  const store = new TokenBucketStore(BUCKET_CAPACITY, REFILL_PER_SECOND);
+  clusterIpc.handle(
+    "ratelimit:take",
+    (
+      {
+        ticket,
+        clientId,
+        cost,
+      }: { ticket: number; clientId: string; cost: number },
+      worker
+    ) => {
+      // Shed requests are not charged; the client did not get anything
+      const decision: RateDecision =
+        cost >= SHED_MIN_COST && isSaturated()
+          ? {
+              allowed: false,
+              reason: "load",
+              remaining: store.peek(clientId),
+              retryAfterMs: SHED_RETRY_MS,
+            }
+          : store.take(clientId, cost);
+      clusterIpc.sendToWorker(worker, "ratelimit:decision", {
+        ticket,
+        decision,
+      });
+    }
+  );
+
+  setInterval(() => store.prune(), PRUNE_INTERVAL_MS).unref();
+  return store;
+};
+
+export const rateBucketStore = createBucketStore();
+
+// Create singleton instance
+export const rateLimiter = new RateLimiter();
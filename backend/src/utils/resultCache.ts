@@ -0,0 +1,99 @@
+/**
+ * Result Cache
+ * Small in-memory LRU cache for the results of tool runs that depend only on
+ * their input, such as formatting and static analysis
+ */
+import * as crypto from "crypto";
+import { metrics } from "./metrics";
+
+/**
+ * Least recently used cache of results keyed by content hash
+ */
+export class ResultCache<T> {
+  // Every cache, so all of them can be emptied under memory pressure
+  private static readonly instances = new Set<ResultCache<unknown>>();
+  private readonly entries = new Map<string, T>();
+  private readonly maxEntries: number;
+  private hits = 0;
+  private misses = 0;
+
+  /**
+   * Create a new ResultCache
+   * @param {number} maxEntries - Entries kept before the oldest is evicted
+   * @param {string} name - Cache name in the metrics, if it is reported
+   */
+  constructor(maxEntries: number, name?: string) {
+    this.maxEntries = maxEntries;
+    ResultCache.instances.add(this);
+    if (name) {
+      metrics.trackCache(name, () => this.getStats());
+    }
+  }
+
+  /**
+   * Compute the key of an input
+   * @param {Array<string | number>} parts - Everything the result depends on
+   * @returns {string} Content hash
+   */
+  static key(...parts: (string | number)[]): string {
+    const hash = crypto.createHash("sha256");
+    for (const part of parts) {
+      hash.update(String(part)).update("\0");
+    }
+    return hash.digest("hex");
+  }
+
+  /**
+   * Look up a result, marking it as recently used
+   * @param {string} key - Content hash
+   * @returns {T | undefined} Cached result
+   */
+  get(key: string): T | undefined {
+    const value = this.entries.get(key);
+    if (value === undefined) {
+      this.misses++;
+      return undefined;
+    }
+
+    // Maps iterate in insertion order, so re-inserting moves it to the end
+    this.entries.delete(key);
+    this.entries.set(key, value);
+    this.hits++;
+    return value;
+  }
+
+  /**
+   * Store a result, evicting the least recently used one when full
+   * @param {string} key - Content hash
+   * @param {T} value - Result
+   */
+  set(key: string, value: T): void {
+    this.entries.delete(key);
+    this.entries.set(key, value);
+    if (this.entries.size > this.maxEntries) {
+      this.entries.delete(this.entries.keys().next().value!);
+    }
+  }
+
+  /**
+   * Drop every entry
+   */
+  clear(): void {
+    this.entries.clear();
+  }
+
+  /**
+   * Drop the entries of every cache
+   */
+  static clearAll(): void {
+    ResultCache.instances.forEach((cache) => cache.clear());
+  }
+
+  /**
+   * Get cache statistics
+   * @returns {object} Entry count, hits and misses
+   */
+  getStats(): { entries: number; hits: number; misses: number } {
+    return { entries: this.entries.size, hits: this.hits, misses: this.misses };
+  }
+}
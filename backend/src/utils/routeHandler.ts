@@ -29,3 +29,19 @@ export const koaHandler = <T = any>(
     }
   };
 };
+
+/**
+ * Get a signal that is aborted if the client goes away before the response
+ * is sent, so its queued or running compiles can be cancelled
+ * @param {Context} ctx - Koa context
+ * @returns {AbortSignal} Abort signal of the request
+ */
+export const getRequestSignal = (ctx: Context): AbortSignal => {
+  const controller = new AbortController();
+  ctx.res.once("close", () => {
+    if (!ctx.res.writableFinished) {
+      controller.abort();
+    }
+  });
+  return controller.signal;
+};
@@ -0,0 +1,213 @@
+/**
+ * Sandbox Pool
+ * Keeps pre-created working directories on a RAM-backed mount so requests do
+ * not create and recursively delete a temporary directory on the request path
+ */
+import * as fs from "fs-extra";
+import * as path from "path";
+import * as os from "os";
+import { DirResult } from "tmp";
+import { SandboxPoolStats } from "../types";
+
+/**
+ * Sandbox pool limits
+ */
+export interface SandboxPoolOptions {
+  minIdle: number; // Refill below this many idle directories
+  maxIdle: number; // Directories beyond this are deleted on release
+  maxActive: number; // Upper bound on directories handed out at once
+}
+
+/**
+ * Sandbox Pool Implementation
+ * Released directories are emptied in the background and handed out again
+ */
+export class SandboxPool {
+  private readonly rootDir: string;
+  private readonly options: SandboxPoolOptions;
+  private readonly idle: string[] = [];
+  private active = 0;
+  private created = 0;
+  private recycled = 0;
+  private refilling: Promise<void> | null = null;
+
+  /**
+   * Create a new SandboxPool
+   * @param {string} rootDir - Directory the sandboxes are created in
+   * @param {SandboxPoolOptions} options - Pool limits
+   */
+  constructor(rootDir: string, options: SandboxPoolOptions) {
+    this.rootDir = rootDir;
+    this.options = options;
+  }
+
+  /**
+   * Acquire an empty working directory
+   * The returned removeCallback returns the directory to the pool, so it is a
+   * drop-in replacement for tmp.dirSync; calling it more than once is harmless
+   * @returns {Promise<DirResult>} Directory and its release callback
+   */
+  async acquire(): Promise<DirResult> {
+    if (this.active >= this.options.maxActive) {
+      throw new Error(
+        `Sandbox limit reached (${this.options.maxActive} active directories)`
+      );
+    }
+
+    this.active++;
+    let dir = this.idle.pop();
+    try {
+      if (!dir) {
+        dir = await this.createDirectory();
+      }
+    } catch (error) {
+      this.active--;
+      throw error;
+    }
+
+    this.scheduleRefill();
+
+    let released = false;
+    const name = dir;
+    return {
+      name,
+      removeCallback: () => {
+        if (!released) {
+          released = true;
+          this.active--;
+          this.recycle(name);
+        }
+      },
+    };
+  }
+
+  /**
+   * Fill the pool up to its low-water mark
+   * Called once at startup and after every acquire that takes the pool below it
+   */
+  async warmUp(): Promise<void> {
+    while (this.idle.length < this.options.minIdle) {
+      this.idle.push(await this.createDirectory());
+    }
+  }
+
+  /**
+   * Remove the sandboxes of a process that exited without releasing them
+   * Sandboxes are named after their owning process for this purpose
+   * @param {number} pid - Process ID of the exited worker
+   */
+  async removeOrphans(pid: number): Promise<void> {
+    const prefix = `CinCout-${pid}-`;
+    const names = await fs.readdir(this.rootDir).catch(() => [] as string[]);
+
+    await Promise.all(
+      names
+        .filter((name) => name.startsWith(prefix))
+        .map((name) => fs.remove(path.join(this.rootDir, name)))
+    );
+  }
+
+  /**
+   * Get pool statistics
+   * @returns {SandboxPoolStats} Idle and active directory counts
+   */
+  getStats(): SandboxPoolStats {
+    return {
+      rootDir: this.rootDir,
+      idle: this.idle.length,
+      active: this.active,
+      created: this.created,
+      recycled: this.recycled,
+    };
+  }
+
+  /**
+   * Refill the pool in the background unless a refill is already running
+   * @private
+   */
+  private scheduleRefill(): void {
+    if (this.refilling || this.idle.length >= this.options.minIdle) {
+      return;
+    }
+
+    this.refilling = new Promise<void>((resolve) => setImmediate(resolve))
+      .then(() => this.warmUp())
+      .catch((error) => {
+        console.error("Error refilling sandbox pool:", error);
+      })
+      .finally(() => {
+        this.refilling = null;
+      });
+  }
+
+  /**
+   * Empty a released directory and put it back into the pool
+   * Directories above the idle limit, or that cannot be emptied, are deleted
+   * @param {string} dir - Released directory
+   * @private
+   */
+  private recycle(dir: string): void {
+    const reset =
+      this.idle.length < this.options.maxIdle
+        ? fs.emptyDir(dir).then(() => {
+            this.idle.push(dir);
+            this.recycled++;
+          })
+        : fs.remove(dir);
+
+    reset.catch((error) => {
+      console.error(`Error recycling sandbox ${dir}:`, error);
+      fs.remove(dir).catch(() => {});
+    });
+  }
+
+  /**
+   * Create a new sandbox directory
+   * @returns {Promise<string>} Directory path
+   * @private
+   */
+  private async createDirectory(): Promise<string> {
+    await fs.ensureDir(this.rootDir);
+    const dir = await fs.mkdtemp(
+      path.join(this.rootDir, `CinCout-${process.pid}-`)
+    );
+    this.created++;
+    return dir;
+  }
+}
+
+/**
+ * Pick the directory sandboxes live in
+ * Prefers RAM-backed /dev/shm, unless it is mounted noexec (the Docker default)
+ * since compiled programs run from the sandbox
+ * @returns {string} Root directory
+ */
+const resolveSandboxRoot = (): string => {
+  if (process.env.CINCOUT_SANDBOX_DIR) {
+    return process.env.CINCOUT_SANDBOX_DIR;
+  }
+
+  try {
+    const shm = fs
+      .readFileSync("/proc/mounts", "utf8")
+      .split("\n")
+      .map((line) => line.split(" "))
+      .find((fields) => fields[1] === "/dev/shm");
+
+    if (shm && !shm[3].split(",").includes("noexec")) {
+      fs.accessSync("/dev/shm", fs.constants.W_OK);
+      return "/dev/shm";
+    }
+  } catch {
+    // No /proc or no writable /dev/shm
+  }
+
+  return os.tmpdir();
+};
+
+// Create singleton instance
+export const sandboxPool = new SandboxPool(resolveSandboxRoot(), {
+  minIdle: parseInt(process.env.CINCOUT_SANDBOX_MIN_IDLE || "8", 10),
+  maxIdle: parseInt(process.env.CINCOUT_SANDBOX_MAX_IDLE || "32", 10),
+  maxActive: parseInt(process.env.CINCOUT_SANDBOX_MAX_ACTIVE || "256", 10),
+});
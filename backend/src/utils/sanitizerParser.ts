@@ -0,0 +1,229 @@
+/**
+ * Sanitizer Parser
+ * Parses AddressSanitizer, LeakSanitizer and UndefinedBehaviorSanitizer
+ * reports into the same records as Valgrind memcheck, so both leak check
+ * modes share the client view
+ */
+import * as fs from "fs-extra";
+import * as path from "path";
+import { MemcheckFrame, MemcheckRecord } from "../types";
+import { LeakRecordSet } from "./memcheckParser";
+
+// "==1234==" in front of ASan and LSan lines
+const PID_PREFIX = /^==\d+==/;
+// "ERROR: AddressSanitizer: heap-use-after-free on address 0x... at pc ..."
+const ASAN_ERROR =
+  /^ERROR: \w+Sanitizer: ((?:attempting )?([\w-]+).*?)(?: (?:at |\()pc .*)?$/;
+// "READ of size 4 at 0x602000000010 thread T0"
+const ACCESS = /^((?:READ|WRITE) of size \d+) at /;
+// "Direct leak of 40 byte(s) in 1 object(s) allocated from:"
+const LEAK = /^(Direct|Indirect) leak of (\d+) byte\(s\) in (\d+) object\(s\)/;
+// "main.c:5:10: runtime error: signed integer overflow: ..."
+const UBSAN_ERROR = /^(.+?):(\d+):(?:\d+:)? runtime error: (.*)$/;
+// "    #0 0x4f5a3e in main main.c:7:3"
+const FRAME = /^\s*#\d+ 0x[0-9a-f]+ (?:in )?(.*)$/;
+const FRAME_OBJECT = /^(.*?) ?\(([^()]+)\+0x[0-9a-f]+\)$/;
+const FRAME_LOCATION = /^(.*) (\S+?):(\d+)(?::\d+)?$/;
+// "SUMMARY: UndefinedBehaviorSanitizer: signed-integer-overflow main.c:5:10"
+const SUMMARY = /^SUMMARY: (\w+)Sanitizer: ([\w-]+)/;
+
+/**
+ * Parse a stack frame line
+ * @param {string} text - Frame without the "#N 0xADDR" prefix
+ * @returns {MemcheckFrame} Frame
+ */
+const parseFrame = (text: string): MemcheckFrame => {
+  text = text.replace(/ \(BuildId: [0-9a-f]+\)$/, "");
+
+  const object = text.match(FRAME_OBJECT);
+  if (object) {
+    return { fn: object[1] || undefined, obj: path.basename(object[2]) };
+  }
+
+  const location = text.match(FRAME_LOCATION);
+  if (location) {
+    return {
+      fn: location[1],
+      file: path.basename(location[2]),
+      line: parseInt(location[3], 10),
+    };
+  }
+
+  return { fn: text || undefined };
+};
+
+/**
+ * Incremental sanitizer report parser
+ */
+export class SanitizerStream extends LeakRecordSet {
+  private remainder = "";
+  private current: MemcheckRecord | null = null;
+  // Where frames go: the main stack, the first auxiliary stack, or nowhere
+  private target: "stack" | "aux" | null = null;
+  // Location of a UBSan error, used when it comes without a stack
+  private location: MemcheckFrame | null = null;
+
+  /**
+   * Feed a chunk of a report
+   * @param {string} chunk - Report chunk
+   */
+  push(chunk: string): void {
+    const lines = (this.remainder + chunk).split("\n");
+    this.remainder = lines.pop() || "";
+    lines.forEach((line) => this.parseLine(line));
+  }
+
+  /**
+   * Signal the end of a report
+   */
+  end(): void {
+    this.parseLine(this.remainder);
+    this.remainder = "";
+    this.flush();
+  }
+
+  /**
+   * Parse the report files a run has written
+   * Sanitizers append the process ID to log_path; a clean run writes nothing
+   * @param {string} logPath - log_path given to the sanitizers
+   * @returns {Promise<SanitizerStream>} Parsed reports of all processes
+   */
+  static async fromLogs(logPath: string): Promise<SanitizerStream> {
+    const stream = new SanitizerStream();
+    const dir = path.dirname(logPath);
+    const prefix = path.basename(logPath) + ".";
+    const files = (await fs.readdir(dir))
+      .filter((name) => name.startsWith(prefix))
+      .sort();
+
+    for (const name of files) {
+      const reader = fs.createReadStream(path.join(dir, name), {
+        encoding: "utf8",
+      });
+      for await (const chunk of reader) {
+        stream.push(chunk as string);
+      }
+      stream.end();
+    }
+    return stream;
+  }
+
+  /**
+   * Parse a single report line
+   * @private
+   */
+  private parseLine(line: string): void {
+    line = line.trimEnd().replace(PID_PREFIX, "");
+    if (!line) {
+      this.target = null;
+      return;
+    }
+
+    const frame = line.match(FRAME);
+    if (frame) {
+      if (this.current && this.target === "stack") {
+        this.current.stack.push(parseFrame(frame[1]));
+      } else if (this.current && this.target === "aux") {
+        this.current.auxStack!.push(parseFrame(frame[1]));
+      }
+      return;
+    }
+
+    const asan = line.match(ASAN_ERROR);
+    if (asan) {
+      this.flush();
+      // LSan announces leaks with an error of its own; the leaks follow
+      if (asan[2] !== "detected") {
+        this.begin({ kind: asan[2], message: asan[1], stack: [], count: 1 });
+      }
+      return;
+    }
+
+    const leak = line.match(LEAK);
+    if (leak) {
+      this.flush();
+      this.begin({
+        kind:
+          leak[1] === "Direct" ? "Leak_DefinitelyLost" : "Leak_IndirectlyLost",
+        message: `${leak[1]} leak of ${leak[2]} bytes in ${leak[3]} objects`,
+        bytes: parseInt(leak[2], 10),
+        blocks: parseInt(leak[3], 10),
+        stack: [],
+        count: 1,
+      });
+      return;
+    }
+
+    const ubsan = line.match(UBSAN_ERROR);
+    if (ubsan) {
+      this.flush();
+      this.begin({
+        kind: "UndefinedBehavior",
+        message: ubsan[3],
+        stack: [],
+        count: 1,
+      });
+      this.location = {
+        file: path.basename(ubsan[1]),
+        line: parseInt(ubsan[2], 10),
+      };
+      return;
+    }
+
+    const summary = line.match(SUMMARY);
+    if (summary) {
+      if (this.current && summary[1] === "UndefinedBehavior") {
+        this.current.kind = summary[2];
+      }
+      this.flush();
+      return;
+    }
+
+    if (!this.current) {
+      return;
+    }
+
+    const access = line.match(ACCESS);
+    if (access && this.current.stack.length === 0) {
+      this.current.message += `: ${access[1]}`;
+    } else if (line.endsWith(" here:")) {
+      // Only the first auxiliary stack (usually where memory was freed) is kept
+      if (this.current.auxMessage === undefined) {
+        this.current.auxMessage = line.slice(0, -1);
+        this.current.auxStack = [];
+        this.target = "aux";
+      } else {
+        this.target = null;
+      }
+    }
+  }
+
+  /**
+   * Start collecting a record
+   * @private
+   */
+  private begin(record: MemcheckRecord): void {
+    this.current = record;
+    this.target = "stack";
+    this.location = null;
+  }
+
+  /**
+   * Add the record being collected
+   * @private
+   */
+  private flush(): void {
+    const record = this.current;
+    if (!record) {
+      return;
+    }
+
+    if (record.stack.length === 0 && this.location) {
+      record.stack.push(this.location);
+    }
+    this.addRecord(record);
+    this.current = null;
+    this.target = null;
+    this.location = null;
+  }
+}
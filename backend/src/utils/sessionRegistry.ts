@@ -0,0 +1,247 @@
+/**
+ * Session Registry
+ * Session map with precise idle expiry: a min-heap ordered by expiry deadline
+ * drives a single timer, so expiring a session costs O(log n) instead of a
+ * periodic scan over all sessions
+ */
+import { Session } from "../types";
+
+/**
+ * A scheduled expiry check
+ * Activity does not touch the heap; an entry whose session was active since
+ * it was scheduled is pushed back when it comes due
+ */
+interface ExpiryEntry {
+  sessionId: string;
+  session: Session;
+  deadline: number;
+}
+
+/**
+ * Session Registry Implementation
+ * Behaves like a Map of sessions; entries are expired once they have been
+ * idle for longer than the configured limit
+ */
+export class SessionRegistry extends Map<string, Session> {
+  private readonly maxIdleMs: number;
+  private readonly onExpire: (sessionId: string, session: Session) => void;
+  private readonly onCountChange?: (count: number) => void;
+  private heap: ExpiryEntry[] = [];
+  private timer: NodeJS.Timeout | null = null;
+  private timerDeadline = Infinity;
+  private countChangePending = false;
+
+  /**
+   * Create a new SessionRegistry
+   * @param {number} maxIdleMs - Idle time after which a session expires
+   * @param {Function} onExpire - Called for every expired session
+   * @param {Function} onCountChange - Called with the new session count,
+   * at most once per event loop turn
+   */
+  constructor(
+    maxIdleMs: number,
+    onExpire: (sessionId: string, session: Session) => void,
+    onCountChange?: (count: number) => void
+  ) {
+    super();
+    this.maxIdleMs = maxIdleMs;
+    this.onExpire = onExpire;
+    this.onCountChange = onCountChange;
+  }
+
+  /**
+   * Add or replace a session and schedule its expiry
+   * @param {string} sessionId - Session ID
+   * @param {Session} session - Session
+   * @returns {this} The registry
+   */
+  set(sessionId: string, session: Session): this {
+    const added = !super.has(sessionId);
+    super.set(sessionId, session);
+    this.schedule({
+      sessionId,
+      session,
+      deadline: session.lastActivity + this.maxIdleMs,
+    });
+
+    if (added) {
+      this.countChanged();
+    }
+    return this;
+  }
+
+  /**
+   * Remove a session; its heap entry is discarded when it comes due
+   * @param {string} sessionId - Session ID
+   * @returns {boolean} True if a session was removed
+   */
+  delete(sessionId: string): boolean {
+    const removed = super.delete(sessionId);
+    if (removed) {
+      this.countChanged();
+      this.compact();
+    }
+    return removed;
+  }
+
+  /**
+   * Record activity on a session
+   * @param {string} sessionId - Session ID
+   */
+  touch(sessionId: string): void {
+    const session = super.get(sessionId);
+    if (session) {
+      session.lastActivity = Date.now();
+    }
+  }
+
+  /**
+   * Push an entry onto the heap and re-arm the timer if it is due first
+   * @private
+   */
+  private schedule(entry: ExpiryEntry): void {
+    const heap = this.heap;
+    heap.push(entry);
+
+    // Sift up
+    let index = heap.length - 1;
+    while (index > 0) {
+      const parent = (index - 1) >> 1;
+      if (heap[parent].deadline <= entry.deadline) {
+        break;
+      }
+      heap[index] = heap[parent];
+      index = parent;
+    }
+    heap[index] = entry;
+
+    if (entry.deadline < this.timerDeadline) {
+      this.arm();
+    }
+  }
+
+  /**
+   * Remove and return the earliest entry
+   * @private
+   */
+  private pop(): ExpiryEntry | undefined {
+    const heap = this.heap;
+    const top = heap[0];
+    const last = heap.pop();
+    if (!top || !last || heap.length === 0) {
+      return top;
+    }
+
+    // Sift the last entry down from the root
+    let index = 0;
+    for (;;) {
+      const left = 2 * index + 1;
+      if (left >= heap.length) {
+        break;
+      }
+      const right = left + 1;
+      const smallest =
+        right < heap.length && heap[right].deadline < heap[left].deadline
+          ? right
+          : left;
+      if (heap[smallest].deadline >= last.deadline) {
+        break;
+      }
+      heap[index] = heap[smallest];
+      index = smallest;
+    }
+    heap[index] = last;
+
+    return top;
+  }
+
+  /**
+   * Arm the timer for the earliest deadline
+   * @private
+   */
+  private arm(): void {
+    if (this.timer) {
+      clearTimeout(this.timer);
+      this.timer = null;
+    }
+
+    const next = this.heap[0];
+    this.timerDeadline = next ? next.deadline : Infinity;
+    if (!next) {
+      return;
+    }
+
+    this.timer = setTimeout(
+      () => this.expireDue(),
+      Math.max(0, next.deadline - Date.now())
+    );
+    // Expiry alone should not keep the process alive
+    this.timer.unref();
+  }
+
+  /**
+   * Expire every session whose deadline has passed
+   * @private
+   */
+  private expireDue(): void {
+    this.timer = null;
+    const now = Date.now();
+
+    while (this.heap.length > 0 && this.heap[0].deadline <= now) {
+      const entry = this.pop()!;
+
+      // Skip sessions that were removed or replaced since
+      if (super.get(entry.sessionId) !== entry.session) {
+        continue;
+      }
+
+      const deadline = entry.session.lastActivity + this.maxIdleMs;
+      if (deadline > now) {
+        this.schedule({ ...entry, deadline });
+        continue;
+      }
+
+      try {
+        this.onExpire(entry.sessionId, entry.session);
+      } catch (error) {
+        console.error(`Error expiring session ${entry.sessionId}:`, error);
+      }
+    }
+
+    this.arm();
+  }
+
+  /**
+   * Rebuild the heap once most of its entries belong to removed sessions
+   * @private
+   */
+  private compact(): void {
+    if (this.heap.length <= 2 * this.size + 64) {
+      return;
+    }
+
+    const live = this.heap.filter(
+      (entry) => super.get(entry.sessionId) === entry.session
+    );
+    this.heap = [];
+    this.timerDeadline = Infinity;
+    live.forEach((entry) => this.schedule(entry));
+    this.arm();
+  }
+
+  /**
+   * Report the session count once the current turn is done
+   * @private
+   */
+  private countChanged(): void {
+    if (!this.onCountChange || this.countChangePending) {
+      return;
+    }
+
+    this.countChangePending = true;
+    setImmediate(() => {
+      this.countChangePending = false;
+      this.onCountChange?.(this.size);
+    });
+  }
+}
@@ -2,33 +2,102 @@
  * Session Service
  * Centralizes all session and process management for the application
  */
+import * as fs from "fs-extra";
+import * as os from "os";
+import * as path from "path";
 import * as pty from "node-pty";
 import { DirResult } from "tmp";
 import { v4 as uuidv4 } from "uuid";
 import { Socket } from "socket.io";
-import { ISessionService, Session, SessionSocket } from "../types";
+import {
+  ISessionService,
+  Session,
+  SessionProcess,
+  SessionSocket,
+  WorkspaceCache,
+} from "../types";
+import { OutputCoalescer } from "./outputCoalescer";
+import { executionLimiter, LimitedExecution } from "./executionLimits";
+import { debuggerPool, launcherPool } from "./warmPool";
+import { PipeProcess } from "./pipeProcess";
+import { SessionRegistry } from "./sessionRegistry";
+import { connectionRouter } from "./connectionRouter";
+import { metrics, SIZE_BUCKETS } from "./metrics";
 import {
   socketEvents,
   webSocketManager,
   SocketEvents,
 } from "../ws/webSocketManager";
 
+// Workspace object caches kept per worker; the least recently used is
+// dropped beyond this
+const MAX_WORKSPACES = 64;
+const WORKSPACE_SWEEP_MS = 60 * 1000;
+
+const processStart = metrics.histogram(
+  "cincout_process_start_seconds",
+  "Time to start a session process, by kind: pty, pipe or warm launcher"
+);
+const firstOutputDelay = metrics.histogram(
+  "cincout_first_output_seconds",
+  "Time from the start of a session process to its first output"
+);
+const sessionOutput = metrics.histogram(
+  "cincout_session_output_bytes",
+  "Output produced by a session process",
+  SIZE_BUCKETS
+);
+
 /**
  * Session Service Implementation
  * Manages all PTY sessions and their lifecycle
  */
 export class SessionService implements ISessionService {
-  private sessions: Map<string, Session>;
-  private cleanupInterval: NodeJS.Timeout | null = null;
+  private sessions: SessionRegistry;
   private readonly maxSessionAge: number; // in milliseconds
+  // Object caches of multi-file workspaces, by server-issued workspace ID
+  private readonly workspaces = new Map<string, WorkspaceCache>();
+  // Output streams of running processes
+  private readonly outputs = new Set<OutputCoalescer>();
 
   /**
    * Create a new SessionService
+   * Sessions idle for longer than the maximum age are terminated as soon as
+   * they reach it; the session count is reported for connection routing
    * @param {number} maxSessionAgeMinutes - Maximum session age in minutes
    */
   constructor(maxSessionAgeMinutes: number = 30) {
-    this.sessions = new Map<string, Session>();
     this.maxSessionAge = maxSessionAgeMinutes * 60 * 1000;
+    this.sessions = new SessionRegistry(
+      this.maxSessionAge,
+      (sessionId: string) => {
+        console.log(
+          `Cleaning up stale session ${sessionId} after ${this.maxSessionAge}ms of inactivity`
+        );
+        this.terminateSession(sessionId);
+      },
+      (count: number) => connectionRouter.reportSessions(count)
+    );
+    setInterval(() => this.sweepWorkspaces(), WORKSPACE_SWEEP_MS).unref();
+
+    metrics.collect(
+      "cincout_active_sessions",
+      "Sessions running, by session type",
+      "gauge",
+      () => {
+        const counts = new Map<string, number>();
+        this.sessions.forEach((session) =>
+          counts.set(
+            session.sessionType,
+            (counts.get(session.sessionType) || 0) + 1
+          )
+        );
+        return Array.from(counts, ([type, value]) => ({
+          labels: { session_type: type },
+          value,
+        }));
+      }
+    );
   }
 
   /**
@@ -49,78 +118,199 @@ export class SessionService implements ISessionService {
         }
       }
     );
-
-    // Set up interval to clean up stale sessions
-    if (this.cleanupInterval) {
-      clearInterval(this.cleanupInterval);
-    }
-
-    this.cleanupInterval = setInterval(() => {
-      this.cleanupStaleSessions();
-    }, 5 * 60 * 1000); // Check every 5 minutes
   }
 
   /**
    * Create a PTY instance with standardized options
    * @param {string} command - Command to execute
    * @param {pty.IPtyForkOptions} options - Additional PTY options
+   * @param {LimitedExecution} execution - Resource limits for the process tree;
+   * limited processes get a minimal environment instead of the server's
    * @returns {pty.IPty} PTY process
    */
   private createPtyProcess(
     command: string,
-    options: pty.IPtyForkOptions = {}
+    options: pty.IPtyForkOptions = {},
+    execution?: LimitedExecution
   ): pty.IPty {
+    const cwd = options.cwd || process.cwd();
     const defaultOptions: pty.IPtyForkOptions = {
       name: "xterm-256color",
       cols: 80,
       rows: 24,
-      cwd: process.cwd(),
-      env: {
-        ...(process.env as { [key: string]: string }),
-        TERM: "xterm-256color",
-      },
+      cwd,
+      env: execution
+        ? execution.getEnv(cwd)
+        : {
+            ...(process.env as { [key: string]: string }),
+            TERM: "xterm-256color",
+          },
     };
 
     const ptyOptions = { ...defaultOptions, ...options };
 
     try {
-      return pty.spawn("/bin/sh", ["-c", command], ptyOptions);
+      const timer = processStart.startTimer({ kind: "pty" });
+      const ptyProcess = pty.spawn(
+        "/bin/sh",
+        ["-c", execution ? execution.wrapCommand(command) : command],
+        ptyOptions
+      );
+      timer();
+      execution?.start(() => ptyProcess.kill("SIGKILL"));
+      return ptyProcess;
     } catch (error) {
       console.error("Error creating PTY process:", error);
       throw new Error(`Failed to create PTY process: ${error}`);
     }
   }
 
+  /**
+   * Run a command with plain pipes under resource limits
+   * The shell applies the limits and execs the command in its place through
+   * stdbuf: stdio would fully buffer output to a pipe, so nothing would show
+   * until exit and a crash would lose it, while line buffering streams it as
+   * a terminal does. Standard error shares the pipe of standard output so the
+   * two stay in the order they were written
+   * @param {string} command - Command to execute
+   * @param {string} cwd - Working directory (the sandbox)
+   * @param {LimitedExecution} execution - Resource limits for the process tree
+   * @returns {PipeProcess} Running process
+   */
+  private createPipeProcess(
+    command: string,
+    cwd: string,
+    execution: LimitedExecution
+  ): PipeProcess {
+    const timer = processStart.startTimer({ kind: "pipe" });
+    const pipeProcess = new PipeProcess(
+      "/bin/sh",
+      ["-c", execution.wrapCommand(`stdbuf -oL -eL ${command} 2>&1`)],
+      { cwd, env: execution.getEnv(cwd) }
+    );
+    timer();
+    return pipeProcess;
+  }
+
+  /**
+   * Stream PTY output to a client in coalesced frames
+   * Frames are sent as binary unless a text filter is given; output beyond the
+   * session's volume limit is cut off and the process is killed
+   * @param {Socket} socket - Socket.IO connection
+   * @param {string} sessionId - Session ID
+   * @param {SessionProcess} ptyProcess - Process producing the output
+   * @param {string} event - Event carrying the output
+   * @param {Function} filter - Optional text transformation
+   * @returns {OutputCoalescer} Coalescer to end when the process exits
+   */
+  streamOutput(
+    socket: Socket,
+    sessionId: string,
+    ptyProcess: SessionProcess,
+    event: string,
+    filter?: (text: string) => string
+  ): OutputCoalescer {
+    const labels = {
+      session_type: this.sessions.get(sessionId)?.sessionType || "unknown",
+    };
+    const firstOutput = firstOutputDelay.startTimer(labels);
+    let outputBytes = 0;
+    let hasOutput = false;
+
+    const output = new OutputCoalescer(
+      (chunk: Buffer) => {
+        try {
+          // Update last activity timestamp once per frame
+          this.updateSessionActivity(sessionId);
+
+          webSocketManager.emitToClient(socket, event, {
+            output: filter ? filter(chunk.toString("utf8")) : chunk,
+          });
+        } catch (e) {
+          console.error(`Error sending output for session ${sessionId}:`, e);
+        }
+      },
+      {
+        onPause: () => ptyProcess.pause(),
+        onResume: () => ptyProcess.resume(),
+        onTruncate: () => {
+          const execution = this.sessions.get(sessionId)?.execution;
+          if (execution) {
+            execution.kill("output");
+          } else {
+            ptyProcess.kill("SIGKILL");
+          }
+        },
+      }
+    );
+
+    ptyProcess.onData((data: string) => {
+      if (!hasOutput) {
+        hasOutput = true;
+        firstOutput();
+      }
+      outputBytes += Buffer.byteLength(data, "utf8");
+      output.write(data);
+    });
+    ptyProcess.onExit(() => {
+      this.outputs.delete(output);
+      sessionOutput.observe(labels, outputBytes);
+    });
+    this.outputs.add(output);
+    return output;
+  }
+
   /**
    * Execute a new compilation session
+   * A program that may read input runs in a PTY from a launcher, which the
+   * caller can take while the program is still compiling; the launcher execs
+   * the program in place, so no shell stays between the PTY and the program.
+   * Without a launcher the program runs with plain pipes
    * @param {Socket} socket - Socket.IO connection
    * @param {string} sessionId - Session ID
    * @param {DirResult} tmpDir - Temporary directory
    * @param {string} outputFile - Path to compiled executable
-   * @returns {boolean} Success status
+   * @param {Promise<pty.IPty>} launcher - Launcher for a program reading input
+   * @returns {Promise<boolean>} Success status
    */
-  executeCompilationSession(
+  async executeCompilationSession(
     socket: Socket,
     sessionId: string,
     tmpDir: DirResult,
-    outputFile: string
-  ): boolean {
+    outputFile: string,
+    launcher?: Promise<pty.IPty>
+  ): Promise<boolean> {
+    // Confine the program to the run profile
+    const execution = await executionLimiter.create("run", sessionId);
+
     try {
       // Set standard terminal size
       const cols = 80;
       const rows = 24;
 
-      // Create PTY instance
-      const ptyProcess = this.createPtyProcess(`"${outputFile}"`, {
-        name: "xterm-256color",
-        cols: cols,
-        rows: rows,
-        cwd: tmpDir.name,
-        env: {
-          ...(process.env as { [key: string]: string }),
-          TERM: "xterm-256color",
-        },
-      });
+      const command = `"${outputFile}"`;
+      let ptyProcess: SessionProcess;
+      if (launcher) {
+        // Includes waiting for a launcher that was not ready
+        const timer = processStart.startTimer({ kind: "launcher" });
+        ptyProcess = await launcherPool.launch(
+          command,
+          tmpDir.name,
+          execution,
+          launcher
+        );
+        timer();
+      } else {
+        ptyProcess = this.createPipeProcess(command, tmpDir.name, execution);
+      }
+      execution.start(() => ptyProcess.kill("SIGKILL"));
+
+      // The client may have left while the launcher was being handed over
+      if (!socket.connected) {
+        execution.kill("timeout");
+        await execution.finish();
+        return false;
+      }
 
       // Store session
       this.sessions.set(sessionId, {
@@ -130,30 +320,29 @@ export class SessionService implements ISessionService {
         dimensions: { cols, rows },
         sessionType: "compilation",
         socketId: socket.id,
+        execution,
       });
 
-      // Handle PTY output
-      ptyProcess.onData((data: string) => {
-        try {
-          // Update last activity timestamp
-          this.updateSessionActivity(sessionId);
-
-          // Send output to client
-          webSocketManager.emitToClient(socket, SocketEvents.OUTPUT, {
-            output: data,
-          });
-        } catch (e) {
-          console.error(`Error sending output for session ${sessionId}:`, e);
-        }
-      });
+      // Handle program output
+      const output = this.streamOutput(
+        socket,
+        sessionId,
+        ptyProcess,
+        SocketEvents.OUTPUT
+      );
 
-      // Handle PTY exit
-      ptyProcess.onExit(({ exitCode }) => {
+      // Handle program exit
+      ptyProcess.onExit(async ({ exitCode, signal }) => {
         try {
-          // Send exit notification with enhanced information
+          // Deliver buffered output before the exit notification
+          output.end();
+
+          // Send exit notification with resource usage and kill reason
+          const stats = await execution.finish(signal);
           webSocketManager.emitToClient(socket, SocketEvents.EXIT, {
             code: exitCode,
-            success: exitCode === 0,
+            success: exitCode === 0 && !stats.killReason,
+            stats,
           });
 
           // Clean up
@@ -167,6 +356,7 @@ export class SessionService implements ISessionService {
 
       return true;
     } catch (ptyError) {
+      await execution.finish();
       console.error(`Error creating PTY for session ${sessionId}:`, ptyError);
       webSocketManager.emitToClient(socket, SocketEvents.ERROR, {
         message: `Error executing program: ${(ptyError as Error).message}`,
@@ -182,33 +372,30 @@ export class SessionService implements ISessionService {
    * @param {string} sessionId - Session ID
    * @param {DirResult} tmpDir - Temporary directory
    * @param {string} outputFile - Path to compiled executable
-   * @returns {boolean} Success status
+   * @returns {Promise<boolean>} Success status
    */
-  executeDebugSession(
+  async executeDebugSession(
     socket: Socket,
     sessionId: string,
     tmpDir: DirResult,
     outputFile: string
-  ): boolean {
+  ): Promise<boolean> {
+    // gdb and the program share the debug profile
+    const execution = await executionLimiter.create("debug", sessionId);
+
     try {
       // Set standard terminal size
       const cols = 80;
       const rows = 24;
 
-      // Create PTY instance with GDB - use quiet mode for cleaner output
-      const ptyProcess = this.createPtyProcess(
-        `gdb -q -ex "set disable-randomization off" "${outputFile}"`,
-        {
-          name: "xterm-256color",
-          cols: cols,
-          rows: rows,
-          cwd: tmpDir.name,
-          env: {
-            ...(process.env as { [key: string]: string }),
-            TERM: "xterm-256color",
-          },
-        }
+      // Take a pre-started gdb (quiet mode, settings applied) and load the
+      // program; it answers at its prompt once loading finished
+      const ptyProcess = await debuggerPool.open(
+        tmpDir.name,
+        outputFile,
+        execution
       );
+      execution.start(() => ptyProcess.kill("SIGKILL"));
 
       // Store session with debug flag
       this.sessions.set(sessionId, {
@@ -219,39 +406,35 @@ export class SessionService implements ISessionService {
         sessionType: "debug",
         socketId: socket.id,
         isDebugSession: true,
+        execution,
       });
 
-      // Handle PTY output
-      ptyProcess.onData((data: string) => {
-        try {
-          // Update last activity timestamp
-          this.updateSessionActivity(sessionId);
-
-          const filteredData = data
+      // Handle PTY output; gdb output is filtered, so it is sent as text
+      const output = this.streamOutput(
+        socket,
+        sessionId,
+        ptyProcess,
+        SocketEvents.DEBUG_RESPONSE,
+        (text) =>
+          text
             // remove reading symbols messages
             .replace(/Reading symbols from .*\.\.\.([\r\n]|\s)*/g, "")
-            // replace temporary path with a simplified version
-            .replace(/\/tmp\/CinCout-[^\/]*\/([^.:]+)/g, "$1");
-
-          // Send filtered output to client
-          webSocketManager.emitToClient(socket, SocketEvents.DEBUG_RESPONSE, {
-            output: filteredData,
-          });
-        } catch (e) {
-          console.error(
-            `Error sending debug output for session ${sessionId}:`,
-            e
-          );
-        }
-      });
+            // replace sandbox path with a simplified version
+            .replace(/(?:\/[^\/\s]+)*\/CinCout-[^\/]*\/([^.:]+)/g, "$1")
+      );
 
       // Handle PTY exit
-      ptyProcess.onExit(({ exitCode }) => {
+      ptyProcess.onExit(async ({ exitCode, signal }) => {
         try {
-          // Send exit notification with enhanced information
+          // Deliver buffered output before the exit notification
+          output.end();
+
+          // Send exit notification with resource usage and kill reason
+          const stats = await execution.finish(signal);
           webSocketManager.emitToClient(socket, SocketEvents.DEBUG_EXIT, {
             code: exitCode,
-            success: exitCode === 0,
+            success: exitCode === 0 && !stats.killReason,
+            stats,
           });
 
           // Clean up
@@ -266,27 +449,12 @@ export class SessionService implements ISessionService {
         }
       });
 
-      // Send some initial commands to GDB to make it more user-friendly
-      setTimeout(() => {
-        try {
-          // Enable pretty printing of structures
-          ptyProcess.write("set print pretty on\n");
-          // Set pagination off to avoid pauses
-          ptyProcess.write("set pagination off\n");
-          // Show source code
-          ptyProcess.write("list\n");
-          // Set a breakpoint at main
-          ptyProcess.write("break main\n");
-        } catch (e) {
-          console.error(
-            `Error sending initial GDB commands for session ${sessionId}:`,
-            e
-          );
-        }
-      }, 500);
+      // Show source code and set a breakpoint at main
+      ptyProcess.write("list\nbreak main\n");
 
       return true;
     } catch (ptyError) {
+      await execution.finish();
       console.error(`Error creating GDB session ${sessionId}:`, ptyError);
       webSocketManager.emitToClient(socket, SocketEvents.DEBUG_ERROR, {
         message: `Error starting GDB debugger: ${(ptyError as Error).message}`,
@@ -298,20 +466,21 @@ export class SessionService implements ISessionService {
 
   /**
    * Execute a new strace session
+   * A failed start is reported to the client and its sandbox removed here
    * @param {Socket} socket - Socket.IO connection
    * @param {string} sessionId - Session ID
    * @param {DirResult} tmpDir - Temporary directory
    * @param {string} outputFile - Path to compiled executable
    * @param {string} straceLogFile - Path to strace log file
-   * @returns {boolean} Success status
+   * @returns {Promise<boolean>} Success status
    */
-  executeStraceSession(
+  async executeStraceSession(
     socket: Socket,
     sessionId: string,
     tmpDir: DirResult,
     outputFile: string,
     straceLogFile: string
-  ): boolean {
+  ): Promise<boolean> {
     try {
       // Set standard terminal size
       const cols = 80;
@@ -319,20 +488,22 @@ export class SessionService implements ISessionService {
 
       // Build strace command with output redirection to file
       // -f: trace child processes
-      // -o: output to file
-      const straceCmd = `strace -f -o "${straceLogFile}" "${outputFile}"`;
-
-      // Create PTY instance
-      const ptyProcess = this.createPtyProcess(straceCmd, {
-        name: "xterm-256color",
-        cols: cols,
-        rows: rows,
-        cwd: tmpDir.name,
-        env: {
-          ...(process.env as { [key: string]: string }),
-          TERM: "xterm-256color",
+      // -T: time spent in each call
+      // -o: output to file (tailed while the program runs)
+      const straceCmd = `strace -f -T -o "${straceLogFile}" "${outputFile}"`;
+
+      // Create PTY instance; strace and the traced program share the limits
+      const execution = await executionLimiter.create("trace", sessionId);
+      const ptyProcess = this.createPtyProcess(
+        straceCmd,
+        {
+          name: "xterm-256color",
+          cols: cols,
+          rows: rows,
+          cwd: tmpDir.name,
         },
-      });
+        execution
+      );
 
       // Store session
       this.sessions.set(sessionId, {
@@ -344,35 +515,31 @@ export class SessionService implements ISessionService {
         socketId: socket.id,
         // Store strace log file path for reference
         straceLogFile: straceLogFile,
+        execution,
       });
 
       // Handle PTY output
-      ptyProcess.onData((data: string) => {
-        try {
-          // Update last activity timestamp
-          this.updateSessionActivity(sessionId);
-
-          // Send program output to client
-          webSocketManager.emitToClient(socket, SocketEvents.STRACE_RESPONSE, {
-            output: data,
-          });
-        } catch (e) {
-          console.error(
-            `Error sending output for strace session ${sessionId}:`,
-            e
-          );
-        }
-      });
+      const output = this.streamOutput(
+        socket,
+        sessionId,
+        ptyProcess,
+        SocketEvents.STRACE_RESPONSE
+      );
 
       // Handle PTY exit
-      ptyProcess.onExit(({ exitCode }: { exitCode: number }) => {
+      ptyProcess.onExit(async ({ exitCode, signal }) => {
         try {
+          // Deliver buffered output before the exit notification
+          output.end();
+          const stats = await execution.finish(signal);
+
           // Emit an event that will allow syscallSocket to process the strace results
           socketEvents.emit("strace-session-exit", {
             sessionId,
             socketId: socket.id,
             straceLogFile,
             exitCode,
+            stats,
           });
         } catch (e) {
           console.error(
@@ -445,10 +612,7 @@ export class SessionService implements ISessionService {
    * @param {string} sessionId - Session ID
    */
   private updateSessionActivity(sessionId: string): void {
-    const session = this.sessions.get(sessionId);
-    if (session) {
-      session.lastActivity = Date.now();
-    }
+    this.sessions.touch(sessionId);
   }
 
   /**
@@ -481,6 +645,12 @@ export class SessionService implements ISessionService {
   private cleanupSession(sessionId: string): void {
     const session = this.sessions.get(sessionId);
     if (session) {
+      // Kill anything left in the process tree and release its limits
+      if (session.execution) {
+        session.execution.kill("timeout");
+        session.execution.finish();
+      }
+
       if (session.tmpDir) {
         try {
           session.tmpDir.removeCallback();
@@ -502,20 +672,81 @@ export class SessionService implements ISessionService {
   }
 
   /**
-   * Clean up stale sessions
+   * Get the object cache of a workspace, creating it on first use
+   * Each run is a new connection, so the cache is found by a random ID the
+   * server issues with it; the client sends the ID back with its next run,
+   * and no other client can guess it. An unknown ID, e.g. of a cache that
+   * was swept or lives in another worker, gets a new cache. The cache lives
+   * until it has been idle for as long as a session may be
+   * @param {string} workspaceId - ID issued with an earlier run, if any
+   * @returns {Promise<WorkspaceCache>} Object cache of the workspace
+   */
+  async getWorkspaceCache(workspaceId?: string): Promise<WorkspaceCache> {
+    let workspace = workspaceId ? this.workspaces.get(workspaceId) : undefined;
+    if (!workspace) {
+      workspace = {
+        id: uuidv4(),
+        dir: await fs.mkdtemp(path.join(os.tmpdir(), "cincout-ws-")),
+        sources: new Map(),
+        objects: new Map(),
+        linkKey: null,
+        lastUsed: 0,
+        queue: Promise.resolve(),
+      };
+    }
+
+    // Reinsert to keep the map in least recently used order
+    this.workspaces.delete(workspace.id);
+    workspace.lastUsed = Date.now();
+    this.workspaces.set(workspace.id, workspace);
+    this.sweepWorkspaces();
+    return workspace;
+  }
+
+  /**
+   * Give up memory held for later requests while the worker drains
+   * Workspace caches are dropped and running sessions get a lower output
+   * limit, so slow clients cannot make their output pile up in the worker
+   * @param {number} maxOutputBytes - Output limit of running sessions
+   */
+  shedMemory(maxOutputBytes: number): void {
+    this.sweepWorkspaces(0);
+    this.outputs.forEach((output) => output.restrict(maxOutputBytes));
+  }
+
+  /**
+   * Drop idle workspace caches, and the least recently used ones beyond the
+   * limit; a directory is removed once the builds using it are done
+   * @param {number} maxWorkspaces - Workspace caches to keep
    * @private
    */
-  private cleanupStaleSessions(): void {
+  private sweepWorkspaces(maxWorkspaces: number = MAX_WORKSPACES): void {
     const now = Date.now();
-
-    this.sessions.forEach((session, sessionId) => {
-      if (now - session.lastActivity > this.maxSessionAge) {
-        console.log(
-          `Cleaning up stale session ${sessionId} after ${this.maxSessionAge}ms of inactivity`
-        );
-        this.terminateSession(sessionId);
+    for (const workspace of Array.from(this.workspaces.values())) {
+      if (
+        this.workspaces.size <= maxWorkspaces &&
+        now - workspace.lastUsed < this.maxSessionAge
+      ) {
+        break;
       }
-    });
+
+      this.dropWorkspace(workspace);
+    }
+  }
+
+  /**
+   * Forget a workspace cache and remove its directory once the builds using
+   * it are done
+   * @param {WorkspaceCache} workspace - Cache to drop
+   * @private
+   */
+  private dropWorkspace(workspace: WorkspaceCache): void {
+    this.workspaces.delete(workspace.id);
+    workspace.queue
+      .then(() => fs.remove(workspace.dir))
+      .catch((error) => {
+        console.error(`Error removing workspace ${workspace.dir}:`, error);
+      });
   }
 
   /**
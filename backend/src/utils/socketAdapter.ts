@@ -0,0 +1,121 @@
+/**
+ * Socket Adapter
+ * Socket.IO adapter that shares rooms and broadcasts between cluster workers
+ * The Socket.IO servers of the workers exchange adapter messages through the
+ * primary, which relays them to every other worker
+ */
+import cluster from "cluster";
+import { Namespace } from "socket.io";
+import {
+  ClusterAdapterOptions,
+  ClusterAdapterWithHeartbeat,
+  ClusterMessage,
+  ClusterResponse,
+} from "socket.io-adapter";
+import { clusterIpc } from "./clusterIpc";
+
+const CHANNEL = "socket:adapter";
+
+/**
+ * Adapter message as relayed by the primary
+ * Responses carry the ID of the server that asked for them
+ */
+interface AdapterEnvelope {
+  nsp: string;
+  message?: ClusterMessage;
+  requesterUid?: string;
+  response?: ClusterResponse;
+}
+
+/**
+ * Cluster Socket Adapter Implementation (worker side)
+ */
+export class ClusterSocketAdapter extends ClusterAdapterWithHeartbeat {
+  /**
+   * Create a new ClusterSocketAdapter
+   * @param {Namespace} nsp - Namespace the adapter serves
+   * @param {ClusterAdapterOptions} opts - Heartbeat settings
+   */
+  constructor(nsp: Namespace, opts: ClusterAdapterOptions = {}) {
+    super(nsp, opts);
+
+    clusterIpc.on(CHANNEL, (envelope: AdapterEnvelope) => {
+      if (envelope.nsp !== this.nsp.name) {
+        return;
+      }
+
+      if (envelope.response) {
+        if (envelope.requesterUid === this.uid) {
+          this.onResponse(envelope.response);
+        }
+      } else if (envelope.message) {
+        this.onMessage(envelope.message);
+      }
+    });
+    this.init();
+  }
+
+  /**
+   * Publish a message to the other workers
+   * @param {ClusterMessage} message - Adapter message
+   * @returns {Promise<string>} Offset; connection state recovery is not
+   * supported, so it is always empty
+   * @protected
+   */
+  protected doPublish(message: ClusterMessage): Promise<string> {
+    clusterIpc.notify(CHANNEL, { nsp: this.nsp.name, message });
+    return Promise.resolve("");
+  }
+
+  /**
+   * Publish a response to the worker that asked for it
+   * @param {string} requesterUid - Server ID of the requester
+   * @param {ClusterResponse} response - Adapter response
+   * @returns {Promise<void>}
+   * @protected
+   */
+  protected doPublishResponse(
+    requesterUid: string,
+    response: ClusterResponse
+  ): Promise<void> {
+    clusterIpc.notify(CHANNEL, {
+      nsp: this.nsp.name,
+      requesterUid,
+      response,
+    });
+    return Promise.resolve();
+  }
+}
+
+/**
+ * Relay adapter messages between workers (primary side)
+ * Every message goes to all workers except its sender; workers ignore
+ * responses meant for someone else
+ */
+export const setupAdapterRelay = (): void => {
+  clusterIpc.handle(CHANNEL, (envelope: AdapterEnvelope, sender) => {
+    for (const worker of Object.values(cluster.workers || {})) {
+      if (worker && worker !== sender) {
+        clusterIpc.sendToWorker(worker, CHANNEL, envelope);
+      }
+    }
+  });
+};
+
+/**
+ * Get the adapter the Socket.IO server of this process should use
+ * Set CINCOUT_SOCKET_ADAPTER=memory to keep each worker's rooms to itself
+ * @returns {Function | undefined} Adapter constructor, or undefined for the
+ * default in-memory adapter
+ */
+export const getSocketAdapter = ():
+  | ((nsp: Namespace) => ClusterSocketAdapter)
+  | undefined => {
+  if (
+    !clusterIpc.isWorker() ||
+    process.env.CINCOUT_SOCKET_ADAPTER === "memory"
+  ) {
+    return undefined;
+  }
+  return (nsp: Namespace) => new ClusterSocketAdapter(nsp);
+};
@@ -0,0 +1,181 @@
+/**
+ * Static Assets
+ * In-memory responses compressed once with brotli and gzip, served with
+ * strong ETags so repeat requests cost neither a compression nor a body
+ */
+import crypto from "crypto";
+import fs from "fs-extra";
+import path from "path";
+import zlib from "zlib";
+import { promisify } from "util";
+import { Context, Next } from "koa";
+
+const brotliCompress = promisify(zlib.brotliCompress);
+const gzip = promisify(zlib.gzip);
+
+// Content types worth compressing; images and fonts already are
+const COMPRESSIBLE = /text|javascript|json|svg|xml/i;
+
+const CONTENT_TYPES: Record<string, string> = {
+  ".html": "text/html; charset=utf-8",
+  ".js": "application/javascript; charset=utf-8",
+  ".mjs": "application/javascript; charset=utf-8",
+  ".css": "text/css; charset=utf-8",
+  ".json": "application/json; charset=utf-8",
+  ".svg": "image/svg+xml",
+  ".txt": "text/plain; charset=utf-8",
+  ".map": "application/json; charset=utf-8",
+};
+
+/**
+ * A response body with its precompressed encodings
+ * Encodings that do not shrink the body are left out
+ */
+export interface CompressedAsset {
+  type: string;
+  etag: string; // Hash of the uncompressed body, without quotes
+  identity: Buffer;
+  br?: Buffer;
+  gzip?: Buffer;
+}
+
+/**
+ * Compress a response body once with every supported encoding
+ * @param {Buffer | string} body - Uncompressed body
+ * @param {string} type - Content type
+ * @returns {Promise<CompressedAsset>} Asset ready to be served
+ */
+export const compressAsset = async (
+  body: Buffer | string,
+  type: string
+): Promise<CompressedAsset> => {
+  const identity = Buffer.isBuffer(body) ? body : Buffer.from(body, "utf8");
+  const asset: CompressedAsset = {
+    type,
+    etag: crypto
+      .createHash("sha256")
+      .update(identity)
+      .digest("base64url")
+      .slice(0, 27),
+    identity,
+  };
+
+  if (COMPRESSIBLE.test(type) && identity.length > 0) {
+    const [br, gz] = await Promise.all([
+      brotliCompress(identity, {
+        params: {
+          [zlib.constants.BROTLI_PARAM_QUALITY]:
+            zlib.constants.BROTLI_MAX_QUALITY,
+          [zlib.constants.BROTLI_PARAM_SIZE_HINT]: identity.length,
+        },
+      }),
+      gzip(identity, { level: zlib.constants.Z_BEST_COMPRESSION }),
+    ]);
+    asset.br = br.length < identity.length ? br : undefined;
+    asset.gzip = gz.length < identity.length ? gz : undefined;
+  }
+
+  return asset;
+};
+
+/**
+ * Send an asset in the best encoding the client accepts
+ * Each encoding has its own strong ETag; a matching If-None-Match gets 304
+ * @param {Context} ctx - Koa context
+ * @param {CompressedAsset} asset - Asset to send
+ * @param {string} cacheControl - Cache-Control header value
+ */
+export const sendAsset = (
+  ctx: Context,
+  asset: CompressedAsset,
+  cacheControl = "no-cache"
+): void => {
+  const encodings = ["br", "gzip"].filter(
+    (encoding) => asset[encoding as "br" | "gzip"]
+  );
+  const encoding =
+    encodings.length > 0
+      ? ctx.acceptsEncodings([...encodings, "identity"]) || "identity"
+      : "identity";
+
+  // The body is final; koa-compress must not compress it again
+  ctx.compress = false;
+  ctx.vary("Accept-Encoding");
+  ctx.set("Cache-Control", cacheControl);
+  ctx.etag =
+    encoding === "identity" ? asset.etag : `${asset.etag}-${encoding}`;
+  ctx.type = asset.type;
+
+  ctx.status = 200;
+  if (ctx.fresh) {
+    ctx.status = 304;
+    return;
+  }
+
+  if (encoding !== "identity") {
+    ctx.set("Content-Encoding", encoding);
+  }
+  ctx.body =
+    encoding === "identity" ? asset.identity : asset[encoding as "br" | "gzip"];
+};
+
+/**
+ * Cache-Control of a static file
+ * HTML must be revalidated; the files it references carry content hashes
+ * @private
+ */
+const staticCacheControl = (file: string): string =>
+  file.endsWith(".html") ? "no-cache" : "public, max-age=86400, immutable";
+
+/**
+ * Koa middleware serving a directory from memory, precompressed
+ * Files are loaded and compressed in the background at startup; requests
+ * that arrive earlier, and files that are not compressible, fall through
+ * to the next middleware
+ * @param {string} root - Directory to serve
+ * @param {string} index - File served for directory paths
+ * @returns {Function} Koa middleware
+ */
+export const precompressedStatic = (
+  root: string,
+  index = "index.html"
+): ((ctx: Context, next: Next) => Promise<void>) => {
+  const assets = new Map<string, CompressedAsset>();
+
+  const load = async (dir: string): Promise<void> => {
+    for (const entry of await fs.readdir(dir, { withFileTypes: true })) {
+      const file = path.join(dir, entry.name);
+      if (entry.isDirectory()) {
+        await load(file);
+        continue;
+      }
+
+      const type = CONTENT_TYPES[path.extname(entry.name).toLowerCase()];
+      if (!type) {
+        continue;
+      }
+      const urlPath = `/${path.relative(root, file).split(path.sep).join("/")}`;
+      assets.set(urlPath, await compressAsset(await fs.readFile(file), type));
+    }
+  };
+
+  load(root).catch((error) => {
+    console.error("Error precompressing static files:", error);
+  });
+
+  return async (ctx: Context, next: Next) => {
+    if (ctx.method !== "GET" && ctx.method !== "HEAD") {
+      await next();
+      return;
+    }
+
+    const urlPath = ctx.path.endsWith("/") ? `${ctx.path}${index}` : ctx.path;
+    const asset = assets.get(urlPath);
+    if (!asset) {
+      await next();
+      return;
+    }
+
+    sendAsset(ctx, asset, staticCacheControl(urlPath));
+  };
+};
@@ -0,0 +1,194 @@
+/**
+ * Strace Parser
+ * Parses strace -f -T output into structured records and keeps
+ * strace -c style per-syscall totals
+ */
+import { SyscallRecord, SyscallSummaryEntry } from "../types";
+
+// "1234  " (-f with -o) or "[pid  1234] " (-f on stderr)
+const PID_PREFIX = /^(?:\[pid\s+(\d+)\]|(\d+))\s+/;
+// "name(args) = result rest"; the greedy argument match anchors on the last
+// ") = " so results inside string arguments are not mistaken for the return
+const SYSCALL = /^(\w+)\((.*)\)\s+=\s+(\S+)(?:\s+(.*))?$/;
+const DURATION = /\s+<(\d+\.\d+|unavailable)>$/;
+const UNFINISHED = /^(.*?) ?<unfinished \.\.\.>$/;
+const RESUMED = /^<\.\.\. (\w+) resumed>\s*(.*)$/;
+const SIGNAL = /^--- (\w+) (.*) ---$/;
+const PROCESS_EXIT = /^\+\+\+ (.*) \+\+\+$/;
+
+// Argument strings are cut to this length; strace already abbreviates data
+const MAX_ARGS_LENGTH = 256;
+
+/**
+ * Incremental strace log parser
+ * Accepts the log in arbitrary chunks; calls interrupted by another process
+ * ("<unfinished ...>") are joined with their "<... resumed>" tail
+ */
+export class StraceStream {
+  private remainder = "";
+  private readonly unfinished = new Map<number | null, string>();
+
+  /**
+   * Feed a chunk of the log
+   * @param {string} chunk - Log chunk
+   * @returns {SyscallRecord[]} Records completed by this chunk
+   */
+  push(chunk: string): SyscallRecord[] {
+    const lines = (this.remainder + chunk).split("\n");
+    this.remainder = lines.pop() || "";
+
+    const records: SyscallRecord[] = [];
+    for (const line of lines) {
+      const record = this.parseLine(line);
+      if (record) {
+        records.push(record);
+      }
+    }
+    return records;
+  }
+
+  /**
+   * Signal the end of the log
+   * @returns {SyscallRecord[]} Remaining records
+   */
+  end(): SyscallRecord[] {
+    const record = this.parseLine(this.remainder);
+    this.remainder = "";
+    this.unfinished.clear();
+    return record ? [record] : [];
+  }
+
+  /**
+   * Parse a single log line
+   * @private
+   */
+  private parseLine(line: string): SyscallRecord | null {
+    line = line.trimEnd();
+    if (!line) {
+      return null;
+    }
+
+    let pid: number | null = null;
+    const prefix = line.match(PID_PREFIX);
+    if (prefix) {
+      pid = parseInt(prefix[1] || prefix[2], 10);
+      line = line.slice(prefix[0].length);
+    }
+
+    const unfinished = line.match(UNFINISHED);
+    if (unfinished) {
+      this.unfinished.set(pid, unfinished[1]);
+      return null;
+    }
+
+    const resumed = line.match(RESUMED);
+    if (resumed) {
+      const head = this.unfinished.get(pid);
+      this.unfinished.delete(pid);
+      line =
+        head !== undefined ? head + resumed[2] : `${resumed[1]}(${resumed[2]}`;
+    }
+
+    const signal = line.match(SIGNAL);
+    if (signal) {
+      return { pid, kind: "signal", name: signal[1], args: signal[2] };
+    }
+
+    const exit = line.match(PROCESS_EXIT);
+    if (exit) {
+      return { pid, kind: "exit", name: "exit", args: exit[1] };
+    }
+
+    let durationMs: number | undefined;
+    const duration = line.match(DURATION);
+    if (duration) {
+      if (duration[1] !== "unavailable") {
+        durationMs = parseFloat(duration[1]) * 1000;
+      }
+      line = line.slice(0, duration.index);
+    }
+
+    const call = line.match(SYSCALL);
+    if (!call) {
+      return null;
+    }
+
+    const errno = call[4]?.match(/^(E[A-Z0-9]+)\b/);
+    return {
+      pid,
+      kind: "syscall",
+      name: call[1],
+      args:
+        call[2].length > MAX_ARGS_LENGTH
+          ? call[2].slice(0, MAX_ARGS_LENGTH) + "..."
+          : call[2],
+      result: call[3],
+      errno: errno && call[3].startsWith("-") ? errno[1] : undefined,
+      durationMs,
+    };
+  }
+}
+
+/**
+ * Per-syscall totals
+ */
+export class SyscallSummary {
+  private readonly totals = new Map<
+    string,
+    { calls: number; errors: number; totalMs: number }
+  >();
+  private dirty = false;
+
+  /**
+   * Account for parsed records
+   * @param {SyscallRecord[]} records - Records to add
+   */
+  add(records: SyscallRecord[]): void {
+    for (const record of records) {
+      if (record.kind !== "syscall") {
+        continue;
+      }
+
+      const total = this.totals.get(record.name) || {
+        calls: 0,
+        errors: 0,
+        totalMs: 0,
+      };
+      total.calls++;
+      if (record.errno) {
+        total.errors++;
+      }
+      total.totalMs += record.durationMs || 0;
+      this.totals.set(record.name, total);
+      this.dirty = true;
+    }
+  }
+
+  /**
+   * Whether totals changed since the last snapshot
+   * @returns {boolean} True if a new snapshot would differ
+   */
+  hasChanges(): boolean {
+    return this.dirty;
+  }
+
+  /**
+   * Get the totals, most time-consuming syscall first
+   * @returns {SyscallSummaryEntry[]} Summary entries
+   */
+  snapshot(): SyscallSummaryEntry[] {
+    this.dirty = false;
+
+    let totalMs = 0;
+    this.totals.forEach((total) => (totalMs += total.totalMs));
+
+    return Array.from(this.totals, ([name, total]) => ({
+      name,
+      calls: total.calls,
+      errors: total.errors,
+      totalMs: Math.round(total.totalMs * 1000) / 1000,
+      percent:
+        totalMs > 0 ? Math.round((total.totalMs / totalMs) * 10000) / 100 : 0,
+    })).sort((a, b) => b.totalMs - a.totalMs || b.calls - a.calls);
+  }
+}
@@ -0,0 +1,49 @@
+/**
+ * Template Files
+ * Finds the bundled code templates of a language
+ * Templates in a subdirectory form a family and are named after it, e.g.
+ * "perf/AoS vs SoA" for cpp/perf/AoS vs SoA.cpp
+ */
+import fs from "fs-extra";
+import path from "path";
+
+/**
+ * A template source file
+ */
+export interface TemplateFile {
+  name: string; // Name shown to users, including its family
+  file: string; // Absolute path
+}
+
+/**
+ * List the templates below a directory
+ * @param {string} dir - Template directory of a language
+ * @param {string} family - Family prefix of the templates in dir
+ * @returns {Promise<TemplateFile[]>} Templates, top-level ones first
+ */
+export const listTemplateFiles = async (
+  dir: string,
+  family = ""
+): Promise<TemplateFile[]> => {
+  const entries = await fs.readdir(dir, { withFileTypes: true });
+  const templates: TemplateFile[] = entries
+    .filter(
+      (entry) =>
+        entry.isFile() &&
+        (entry.name.endsWith(".c") || entry.name.endsWith(".cpp"))
+    )
+    .map((entry) => ({
+      name: family + entry.name.replace(/\.[^.]+$/, ""),
+      file: path.join(dir, entry.name),
+    }));
+
+  for (const entry of entries.filter((entry) => entry.isDirectory())) {
+    templates.push(
+      ...(await listTemplateFiles(
+        path.join(dir, entry.name),
+        `${family}${entry.name}/`
+      ))
+    );
+  }
+  return templates;
+};
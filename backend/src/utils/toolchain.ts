@@ -0,0 +1,148 @@
+/**
+ * Toolchain utilities
+ * Identifies the installed compilers so generated artifacts can be tied to them,
+ * and checks which optional tools can be used
+ */
+import * as crypto from "crypto";
+import { execFile } from "child_process";
+import { MatrixConfig, MatrixRequest } from "../types";
+
+/**
+ * Optimization options accepted from clients
+ */
+export const OPTIMIZATION_LEVELS = ["-O0", "-O1", "-O2", "-O3", "-Os"];
+
+/**
+ * Language standards accepted from clients, per language
+ * Limited to what every installed gcc and clang understands
+ */
+export const LANGUAGE_STANDARDS: Record<string, string[]> = {
+  c: ["-std=c99", "-std=c11", "-std=c17"],
+  cpp: ["-std=c++11", "-std=c++14", "-std=c++17", "-std=c++20"],
+};
+
+/**
+ * Language standard used when a request names none
+ */
+export const DEFAULT_STANDARDS: Record<string, string> = {
+  c: "-std=c11",
+  cpp: "-std=c++20",
+};
+
+/**
+ * Compilers a matrix run compares
+ */
+export const MATRIX_COMPILERS = ["gcc", "clang"];
+
+/**
+ * Most configurations a matrix run builds
+ */
+export const MAX_MATRIX_CELLS = 16;
+
+/**
+ * Keep the requested values that are allowed, in their canonical order
+ * @private
+ */
+const selectValues = (
+  requested: unknown,
+  allowed: string[],
+  fallback: string[]
+): string[] => {
+  const selected = Array.isArray(requested)
+    ? allowed.filter((value) => requested.includes(value))
+    : [];
+  return selected.length > 0 ? selected : fallback;
+};
+
+/**
+ * Expand a matrix run request into every combination of its allowed
+ * compilers, standards and optimization levels
+ * Not capped at MAX_MATRIX_CELLS, so callers can tell what was dropped
+ * @param {MatrixRequest} request - Matrix run request
+ * @returns {MatrixConfig[]} Build configurations in canonical order
+ */
+export const expandMatrix = (
+  request: Partial<MatrixRequest> | undefined
+): MatrixConfig[] => {
+  const lang = request?.lang === "c" ? "c" : "cpp";
+  const compilers = selectValues(
+    request?.compilers,
+    MATRIX_COMPILERS,
+    MATRIX_COMPILERS
+  );
+  const optimizations = selectValues(
+    request?.optimizations,
+    OPTIMIZATION_LEVELS,
+    ["-O0", "-O2"]
+  );
+  const standards = selectValues(
+    request?.standards,
+    LANGUAGE_STANDARDS[lang],
+    [DEFAULT_STANDARDS[lang]]
+  );
+
+  const configs: MatrixConfig[] = [];
+  for (const compiler of compilers) {
+    for (const standard of standards) {
+      for (const optimization of optimizations) {
+        configs.push({ compiler, optimization, standard });
+      }
+    }
+  }
+  return configs;
+};
+
+const fingerprints = new Map<string, Promise<string>>();
+const probes = new Map<string, Promise<boolean>>();
+
+/**
+ * Get a short fingerprint of a compiler's version string
+ * The result is memoized per process; an unavailable compiler yields "unknown"
+ * @param {string} compiler - Compiler command ('gcc', 'g++', 'clang', 'clang++')
+ * @returns {Promise<string>} Hex fingerprint
+ */
+export const getCompilerFingerprint = (compiler: string): Promise<string> => {
+  let fingerprint = fingerprints.get(compiler);
+
+  if (!fingerprint) {
+    fingerprint = new Promise<string>((resolve) => {
+      execFile(compiler, ["--version"], (error, stdout) => {
+        resolve(
+          error
+            ? "unknown"
+            : crypto
+                .createHash("sha256")
+                .update(stdout)
+                .digest("hex")
+                .slice(0, 12)
+        );
+      });
+    });
+    fingerprints.set(compiler, fingerprint);
+  }
+
+  return fingerprint;
+};
+
+/**
+ * Check once whether a command runs and its events are supported
+ * @param {string} command - Command
+ * @param {string[]} args - Arguments
+ * @returns {Promise<boolean>} True if the command succeeded
+ */
+export const isToolUsable = (
+  command: string,
+  args: string[]
+): Promise<boolean> => {
+  const key = [command, ...args].join(" ");
+  let result = probes.get(key);
+  if (!result) {
+    result = new Promise<boolean>((resolve) => {
+      execFile(command, args, (error, _stdout, stderr) =>
+        resolve(!error && !/not supported|not counted/.test(stderr))
+      );
+    });
+    probes.set(key, result);
+  }
+  return result;
+};
@@ -0,0 +1,102 @@
+/**
+ * Tracing
+ * Times the stages of requests on the compile and run path. Every stage is
+ * recorded in cincout_stage_duration_seconds; a request slower than
+ * CINCOUT_TRACE_SLOW_MS is logged with its stage breakdown, so tail latency
+ * can be attributed to the stage that caused it
+ */
+import { AsyncLocalStorage } from "async_hooks";
+import { performance } from "perf_hooks";
+import { MetricLabels, metrics } from "./metrics";
+
+// Requests slower than this are logged; 0 disables the log
+const SLOW_TRACE_MS = parseInt(process.env.CINCOUT_TRACE_SLOW_MS || "5000", 10);
+
+/**
+ * A request being traced
+ */
+interface Trace {
+  operation: string;
+  attributes: MetricLabels;
+  spans: { stage: string; startMs: number; ms: number }[];
+  startedAt: number;
+}
+
+const stageDuration = metrics.histogram(
+  "cincout_stage_duration_seconds",
+  "Duration of each stage of a traced operation"
+);
+const current = new AsyncLocalStorage<Trace>();
+
+/**
+ * Trace an operation; stages run inside it are attributed to it
+ * @param {string} operation - Operation name, e.g. "compile"
+ * @param {MetricLabels} attributes - Logged with a slow operation
+ * @param {Function} task - The operation
+ * @returns {Promise<T>} Result of the task
+ */
+export const traceOperation = <T>(
+  operation: string,
+  attributes: MetricLabels,
+  task: () => Promise<T>
+): Promise<T> => {
+  // A nested operation stays part of the outer one
+  if (current.getStore()) {
+    return task();
+  }
+
+  const trace: Trace = {
+    operation,
+    attributes,
+    spans: [],
+    startedAt: performance.now(),
+  };
+  return current.run(trace, async () => {
+    try {
+      return await task();
+    } finally {
+      const totalMs = performance.now() - trace.startedAt;
+      if (SLOW_TRACE_MS > 0 && totalMs >= SLOW_TRACE_MS) {
+        const stages = trace.spans
+          .map(
+            (span) =>
+              `${span.stage} +${Math.round(span.startMs)} ${Math.round(
+                span.ms
+              )}ms`
+          )
+          .join(", ");
+        console.warn(
+          `Slow ${operation} (${Math.round(totalMs)}ms, ${Object.entries(
+            attributes
+          )
+            .map(([name, value]) => `${name}=${value}`)
+            .join(" ")}): ${stages}`
+        );
+      }
+    }
+  });
+};
+
+/**
+ * Time a stage of the current operation
+ * @param {string} stage - Stage name, e.g. "cache_restore"
+ * @param {Function} task - The stage
+ * @returns {Promise<T>} Result of the task
+ */
+export const traceStage = async <T>(
+  stage: string,
+  task: () => Promise<T>
+): Promise<T> => {
+  const trace = current.getStore();
+  const started = performance.now();
+  try {
+    return await task();
+  } finally {
+    const ms = performance.now() - started;
+    stageDuration.observe(
+      { operation: trace?.operation ?? "none", stage },
+      ms / 1000
+    );
+    trace?.spans.push({ stage, startMs: started - trace.startedAt, ms });
+  }
+};
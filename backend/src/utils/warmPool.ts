@@ -0,0 +1,370 @@
+/**
+ * Warm Process Pool
+ * Keeps pre-started PTY processes so interactive sessions skip process and
+ * tool startup: gdb instances waiting at their prompt, and launcher shells
+ * that exec a program or tool (valgrind) as soon as they are handed a
+ * command line
+ * Readiness is detected from the process output instead of fixed delays
+ */
+import * as pty from "node-pty";
+import * as os from "os";
+import {
+  executionLimiter,
+  LimitedExecution,
+  minimalEnv,
+} from "./executionLimits";
+import { metrics } from "./metrics";
+
+// Upper bound for a process to become ready; normally a few milliseconds
+const READY_TIMEOUT_MS = 10000;
+
+const GDB_PROMPT = /\(gdb\) $/;
+// Printed by gdb once a program is loaded; matched at the start of a line so
+// the echoed "echo" command itself does not count
+const GDB_LOADED = /(^|\n)__CINCOUT_LOADED__\r?\n\(gdb\) $/;
+const LAUNCHER_READY = /__CINCOUT_READY__\r?\n$/;
+
+/**
+ * Wait until a PTY prints output matching a pattern
+ * @param {pty.IPty} ptyProcess - PTY process
+ * @param {RegExp} pattern - Pattern matched against the recent output
+ * @param {number} timeoutMs - Give up after this long
+ * @returns {Promise<void>} Resolves once matched; rejects on exit or timeout
+ */
+export const waitForOutput = (
+  ptyProcess: pty.IPty,
+  pattern: RegExp,
+  timeoutMs: number = READY_TIMEOUT_MS
+): Promise<void> =>
+  new Promise<void>((resolve, reject) => {
+    let seen = "";
+    let done = false;
+
+    const finish = (error?: Error) => {
+      if (done) {
+        return;
+      }
+      done = true;
+      clearTimeout(timer);
+      dataListener.dispose();
+      exitListener.dispose();
+      if (error) {
+        reject(error);
+      } else {
+        resolve();
+      }
+    };
+
+    const timer = setTimeout(
+      () => finish(new Error(`Timed out waiting for ${pattern}`)),
+      timeoutMs
+    );
+    const dataListener = ptyProcess.onData((data: string) => {
+      seen = (seen + data).slice(-4096);
+      if (pattern.test(seen)) {
+        finish();
+      }
+    });
+    const exitListener = ptyProcess.onExit(() =>
+      finish(new Error("Process exited before it was ready"))
+    );
+  });
+
+/**
+ * Spawn a shell script in a PTY outside any session
+ * @param {string} script - Shell script
+ * @returns {pty.IPty} PTY process
+ */
+const spawnWarm = (script: string): pty.IPty =>
+  pty.spawn("/bin/sh", ["-c", script], {
+    name: "xterm-256color",
+    cols: 80,
+    rows: 24,
+    cwd: os.tmpdir(),
+    env: minimalEnv(os.tmpdir()),
+  });
+
+/**
+ * Warm PTY Pool Implementation
+ * Processes that exit while idle are dropped; the pool refills in the
+ * background after every acquire
+ */
+export class WarmPtyPool {
+  private readonly name: string;
+  private readonly size: number;
+  private readonly startProcess: () => Promise<pty.IPty>;
+  private readonly idle: pty.IPty[] = [];
+  private readonly idleExitListeners = new Map<pty.IPty, pty.IDisposable>();
+  private starting = 0;
+  private hits = 0;
+  private misses = 0;
+
+  /**
+   * Create a new WarmPtyPool
+   * @param {string} name - Pool name used in log messages
+   * @param {number} size - Number of idle processes to keep
+   * @param {Function} startProcess - Starts a process and waits until ready
+   */
+  constructor(
+    name: string,
+    size: number,
+    startProcess: () => Promise<pty.IPty>
+  ) {
+    this.name = name;
+    this.size = size;
+    this.startProcess = startProcess;
+    // A miss is an acquire that had to start a process itself
+    metrics.trackCache(`${name}_pool`, () => ({
+      hits: this.hits,
+      misses: this.misses,
+    }));
+  }
+
+  /**
+   * Take a ready process, starting one if the pool is empty
+   * @returns {Promise<pty.IPty>} Ready process owned by the caller
+   */
+  async acquire(): Promise<pty.IPty> {
+    const ptyProcess = this.idle.shift();
+    this.refill();
+
+    if (!ptyProcess) {
+      this.misses++;
+      return this.startProcess();
+    }
+    this.hits++;
+
+    this.idleExitListeners.get(ptyProcess)?.dispose();
+    this.idleExitListeners.delete(ptyProcess);
+    return ptyProcess;
+  }
+
+  /**
+   * Hand back a process that was acquired but not used
+   * It must still be in its ready state; beyond the pool size it is killed
+   * @param {pty.IPty} ptyProcess - Process returned by acquire
+   */
+  release(ptyProcess: pty.IPty): void {
+    if (this.idle.length >= this.size) {
+      try {
+        ptyProcess.kill("SIGKILL");
+      } catch {
+        // Already gone
+      }
+      return;
+    }
+    this.addIdle(ptyProcess);
+  }
+
+  /**
+   * Start processes until the pool is full
+   * Called once at startup
+   * @returns {Promise<void>} Resolves when the pool is filled
+   */
+  async warmUp(): Promise<void> {
+    await Promise.all(this.refill());
+  }
+
+  /**
+   * Kill all idle processes
+   */
+  shutdown(): void {
+    for (const ptyProcess of this.idle.splice(0)) {
+      this.idleExitListeners.get(ptyProcess)?.dispose();
+      this.idleExitListeners.delete(ptyProcess);
+      try {
+        ptyProcess.kill("SIGKILL");
+      } catch {
+        // Already gone
+      }
+    }
+  }
+
+  /**
+   * Start processes for the missing pool slots
+   * @returns {Promise<void>[]} One promise per started process
+   * @private
+   */
+  private refill(): Promise<void>[] {
+    const started: Promise<void>[] = [];
+
+    while (this.idle.length + this.starting < this.size) {
+      this.starting++;
+      started.push(
+        this.startProcess()
+          .then((ptyProcess) => this.addIdle(ptyProcess))
+          .catch((error) => {
+            console.error(`Error starting warm ${this.name} process:`, error);
+          })
+          .finally(() => {
+            this.starting--;
+          })
+      );
+    }
+
+    return started;
+  }
+
+  /**
+   * Keep a ready process, dropping it if it exits while idle
+   * @private
+   */
+  private addIdle(ptyProcess: pty.IPty): void {
+    this.idleExitListeners.set(
+      ptyProcess,
+      ptyProcess.onExit(() => {
+        this.idleExitListeners.delete(ptyProcess);
+        const index = this.idle.indexOf(ptyProcess);
+        if (index !== -1) {
+          this.idle.splice(index, 1);
+        }
+      })
+    );
+    this.idle.push(ptyProcess);
+  }
+}
+
+/**
+ * Start gdb with the session settings applied and wait for its prompt
+ * Without cgroups, the debug profile's ulimits are applied at spawn time
+ * @returns {Promise<pty.IPty>} gdb waiting at its prompt
+ */
+const startDebugger = async (): Promise<pty.IPty> => {
+  const command =
+    'gdb -q -ex "set disable-randomization off" ' +
+    '-ex "set print pretty on" -ex "set pagination off"';
+  // Without cgroups this only picks the ulimits, nothing needs releasing
+  const ptyProcess = spawnWarm(
+    executionLimiter.usesCgroups()
+      ? `exec ${command}`
+      : (await executionLimiter.create("debug", "warm")).wrapCommand(command)
+  );
+
+  try {
+    await waitForOutput(ptyProcess, GDB_PROMPT);
+    return ptyProcess;
+  } catch (error) {
+    ptyProcess.kill("SIGKILL");
+    throw error;
+  }
+};
+
+/**
+ * Start a shell that disables echo, reports readiness and then evaluates the
+ * first line it reads
+ * @returns {Promise<pty.IPty>} Shell waiting for a command line
+ */
+const startLauncher = async (): Promise<pty.IPty> => {
+  const ptyProcess = spawnWarm(
+    'stty -echo; echo __CINCOUT_READY__; IFS= read -r line && eval "$line"'
+  );
+
+  try {
+    await waitForOutput(ptyProcess, LAUNCHER_READY);
+    return ptyProcess;
+  } catch (error) {
+    ptyProcess.kill("SIGKILL");
+    throw error;
+  }
+};
+
+/**
+ * Debugger Pool Implementation
+ * Hands out gdb instances with a program already loaded
+ */
+export class DebuggerPool extends WarmPtyPool {
+  /**
+   * Create a new DebuggerPool
+   * @param {number} size - Number of idle gdb instances to keep
+   */
+  constructor(size: number) {
+    super("gdb", size, startDebugger);
+  }
+
+  /**
+   * Take a gdb instance, confine it and load a program into it
+   * @param {string} workDir - Working directory (the sandbox)
+   * @param {string} binary - Program to debug
+   * @param {LimitedExecution} execution - Limits for gdb and the program
+   * @returns {Promise<pty.IPty>} gdb at its prompt with the program loaded
+   */
+  async open(
+    workDir: string,
+    binary: string,
+    execution: LimitedExecution
+  ): Promise<pty.IPty> {
+    const ptyProcess = await this.acquire();
+
+    try {
+      if (
+        executionLimiter.usesCgroups() &&
+        !(await execution.adopt(ptyProcess.pid))
+      ) {
+        throw new Error("Failed to apply resource limits to gdb");
+      }
+
+      const loaded = waitForOutput(ptyProcess, GDB_LOADED);
+      ptyProcess.write(
+        [
+          `cd ${workDir}`,
+          `set environment HOME ${workDir}`,
+          `set environment TMPDIR ${workDir}`,
+          `file "${binary}"`,
+          "echo __CINCOUT_LOADED__\\n",
+        ].join("\n") + "\n"
+      );
+      await loaded;
+
+      return ptyProcess;
+    } catch (error) {
+      ptyProcess.kill("SIGKILL");
+      throw error;
+    }
+  }
+}
+
+/**
+ * Launcher Pool Implementation
+ * Hands out shells that exec a command in place, keeping the PTY
+ */
+export class LauncherPool extends WarmPtyPool {
+  /**
+   * Create a new LauncherPool
+   * @param {number} size - Number of idle launchers to keep
+   */
+  constructor(size: number) {
+    super("launcher", size, startLauncher);
+  }
+
+  /**
+   * Run a command in a launcher under the given limits
+   * @param {string} command - Shell command
+   * @param {string} workDir - Working directory (the sandbox)
+   * @param {LimitedExecution} execution - Limits for the command
+   * @param {Promise<pty.IPty>} launcher - Launcher acquired ahead of time,
+   * e.g. while the program was compiling
+   * @returns {Promise<pty.IPty>} PTY now running the command
+   */
+  async launch(
+    command: string,
+    workDir: string,
+    execution: LimitedExecution,
+    launcher: Promise<pty.IPty> = this.acquire()
+  ): Promise<pty.IPty> {
+    const ptyProcess = await launcher;
+
+    ptyProcess.write(
+      `stty echo; cd "${workDir}" || exit 1; export HOME="${workDir}" ` +
+        `TMPDIR="${workDir}"; ${execution.wrapCommand(command)}\n`
+    );
+    return ptyProcess;
+  }
+}
+
+// Create singleton instances
+export const debuggerPool = new DebuggerPool(
+  parseInt(process.env.CINCOUT_WARM_DEBUGGERS || "2", 10)
+);
+export const launcherPool = new LauncherPool(
+  parseInt(process.env.CINCOUT_WARM_LAUNCHERS || "4", 10)
+);
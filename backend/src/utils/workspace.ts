@@ -0,0 +1,82 @@
+/**
+ * Workspace utilities
+ * Validation of multi-file workspaces and parsing of the dependency files
+ * the compiler writes for their translation units
+ */
+import { WorkspaceFile } from "../types";
+
+// Limits on what a client may send as one workspace; the size stays below
+// the 1 MB message limit of Socket.IO
+export const MAX_WORKSPACE_FILES = 64;
+export const MAX_WORKSPACE_BYTES = 512 * 1024;
+
+// Flat file names only: diagnostics carry file names without directories
+const FILE_NAME = /^[A-Za-z0-9_][\w+-]*(?:\.[\w+-]+)*\.(?:c|cc|cpp|cxx|h|hh|hpp|hxx|inl)$/;
+const C_UNIT = /\.c$/;
+const CPP_UNIT = /\.(?:cc|cpp|cxx)$/;
+
+/**
+ * Get the language of a translation unit
+ * @param {string} name - File name
+ * @returns {"c" | "cpp" | null} Language, or null for headers
+ */
+export const getUnitLanguage = (name: string): "c" | "cpp" | null =>
+  CPP_UNIT.test(name) ? "cpp" : C_UNIT.test(name) ? "c" : null;
+
+/**
+ * Check a workspace sent by a client
+ * @param {WorkspaceFile[]} files - Workspace files
+ * @returns {string | null} Reason the workspace is rejected, or null
+ */
+export const validateWorkspace = (files: WorkspaceFile[]): string | null => {
+  if (!Array.isArray(files) || files.length === 0) {
+    return "Workspace is empty";
+  }
+  if (files.length > MAX_WORKSPACE_FILES) {
+    return `Workspace has more than ${MAX_WORKSPACE_FILES} files`;
+  }
+
+  const names = new Set<string>();
+  let bytes = 0;
+  for (const file of files) {
+    if (
+      typeof file?.name !== "string" ||
+      typeof file.content !== "string" ||
+      !FILE_NAME.test(file.name)
+    ) {
+      return `Invalid workspace file name: ${String(file?.name)}`;
+    }
+    if (names.has(file.name)) {
+      return `Duplicate workspace file: ${file.name}`;
+    }
+    names.add(file.name);
+    bytes += Buffer.byteLength(file.content, "utf8");
+  }
+
+  if (bytes > MAX_WORKSPACE_BYTES) {
+    return `Workspace is larger than ${MAX_WORKSPACE_BYTES} bytes`;
+  }
+  if (!files.some((file) => getUnitLanguage(file.name))) {
+    return "Workspace has no source file to compile";
+  }
+  return null;
+};
+
+/**
+ * Parse a Makefile rule written by -MMD
+ * "obj/a.cpp.o: a.cpp vec.hpp \" continues on the next line
+ * @param {string} text - Dependency file
+ * @returns {string[]} Prerequisites of the rule, the unit itself first
+ */
+export const parseDepFile = (text: string): string[] => {
+  const rule = text.replace(/\\\r?\n/g, " ");
+  const colon = rule.indexOf(": ");
+  if (colon < 0) {
+    return [];
+  }
+  return rule
+    .slice(colon + 2)
+    .split("\n")[0]
+    .split(/\s+/)
+    .filter((dep) => dep.length > 0);
+};
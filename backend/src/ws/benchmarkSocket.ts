@@ -0,0 +1,295 @@
+/**
+ * Socket.IO handler for micro-benchmarks
+ * Compiles the code once per requested compiler configuration and times
+ * repeated runs of each build, so configurations can be compared side by side
+ */
+import {
+  ICodeProcessingService,
+  ISessionService,
+  IWebSocketManager,
+  SessionSocket,
+  CompilationEnvironment,
+  BenchmarkOptions,
+  BenchmarkResult,
+  BenchmarkVariant,
+} from "../types";
+import { codeProcessingService } from "../utils/codeProcessingService";
+import { sessionService } from "../utils/sessionService";
+import { benchmarkService } from "../utils/benchmarkService";
+import { OPTIMIZATION_LEVELS } from "../utils/toolchain";
+import {
+  webSocketManager,
+  SocketEvents,
+  BaseSocketHandler,
+} from "./webSocketManager";
+import { getSocketClientAddress } from "../utils/clientAddress";
+
+// Request limits
+const MAX_VARIANTS = 4;
+const MAX_ITERATIONS = 100;
+const MAX_WARMUP = 10;
+const MAX_INPUT_LENGTH = 64 * 1024;
+
+/**
+ * Benchmark request sent by the client
+ */
+interface BenchmarkRequest {
+  code: string;
+  lang: string;
+  compiler?: string;
+  optimization?: string;
+  variants?: BenchmarkVariant[]; // Defaults to compiler and optimization
+  iterations?: number;
+  warmup?: number;
+  input?: string;
+}
+
+/**
+ * Clamp a requested count to a range
+ * @private
+ */
+const clamp = (
+  value: number | undefined,
+  fallback: number,
+  min: number,
+  max: number
+): number =>
+  Number.isFinite(value)
+    ? Math.min(max, Math.max(min, Math.floor(value!)))
+    : fallback;
+
+/**
+ * BenchmarkWebSocketHandler handles micro-benchmark requests
+ */
+export class BenchmarkWebSocketHandler extends BaseSocketHandler {
+  // Benchmarks in progress, keyed by socket ID
+  private readonly running = new Map<string, AbortController>();
+
+  /**
+   * Create a new BenchmarkWebSocketHandler
+   * @param compilationService - Compilation service
+   * @param sessionService - Session service
+   * @param webSocketManager - WebSocket manager
+   */
+  constructor(
+    compilationService: ICodeProcessingService,
+    sessionService: ISessionService,
+    webSocketManager: IWebSocketManager
+  ) {
+    super(compilationService, sessionService, webSocketManager);
+  }
+
+  /**
+   * Handle benchmark requests
+   * Variants are benchmarked one after another; each result is sent as soon
+   * as it is available
+   * @param {SessionSocket} socket - Socket.IO connection
+   * @param {BenchmarkRequest} data - Benchmark request data
+   */
+  async handleBenchmarkRequest(
+    socket: SessionSocket,
+    data: BenchmarkRequest
+  ): Promise<void> {
+    // A new request replaces the previous one
+    this.running.get(socket.id)?.abort();
+    const controller = new AbortController();
+    this.running.set(socket.id, controller);
+
+    const requested: Partial<BenchmarkVariant>[] = data.variants?.length
+      ? data.variants
+      : [{ compiler: data.compiler || "gcc", optimization: data.optimization }];
+    const variants: BenchmarkVariant[] = requested
+      .slice(0, MAX_VARIANTS)
+      .map((variant) => ({
+        compiler: variant.compiler === "clang" ? "clang" : "gcc",
+        optimization:
+          variant.optimization &&
+          OPTIMIZATION_LEVELS.includes(variant.optimization)
+            ? variant.optimization
+            : "-O0",
+      }));
+    const options: BenchmarkOptions = {
+      iterations: clamp(data.iterations, 20, 1, MAX_ITERATIONS),
+      warmup: clamp(data.warmup, 3, 0, MAX_WARMUP),
+      input: String(data.input || "").slice(0, MAX_INPUT_LENGTH),
+    };
+
+    try {
+      for (let index = 0; index < variants.length; index++) {
+        if (controller.signal.aborted) {
+          return;
+        }
+
+        const result = await this.benchmarkVariant(
+          socket,
+          data,
+          index,
+          variants[index],
+          options,
+          controller.signal
+        );
+        if (!result) {
+          return;
+        }
+
+        this.webSocketManager.emitToClient(
+          socket,
+          SocketEvents.BENCHMARK_RESULT,
+          { index, result }
+        );
+      }
+
+      this.webSocketManager.emitToClient(
+        socket,
+        SocketEvents.BENCHMARK_COMPLETE,
+        { variants: variants.length }
+      );
+    } catch (error) {
+      // A replaced or cancelled run has nobody to report to
+      if (controller.signal.aborted) {
+        return;
+      }
+      this.webSocketManager.emitToClient(
+        socket,
+        SocketEvents.BENCHMARK_ERROR,
+        {
+          message: `Error running benchmark: ${(error as Error).message}`,
+        }
+      );
+    } finally {
+      if (this.running.get(socket.id) === controller) {
+        this.running.delete(socket.id);
+      }
+    }
+  }
+
+  /**
+   * Compile and benchmark a single variant
+   * @param socket - Socket.IO connection
+   * @param data - Benchmark request data
+   * @param index - Position of the variant in the request
+   * @param variant - Compiler configuration
+   * @param options - Iterations, warmup and input
+   * @param signal - Aborted when the request is cancelled
+   * @returns Result, or null if compilation failed
+   * @private
+   */
+  private async benchmarkVariant(
+    socket: SessionSocket,
+    data: BenchmarkRequest,
+    index: number,
+    variant: BenchmarkVariant,
+    options: BenchmarkOptions,
+    signal: AbortSignal
+  ): Promise<BenchmarkResult | null> {
+    const env: CompilationEnvironment =
+      await this.compilationService.createCompilationEnvironment(data.lang);
+
+    try {
+      this.webSocketManager.emitToClient(
+        socket,
+        SocketEvents.BENCHMARK_COMPILING,
+        { index, variant }
+      );
+
+      const compiled = await this.compilationService.compileCode(
+        env,
+        data.code,
+        {
+          lang: data.lang,
+          compiler: variant.compiler,
+          optimization: variant.optimization,
+          schedule: this.getScheduleOptions(
+            socket,
+            SocketEvents.BENCHMARK_COMPILING
+          ),
+        }
+      );
+      if (!compiled.success) {
+        this.webSocketManager.emitToClient(
+          socket,
+          SocketEvents.BENCHMARK_ERROR,
+          {
+            index,
+            output: compiled.error,
+          }
+        );
+        return null;
+      }
+
+      return await benchmarkService.run(
+        env.outputFile,
+        env.tmpDir.name,
+        variant,
+        options,
+        socket.sessionId,
+        {
+          schedule: {
+            clientId: getSocketClientAddress(socket),
+            priority: "interactive",
+            signal,
+            onQueued: (position: number) =>
+              this.webSocketManager.emitToClient(
+                socket,
+                SocketEvents.BENCHMARK_PROGRESS,
+                { index, queued: true, position }
+              ),
+          },
+          onProgress: (completed: number, total: number) =>
+            this.webSocketManager.emitToClient(
+              socket,
+              SocketEvents.BENCHMARK_PROGRESS,
+              { index, completed, total }
+            ),
+          signal,
+        }
+      );
+    } finally {
+      env.tmpDir.removeCallback();
+    }
+  }
+
+  /**
+   * Handle cleanup request
+   * @param {SessionSocket} socket - Socket.IO connection
+   */
+  protected handleCleanupRequest(socket: SessionSocket): void {
+    const controller = this.running.get(socket.id);
+    if (controller) {
+      controller.abort();
+      this.running.delete(socket.id);
+      this.webSocketManager.emitToClient(
+        socket,
+        SocketEvents.CLEANUP_COMPLETE,
+        {}
+      );
+    }
+  }
+
+  /**
+   * Setup event handlers for a socket
+   * @param {SessionSocket} socket - Socket.IO connection
+   */
+  public setupSocketHandlers(socket: SessionSocket): void {
+    if (!this.setupCommonHandlers(socket)) {
+      return;
+    }
+
+    socket.on(SocketEvents.BENCHMARK, (data: BenchmarkRequest) => {
+      this.handleBenchmarkRequest(socket, data);
+    });
+
+    // Stop timing runs nobody will see
+    socket.on(SocketEvents.DISCONNECT, () => {
+      this.running.get(socket.id)?.abort();
+      this.running.delete(socket.id);
+    });
+  }
+}
+
+// Create singleton instance with dependencies
+export const benchmarkHandler = new BenchmarkWebSocketHandler(
+  codeProcessingService,
+  sessionService,
+  webSocketManager
+);
@@ -1,25 +1,56 @@
 /**
  * Socket.IO handler for code compilation and execution
  */
+import * as pty from "node-pty";
+import fs from "fs-extra";
 import {
   ICodeProcessingService,
   ISessionService,
   IWebSocketManager,
   SessionSocket,
+  CompilationEnvironment,
+  CompilationOptions,
+  CompilationResult,
+  WorkspaceFile,
+  MatrixConfig,
+  MatrixCell,
+  MatrixRequest,
 } from "../types";
 import { codeProcessingService } from "../utils/codeProcessingService";
 import { sessionService } from "../utils/sessionService";
+import { benchmarkService } from "../utils/benchmarkService";
+import { launcherPool } from "../utils/warmPool";
+import { ResultCache } from "../utils/resultCache";
+import { expandMatrix, MAX_MATRIX_CELLS } from "../utils/toolchain";
 import {
   webSocketManager,
   SocketEvents,
   BaseSocketHandler,
 } from "./webSocketManager";
+import { getSocketClientAddress } from "../utils/clientAddress";
+
+// Ways a program can read standard input; code using none of them runs with
+// pipes instead of a terminal. Mentions in comments only cost the fast path
+const INPUT_PATTERN =
+  /\b(?:cin|wcin|stdin|STDIN_FILENO|scanf|getchar|getwchar|getc|fgetc|fgets|gets|getline|getch|read|fread|readline)\b/;
+
+// Matrix run limits
+const MAX_MATRIX_INPUT = 64 * 1024;
+const MATRIX_CACHE_ENTRIES = 500;
 
 /**
  * CompileWebSocketHandler handles compilation-related Socket.IO communication
  * This class mirrors the frontend's CompileSocketManager structure
  */
 export class CompileWebSocketHandler extends BaseSocketHandler {
+  // Matrix runs in progress, keyed by socket ID
+  private readonly matrixRuns = new Map<string, AbortController>();
+  // Finished cells; a cell depends only on its code, configuration and input
+  private readonly matrixCells = new ResultCache<MatrixCell>(
+    MATRIX_CACHE_ENTRIES,
+    "matrix"
+  );
+
   /**
    * Create a new CompileWebSocketHandler
    * @param compilationService - Compilation service
@@ -39,40 +70,102 @@ export class CompileWebSocketHandler extends BaseSocketHandler {
    * @param {SessionSocket} socket - Socket.IO connection
    * @param {any} data - Compilation request data
    */
-  handleCompileRequest(
+  async handleCompileRequest(
     socket: SessionSocket,
     data: {
       code: string;
       lang: string;
       compiler?: string;
       optimization?: string;
+      remarks?: boolean; // Report vectorization and inlining decisions
+      files?: WorkspaceFile[]; // Multi-file workspace, replaces code
+      workspaceId?: string; // Issued with an earlier run of the workspace
+      stdin?: boolean; // Whether the program reads input, guessed if absent
     }
-  ): void {
-    const { code, lang, compiler, optimization } = data;
+  ): Promise<void> {
+    const { code, lang, compiler, optimization, remarks, files, workspaceId } =
+      data;
+    const readsInput =
+      data.stdin ??
+      (files
+        ? files.some((file) => INPUT_PATTERN.test(String(file?.content)))
+        : INPUT_PATTERN.test(code));
 
-    // Create a temporary directory for compilation
-    const env = this.compilationService.createCompilationEnvironment(lang);
+    // Borrow a working directory for compilation
+    let env: CompilationEnvironment;
+    try {
+      env = await this.compilationService.createCompilationEnvironment(lang);
+    } catch (error) {
+      this.webSocketManager.emitToClient(socket, SocketEvents.COMPILE_ERROR, {
+        output: `Error: ${(error as Error).message}`,
+      });
+      return;
+    }
+
+    // A program reading input runs in a terminal; get the launcher ready
+    // while the compiler runs
+    const launcher = readsInput ? launcherPool.acquire() : undefined;
+    // A failed start is reported when the launcher is used
+    launcher?.catch(() => {});
 
     try {
-      // Write the code to a temporary file
-      this.compilationService.writeCodeToFile(env.sourceFile, code);
+      // A workspace keeps its objects between runs under the ID it was
+      // issued, which the client sends back with the next run
+      const workspace = files
+        ? await this.sessionService.getWorkspaceCache(
+            typeof workspaceId === "string" ? workspaceId : undefined
+          )
+        : undefined;
 
       // Notify client that compilation has started
-      this.webSocketManager.emitToClient(socket, SocketEvents.COMPILING, {});
+      this.webSocketManager.emitToClient(
+        socket,
+        SocketEvents.COMPILING,
+        workspace ? { workspaceId: workspace.id } : {}
+      );
+
+      const options: CompilationOptions = {
+        lang,
+        compiler,
+        optimization,
+        remarks: !!remarks,
+        schedule: this.getScheduleOptions(socket),
+        // Forward each diagnostic as soon as the compiler reports it
+        onDiagnostic: (html, diagnostic) =>
+          this.webSocketManager.emitToClient(
+            socket,
+            SocketEvents.COMPILE_DIAGNOSTIC,
+            { html, kind: diagnostic.kind }
+          ),
+      };
+
+      // Run the compilation; a workspace rebuilds only what changed
+      const compilation: Promise<CompilationResult> =
+        files && workspace
+          ? this.compilationService.compileWorkspace(
+              env,
+              files,
+              options,
+              workspace
+            )
+          : this.compilationService.compileCode(env, code, options);
 
-      // Run the compilation
-      this.compilationService
-        .compileCode(env, code, { lang, compiler, optimization })
+      compilation
         .then((result) => {
           if (result.success) {
             // Compilation succeeded, run the program
             this.webSocketManager.emitToClient(
               socket,
               SocketEvents.COMPILE_SUCCESS,
-              {}
+              {
+                cached: !!result.cached,
+                usedPch: !!result.usedPch,
+                remarks: result.remarks,
+                units: result.units,
+              }
             );
 
-            this.runCompiledProgram(socket, env);
+            this.runCompiledProgram(socket, env, launcher);
           } else {
             // Compilation failed, send error to client
             this.webSocketManager.emitToClient(
@@ -80,11 +173,13 @@ export class CompileWebSocketHandler extends BaseSocketHandler {
               SocketEvents.COMPILE_ERROR,
               {
                 output: result.error,
+                diagnostics: result.diagnostics,
               }
             );
 
             // Clean up the temporary directory
             env.tmpDir.removeCallback();
+            this.releaseLauncher(launcher);
           }
         })
         .catch((error) => {
@@ -99,6 +194,7 @@ export class CompileWebSocketHandler extends BaseSocketHandler {
 
           // Clean up the temporary directory
           env.tmpDir.removeCallback();
+          this.releaseLauncher(launcher);
         });
     } catch (error) {
       // Error handling
@@ -108,25 +204,46 @@ export class CompileWebSocketHandler extends BaseSocketHandler {
 
       // Clean up the temporary directory
       env.tmpDir.removeCallback();
+      this.releaseLauncher(launcher);
     }
   }
 
+  /**
+   * Hand a launcher that will not run a program back to the pool
+   * @param {Promise<pty.IPty>} launcher - Launcher taken for the program
+   * @private
+   */
+  private releaseLauncher(launcher?: Promise<pty.IPty>): void {
+    launcher
+      ?.then((ptyProcess) => launcherPool.release(ptyProcess))
+      .catch(() => {
+        // Nothing was started
+      });
+  }
+
   /**
    * Run a compiled program
    * @param {SessionSocket} socket - Socket.IO connection
    * @param {any} env - Compilation environment
+   * @param {Promise<pty.IPty>} launcher - Terminal for a program reading
+   * input; without one the program runs with pipes
    * @private
    */
-  private runCompiledProgram(socket: SessionSocket, env: any): void {
+  private async runCompiledProgram(
+    socket: SessionSocket,
+    env: any,
+    launcher?: Promise<pty.IPty>
+  ): Promise<void> {
     try {
       // Execute the compilation session
       if (
-        !this.sessionService.executeCompilationSession(
+        !(await this.sessionService.executeCompilationSession(
           socket,
           socket.sessionId,
           env.tmpDir,
-          env.outputFile
-        )
+          env.outputFile,
+          launcher
+        ))
       ) {
         this.webSocketManager.emitToClient(socket, SocketEvents.ERROR, {
           message: "Failed to execute compilation session",
@@ -141,6 +258,181 @@ export class CompileWebSocketHandler extends BaseSocketHandler {
     }
   }
 
+  /**
+   * Handle matrix run requests
+   * All configurations are compiled at once through the compile scheduler
+   * and run one per benchmark CPU slot. Cached cells are sent immediately,
+   * the others as soon as they finish, followed by the whole table
+   * @param {SessionSocket} socket - Socket.IO connection
+   * @param {MatrixRequest} data - Matrix run request data
+   */
+  async handleMatrixRequest(
+    socket: SessionSocket,
+    data: MatrixRequest
+  ): Promise<void> {
+    // A new request replaces the previous one
+    this.matrixRuns.get(socket.id)?.abort();
+    const controller = new AbortController();
+    this.matrixRuns.set(socket.id, controller);
+
+    const lang = data.lang === "c" ? "c" : "cpp";
+    const code = String(data.code ?? "");
+    const input = String(data.input || "").slice(0, MAX_MATRIX_INPUT);
+    // Combinations beyond the limit are not run, but the client is told
+    const requested = expandMatrix(data);
+    const configs = requested.slice(0, MAX_MATRIX_CELLS);
+    const skipped = requested.length - configs.length;
+
+    const cells: (MatrixCell | null)[] = configs.map(() => null);
+    const emitCell = (index: number, cell: MatrixCell): void => {
+      cells[index] = cell;
+      this.webSocketManager.emitToClient(socket, SocketEvents.MATRIX_CELL, {
+        index,
+        total: configs.length,
+        skipped,
+        cell,
+      });
+    };
+
+    try {
+      const keys = configs.map((config) =>
+        ResultCache.key(
+          code,
+          lang,
+          config.compiler,
+          config.optimization,
+          config.standard,
+          input
+        )
+      );
+
+      // Cells run before need neither a compiler nor a CPU slot
+      const pending: number[] = [];
+      keys.forEach((key, index) => {
+        const cached = this.matrixCells.get(key);
+        if (cached) {
+          emitCell(index, { ...cached, cached: true });
+        } else {
+          pending.push(index);
+        }
+      });
+
+      await Promise.all(
+        pending.map(async (index) => {
+          const cell = await this.runMatrixCell(
+            socket,
+            code,
+            lang,
+            configs[index],
+            input,
+            controller.signal
+          );
+          if (controller.signal.aborted) {
+            return;
+          }
+
+          // Runs stopped by a limit depend on the load, not only the code
+          if (!cell.run || cell.run.signal === null) {
+            this.matrixCells.set(keys[index], cell);
+          }
+          emitCell(index, cell);
+        })
+      );
+
+      if (!controller.signal.aborted) {
+        this.webSocketManager.emitToClient(
+          socket,
+          SocketEvents.MATRIX_COMPLETE,
+          { cells, skipped }
+        );
+      }
+    } catch (error) {
+      if (!controller.signal.aborted) {
+        this.webSocketManager.emitToClient(socket, SocketEvents.MATRIX_ERROR, {
+          message: `Matrix run failed: ${(error as Error).message}`,
+        });
+      }
+    } finally {
+      if (this.matrixRuns.get(socket.id) === controller) {
+        this.matrixRuns.delete(socket.id);
+      }
+    }
+  }
+
+  /**
+   * Compile and run one configuration of a matrix run
+   * @param {SessionSocket} socket - Socket.IO connection
+   * @param {string} code - Source code
+   * @param {string} lang - Language
+   * @param {MatrixConfig} config - Build configuration
+   * @param {string} input - Standard input
+   * @param {AbortSignal} signal - Aborts the run
+   * @returns {Promise<MatrixCell>} Build and run results
+   * @private
+   */
+  private async runMatrixCell(
+    socket: SessionSocket,
+    code: string,
+    lang: string,
+    config: MatrixConfig,
+    input: string,
+    signal: AbortSignal
+  ): Promise<MatrixCell> {
+    const env = await this.compilationService.createCompilationEnvironment(
+      lang
+    );
+    // Cells share the fair queues of the client's other requests, without
+    // queue position updates for every cell; an abort also stops cells
+    // that are already compiling or waiting for a CPU slot
+    const schedule = {
+      clientId: getSocketClientAddress(socket),
+      priority: "interactive" as const,
+      signal,
+    };
+
+    try {
+      const started = process.hrtime.bigint();
+      const compiled = await this.compilationService.compileCode(env, code, {
+        lang,
+        ...config,
+        schedule,
+      });
+      const compileMs =
+        Math.round(Number(process.hrtime.bigint() - started) / 1000) / 1000;
+
+      if (!compiled.success) {
+        return {
+          config,
+          cached: false,
+          buildCached: false,
+          compileMs,
+          binaryBytes: null,
+          run: null,
+          error: compiled.error,
+        };
+      }
+
+      const { size } = await fs.stat(env.outputFile);
+      const run = await benchmarkService.measure(
+        env.outputFile,
+        env.tmpDir.name,
+        input,
+        socket.sessionId,
+        { schedule, signal }
+      );
+      return {
+        config,
+        cached: false,
+        buildCached: !!compiled.cached,
+        compileMs,
+        binaryBytes: size,
+        run,
+      };
+    } finally {
+      env.tmpDir.removeCallback();
+    }
+  }
+
   /**
    * Handle sending input to a running program
    * @param {SessionSocket} socket - Socket.IO connection
@@ -165,6 +457,8 @@ export class CompileWebSocketHandler extends BaseSocketHandler {
    * @param {SessionSocket} socket - Socket.IO connection
    */
   protected handleCleanupRequest(socket: SessionSocket): void {
+    this.matrixRuns.get(socket.id)?.abort();
+    this.matrixRuns.delete(socket.id);
     this.handleCleanup(socket, "compilation");
   }
 
@@ -184,6 +478,10 @@ export class CompileWebSocketHandler extends BaseSocketHandler {
         lang: string;
         compiler?: string;
         optimization?: string;
+        remarks?: boolean;
+        files?: WorkspaceFile[];
+        workspaceId?: string;
+        stdin?: boolean;
       }) => {
         this.handleCompileRequest(socket, data);
       }
@@ -192,6 +490,16 @@ export class CompileWebSocketHandler extends BaseSocketHandler {
     socket.on(SocketEvents.INPUT, (data: { input: string }) => {
       this.handleInput(socket, data);
     });
+
+    socket.on(SocketEvents.MATRIX_RUN, (data: MatrixRequest) => {
+      this.handleMatrixRequest(socket, data);
+    });
+
+    // Stop matrix runs nobody will see
+    socket.on(SocketEvents.DISCONNECT, () => {
+      this.matrixRuns.get(socket.id)?.abort();
+      this.matrixRuns.delete(socket.id);
+    });
   }
 }
 
@@ -6,6 +6,7 @@ import {
   ISessionService,
   IWebSocketManager,
   SessionSocket,
+  CompilationEnvironment,
 } from "../types";
 import { codeProcessingService } from "../utils/codeProcessingService";
 import { sessionService } from "../utils/sessionService";
@@ -38,33 +39,46 @@ export class DebugWebSocketHandler extends BaseSocketHandler {
    * @param {SessionSocket} socket - Socket.IO connection
    * @param {any} data - Debug request data
    */
-  handleDebugRequest(
+  async handleDebugRequest(
     socket: SessionSocket,
     data: {
       code: string;
       lang: string;
       compiler?: string;
     }
-  ): void {
+  ): Promise<void> {
     const { code, lang, compiler } = data;
 
-    // Create compilation environment
-    const env = this.compilationService.createCompilationEnvironment(lang);
+    // Borrow a working directory for compilation
+    let env: CompilationEnvironment;
+    try {
+      env = await this.compilationService.createCompilationEnvironment(lang);
+    } catch (error) {
+      this.webSocketManager.emitToClient(socket, SocketEvents.DEBUG_ERROR, {
+        message: "Error setting up debug session: " + (error as Error).message,
+      });
+      return;
+    }
 
     try {
-      // Write code to temporary file
-      this.compilationService.writeCodeToFile(env.sourceFile, code);
+      // Write code to the working directory
+      await this.compilationService.writeCodeToFile(env.sourceFile, code);
 
       // Notify client that compilation has started
       this.webSocketManager.emitToClient(socket, SocketEvents.COMPILING, {});
 
       // Compile the code with debug flags
       this.compilationService
-        .prepareDebugSession(env, { lang, compiler, optimization: "-O0" })
-        .then((result) => {
+        .prepareDebugSession(env, {
+          lang,
+          compiler,
+          optimization: "-O0",
+          schedule: this.getScheduleOptions(socket),
+        })
+        .then(async (result) => {
           if (result.success) {
             // Execute debug session with GDB
-            const success = this.sessionService.executeDebugSession(
+            const success = await this.sessionService.executeDebugSession(
               socket,
               socket.sessionId,
               env.tmpDir,
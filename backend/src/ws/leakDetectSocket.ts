@@ -8,9 +8,17 @@ import {
   IWebSocketManager,
   SessionSocket,
   CompilationEnvironment,
+  CompilationOptions,
+  ExecutionStats,
+  LeakCheckMode,
 } from "../types";
 import { codeProcessingService } from "../utils/codeProcessingService";
 import { sessionService } from "../utils/sessionService";
+import { executionLimiter } from "../utils/executionLimits";
+import { launcherPool } from "../utils/warmPool";
+import { LogTailer } from "../utils/logTailer";
+import { LeakRecordSet, MemcheckStream } from "../utils/memcheckParser";
+import { SanitizerStream } from "../utils/sanitizerParser";
 import {
   webSocketManager,
   SocketEvents,
@@ -18,6 +26,18 @@ import {
 } from "./webSocketManager";
 import fs from "fs-extra";
 
+/**
+ * How a program is checked and its report collected
+ */
+interface LeakCheck {
+  mode: LeakCheckMode;
+  command: string; // Shell command running the program under the checker
+  start: () => void; // Called once the program runs
+  // Report after exit, null if the checker wrote none; sanitizers write
+  // nothing on a clean run, which is an empty report rather than null
+  collect: () => Promise<LeakRecordSet | null>;
+}
+
 /**
  * LeakDetectWebSocketHandler handles memory leak detection using Valgrind
  * This class follows the pattern of the existing CompileWebSocketHandler
@@ -42,17 +62,33 @@ export class LeakDetectWebSocketHandler extends BaseSocketHandler {
    * @param {SessionSocket} socket - Socket.IO connection
    * @param {any} data - Leak detection request data
    */
-  handleLeakDetectRequest(
+  async handleLeakDetectRequest(
     socket: SessionSocket,
     data: {
       code: string;
       lang: string;
       compiler?: string;
       optimization?: string;
+      mode?: LeakCheckMode;
     }
-  ): void {
+  ): Promise<void> {
     const { code, lang, compiler, optimization } = data;
-    const env = this.compilationService.createCompilationEnvironment(lang);
+    const mode: LeakCheckMode = data.mode === "asan" ? "asan" : "valgrind";
+
+    let env: CompilationEnvironment;
+    try {
+      env = await this.compilationService.createCompilationEnvironment(lang);
+    } catch (error) {
+      this.webSocketManager.emitToClient(
+        socket,
+        SocketEvents.LEAK_CHECK_ERROR,
+        {
+          message:
+            "Error setting up leak detection: " + (error as Error).message,
+        }
+      );
+      return;
+    }
 
     try {
       this.webSocketManager.emitToClient(
@@ -62,10 +98,14 @@ export class LeakDetectWebSocketHandler extends BaseSocketHandler {
       );
 
       // Prepare the leak detection environment using the specialized method
-      this.compileCodeForLeakCheck(socket, env, code, {
+      this.compileCodeForLeakCheck(socket, env, code, mode, {
         lang,
         compiler,
         optimization,
+        schedule: this.getScheduleOptions(
+          socket,
+          SocketEvents.LEAK_CHECK_COMPILING
+        ),
       });
     } catch (error) {
       this.webSocketManager.emitToClient(
@@ -85,6 +125,7 @@ export class LeakDetectWebSocketHandler extends BaseSocketHandler {
    * @param socket - Socket.IO connection
    * @param env - Compilation environment
    * @param code - Source code
+   * @param mode - Valgrind or sanitizer check
    * @param options - Compilation options
    * @private
    */
@@ -92,14 +133,38 @@ export class LeakDetectWebSocketHandler extends BaseSocketHandler {
     socket: SessionSocket,
     env: CompilationEnvironment,
     code: string,
-    options: { lang: string; compiler?: string; optimization?: string }
+    mode: LeakCheckMode,
+    options: CompilationOptions
   ): void {
-    this.compilationService
-      .prepareLeakDetection(env, code, options)
+    const prepared: Promise<{
+      success: boolean;
+      error?: string;
+      check: LeakCheck | null;
+    }> =
+      mode === "asan"
+        ? this.compilationService
+            .prepareSanitizerCheck(env, code, options)
+            .then((result) => ({
+              success: result.success,
+              error: result.error,
+              check: result.sanitizerLogPath
+                ? this.createSanitizerCheck(env, result.sanitizerLogPath)
+                : null,
+            }))
+        : this.compilationService
+            .prepareLeakDetection(env, code, options)
+            .then((result) => ({
+              success: result.success,
+              error: result.error,
+              check: result.valgrindXmlFile
+                ? this.createValgrindCheck(env, result.valgrindXmlFile)
+                : null,
+            }));
+
+    prepared
       .then((result) => {
-        if (result.success && result.valgrindLogFile) {
-          // Execute a special leak detection session with the prepared valgrindLogFile
-          this.executeLeakDetectionSession(socket, env, result.valgrindLogFile);
+        if (result.success && result.check) {
+          this.executeLeakDetectionSession(socket, env, result.check);
         } else {
           this.webSocketManager.emitToClient(
             socket,
@@ -124,18 +189,83 @@ export class LeakDetectWebSocketHandler extends BaseSocketHandler {
       });
   }
 
+  /**
+   * Create a check running the program under Valgrind memcheck
+   * The XML report is parsed while Valgrind writes it
+   * @param env - Compilation environment
+   * @param valgrindXmlFile - Path of the Valgrind XML report
+   * @returns Leak check
+   * @private
+   */
+  private createValgrindCheck(
+    env: CompilationEnvironment,
+    valgrindXmlFile: string
+  ): LeakCheck {
+    const memcheck = new MemcheckStream();
+    const tailer = new LogTailer(valgrindXmlFile, (chunk) =>
+      memcheck.push(chunk)
+    );
+
+    return {
+      mode: "valgrind",
+      command: `valgrind --tool=memcheck --leak-check=full --show-leak-kinds=all --track-origins=yes --xml=yes --xml-file="${valgrindXmlFile}" "${env.outputFile}"`,
+      start: () => tailer.start(),
+      collect: async () => {
+        await tailer.stop();
+        return (await fs.pathExists(valgrindXmlFile)) ? memcheck : null;
+      },
+    };
+  }
+
+  /**
+   * Create a check running the sanitizer-instrumented program
+   * Reports only exist once a process failed or exited, so they are parsed
+   * after the run
+   * @param env - Compilation environment
+   * @param sanitizerLogPath - log_path given to the sanitizers
+   * @returns Leak check
+   * @private
+   */
+  private createSanitizerCheck(
+    env: CompilationEnvironment,
+    sanitizerLogPath: string
+  ): LeakCheck {
+    const asanOptions = [
+      `log_path=${sanitizerLogPath}`,
+      "detect_leaks=1",
+      "symbolize=1",
+      "print_summary=1",
+      "color=never",
+    ].join(":");
+    const ubsanOptions = [
+      `log_path=${sanitizerLogPath}`,
+      "print_stacktrace=1",
+      "report_error_type=1",
+      "symbolize=1",
+      "color=never",
+    ].join(":");
+
+    return {
+      mode: "asan",
+      command: `env ASAN_OPTIONS="${asanOptions}" UBSAN_OPTIONS="${ubsanOptions}" "${env.outputFile}"`,
+      start: () => {},
+      // No log files is a clean run: an empty report, never null
+      collect: () => SanitizerStream.fromLogs(sanitizerLogPath),
+    };
+  }
+
   /**
    * Execute a leak detection session
    * @param socket - Socket.IO connection
    * @param env - Compilation environment
-   * @param valgrindLogFile - Path to the Valgrind log file
+   * @param check - How the program is run and its report collected
    * @private
    */
-  private executeLeakDetectionSession(
+  private async executeLeakDetectionSession(
     socket: SessionSocket,
     env: CompilationEnvironment,
-    valgrindLogFile: string
-  ): void {
+    check: LeakCheck
+  ): Promise<void> {
     // Let the client know we're running leak detection
     this.webSocketManager.emitToClient(
       socket,
@@ -143,26 +273,21 @@ export class LeakDetectWebSocketHandler extends BaseSocketHandler {
       {}
     );
 
-    // Create a session for running the program with Valgrind
+    // Create a session for running the program under the checker
     const sessionId = socket.sessionId;
     const cols = 80;
     const rows = 24;
+    const execution = await executionLimiter.create("memcheck", sessionId);
 
     try {
-      // Build Valgrind command
-      const valgrindCmd = `valgrind --tool=memcheck --leak-check=full --show-leak-kinds=all --track-origins=yes --log-file="${valgrindLogFile}" "${env.outputFile}"`;
-
-      // Create PTY instance
-      const ptyProcess = sessionService["createPtyProcess"](valgrindCmd, {
-        name: "xterm-256color",
-        cols: cols,
-        rows: rows,
-        cwd: env.tmpDir.name,
-        env: {
-          ...(process.env as { [key: string]: string }),
-          TERM: "xterm-256color",
-        },
-      });
+      // Run in a pre-started launcher, confined to the memcheck profile
+      const ptyProcess = await launcherPool.launch(
+        check.command,
+        env.tmpDir.name,
+        execution
+      );
+      execution.start(() => ptyProcess.kill("SIGKILL"));
+      check.start();
 
       // Store session
       sessionService["sessions"].set(sessionId, {
@@ -172,30 +297,31 @@ export class LeakDetectWebSocketHandler extends BaseSocketHandler {
         dimensions: { cols, rows },
         sessionType: "leak_detection",
         socketId: socket.id,
+        execution,
       });
 
       // Handle PTY output
-      ptyProcess.onData((data: string) => {
-        try {
-          // Update last activity timestamp
-          sessionService["updateSessionActivity"](sessionId);
-
-          // Send output to client
-          this.webSocketManager.emitToClient(socket, SocketEvents.OUTPUT, {
-            output: data,
-          });
-        } catch (e) {
-          console.error(
-            `Error sending output for leak detection session ${sessionId}:`,
-            e
-          );
-        }
-      });
+      const output = sessionService.streamOutput(
+        socket,
+        sessionId,
+        ptyProcess,
+        SocketEvents.OUTPUT
+      );
 
       // Handle PTY exit
-      ptyProcess.onExit(({ exitCode }) => {
+      ptyProcess.onExit(async ({ exitCode, signal }) => {
         try {
-          this.processLeakDetectionResults(socket, valgrindLogFile, exitCode);
+          // Deliver buffered output before the report
+          output.end();
+          const stats = await execution.finish(signal);
+
+          this.processLeakDetectionResults(
+            socket,
+            check.mode,
+            await check.collect(),
+            exitCode,
+            stats
+          );
         } catch (e) {
           console.error(
             `Error processing leak detection exit for session ${sessionId}:`,
@@ -216,6 +342,8 @@ export class LeakDetectWebSocketHandler extends BaseSocketHandler {
         }
       });
     } catch (error) {
+      execution.finish();
+      check.collect().catch(() => {});
       console.error(
         `Error creating PTY for leak detection session ${sessionId}:`,
         error
@@ -234,76 +362,46 @@ export class LeakDetectWebSocketHandler extends BaseSocketHandler {
   }
 
   /**
-   * Process Valgrind leak detection results
+   * Send the parsed report
    * @param socket - Socket.IO connection
-   * @param valgrindLogFile - Path to Valgrind log file
-   * @param exitCode - Exit code of the Valgrind process
+   * @param mode - Checker that produced the report
+   * @param report - Parsed report, or null if none was written
+   * @param exitCode - Exit code of the checked process
+   * @param stats - Resource usage of the checked process tree
    * @private
    */
   private processLeakDetectionResults(
     socket: SessionSocket,
-    valgrindLogFile: string,
-    exitCode: number
+    mode: LeakCheckMode,
+    report: LeakRecordSet | null,
+    exitCode: number,
+    stats: ExecutionStats
   ): void {
-    try {
-      if (fs.existsSync(valgrindLogFile)) {
-        // Read Valgrind log
-        const valgrindOutput = fs.readFileSync(valgrindLogFile, "utf8");
-
-        // Extract important information
-        let report = "";
-        const lines = valgrindOutput.split("\n");
-        let startReading = false;
-
-        for (const line of lines) {
-          if (line.includes("HEAP SUMMARY:")) {
-            startReading = true;
-          }
-
-          if (
-            startReading &&
-            line.trim() !== "" &&
-            !line.includes("For lists of")
-          ) {
-            report += line + "\n";
-          }
-        }
-
-        // Format report
-        const formattedReport = codeProcessingService["formatOutput"](
-          report,
-          "leakDetect"
-        );
-
-        // Send report to client
-        this.webSocketManager.emitToClient(
-          socket,
-          SocketEvents.LEAK_CHECK_REPORT,
-          {
-            report: formattedReport,
-            exitCode: exitCode,
-          }
-        );
-      } else {
-        this.webSocketManager.emitToClient(
-          socket,
-          SocketEvents.LEAK_CHECK_ERROR,
-          {
-            message: "Valgrind log file not found after execution",
-          }
-        );
-      }
-    } catch (error) {
+    if (!report) {
+      const checker = mode === "asan" ? "Sanitizer" : "Valgrind";
       this.webSocketManager.emitToClient(
         socket,
         SocketEvents.LEAK_CHECK_ERROR,
         {
-          message:
-            "Error processing leak detection results: " +
-            (error as Error).message,
+          message: `${checker} report not found after execution`,
         }
       );
+      return;
     }
+
+    // Records are rendered by the client
+    this.webSocketManager.emitToClient(
+      socket,
+      SocketEvents.LEAK_CHECK_REPORT,
+      {
+        mode,
+        records: report.getRecords(),
+        summary: report.getSummary(),
+        dropped: report.getDroppedCount(),
+        exitCode: exitCode,
+        stats,
+      }
+    );
   }
 
   /**
@@ -353,6 +451,7 @@ export class LeakDetectWebSocketHandler extends BaseSocketHandler {
         lang: string;
         compiler?: string;
         optimization?: string;
+        mode?: LeakCheckMode;
       }) => {
         this.handleLeakDetectRequest(socket, data);
       }
@@ -0,0 +1,266 @@
+/**
+ * Socket.IO handler for sampling profiles
+ * Runs the program interactively under a sampling profiler and sends the
+ * collapsed stacks and source hotspots once it exits
+ */
+import {
+  ICodeProcessingService,
+  ISessionService,
+  IWebSocketManager,
+  SessionSocket,
+  CompilationEnvironment,
+} from "../types";
+import { codeProcessingService } from "../utils/codeProcessingService";
+import { sessionService } from "../utils/sessionService";
+import { executionLimiter } from "../utils/executionLimits";
+import { launcherPool } from "../utils/warmPool";
+import { ProfileRun, profilerService } from "../utils/profilerService";
+import {
+  webSocketManager,
+  SocketEvents,
+  BaseSocketHandler,
+} from "./webSocketManager";
+
+/**
+ * Profile request sent by the client
+ */
+interface ProfileRequest {
+  code: string;
+  lang: string;
+  compiler?: string;
+  optimization?: string;
+}
+
+/**
+ * ProfileWebSocketHandler handles sampling profiler sessions
+ */
+export class ProfileWebSocketHandler extends BaseSocketHandler {
+  /**
+   * Create a new ProfileWebSocketHandler
+   * @param compilationService - Compilation service
+   * @param sessionService - Session service
+   * @param webSocketManager - WebSocket manager
+   */
+  constructor(
+    compilationService: ICodeProcessingService,
+    sessionService: ISessionService,
+    webSocketManager: IWebSocketManager
+  ) {
+    super(compilationService, sessionService, webSocketManager);
+  }
+
+  /**
+   * Handle profile requests
+   * @param {SessionSocket} socket - Socket.IO connection
+   * @param {ProfileRequest} data - Profile request data
+   */
+  async handleProfileRequest(
+    socket: SessionSocket,
+    data: ProfileRequest
+  ): Promise<void> {
+    const { code, lang, compiler, optimization } = data;
+
+    let env: CompilationEnvironment;
+    try {
+      env = await this.compilationService.createCompilationEnvironment(lang);
+    } catch (error) {
+      this.webSocketManager.emitToClient(socket, SocketEvents.PROFILE_ERROR, {
+        message: "Error setting up profiling: " + (error as Error).message,
+      });
+      return;
+    }
+
+    try {
+      this.webSocketManager.emitToClient(
+        socket,
+        SocketEvents.PROFILE_COMPILING,
+        {}
+      );
+
+      const result = await this.compilationService.prepareProfiling(
+        env,
+        code,
+        {
+          lang,
+          compiler,
+          optimization,
+          schedule: this.getScheduleOptions(
+            socket,
+            SocketEvents.PROFILE_COMPILING
+          ),
+        }
+      );
+      if (!result.success) {
+        this.webSocketManager.emitToClient(
+          socket,
+          SocketEvents.PROFILE_ERROR,
+          {
+            output:
+              result.error || "Compilation failed with no specific error",
+          }
+        );
+        env.tmpDir.removeCallback();
+        return;
+      }
+
+      const run = await profilerService.prepare(
+        env.outputFile,
+        env.tmpDir.name
+      );
+      await this.executeProfileSession(socket, env, run);
+    } catch (error) {
+      this.webSocketManager.emitToClient(socket, SocketEvents.PROFILE_ERROR, {
+        message: "Error setting up profiling: " + (error as Error).message,
+      });
+      env.tmpDir.removeCallback();
+    }
+  }
+
+  /**
+   * Execute a profiling session
+   * @param socket - Socket.IO connection
+   * @param env - Compilation environment
+   * @param run - How the program is profiled and its report collected
+   * @private
+   */
+  private async executeProfileSession(
+    socket: SessionSocket,
+    env: CompilationEnvironment,
+    run: ProfileRun
+  ): Promise<void> {
+    this.webSocketManager.emitToClient(socket, SocketEvents.PROFILE_RUNNING, {
+      mode: run.mode,
+    });
+
+    const sessionId = socket.sessionId;
+    const cols = 80;
+    const rows = 24;
+    const execution = await executionLimiter.create("profile", sessionId);
+
+    try {
+      // The profiler and the program share the profile limits
+      const ptyProcess = await launcherPool.launch(
+        run.command,
+        env.tmpDir.name,
+        execution
+      );
+      execution.start(() => ptyProcess.kill("SIGKILL"));
+
+      // Store session
+      sessionService["sessions"].set(sessionId, {
+        pty: ptyProcess,
+        tmpDir: env.tmpDir,
+        lastActivity: Date.now(),
+        dimensions: { cols, rows },
+        sessionType: "profile",
+        socketId: socket.id,
+        execution,
+      });
+
+      // Handle PTY output
+      const output = sessionService.streamOutput(
+        socket,
+        sessionId,
+        ptyProcess,
+        SocketEvents.OUTPUT
+      );
+
+      // Handle PTY exit
+      ptyProcess.onExit(async ({ exitCode, signal }) => {
+        try {
+          // Deliver buffered output before the report
+          output.end();
+          const stats = await execution.finish(signal);
+
+          // Profiles are collected even if the program failed
+          this.webSocketManager.emitToClient(
+            socket,
+            SocketEvents.PROFILE_REPORT,
+            {
+              ...(await run.collect()),
+              exitCode,
+              stats,
+            }
+          );
+        } catch (e) {
+          this.webSocketManager.emitToClient(
+            socket,
+            SocketEvents.PROFILE_ERROR,
+            {
+              message: "Error processing profile: " + (e as Error).message,
+            }
+          );
+        } finally {
+          // Always clean up
+          this.cleanupSession(sessionId);
+        }
+      });
+    } catch (error) {
+      execution.finish();
+      console.error(
+        `Error creating PTY for profile session ${sessionId}:`,
+        error
+      );
+      this.webSocketManager.emitToClient(socket, SocketEvents.PROFILE_ERROR, {
+        message: `Error executing profiler: ${(error as Error).message}`,
+      });
+      env.tmpDir.removeCallback();
+    }
+  }
+
+  /**
+   * Handle sending input to a program being profiled
+   * @param {SessionSocket} socket - Socket.IO connection
+   * @param {any} data - Input data
+   */
+  handleInput(socket: SessionSocket, data: { input: string }): void {
+    const sessionId = socket.sessionId;
+    const session = this.sessionService.getSession(sessionId);
+
+    // Only process input for profile sessions
+    if (session && session.sessionType === "profile") {
+      if (!this.sessionService.sendInputToSession(sessionId, data.input)) {
+        this.webSocketManager.emitToClient(
+          socket,
+          SocketEvents.PROFILE_ERROR,
+          {
+            message: "No active profile session to receive input",
+          }
+        );
+      }
+    }
+  }
+
+  /**
+   * Handle cleanup request
+   * @param {SessionSocket} socket - Socket.IO connection
+   */
+  protected handleCleanupRequest(socket: SessionSocket): void {
+    this.handleCleanup(socket, "profile");
+  }
+
+  /**
+   * Setup event handlers for a socket
+   * @param {SessionSocket} socket - Socket.IO connection
+   */
+  public setupSocketHandlers(socket: SessionSocket): void {
+    if (!this.setupCommonHandlers(socket)) {
+      return;
+    }
+
+    socket.on(SocketEvents.PROFILE, (data: ProfileRequest) => {
+      this.handleProfileRequest(socket, data);
+    });
+
+    socket.on(SocketEvents.INPUT, (data: { input: string }) => {
+      this.handleInput(socket, data);
+    });
+  }
+}
+
+// Create singleton instance with dependencies
+export const profileHandler = new ProfileWebSocketHandler(
+  codeProcessingService,
+  sessionService,
+  webSocketManager
+);
@@ -8,6 +8,9 @@ import {
   IWebSocketManager,
   SessionSocket,
   CompilationEnvironment,
+  CompilationOptions,
+  ExecutionStats,
+  SyscallRecord,
 } from "../types";
 import { codeProcessingService } from "../utils/codeProcessingService";
 import { sessionService } from "../utils/sessionService";
@@ -17,7 +20,24 @@ import {
   BaseSocketHandler,
   socketEvents,
 } from "./webSocketManager";
-import fs from "fs-extra";
+import { StraceStream, SyscallSummary } from "../utils/straceParser";
+import { LogTailer } from "../utils/logTailer";
+
+// Records beyond this are only counted in the summary
+const MAX_STREAMED_RECORDS = 10000;
+const SUMMARY_INTERVAL_MS = 500;
+
+/**
+ * Parser state of a running trace
+ */
+interface TraceStream {
+  stream: StraceStream;
+  summary: SyscallSummary;
+  tailer: LogTailer;
+  summaryTimer: NodeJS.Timeout | null;
+  total: number; // Records parsed
+  streamed: number; // Records sent to the client
+}
 
 /**
  * SyscallWebSocketHandler handles system call tracing with strace
@@ -43,7 +63,7 @@ export class SyscallWebSocketHandler extends BaseSocketHandler {
    * @param {SessionSocket} socket - Socket.IO connection
    * @param {any} data - Strace request data
    */
-  handleStraceRequest(
+  async handleStraceRequest(
     socket: SessionSocket,
     data: {
       code: string;
@@ -51,12 +71,21 @@ export class SyscallWebSocketHandler extends BaseSocketHandler {
       compiler?: string;
       optimization?: string;
     }
-  ): void {
+  ): Promise<void> {
     const { code, lang, compiler, optimization } = data;
-    const env = this.compilationService.createCompilationEnvironment(lang);
+
+    let env: CompilationEnvironment;
+    try {
+      env = await this.compilationService.createCompilationEnvironment(lang);
+    } catch (error) {
+      this.webSocketManager.emitToClient(socket, SocketEvents.STRACE_ERROR, {
+        message:
+          "Error setting up syscall tracing: " + (error as Error).message,
+      });
+      return;
+    }
 
     try {
-      this.compilationService.writeCodeToFile(env.sourceFile, code);
       this.webSocketManager.emitToClient(socket, SocketEvents.COMPILING, {});
 
       // Compile the code for syscall tracing
@@ -64,6 +93,7 @@ export class SyscallWebSocketHandler extends BaseSocketHandler {
         lang,
         compiler,
         optimization: optimization || "-O0",
+        schedule: this.getScheduleOptions(socket),
       });
     } catch (error) {
       this.webSocketManager.emitToClient(socket, SocketEvents.STRACE_ERROR, {
@@ -86,7 +116,7 @@ export class SyscallWebSocketHandler extends BaseSocketHandler {
     socket: SessionSocket,
     env: CompilationEnvironment,
     code: string,
-    options: { lang: string; compiler?: string; optimization?: string }
+    options: CompilationOptions
   ): void {
     this.compilationService
       .prepareSyscallTracing(env, code, options)
@@ -122,71 +152,92 @@ export class SyscallWebSocketHandler extends BaseSocketHandler {
 
   /**
    * Execute a syscall tracing session
+   * The log is tailed while the program runs: parsed records are streamed in
+   * batches (up to a limit) and the per-syscall summary is refreshed live
    * @param socket - Socket.IO connection
    * @param env - Compilation environment
    * @param straceLogFile - Path to the strace log file
    * @private
    */
-  private executeSyscallTracingSession(
+  private async executeSyscallTracingSession(
     socket: SessionSocket,
     env: CompilationEnvironment,
     straceLogFile: string
-  ): void {
+  ): Promise<void> {
     // Create a session for running the program with strace
     const sessionId = socket.sessionId;
+    const trace = this.createTraceStream(socket, straceLogFile);
 
-    try {
-      // Set up handler for strace session exit event
-      socketEvents.once(
-        "strace-session-exit",
-        ({
-          sessionId: sid,
-          straceLogFile: logFile,
+    // Handle the exit of this session; every strace session in the worker
+    // listens, so the handler removes itself only once its own session ends
+    const onExit = async ({
+      sessionId: sid,
+      exitCode,
+      stats,
+    }: {
+      sessionId: string;
+      socketId: string;
+      straceLogFile: string;
+      exitCode: number;
+      stats: ExecutionStats;
+    }) => {
+      if (sid !== sessionId) {
+        return;
+      }
+      socketEvents.off("strace-session-exit", onExit);
+
+      try {
+        await this.processSyscallTracingResults(
+          socket,
+          trace,
           exitCode,
-        }: {
-          sessionId: string;
-          socketId: string;
-          straceLogFile: string;
-          exitCode: number;
-        }) => {
-          if (sid === sessionId) {
-            try {
-              this.processSyscallTracingResults(socket, logFile, exitCode);
-            } catch (e) {
-              console.error(
-                `Error processing strace exit for session ${sessionId}:`,
-                e
-              );
-              this.webSocketManager.emitToClient(
-                socket,
-                SocketEvents.STRACE_ERROR,
-                {
-                  message:
-                    "Error processing strace results: " + (e as Error).message,
-                }
-              );
-            } finally {
-              // Always clean up
-              this.cleanupSession(sessionId);
-            }
-          }
-        }
-      );
+          stats
+        );
+      } catch (e) {
+        console.error(
+          `Error processing strace exit for session ${sessionId}:`,
+          e
+        );
+        this.webSocketManager.emitToClient(socket, SocketEvents.STRACE_ERROR, {
+          message: "Error processing strace results: " + (e as Error).message,
+        });
+      } finally {
+        // Always clean up
+        this.cleanupSession(sessionId);
+      }
+    };
+
+    try {
+      socketEvents.on("strace-session-exit", onExit);
 
       // Use sessionService to execute the strace session
       if (
-        !this.sessionService.executeStraceSession(
+        !(await this.sessionService.executeStraceSession(
           socket,
           sessionId,
           env.tmpDir,
           env.outputFile,
           straceLogFile
-        )
+        ))
       ) {
-        throw new Error("Failed to execute strace session");
+        // The session service has reported the error and removed the sandbox
+        socketEvents.off("strace-session-exit", onExit);
+        return;
       }
+
+      trace.tailer.start();
+      trace.summaryTimer = setInterval(() => {
+        if (trace.summary.hasChanges()) {
+          this.webSocketManager.emitToClient(
+            socket,
+            SocketEvents.STRACE_SUMMARY,
+            { summary: trace.summary.snapshot(), totalRecords: trace.total }
+          );
+        }
+      }, SUMMARY_INTERVAL_MS);
     } catch (error) {
       console.error(`Error creating strace session ${sessionId}:`, error);
+      socketEvents.off("strace-session-exit", onExit);
       this.webSocketManager.emitToClient(socket, SocketEvents.STRACE_ERROR, {
         message: `Error executing strace: ${(error as Error).message}`,
       });
@@ -195,53 +246,95 @@ export class SyscallWebSocketHandler extends BaseSocketHandler {
   }
 
   /**
-   * Process strace results
+   * Create the parser state for a traced program
+   * Only the running totals are kept on the server; records are forwarded
+   * as they are parsed and dropped once the streaming limit is reached
    * @param socket - Socket.IO connection
-   * @param straceLogFile - Path to strace log file
-   * @param exitCode - Exit code of the strace process
+   * @param straceLogFile - Path to the strace log file
    * @private
    */
-  private processSyscallTracingResults(
+  private createTraceStream(
     socket: SessionSocket,
-    straceLogFile: string,
-    exitCode: number
+    straceLogFile: string
+  ): TraceStream {
+    const trace: TraceStream = {
+      stream: new StraceStream(),
+      summary: new SyscallSummary(),
+      tailer: new LogTailer(straceLogFile, (chunk: string) =>
+        this.forwardRecords(socket, trace, trace.stream.push(chunk))
+      ),
+      summaryTimer: null,
+      total: 0,
+      streamed: 0,
+    };
+    return trace;
+  }
+
+  /**
+   * Account for parsed records and stream them while under the limit
+   * @private
+   */
+  private forwardRecords(
+    socket: SessionSocket,
+    trace: TraceStream,
+    records: SyscallRecord[]
   ): void {
-    try {
-      if (fs.existsSync(straceLogFile)) {
-        // Read strace log
-        const straceOutput = fs.readFileSync(straceLogFile, "utf8");
+    if (records.length === 0) {
+      return;
+    }
 
-        // Check if file has content
-        if (!straceOutput || straceOutput.trim().length === 0) {
-          console.error("Strace log file is empty");
-          this.webSocketManager.emitToClient(
-            socket,
-            SocketEvents.STRACE_ERROR,
-            {
-              message:
-                "No system call information captured. The program may have failed to execute properly.",
-            }
-          );
-          return;
-        }
+    trace.summary.add(records);
+    trace.total += records.length;
 
-        // Send report to client - this will cause the frontend to disconnect
-        this.webSocketManager.emitToClient(socket, SocketEvents.STRACE_REPORT, {
-          report: straceOutput,
-          exitCode: exitCode,
-        });
-      } else {
-        console.error(`Strace log file not found: ${straceLogFile}`);
-        this.webSocketManager.emitToClient(socket, SocketEvents.STRACE_ERROR, {
-          message: "Strace log file not found after execution",
-        });
-      }
-    } catch (error) {
-      console.error("Error processing strace results:", error);
+    const batch = records.slice(0, MAX_STREAMED_RECORDS - trace.streamed);
+    if (batch.length > 0) {
+      trace.streamed += batch.length;
+      this.webSocketManager.emitToClient(socket, SocketEvents.STRACE_BATCH, {
+        records: batch,
+      });
+    }
+  }
+
+  /**
+   * Finish a trace once the program exited
+   * @param socket - Socket.IO connection
+   * @param trace - Parser state of the trace
+   * @param exitCode - Exit code of the strace process
+   * @param stats - Resource usage of the traced process tree
+   * @private
+   */
+  private async processSyscallTracingResults(
+    socket: SessionSocket,
+    trace: TraceStream,
+    exitCode: number,
+    stats: ExecutionStats
+  ): Promise<void> {
+    if (trace.summaryTimer) {
+      clearInterval(trace.summaryTimer);
+      trace.summaryTimer = null;
+    }
+
+    // Read what strace wrote after the last poll
+    await trace.tailer.stop();
+    this.forwardRecords(socket, trace, trace.stream.end());
+
+    if (trace.total === 0) {
+      console.error("Strace log is empty");
       this.webSocketManager.emitToClient(socket, SocketEvents.STRACE_ERROR, {
-        message: "Error processing strace results: " + (error as Error).message,
+        message:
+          "No system call information captured. The program may have failed to execute properly.",
       });
+      return;
     }
+
+    // Send report to client - this will cause the frontend to disconnect
+    this.webSocketManager.emitToClient(socket, SocketEvents.STRACE_REPORT, {
+      summary: trace.summary.snapshot(),
+      totalRecords: trace.total,
+      streamedRecords: trace.streamed,
+      exitCode: exitCode,
+      stats,
+    });
   }
 
   /**
@@ -3,7 +3,7 @@
  * Centralized utilities for Socket.IO communication
  */
 import { Server as SocketIOServer, Socket } from "socket.io";
-import { EventEmitter } from "events";
+import { EventEmitter, setMaxListeners } from "events";
 import { Server } from "http";
 import zlib from "zlib";
 import {
@@ -11,8 +11,13 @@ import {
   SessionSocket,
   ISessionService,
   ICodeProcessingService,
+  CompileScheduleOptions,
 } from "../types";
 import { sessionService } from "../utils/sessionService";
+import { rateLimiter, REQUEST_COSTS } from "../utils/rateLimiter";
+import { getSocketAdapter } from "../utils/socketAdapter";
+import { getSocketClientAddress } from "../utils/clientAddress";
+import { expandMatrix, MAX_MATRIX_CELLS } from "../utils/toolchain";
 
 /**
  * Socket event types enum
@@ -27,6 +32,13 @@ export enum SocketEvents {
   COMPILING = "compiling",
   COMPILE_SUCCESS = "compile_success",
   COMPILE_ERROR = "compile_error",
+  COMPILE_DIAGNOSTIC = "compile_diagnostic",
+
+  // Matrix run events: one source across build configurations
+  MATRIX_RUN = "matrix_run",
+  MATRIX_CELL = "matrix_cell",
+  MATRIX_COMPLETE = "matrix_complete",
+  MATRIX_ERROR = "matrix_error",
 
   // Execution events
   OUTPUT = "output",
@@ -59,6 +71,23 @@ export enum SocketEvents {
   STRACE_RESPONSE = "strace_response",
   STRACE_ERROR = "strace_error",
   STRACE_REPORT = "strace_report",
+  STRACE_BATCH = "strace_batch",
+  STRACE_SUMMARY = "strace_summary",
+
+  // Benchmark events
+  BENCHMARK = "benchmark",
+  BENCHMARK_COMPILING = "benchmark_compiling",
+  BENCHMARK_PROGRESS = "benchmark_progress",
+  BENCHMARK_RESULT = "benchmark_result",
+  BENCHMARK_COMPLETE = "benchmark_complete",
+  BENCHMARK_ERROR = "benchmark_error",
+
+  // Profiling events
+  PROFILE = "profile",
+  PROFILE_COMPILING = "profile_compiling",
+  PROFILE_RUNNING = "profile_running",
+  PROFILE_REPORT = "profile_report",
+  PROFILE_ERROR = "profile_error",
 }
 
 /**
@@ -115,6 +144,31 @@ export abstract class BaseSocketHandler {
     }
   }
 
+  /**
+   * Build compile scheduling options for a socket
+   * Queue positions are reported to the client while it waits for a slot;
+   * its compiles are cancelled when it disconnects
+   * @param socket - Socket.IO connection
+   * @param queuedEvent - Event used to report the queue position
+   * @protected
+   */
+  protected getScheduleOptions(
+    socket: SessionSocket,
+    queuedEvent: string = SocketEvents.COMPILING
+  ): CompileScheduleOptions {
+    return {
+      clientId: getSocketClientAddress(socket),
+      priority: "interactive",
+      signal: getDisconnectSignal(socket),
+      onQueued: (position: number) => {
+        this.webSocketManager.emitToClient(socket, queuedEvent, {
+          queued: true,
+          position,
+        });
+      },
+    };
+  }
+
   /**
    * Common setup for socket event handlers
    * @param socket - Socket.IO connection
@@ -155,8 +209,90 @@ export abstract class BaseSocketHandler {
   public abstract setupSocketHandlers(socket: SessionSocket): void;
 }
 
+// Aborted when a socket disconnects, shared by the socket's requests
+const disconnectSignals = new WeakMap<Socket, AbortSignal>();
+
+/**
+ * Get a signal that is aborted once a socket disconnects
+ * @param socket - Socket.IO socket
+ * @returns Abort signal of the socket
+ */
+export const getDisconnectSignal = (socket: Socket): AbortSignal => {
+  let signal = disconnectSignals.get(socket);
+  if (!signal) {
+    const controller = new AbortController();
+    // Every queued or running compile of the socket listens
+    setMaxListeners(0, controller.signal);
+    if (socket.connected) {
+      socket.once(SocketEvents.DISCONNECT, () => controller.abort());
+    } else {
+      controller.abort();
+    }
+    signal = controller.signal;
+    disconnectSignals.set(socket, signal);
+  }
+  return signal;
+};
+
+/**
+ * Run requests charged to the client's rate limit
+ * Each entry prices the request and names the event and payload field that
+ * report a refusal to the client
+ */
+const RATE_LIMITED_EVENTS: Record<
+  string,
+  { cost: (data: any) => number; errorEvent: SocketEvents; field: string }
+> = {
+  [SocketEvents.COMPILE]: {
+    cost: () => REQUEST_COSTS.compile,
+    errorEvent: SocketEvents.COMPILE_ERROR,
+    field: "output",
+  },
+  [SocketEvents.DEBUG_START]: {
+    cost: () => REQUEST_COSTS.debug,
+    errorEvent: SocketEvents.DEBUG_ERROR,
+    field: "message",
+  },
+  [SocketEvents.LEAK_CHECK]: {
+    cost: (data) =>
+      data?.mode === "asan"
+        ? REQUEST_COSTS.leakCheckAsan
+        : REQUEST_COSTS.leakCheckValgrind,
+    errorEvent: SocketEvents.LEAK_CHECK_ERROR,
+    field: "message",
+  },
+  [SocketEvents.STRACE_START]: {
+    cost: () => REQUEST_COSTS.syscall,
+    errorEvent: SocketEvents.STRACE_ERROR,
+    field: "message",
+  },
+  [SocketEvents.BENCHMARK]: {
+    // The handler runs at most four variants
+    cost: (data) =>
+      REQUEST_COSTS.benchmarkVariant *
+      Math.min(data?.variants?.length || 1, 4),
+    errorEvent: SocketEvents.BENCHMARK_ERROR,
+    field: "message",
+  },
+  [SocketEvents.MATRIX_RUN]: {
+    // Every configuration the handler keeps is compiled and run
+    cost: (data) =>
+      REQUEST_COSTS.matrixCell *
+      Math.min(expandMatrix(data).length, MAX_MATRIX_CELLS),
+    errorEvent: SocketEvents.MATRIX_ERROR,
+    field: "message",
+  },
+  [SocketEvents.PROFILE]: {
+    cost: () => REQUEST_COSTS.profile,
+    errorEvent: SocketEvents.PROFILE_ERROR,
+    field: "message",
+  },
+};
+
 // Events emitter for cross-component communication
 export const socketEvents = new EventEmitter();
+// Every running strace session listens for session exits
+socketEvents.setMaxListeners(0);
 
 // Track active sockets
 const connectedSockets = new Set<string>();
@@ -167,6 +303,7 @@ const connectedSockets = new Set<string>();
  */
 export class WebSocketManager implements IWebSocketManager {
   private io: SocketIOServer | null = null;
+  private accepting = true;
 
   /**
    * Initialize Socket.IO server
@@ -181,6 +318,8 @@ export class WebSocketManager implements IWebSocketManager {
           methods: ["GET", "POST"],
         },
         transports: ["websocket"],
+        // Share rooms and broadcasts with the other cluster workers
+        adapter: getSocketAdapter(),
         // Enable compression
         perMessageDeflate: {
           threshold: 1024, // Only compress data if larger than 1KB
@@ -194,6 +333,16 @@ export class WebSocketManager implements IWebSocketManager {
         },
       });
 
+      // A draining worker keeps its sockets but takes no new ones; the
+      // client retries and lands on another worker
+      this.io.use((_socket, next) =>
+        next(
+          this.accepting
+            ? undefined
+            : new Error("Server is restarting, please retry")
+        )
+      );
+
       // Set up connection handler
       this.io.on(SocketEvents.CONNECT, (socket: Socket) => {
         // Skip if already handled
@@ -210,11 +359,39 @@ export class WebSocketManager implements IWebSocketManager {
         // Generate and assign a session ID
         sessionService.createSession(sessionSocket);
 
+        // Charge run requests before any handler sees them
+        socket.use(([event, data], next) => {
+          const limited = RATE_LIMITED_EVENTS[event];
+          if (!limited) {
+            next();
+            return;
+          }
+
+          rateLimiter
+            .consume(getSocketClientAddress(socket), limited.cost(data))
+            .then((decision) => {
+              if (decision.allowed) {
+                next();
+                return;
+              }
+
+              const retryAfter = Math.ceil(decision.retryAfterMs / 1000);
+              this.emitToClient(socket, limited.errorEvent, {
+                [limited.field]:
+                  decision.reason === "load"
+                    ? `Server is busy, please retry in ${retryAfter}s`
+                    : `Rate limit exceeded, please retry in ${retryAfter}s`,
+              });
+            });
+        });
+
         // Use dynamic imports for handlers to avoid circular dependencies
         setupCompileHandlers(sessionSocket);
         setupDebugHandlers(sessionSocket);
         setupLeakDetectHandlers(sessionSocket);
         setupStraceHandlers(sessionSocket);
+        setupBenchmarkHandlers(sessionSocket);
+        setupProfileHandlers(sessionSocket);
 
         // Handle disconnect
         socket.on(SocketEvents.DISCONNECT, () => {
@@ -241,6 +418,13 @@ export class WebSocketManager implements IWebSocketManager {
     }
   }
 
+  /**
+   * Refuse new connections; connected sockets are not affected
+   */
+  stopAccepting(): void {
+    this.accepting = false;
+  }
+
   /**
    * Send a message to a specific client
    * @param socket - Socket.IO socket
@@ -274,6 +458,16 @@ const setupStraceHandlers = async (socket: SessionSocket) => {
   straceHandler.setupSocketHandlers(socket);
 };
 
+const setupBenchmarkHandlers = async (socket: SessionSocket) => {
+  const { benchmarkHandler } = await import("./benchmarkSocket");
+  benchmarkHandler.setupSocketHandlers(socket);
+};
+
+const setupProfileHandlers = async (socket: SessionSocket) => {
+  const { profileHandler } = await import("./profileSocket");
+  profileHandler.setupSocketHandlers(socket);
+};
+
 // Create singleton instance
 export const webSocketManager = new WebSocketManager();
 
@@ -0,0 +1,108 @@
+// Array of structures vs structure of arrays
+// Summing one field of a struct drags the unused fields through the cache;
+// a separate array per field reads only the bytes it needs and vectorizes.
+// Each section prints "BENCH <name> <nanoseconds>", which benchmark mode
+// charts. Optional input: number of particles (default 1000000)
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+template <typename T>
+void keep(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+void bench(const char* name, F&& body)
+{
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    std::printf("BENCH %s %lld\n", name, static_cast<long long>(ns));
+}
+
+struct Particle
+{
+    float x, y, z;
+    float vx, vy, vz;
+    float mass;
+    int id;
+};
+
+struct Particles
+{
+    std::vector<float> x, y, z;
+    std::vector<float> vx, vy, vz;
+    std::vector<float> mass;
+    std::vector<int> id;
+};
+
+int main()
+{
+    std::size_t n;
+    if (!(std::cin >> n) || n == 0)
+        n = 1000000;
+    const int passes = 10;
+
+    std::vector<Particle> aos(n);
+    Particles soa;
+    for (auto* field : {&soa.x, &soa.y, &soa.z, &soa.vx, &soa.vy, &soa.vz,
+                        &soa.mass})
+        field->resize(n);
+    soa.id.resize(n);
+
+    for (std::size_t i = 0; i < n; i++)
+    {
+        float v = static_cast<float>(i % 100) * 0.01f;
+        aos[i] = {v, v, v, v, v, v, 1.0f + v, static_cast<int>(i)};
+        soa.x[i] = soa.y[i] = soa.z[i] = v;
+        soa.vx[i] = soa.vy[i] = soa.vz[i] = v;
+        soa.mass[i] = 1.0f + v;
+        soa.id[i] = static_cast<int>(i);
+    }
+
+    // Move every particle along its velocity: touches 6 of 8 fields
+    bench("aos_update", [&] {
+        for (int pass = 0; pass < passes; pass++)
+            for (auto& p : aos)
+            {
+                p.x += p.vx;
+                p.y += p.vy;
+                p.z += p.vz;
+            }
+        keep(aos[n / 2]);
+    });
+    bench("soa_update", [&] {
+        for (int pass = 0; pass < passes; pass++)
+            for (std::size_t i = 0; i < n; i++)
+            {
+                soa.x[i] += soa.vx[i];
+                soa.y[i] += soa.vy[i];
+                soa.z[i] += soa.vz[i];
+            }
+        keep(soa.x[n / 2]);
+    });
+
+    // Total mass: touches 1 of 8 fields
+    float aosMass = 0, soaMass = 0;
+    bench("aos_mass", [&] {
+        for (int pass = 0; pass < passes; pass++)
+            for (const auto& p : aos)
+                aosMass += p.mass;
+        keep(aosMass);
+    });
+    bench("soa_mass", [&] {
+        for (int pass = 0; pass < passes; pass++)
+            for (float m : soa.mass)
+                soaMass += m;
+        keep(soaMass);
+    });
+
+    std::cout << "particles: " << n
+              << ", bytes per particle: " << sizeof(Particle) << "\n";
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Branchy vs branchless loops
+// Copying the values above a threshold with an if costs a misprediction
+// whenever the branch is unpredictable. The branchless version always
+// stores the value and advances the output only when it passes, so every
+// iteration does the same work. Sorting the data first makes the branch
+// predictable again.
+// Each section prints "BENCH <name> <nanoseconds>", which benchmark mode
+// charts. Optional input: number of values (default 1000000)
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+template <typename T>
+void keep(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+void bench(const char* name, F&& body)
+{
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    std::printf("BENCH %s %lld\n", name, static_cast<long long>(ns));
+}
+
+// noinline keeps each loop separate so the compiler cannot merge them
+__attribute__((noinline)) std::size_t
+filterBranchy(const std::vector<int>& data, std::vector<int>& out)
+{
+    std::size_t count = 0;
+    for (int value : data)
+        if (value >= 128)
+            out[count++] = value;
+    return count;
+}
+
+__attribute__((noinline)) std::size_t
+filterBranchless(const std::vector<int>& data, std::vector<int>& out)
+{
+    std::size_t count = 0;
+    for (int value : data)
+    {
+        out[count] = value;
+        count += value >= 128;
+    }
+    return count;
+}
+
+int main()
+{
+    std::size_t n;
+    if (!(std::cin >> n) || n == 0)
+        n = 1000000;
+    const int passes = 10;
+
+    std::mt19937 gen(42);
+    std::vector<int> data(n);
+    for (auto& value : data)
+        value = static_cast<int>(gen() % 256);
+    std::vector<int> sorted = data;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<int> out(n);
+    std::size_t results[4] = {};
+    bench("branchy_random", [&] {
+        for (int pass = 0; pass < passes; pass++)
+            results[0] += filterBranchy(data, out);
+        keep(out[0]);
+    });
+    bench("branchless_random", [&] {
+        for (int pass = 0; pass < passes; pass++)
+            results[1] += filterBranchless(data, out);
+        keep(out[0]);
+    });
+    bench("branchy_sorted", [&] {
+        for (int pass = 0; pass < passes; pass++)
+            results[2] += filterBranchy(sorted, out);
+        keep(out[0]);
+    });
+    bench("branchless_sorted", [&] {
+        for (int pass = 0; pass < passes; pass++)
+            results[3] += filterBranchless(sorted, out);
+        keep(out[0]);
+    });
+
+    std::cout << "values: " << n << ", counts match: " << std::boolalpha
+              << (results[0] == results[1] && results[1] == results[2] &&
+                  results[2] == results[3])
+              << "\n";
+    return 0;
+}
@@ -0,0 +1,85 @@
+// std::map vs std::unordered_map vs sorted std::vector lookup
+// A map walks a pointer-linked tree, an unordered_map hashes into buckets,
+// and binary search over a sorted vector probes contiguous memory.
+// Each section prints "BENCH <name> <nanoseconds>", which benchmark mode
+// charts. Optional input: number of keys (default 200000)
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+template <typename T>
+void keep(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+void bench(const char* name, F&& body)
+{
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    std::printf("BENCH %s %lld\n", name, static_cast<long long>(ns));
+}
+
+int main()
+{
+    std::size_t n;
+    if (!(std::cin >> n) || n == 0)
+        n = 200000;
+    const std::size_t lookups = 200000;
+
+    // Distinct keys in random order
+    std::mt19937 gen(42);
+    std::vector<int> keys(n);
+    for (std::size_t i = 0; i < n; i++)
+        keys[i] = static_cast<int>(i * 7919);
+    std::shuffle(keys.begin(), keys.end(), gen);
+
+    std::map<int, int> tree;
+    std::unordered_map<int, int> hash;
+    std::vector<std::pair<int, int>> sorted;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        tree[keys[i]] = static_cast<int>(i);
+        hash[keys[i]] = static_cast<int>(i);
+        sorted.emplace_back(keys[i], static_cast<int>(i));
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<int> queries(lookups);
+    for (auto& query : queries)
+        query = keys[gen() % n];
+
+    long treeSum = 0, hashSum = 0, sortedSum = 0;
+    bench("map", [&] {
+        for (int key : queries)
+            treeSum += tree.find(key)->second;
+        keep(treeSum);
+    });
+    bench("unordered_map", [&] {
+        for (int key : queries)
+            hashSum += hash.find(key)->second;
+        keep(hashSum);
+    });
+    bench("sorted_vector", [&] {
+        for (int key : queries)
+            sortedSum += std::lower_bound(sorted.begin(), sorted.end(),
+                                          std::make_pair(key, 0))
+                             ->second;
+        keep(sortedSum);
+    });
+
+    std::cout << "keys: " << n << ", lookups: " << lookups
+              << ", results match: " << std::boolalpha
+              << (treeSum == hashSum && hashSum == sortedSum) << "\n";
+    return 0;
+}
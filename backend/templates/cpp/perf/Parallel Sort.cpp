@@ -0,0 +1,103 @@
+// Sequential vs parallel sorting
+// std::execution::par lets the library spread a sort over threads. With
+// libstdc++ that needs Intel TBB; without it the policy runs serially.
+// The thread version splits the data, sorts the parts concurrently and
+// merges them, which shows the speedup the hardware allows. Benchmark mode
+// pins programs to a single CPU, so expect parallelism to help only when
+// more than one core is available.
+// Each section prints "BENCH <name> <nanoseconds>", which benchmark mode
+// charts. Optional input: number of values (default 1000000)
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+// With TBB headers installed libstdc++ runs the policies on TBB, which then
+// has to be linked with -ltbb; use them only where they link without it
+#if __has_include(<execution>) && !__has_include(<tbb/tbb.h>)
+#include <execution>
+#define HAVE_EXECUTION 1
+#endif
+
+template <typename T>
+void keep(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+void bench(const char* name, F&& body)
+{
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    std::printf("BENCH %s %lld\n", name, static_cast<long long>(ns));
+}
+
+// Sort parts on their own threads, then merge neighbouring parts pairwise
+void threadSort(std::vector<int>& data, unsigned threads)
+{
+    std::vector<std::size_t> bounds;
+    for (unsigned t = 0; t <= threads; t++)
+        bounds.push_back(data.size() * t / threads);
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++)
+        workers.emplace_back([&, t] {
+            std::sort(data.begin() + bounds[t], data.begin() + bounds[t + 1]);
+        });
+    for (auto& worker : workers)
+        worker.join();
+
+    for (std::size_t width = 1; width < threads; width *= 2)
+        for (std::size_t t = 0; t + width < threads; t += 2 * width)
+            std::inplace_merge(data.begin() + bounds[t],
+                               data.begin() + bounds[t + width],
+                               data.begin() + bounds[std::min<std::size_t>(
+                                   t + 2 * width, threads)]);
+}
+
+int main()
+{
+    std::size_t n;
+    if (!(std::cin >> n) || n == 0)
+        n = 1000000;
+    unsigned threads =
+        std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+
+    std::mt19937 gen(42);
+    std::vector<int> input(n);
+    for (auto& value : input)
+        value = static_cast<int>(gen());
+
+    std::vector<int> data = input;
+    bench("std_sort", [&] {
+        std::sort(data.begin(), data.end());
+        keep(data[0]);
+    });
+    const std::vector<int> expected = data;
+
+#if defined(HAVE_EXECUTION) && defined(__cpp_lib_parallel_algorithm)
+    data = input;
+    bench("execution_par", [&] {
+        std::sort(std::execution::par, data.begin(), data.end());
+        keep(data[0]);
+    });
+    std::cout << "execution::par sorted: " << std::boolalpha
+              << (data == expected) << "\n";
+#endif
+
+    data = input;
+    bench("thread_sort", [&] {
+        threadSort(data, threads);
+        keep(data[0]);
+    });
+    std::cout << "thread sort (" << threads << " threads) sorted: "
+              << std::boolalpha << (data == expected) << "\n";
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Scalar vs vectorized reductions
+// Floating point addition is not associative, so without -ffast-math the
+// compiler must add one element at a time. Splitting the sum into vector
+// lanes by hand, with intrinsics or std::experimental::simd, reorders the
+// additions explicitly and processes 4 or 8 floats per instruction.
+// Each section prints "BENCH <name> <nanoseconds>", which benchmark mode
+// charts. Optional input: number of floats (default 4000000)
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+#if __has_include(<experimental/simd>)
+#include <experimental/simd>
+#define HAVE_STD_SIMD 1
+#endif
+
+template <typename T>
+void keep(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+void bench(const char* name, F&& body)
+{
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    std::printf("BENCH %s %lld\n", name, static_cast<long long>(ns));
+}
+
+__attribute__((noinline)) float sumScalar(const float* data, std::size_t n)
+{
+    float sum = 0;
+    for (std::size_t i = 0; i < n; i++)
+        sum += data[i];
+    return sum;
+}
+
+#ifdef HAVE_X86_SIMD
+// SSE2 is part of every x86-64 CPU
+__attribute__((noinline)) float sumSse(const float* data, std::size_t n)
+{
+    __m128 acc = _mm_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        acc = _mm_add_ps(acc, _mm_loadu_ps(data + i));
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    float sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; i++)
+        sum += data[i];
+    return sum;
+}
+
+// Compiled for AVX regardless of -march; only called if the CPU has it
+__attribute__((noinline, target("avx"))) float sumAvx(const float* data,
+                                                      std::size_t n)
+{
+    __m256 acc = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm256_add_ps(acc, _mm256_loadu_ps(data + i));
+
+    float lanes[8];
+    _mm256_storeu_ps(lanes, acc);
+    float sum = 0;
+    for (float lane : lanes)
+        sum += lane;
+    for (; i < n; i++)
+        sum += data[i];
+    return sum;
+}
+#endif
+
+#ifdef HAVE_STD_SIMD
+namespace stdx = std::experimental;
+
+__attribute__((noinline)) float sumStdSimd(const float* data, std::size_t n)
+{
+    using Vec = stdx::native_simd<float>;
+    Vec acc = 0;
+    std::size_t i = 0;
+    for (; i + Vec::size() <= n; i += Vec::size())
+        acc += Vec(data + i, stdx::element_aligned);
+
+    float sum = stdx::reduce(acc);
+    for (; i < n; i++)
+        sum += data[i];
+    return sum;
+}
+#endif
+
+int main()
+{
+    std::size_t n;
+    if (!(std::cin >> n) || n == 0)
+        n = 4000000;
+    const int passes = 10;
+
+    std::vector<float> data(n);
+    for (std::size_t i = 0; i < n; i++)
+        data[i] = static_cast<float>(i % 10) * 0.1f;
+
+    float scalar = 0;
+    bench("scalar", [&] {
+        for (int pass = 0; pass < passes; pass++)
+        {
+            scalar += sumScalar(data.data(), n);
+            keep(scalar); // Stops the compiler reusing one pass for all
+        }
+    });
+    std::cout << "scalar sum: " << scalar << "\n";
+
+#ifdef HAVE_X86_SIMD
+    float sse = 0;
+    bench("sse", [&] {
+        for (int pass = 0; pass < passes; pass++)
+        {
+            sse += sumSse(data.data(), n);
+            keep(sse);
+        }
+    });
+    std::cout << "sse sum: " << sse << "\n";
+
+    if (__builtin_cpu_supports("avx"))
+    {
+        float avx = 0;
+        bench("avx", [&] {
+            for (int pass = 0; pass < passes; pass++)
+            {
+                avx += sumAvx(data.data(), n);
+                keep(avx);
+            }
+        });
+        std::cout << "avx sum: " << avx << "\n";
+    }
+#endif
+
+#ifdef HAVE_STD_SIMD
+    float simd = 0;
+    bench("std_simd", [&] {
+        for (int pass = 0; pass < passes; pass++)
+        {
+            simd += sumStdSimd(data.data(), n);
+            keep(simd);
+        }
+    });
+    std::cout << "std::simd sum (" << stdx::native_simd<float>::size()
+              << " lanes): " << simd << "\n";
+#endif
+
+    // Sums differ slightly: each version adds in a different order
+    return 0;
+}
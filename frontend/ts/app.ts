@@ -6,7 +6,10 @@ import CompileSocketManager from "./ws/compileSocket";
 import DebugSocketManager from "./ws/debugSocket";
 import LeakDetectSocketManager from "./ws/leakDetectSocket";
 import SyscallSocketManager from "./ws/syscallSocket";
-import apiService from "./service/api";
+import BenchmarkSocketManager from "./ws/benchmarkSocket";
+import MatrixSocketManager from "./ws/matrixSocket";
+import ProfileSocketManager from "./ws/profileSocket";
+import apiService, { ApiError } from "./service/api";
 import { getEditorService, initEditors } from "./service/editor";
 import { getTerminalService } from "./service/terminal";
 import { CompileOptions } from "./types";
@@ -33,6 +36,9 @@ export const domUtils = {
       lintCode: document.getElementById("lintCode"),
       debug: document.getElementById("debug"),
       syscall: document.getElementById("syscall"),
+      benchmark: document.getElementById("benchmark"),
+      profile: document.getElementById("profile"),
+      matrix: document.getElementById("matrix"),
       outputPanel: document.getElementById("outputPanel"),
       closeOutput: document.getElementById("closeOutput"),
       codesnap: document.getElementById("codeSnap"),
@@ -44,6 +50,13 @@ export const domUtils = {
     if (output) output.innerHTML = `<div class='loading'>${text}</div>`;
   },
 
+  // Show compile progress, including the queue position while waiting for a slot
+  showCompilingInOutput: (text: string, data?: any): void => {
+    domUtils.showLoadingInOutput(
+      data?.queued ? `Queued (position ${data.position})` : text
+    );
+  },
+
   setOutput: (html: string): void => {
     const output = document.getElementById("output");
     if (output) output.innerHTML = html;
@@ -69,6 +82,7 @@ export const domUtils = {
     outputPanel.style.display = "none";
     document.querySelector(".editor-panel")?.classList.remove("with-output");
     domUtils.clearOutput();
+    getEditorService().unlinkAssemblyLines();
 
     document.body.classList.contains("zen-mode-active") &&
       getEditorService().refresh();
@@ -95,6 +109,9 @@ export const domUtils = {
   },
 };
 
+// Latest lint request; responses to older ones are dropped
+let lintRequest = 0;
+
 // Code Actions - Will become React hooks
 export const codeActions = {
   viewAssembly: async (options: CompileOptions): Promise<void> => {
@@ -104,7 +121,32 @@ export const codeActions = {
     domUtils.showLoadingInOutput("Generating assembly code...");
 
     try {
-      const data = await apiService.fetchAssembly(options);
+      const data = await apiService.fetchStructuredAssembly(
+        options,
+        options.lang === "cpp"
+      );
+
+      // Lay out the functions one after another, remembering which view
+      // lines each source line produced
+      const lines: string[] = [];
+      const ranges = new Map<number, { from: number; to: number }[]>();
+      const firstRow: number[] = [];
+      data.functions.forEach((fn, index) => {
+        if (index > 0) lines.push("");
+        const vector = fn.vectorCount > 0 ? `, ${fn.vectorCount} vector` : "";
+        lines.push(
+          `${fn.name}:\t# ${fn.instructionCount} instructions${vector}`
+        );
+        firstRow[index] = lines.length;
+        fn.instructions.forEach(({ text, label }) =>
+          lines.push(label ? text : `\t${text}`)
+        );
+      });
+      data.lineMap.forEach((range) => {
+        const from = firstRow[range.function] + range.start;
+        const entry = { from, to: from + range.end - range.start };
+        ranges.set(range.line, [...(ranges.get(range.line) || []), entry]);
+      });
 
       const output = document.getElementById("output");
       if (output) {
@@ -113,7 +155,8 @@ export const codeActions = {
         const assemblyView = editorService.getAssemblyView();
 
         if (assemblyView && container) {
-          editorService.setAssemblyValue(data.trim());
+          editorService.setAssemblyValue(lines.join("\n"));
+          editorService.linkAssemblyLines(ranges);
           container.appendChild(assemblyView.getWrapperElement());
           setTimeout(() => assemblyView.refresh(), 10);
         }
@@ -128,8 +171,17 @@ export const codeActions = {
     const editorService = getEditorService();
     const cursor = editorService.getCursor();
 
+    // With a selection, only the selected lines are reformatted
+    const editor = editorService.getEditor();
+    const lines = editor?.somethingSelected()
+      ? {
+          start: editor.getCursor("from").line + 1,
+          end: editor.getCursor("to").line + 1,
+        }
+      : undefined;
+
     try {
-      const data = await apiService.formatCode(code, lang);
+      const data = await apiService.formatCode(code, lang, lines);
 
       const formattedData = data.replace(/^\n+/, "").replace(/\n+$/, "");
       const scrollInfo = editorService.getScrollInfo();
@@ -157,11 +209,14 @@ export const codeActions = {
   },
 
   runLintCode: async (code: string, lang: string): Promise<void> => {
+    const request = ++lintRequest;
     domUtils.showOutputPanel();
     domUtils.showLoadingInOutput("Running lint code check...");
 
     try {
       const data = await apiService.runLintCode(code, lang);
+      // A newer check has been requested meanwhile
+      if (request !== lintRequest) return;
 
       const lines = data.split("\n");
       const formattedLines = lines
@@ -179,6 +234,13 @@ export const codeActions = {
         )}</div>`
       );
     } catch (error) {
+      // The server answers 409 for checks superseded by a newer one
+      if (
+        request !== lintRequest ||
+        (error instanceof ApiError && error.status === 409)
+      ) {
+        return;
+      }
       domUtils.setOutput(domUtils.formatErrorOutput(error));
     }
   },
@@ -312,6 +374,9 @@ export const initApp = () => {
   const debugSocketManager = new DebugSocketManager();
   const leakDetectSocketManager = new LeakDetectSocketManager();
   const syscallSocketManager = new SyscallSocketManager();
+  const benchmarkSocketManager = new BenchmarkSocketManager();
+  const profileSocketManager = new ProfileSocketManager();
+  const matrixSocketManager = new MatrixSocketManager();
 
   // Set up all event listeners
   const setupEventListeners = () => {
@@ -346,7 +411,10 @@ export const initApp = () => {
 
     // Compilation buttons
     addDebouncedHandler(elements.compile, () => {
-      compileSocketManager.compile(domUtils.getCompileOptions());
+      compileSocketManager.compile(
+        domUtils.getCompileOptions(),
+        getSelectorState().remarks === "on"
+      );
     });
 
     addDebouncedHandler(elements.debug, () => {
@@ -363,11 +431,23 @@ export const initApp = () => {
     });
 
     addDebouncedHandler(elements.memcheck, () => {
-      leakDetectSocketManager.startLeakDetection(domUtils.getCompileOptions());
+      leakDetectSocketManager.startLeakDetection(
+        domUtils.getCompileOptions(),
+        getSelectorState().leakMode === "asan" ? "asan" : "valgrind"
+      );
     });
     addDebouncedHandler(elements.syscall, () => {
       syscallSocketManager.startSyscallTracing(domUtils.getCompileOptions());
     });
+    addDebouncedHandler(elements.benchmark, () => {
+      benchmarkSocketManager.startBenchmark(domUtils.getCompileOptions());
+    });
+    addDebouncedHandler(elements.profile, () => {
+      profileSocketManager.startProfile(domUtils.getCompileOptions());
+    });
+    addDebouncedHandler(elements.matrix, () => {
+      matrixSocketManager.startMatrix(domUtils.getCompileOptions());
+    });
 
     // Settings
     elements.vimMode?.addEventListener("change", () => {
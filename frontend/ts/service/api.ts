@@ -1,4 +1,16 @@
-import { CompileOptions } from "../types";
+import { CompileOptions, StructuredAssembly } from "../types";
+
+/**
+ * Error of an API request, with the HTTP status (0 if no response arrived)
+ */
+export class ApiError extends Error {
+  readonly status: number;
+
+  constructor(message: string, status: number) {
+    super(message);
+    this.status = status;
+  }
+}
 
 /**
  * API Service Implementation
@@ -7,15 +19,17 @@ class ApiService {
   private readonly baseHeaders = {
     "Content-Type": "application/json",
   };
+  // Distinguishes this tab from others sharing the client's address
+  private readonly clientId = Math.random().toString(36).slice(2);
 
   /**
    * Generic method to make POST requests
    */
-  private async post<T>(
+  private async post<T, R = string>(
     endpoint: string,
     data: T,
     expectJson = false
-  ): Promise<string> {
+  ): Promise<R> {
     try {
       const response = await fetch(`/api/${endpoint}`, {
         method: "POST",
@@ -24,40 +38,61 @@ class ApiService {
       });
 
       if (!response.ok) {
-        throw new Error(`API error (${endpoint}): ${response.statusText}`);
+        throw new ApiError(
+          `API error (${endpoint}): ${response.statusText}`,
+          response.status
+        );
       }
 
-      return expectJson ? await response.json() : await response.text();
+      return (
+        expectJson ? await response.json() : await response.text()
+      ) as R;
     } catch (error) {
       const errorMessage =
         error instanceof Error ? error.message : "Unknown error";
-      throw new Error(
+      throw new ApiError(
         `${
           endpoint.charAt(0).toUpperCase() + endpoint.slice(1)
-        } API error: ${errorMessage}`
+        } API error: ${errorMessage}`,
+        error instanceof ApiError ? error.status : 0
       );
     }
   }
 
   /**
-   * Fetch assembly code from API
+   * Fetch a filtered assembly listing mapped to source lines
    */
-  async fetchAssembly(options: CompileOptions): Promise<string> {
-    return this.post("assembly", options, false);
+  async fetchStructuredAssembly(
+    options: CompileOptions,
+    demangle: boolean
+  ): Promise<StructuredAssembly> {
+    return this.post<object, StructuredAssembly>(
+      "assembly",
+      { ...options, format: "structured", demangle },
+      true
+    );
   }
 
   /**
    * Format code using the API
    */
-  async formatCode(code: string, lang: string): Promise<string> {
-    return this.post("format", { code, lang }, false);
+  async formatCode(
+    code: string,
+    lang: string,
+    lines?: { start: number; end: number }
+  ): Promise<string> {
+    return this.post("format", { code, lang, lines }, false);
   }
 
   /**
    * Run lint code on code
    */
   async runLintCode(code: string, lang: string): Promise<string> {
-    return this.post("lintCode", { code, lang }, false);
+    return this.post(
+      "lintCode",
+      { code, lang, clientId: this.clientId },
+      false
+    );
   }
 }
 
@@ -10,7 +10,7 @@ import "codemirror/addon/fold/brace-fold";
 import "codemirror/addon/fold/comment-fold";
 import "codemirror/addon/selection/active-line.js";
 import { debounce } from "lodash-es";
-import { EditorInstances } from "../types";
+import { EditorInstances, OptimizationRemark } from "../types";
 import themeManager from "../ui/themeManager";
 
 const EDITOR_CONFIG = {
@@ -34,6 +34,10 @@ export class EditorService {
   private straceView: CodeMirror.Editor | null = null;
 
   private currentFontSize: number = 14;
+  private hotLines: CodeMirror.LineHandle[] = [];
+  private remarkWidgets: CodeMirror.LineWidget[] = [];
+  private assemblyLines = new Map<number, { from: number; to: number }[]>();
+  private linkedAssemblyLines: CodeMirror.LineHandle[] = [];
   private readonly activeEditors = new Set<CodeMirror.Editor>();
   private readonly debouncedRefresh = debounce(
     () => this.refreshAllEditors(),
@@ -113,6 +117,124 @@ export class EditorService {
   readonly scrollTo = (left: number, top: number): void =>
     this.editor?.scrollTo(left, top);
 
+  // Highlight profile hotspots until the code changes; 1 is the hottest tier
+  readonly highlightHotLines = (
+    lines: { line: number; tier: 1 | 2 | 3 }[]
+  ): void => {
+    const editor = this.editor;
+    if (!editor) return;
+
+    this.clearHotLines();
+    lines.forEach(({ line, tier }) => {
+      const handle = editor.addLineClass(
+        line - 1,
+        "background",
+        `profile-hot-${tier}`
+      );
+      if (handle) this.hotLines.push(handle);
+    });
+    editor.on("change", this.clearHotLines);
+  };
+
+  readonly clearHotLines = (): void => {
+    const editor = this.editor;
+    if (!editor) return;
+
+    editor.off("change", this.clearHotLines);
+    this.hotLines.forEach((handle) => {
+      ["profile-hot-1", "profile-hot-2", "profile-hot-3"].forEach((name) =>
+        editor.removeLineClass(handle, "background", name)
+      );
+    });
+    this.hotLines = [];
+  };
+
+  // Show optimization remarks below the lines they are about until the code
+  // changes
+  readonly showRemarks = (remarks: OptimizationRemark[]): void => {
+    const editor = this.editor;
+    if (!editor) return;
+
+    this.clearRemarks();
+    const byLine = new Map<number, OptimizationRemark[]>();
+    remarks.forEach((remark) =>
+      byLine.set(remark.line, [...(byLine.get(remark.line) || []), remark])
+    );
+
+    byLine.forEach((lineRemarks, line) => {
+      if (line < 1 || line > editor.lineCount()) return;
+      const node = document.createElement("div");
+      node.className = "opt-remarks";
+      lineRemarks.forEach(({ kind, pass, message }) => {
+        const row = document.createElement("div");
+        row.className = `opt-remark opt-remark-${kind}`;
+        row.textContent = `${pass}: ${message}`;
+        node.appendChild(row);
+      });
+      this.remarkWidgets.push(editor.addLineWidget(line - 1, node));
+    });
+    editor.on("change", this.clearRemarks);
+  };
+
+  readonly clearRemarks = (): void => {
+    this.editor?.off("change", this.clearRemarks);
+    this.remarkWidgets.forEach((widget) => widget.clear());
+    this.remarkWidgets = [];
+  };
+
+  // Highlight the assembly generated for the source line under the cursor
+  // until the code changes; ranges are 0-based assembly view lines, end exclusive
+  readonly linkAssemblyLines = (
+    ranges: Map<number, { from: number; to: number }[]>
+  ): void => {
+    const editor = this.editor;
+    if (!editor) return;
+
+    this.unlinkAssemblyLines();
+    this.assemblyLines = ranges;
+    editor.on("cursorActivity", this.showLinkedAssembly);
+    editor.on("change", this.unlinkAssemblyLines);
+    this.showLinkedAssembly();
+  };
+
+  readonly unlinkAssemblyLines = (): void => {
+    this.editor?.off("cursorActivity", this.showLinkedAssembly);
+    this.editor?.off("change", this.unlinkAssemblyLines);
+    this.clearLinkedAssembly();
+    this.assemblyLines = new Map();
+  };
+
+  private readonly clearLinkedAssembly = (): void => {
+    this.linkedAssemblyLines.forEach((handle) =>
+      this.assemblyView?.removeLineClass(handle, "background", "asm-linked")
+    );
+    this.linkedAssemblyLines = [];
+  };
+
+  private readonly showLinkedAssembly = (): void => {
+    const view = this.assemblyView;
+    const cursor = this.editor?.getCursor();
+    if (!view || !cursor) return;
+
+    this.clearLinkedAssembly();
+    const ranges = this.assemblyLines.get(cursor.line + 1) || [];
+    ranges.forEach(({ from, to }) => {
+      for (let line = from; line < to; line++) {
+        const handle = view.addLineClass(line, "background", "asm-linked");
+        if (handle) this.linkedAssemblyLines.push(handle);
+      }
+    });
+    if (ranges.length > 0) {
+      view.scrollIntoView(
+        {
+          from: { line: ranges[0].from, ch: 0 },
+          to: { line: ranges[0].to, ch: 0 },
+        },
+        20
+      );
+    }
+  };
+
   // Refresh editor display
   readonly refresh = (): void => this.editor?.refresh();
 
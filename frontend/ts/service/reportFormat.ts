@@ -0,0 +1,158 @@
+/**
+ * ReportFormat - Turns strace and memcheck records into report lines
+ * Runs inside the report worker, or on the main thread where workers are
+ * unavailable
+ */
+import {
+  LeakCheckMode,
+  MemcheckFrame,
+  MemcheckRecord,
+  MemcheckSummary,
+  OutputRow,
+  ReportRequest,
+  SyscallRecord,
+  SyscallSummaryEntry,
+} from "../types";
+
+const LEAK_LABELS: Record<string, string> = {
+  Leak_DefinitelyLost: "Memory Leak",
+  Leak_IndirectlyLost: "Indirect Leak",
+  Leak_PossiblyLost: "Possible Leak",
+  Leak_StillReachable: "Still Reachable",
+};
+
+/**
+ * Format a streamed record the way strace prints it
+ * @param record Parsed strace record
+ */
+const formatSyscallRecord = (record: SyscallRecord): OutputRow => {
+  const pid = record.pid !== null ? `${record.pid}  ` : "";
+
+  if (record.kind === "signal") {
+    return {
+      text: `${pid}--- ${record.name} ${record.args} ---`,
+      tone: "warning",
+    };
+  }
+  if (record.kind === "exit") {
+    return { text: `${pid}+++ ${record.args} +++`, tone: "muted" };
+  }
+
+  const errno = record.errno ? ` ${record.errno}` : "";
+  const duration =
+    record.durationMs !== undefined
+      ? ` <${(record.durationMs / 1000).toFixed(6)}>`
+      : "";
+  return {
+    text: `${pid}${record.name}(${record.args}) = ${record.result}${errno}${duration}`,
+    tone: record.errno ? "error" : undefined,
+  };
+};
+
+/**
+ * Format syscall totals as an strace -c style table
+ * @param summary Per-syscall totals, most expensive first
+ */
+export const formatSyscallSummary = (
+  summary: SyscallSummaryEntry[]
+): string[] => {
+  const header = "% time     seconds  usecs/call     calls    errors syscall";
+  const rule = "------ ----------- ----------- --------- --------- ----------------";
+
+  const rows = summary.map((entry) =>
+    [
+      entry.percent.toFixed(2).padStart(6),
+      (entry.totalMs / 1000).toFixed(6).padStart(11),
+      Math.round((entry.totalMs * 1000) / entry.calls)
+        .toString()
+        .padStart(11),
+      entry.calls.toString().padStart(9),
+      (entry.errors ? entry.errors.toString() : "").padStart(9),
+      entry.name,
+    ].join(" ")
+  );
+
+  return [header, rule, ...rows];
+};
+
+/**
+ * Format a stack as "at fn (file:line)" lines
+ * @param stack Stack frames, innermost first
+ */
+const formatStack = (stack: MemcheckFrame[]): OutputRow[] =>
+  stack.map((frame) => {
+    const location = frame.file
+      ? `${frame.file}:${frame.line ?? "?"}`
+      : frame.obj || "???";
+    return { text: `    at ${frame.fn || "???"} (${location})` };
+  });
+
+/**
+ * Format a single memcheck record, followed by a blank line
+ * @param record Error or leak record
+ */
+const formatMemcheckRecord = (record: MemcheckRecord): OutputRow[] => {
+  const repeated = record.count > 1 ? ` (${record.count} times)` : "";
+  const label = LEAK_LABELS[record.kind];
+  // Definite leaks and memory errors are flagged in red
+  const flagged = record.kind === "Leak_DefinitelyLost" || !label;
+
+  return [
+    {
+      text: `${flagged ? "⚠ " : ""}${label || record.kind}: ${
+        record.message
+      }${repeated}`,
+      tone: flagged ? "error" : "warning",
+    },
+    ...formatStack(record.stack),
+    ...(record.auxMessage ? [{ text: `  ${record.auxMessage}` }] : []),
+    ...(record.auxStack ? formatStack(record.auxStack) : []),
+    { text: "" },
+  ];
+};
+
+/**
+ * Format the totals line of a memcheck run
+ * @param summary Run totals
+ * @param dropped Distinct records that were not sent
+ * @param mode Checker that produced the report
+ */
+const formatMemcheckSummary = (
+  summary: MemcheckSummary,
+  dropped: number,
+  mode: LeakCheckMode
+): OutputRow => {
+  const tool = mode === "asan" ? "AddressSanitizer" : "Valgrind";
+  const totals = [
+    `${summary.errors} errors`,
+    `definitely lost: ${summary.definitelyLost} bytes`,
+    `indirectly lost: ${summary.indirectlyLost} bytes`,
+    `possibly lost: ${summary.possiblyLost} bytes`,
+    `still reachable: ${summary.stillReachable} bytes`,
+  ].join(", ");
+  const text = `${tool}: ${totals}`;
+  const more = dropped > 0 ? ` (${dropped} more records not shown)` : "";
+
+  if (summary.errors > 0 || summary.definitelyLost > 0) {
+    return { text: `${text}${more}`, tone: "error" };
+  }
+  return { text: `✓ No leaks detected. ${text}${more}`, tone: "success" };
+};
+
+/**
+ * Turn the records of a request into report lines
+ * @param request Records to format
+ */
+export const formatReport = (request: ReportRequest): OutputRow[] => {
+  if (request.kind === "strace") {
+    return request.records.map(formatSyscallRecord);
+  }
+
+  const rows = request.records.flatMap(formatMemcheckRecord);
+  if (request.summary) {
+    rows.push(
+      formatMemcheckSummary(request.summary, request.dropped, request.mode)
+    );
+  }
+  return rows;
+};
@@ -0,0 +1,73 @@
+/**
+ * ReportService - Formats strace and memcheck records in a Web Worker
+ * Falls back to the main thread where the worker cannot be started
+ */
+import { OutputRow, ReportMessage, ReportRequest } from "../types";
+import { formatReport } from "./reportFormat";
+
+export class ReportService {
+  private worker: Worker | null = null;
+  private workerFailed = false;
+  private nextId = 0;
+  // Requests sent to the worker, kept to redo them if the worker fails
+  private readonly pending = new Map<
+    number,
+    { request: ReportRequest; resolve: (rows: OutputRow[]) => void }
+  >();
+
+  // Start the worker on first use
+  private readonly getWorker = (): Worker | null => {
+    if (this.worker || this.workerFailed) return this.worker;
+
+    try {
+      this.worker = new Worker(new URL("./reportWorker.ts", import.meta.url), {
+        type: "module",
+      });
+      this.worker.onmessage = (
+        event: MessageEvent<ReportMessage<OutputRow[]>>
+      ) => {
+        const pending = this.pending.get(event.data.id);
+        this.pending.delete(event.data.id);
+        pending?.resolve(event.data.body);
+      };
+      this.worker.onerror = (error) => {
+        console.error("Report worker failed:", error);
+        this.fallBack();
+      };
+    } catch (error) {
+      console.error("Error starting report worker:", error);
+      this.workerFailed = true;
+    }
+    return this.worker;
+  };
+
+  // Finish outstanding requests and further ones on the main thread
+  private readonly fallBack = (): void => {
+    this.worker?.terminate();
+    this.worker = null;
+    this.workerFailed = true;
+    this.pending.forEach(({ request, resolve }) =>
+      resolve(formatReport(request))
+    );
+    this.pending.clear();
+  };
+
+  /**
+   * Turn records into report lines; results arrive in request order
+   * @param request Records to format
+   */
+  readonly format = (request: ReportRequest): Promise<OutputRow[]> => {
+    const worker = this.getWorker();
+    if (!worker) return Promise.resolve(formatReport(request));
+
+    const id = this.nextId++;
+    return new Promise((resolve) => {
+      this.pending.set(id, { request, resolve });
+      const message: ReportMessage<ReportRequest> = { id, body: request };
+      worker.postMessage(message);
+    });
+  };
+}
+
+export const reportService = new ReportService();
+export default reportService;
@@ -0,0 +1,12 @@
+/**
+ * ReportWorker - Formats strace and memcheck records off the main thread,
+ * so that large traces do not stall rendering while they stream in
+ */
+import { OutputRow, ReportMessage, ReportRequest } from "../types";
+import { formatReport } from "./reportFormat";
+
+self.onmessage = (event: MessageEvent<ReportMessage<ReportRequest>>) => {
+  const { id, body } = event.data;
+  const response: ReportMessage<OutputRow[]> = { id, body: formatReport(body) };
+  self.postMessage(response);
+};
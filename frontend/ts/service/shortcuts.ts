@@ -27,6 +27,9 @@ const uiActions = {
   memoryCheck: () => clickElement(DomElementId.MEMORY_CHECK),
   debug: () => clickElement(DomElementId.DEBUG),
   syscallTrace: () => clickElement(DomElementId.SYSCALL),
+  benchmark: () => clickElement(DomElementId.BENCHMARK),
+  profile: () => clickElement(DomElementId.PROFILE),
+  matrix: () => clickElement(DomElementId.MATRIX),
   takeCodeSnapshot: () => clickElement(DomElementId.CODESNAP),
   closeOutputPanel: (): boolean => {
     const outputPanel = document.getElementById(DomElementId.OUTPUT_PANEL);
@@ -139,6 +142,9 @@ const createShortcuts = (): ShortcutCategories => {
     { action: uiActions.memoryCheck, description: "Memory check" },
     { action: uiActions.debug, description: "Debug with GDB" },
     { action: uiActions.syscallTrace, description: "Trace system calls" },
+    { action: uiActions.benchmark, description: "Benchmark" },
+    { action: uiActions.profile, description: "Profile" },
+    { action: uiActions.matrix, description: "Matrix run" },
   ];
   const mac: Record<string, ShortcutDefinition> = {},
     other: Record<string, ShortcutDefinition> = {};
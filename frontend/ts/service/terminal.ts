@@ -4,6 +4,48 @@ import { TerminalDomElements, TerminalOptions } from "../types";
 import { socketManager, SocketEvents } from "../ws/webSocketManager";
 import "@xterm/xterm/css/xterm.css";
 
+// Lines kept for scrolling back; older ones are dropped
+const SCROLLBACK_LINES = 10000;
+// Output waiting for the terminal beyond this is dropped, oldest first
+const MAX_PENDING_BYTES = 1024 * 1024;
+const SKIPPED_MESSAGE = "\x1b[0m\r\n\x1b[2m[... output skipped ...]\x1b[0m\r\n";
+
+type TerminalData = string | Uint8Array;
+
+/**
+ * Join consecutive chunks of the same kind, keeping their order
+ * @param chunks Strings and UTF-8 byte chunks
+ */
+const mergeChunks = (chunks: TerminalData[]): TerminalData[] => {
+  const merged: TerminalData[] = [];
+  let run: TerminalData[] = [];
+
+  const flushRun = () => {
+    if (run.length === 0) return;
+    if (typeof run[0] === "string") {
+      merged.push(run.join(""));
+    } else {
+      const bytes = new Uint8Array(
+        run.reduce((total, chunk) => total + chunk.length, 0)
+      );
+      run.reduce((offset, chunk) => {
+        bytes.set(chunk as Uint8Array, offset);
+        return offset + chunk.length;
+      }, 0);
+      merged.push(bytes);
+    }
+    run = [];
+  };
+
+  chunks.forEach((chunk) => {
+    if (run.length > 0 && typeof run[0] !== typeof chunk) flushRun();
+    run.push(chunk);
+  });
+  flushRun();
+
+  return merged;
+};
+
 export class TerminalService {
   private static instance: TerminalService;
 
@@ -12,6 +54,14 @@ export class TerminalService {
   private fitAddon: FitAddon | null = null;
   private domElements: TerminalDomElements = {};
 
+  // Output received since the last frame, written to the terminal at once
+  private pending: TerminalData[] = [];
+  private pendingBytes = 0;
+  private skipped = false;
+  private frame: number | null = null;
+  // Whether the terminal is still parsing the previous write
+  private writing = false;
+
   private constructor() {}
 
   static getInstance(): TerminalService {
@@ -44,6 +94,7 @@ export class TerminalService {
       allowTransparency: true,
       rendererType: "dom",
       convertEol: true,
+      scrollback: SCROLLBACK_LINES,
     } as const;
 
     // Create terminal instance
@@ -154,18 +205,75 @@ export class TerminalService {
     }
   };
 
-  // Write data to the terminal
-  readonly write = (data: string): void => {
-    this.terminal?.write(data);
+  // Queue data for the next frame; a program can print far faster than the
+  // terminal renders, so only the newest output is kept once it falls behind
+  private readonly enqueue = (data: TerminalData): void => {
+    if (!this.terminal || data.length === 0) return;
+
+    this.pending.push(data);
+    this.pendingBytes += data.length;
+    while (this.pendingBytes > MAX_PENDING_BYTES) {
+      const excess = this.pendingBytes - MAX_PENDING_BYTES;
+      const oldest = this.pending[0];
+      if (oldest.length > excess) {
+        this.pending[0] = oldest.slice(excess);
+        this.pendingBytes -= excess;
+      } else {
+        this.pending.shift();
+        this.pendingBytes -= oldest.length;
+      }
+      this.skipped = true;
+    }
+
+    this.scheduleFlush();
+  };
+
+  private readonly scheduleFlush = (): void => {
+    if (this.frame !== null || this.writing) return;
+    this.frame = requestAnimationFrame(this.flush);
+  };
+
+  // Write everything queued, then wait for the terminal to parse it
+  private readonly flush = (): void => {
+    this.frame = null;
+    const terminal = this.terminal;
+    if (!terminal || this.pending.length === 0) return;
+
+    const chunks = mergeChunks(this.pending);
+    if (this.skipped) chunks.unshift(SKIPPED_MESSAGE);
+    this.pending = [];
+    this.pendingBytes = 0;
+    this.skipped = false;
+
+    this.writing = true;
+    chunks.forEach((chunk, index) =>
+      terminal.write(
+        chunk,
+        index === chunks.length - 1
+          ? () => {
+              // A disposed terminal has nothing left to flush
+              if (this.terminal !== terminal) return;
+              this.writing = false;
+              if (this.pending.length > 0) this.scheduleFlush();
+            }
+          : undefined
+      )
+    );
+  };
+
+  // Write data to the terminal; program output arrives as raw UTF-8 bytes
+  readonly write = (data: string | Uint8Array): void => {
+    this.enqueue(data);
   };
 
   // Write error message to the terminal with
   readonly writeError = (message: string): void => {
-    this.terminal?.write(`\x1b[31m${message}\x1b[0m`);
+    this.enqueue(`\x1b[31m${message}\x1b[0m`);
   };
 
   // Write exit message with modern approach and constants
-  readonly writeExitMessage = (code: number): void => {
+  // killReason is set when the server stopped the program at a resource limit
+  readonly writeExitMessage = (code: number, killReason?: string): void => {
     if (!this.terminal) return;
 
     const COLORS = {
@@ -194,12 +302,31 @@ export class TerminalService {
       return `${COLORS.WARNING}${baseMessage}, may have errors]${COLORS.RESET}`;
     };
 
-    const exitMessage = `\r\n${getExitMessage(code)}\r\n`;
-    this.terminal.write(exitMessage);
+    const KILL_MESSAGES: Record<string, string> = {
+      timeout: "time limit exceeded",
+      memory: "memory limit exceeded",
+      cpu: "CPU time limit exceeded",
+      output: "output limit exceeded",
+    };
+
+    const exitMessage = killReason
+      ? `\r\n${COLORS.ERROR}[Program killed: ${
+          KILL_MESSAGES[killReason] || killReason
+        }]${COLORS.RESET}\r\n`
+      : `\r\n${getExitMessage(code)}\r\n`;
+    this.enqueue(exitMessage);
   };
 
   // Clean up terminal resources
   readonly dispose = (): void => {
+    // Drop output that was not written yet
+    if (this.frame !== null) cancelAnimationFrame(this.frame);
+    this.frame = null;
+    this.pending = [];
+    this.pendingBytes = 0;
+    this.skipped = false;
+    this.writing = false;
+
     // Clean up in reverse order of creation
     this.fitAddon?.dispose();
     this.terminal?.dispose();
@@ -23,12 +23,19 @@ export interface TemplateCache {
 // WebSocket & Compilation
 // ==========================================
 
+// A file of a multi-file workspace
+export interface WorkspaceFile {
+  name: string; // File name without directory, e.g. 'vec.hpp'
+  content: string;
+}
+
 // Compile options for code execution
 export interface CompileOptions {
   lang: string;
   compiler: string;
   optimization: string;
   code: string;
+  files?: WorkspaceFile[]; // Multi-file workspace, compiled instead of code
 }
 
 // WebSocket message structure
@@ -37,6 +44,201 @@ export interface WebSocketMessage {
   [key: string]: any;
 }
 
+// Leak check implementation: Valgrind (precise) or sanitizers (fast)
+export type LeakCheckMode = "valgrind" | "asan";
+
+// Stack frame of a memcheck record
+export interface MemcheckFrame {
+  fn?: string;
+  file?: string;
+  line?: number;
+  obj?: string;
+}
+
+// Memcheck error or leak, merged with identical ones
+export interface MemcheckRecord {
+  kind: string;
+  message: string;
+  bytes?: number;
+  blocks?: number;
+  stack: MemcheckFrame[];
+  auxMessage?: string;
+  auxStack?: MemcheckFrame[];
+  count: number;
+}
+
+// Totals of a memcheck run
+export interface MemcheckSummary {
+  errors: number;
+  definitelyLost: number;
+  indirectlyLost: number;
+  possiblyLost: number;
+  stillReachable: number;
+}
+
+// Compiler configuration of a benchmark
+export interface BenchmarkVariant {
+  compiler: string;
+  optimization: string;
+}
+
+// Wall time distribution of the timed runs, in milliseconds
+export interface BenchmarkTiming {
+  min: number;
+  median: number;
+  p95: number;
+  mean: number;
+  stddev: number;
+  launchOverhead: number;
+}
+
+// Hardware counters per run; null where unavailable
+export interface BenchmarkCounters {
+  cycles: number | null;
+  instructions: number | null;
+  ipc: number | null;
+  cacheMisses: number | null;
+  branchMisses: number | null;
+}
+
+// Timing of a section the program measured with "BENCH <name> <ns>" lines
+export interface BenchmarkSection {
+  name: string;
+  samples: number;
+  min: number;
+  median: number;
+  p95: number;
+  mean: number;
+  stddev: number;
+}
+
+// Result of benchmarking one variant
+export interface BenchmarkResult {
+  variant: BenchmarkVariant;
+  iterations: number;
+  timing: BenchmarkTiming | null;
+  counters: BenchmarkCounters | null;
+  sections: BenchmarkSection[];
+  cpu: number | null;
+  error?: string;
+}
+
+// Build configuration of a matrix run
+export interface MatrixConfig {
+  compiler: string;
+  optimization: string;
+  standard: string;
+}
+
+// One timed run of a program
+export interface ProgramRun {
+  ms: number;
+  exitCode: number | null;
+  signal: string | null;
+  outputHash: string; // Shortened SHA-256 of stdout
+  outputBytes: number;
+  error?: string;
+}
+
+// Outcome of one configuration of a matrix run
+export interface MatrixCell {
+  config: MatrixConfig;
+  cached: boolean; // Whole cell served from the server's result cache
+  buildCached: boolean; // Binary served from the build cache
+  compileMs: number;
+  binaryBytes: number | null; // null when compiling failed
+  run: ProgramRun | null; // null when compiling failed
+  error?: string; // Compiler output when compiling failed
+}
+
+// An optimizer report about a source line
+export interface OptimizationRemark {
+  line: number;
+  column: number;
+  kind: "passed" | "missed" | "analysis";
+  pass: string;
+  message: string;
+}
+
+// An instruction or jump target of a filtered assembly listing
+export interface AsmInstruction {
+  text: string;
+  line?: number;
+  label?: boolean;
+}
+
+// A function of a filtered assembly listing
+export interface AsmFunction {
+  name: string;
+  symbol: string;
+  instructions: AsmInstruction[];
+  instructionCount: number;
+  vectorCount: number;
+}
+
+// Rows of a function generated for one source line
+export interface AsmLineRange {
+  line: number;
+  function: number;
+  start: number;
+  end: number;
+}
+
+// Assembly listing split into functions and mapped to source lines
+export interface StructuredAssembly {
+  functions: AsmFunction[];
+  lineMap: AsmLineRange[];
+}
+
+// How a profile was sampled
+export type ProfilerMode = "perf" | "sampler";
+
+// A collapsed stack ("main;solve;step") and how often it was sampled
+export interface ProfileStack {
+  stack: string;
+  samples: number;
+}
+
+// A source line the CPU was sampled in
+export interface ProfileHotspot {
+  file: string;
+  line: number;
+  function: string;
+  samples: number;
+  percent: number;
+}
+
+// Sampling profile of a run
+export interface ProfileReport {
+  mode: ProfilerMode;
+  samples: number;
+  lost: number;
+  stacks: ProfileStack[];
+  dropped: number;
+  hotspots: ProfileHotspot[];
+  exitCode: number;
+}
+
+// Parsed strace log entry streamed during syscall tracing
+export interface SyscallRecord {
+  pid: number | null;
+  kind: "syscall" | "signal" | "exit";
+  name: string;
+  args: string;
+  result?: string;
+  errno?: string;
+  durationMs?: number;
+}
+
+// Per-syscall totals in the style of strace -c
+export interface SyscallSummaryEntry {
+  name: string;
+  calls: number;
+  errors: number;
+  totalMs: number;
+  percent: number;
+}
+
 // ==========================================
 // Terminal
 // ==========================================
@@ -56,6 +258,37 @@ export interface TerminalOptions {
   allowTransparency?: boolean;
   rendererType?: string;
   convertEol?: boolean;
+  scrollback?: number;
+}
+
+// ==========================================
+// Output View
+// ==========================================
+
+// Highlight of a report line
+export type OutputTone = "error" | "warning" | "success" | "muted";
+
+// A line of a virtualised report
+export interface OutputRow {
+  text: string;
+  tone?: OutputTone;
+}
+
+// Records the report worker turns into lines
+export type ReportRequest =
+  | { kind: "strace"; records: SyscallRecord[] }
+  | {
+      kind: "memcheck";
+      records: MemcheckRecord[];
+      summary: MemcheckSummary | null;
+      dropped: number;
+      mode: LeakCheckMode;
+    };
+
+// Message exchanged with the report worker
+export interface ReportMessage<T> {
+  id: number;
+  body: T;
 }
 
 // ==========================================
@@ -128,6 +361,9 @@ export enum DomElementId {
   MEMORY_CHECK = "memcheck",
   DEBUG = "debug",
   SYSCALL = "syscall",
+  BENCHMARK = "benchmark",
+  PROFILE = "profile",
+  MATRIX = "matrix",
   OUTPUT_PANEL = "outputPanel",
   LANGUAGE = "language",
   SHORTCUTS_CONTENT = "shortcuts-content",
@@ -18,12 +18,22 @@ const OPTIMIZATION_OPTIONS = [
   { value: "-O3", label: "-O3 (Maximum optimization)" },
   { value: "-Os", label: "-Os (Size optimization)" },
 ];
+const LEAK_MODE_OPTIONS = [
+  { value: "valgrind", label: "Precise (Valgrind)" },
+  { value: "asan", label: "Fast (ASan)" },
+];
+const REMARKS_OPTIONS = [
+  { value: "off", label: "No remarks" },
+  { value: "on", label: "Opt remarks" },
+];
 
 // Global selector state - Ready for React migration
 interface SelectorState {
   language: string;
   compiler: string;
   optimization: string;
+  leakMode: string;
+  remarks: string;
   template?: string;
   "theme-select"?: string;
 }
@@ -33,6 +43,8 @@ let globalSelectorState: SelectorState = {
   language: "c",
   compiler: "gcc",
   optimization: "-O0",
+  leakMode: "valgrind",
+  remarks: "off",
 };
 const stateChangeListeners: StateChangeListener[] = [];
 const subscribeToSelectorState = (listener: StateChangeListener) => {
@@ -110,6 +122,8 @@ const selectorHandlers: Record<string, (value: string) => void> = {
   },
   compiler: (value) => updateSelectorState("compiler", value),
   optimization: (value) => updateSelectorState("optimization", value),
+  leakMode: (value) => updateSelectorState("leakMode", value),
+  remarks: (value) => updateSelectorState("remarks", value),
   template: async (value) => {
     updateSelectorState("template", value);
     await loadAndSetTemplateContent(globalSelectorState.language, value);
@@ -142,7 +156,7 @@ const injectCustomSelectStyles = () => {
   style.id = "custom-select-styles";
   style.textContent = `
     select { appearance: none; background: var(--bg-primary); color: var(--text-primary); border: 2px solid var(--border); padding: 0 10px 0 8px; border-radius: var(--radius-sm); font: var(--font-xs) var(--font-mono); height: 28px; cursor: pointer; transition: all var(--transition-normal); text-overflow: ellipsis; white-space: nowrap; overflow: hidden; text-shadow: 0 1px 1px rgba(0,0,0,0.05); }
-    select#language { width: 55px; } select#compiler { width: 70px; } select#template { width: 140px; } select#optimization { width: 130px; }
+    select#language { width: 55px; } select#compiler { width: 70px; } select#template { width: 140px; } select#optimization { width: 130px; } select#leakMode { width: 140px; } select#remarks { width: 120px; }
     select:hover, select:focus { border-color: var(--accent); box-shadow: var(--shadow-accent-sm); outline: none; }
     select:hover { animation: selectHover var(--transition-normal); }
     select option { background: var(--bg-secondary); color: var(--text-primary); padding: 12px; font-family: var(--font-mono); }
@@ -235,6 +249,8 @@ export const initSelects = async () => {
   renderSelect("language", LANGUAGE_OPTIONS, "c");
   renderSelect("compiler", COMPILER_OPTIONS, "gcc");
   renderSelect("optimization", OPTIMIZATION_OPTIONS, "-O0");
+  renderSelect("leakMode", LEAK_MODE_OPTIONS, "valgrind");
+  renderSelect("remarks", REMARKS_OPTIONS, "off");
   renderThemeSelect();
   await renderTemplateSelect(globalSelectorState.language);
   initCustomSelects();
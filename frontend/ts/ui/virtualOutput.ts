@@ -0,0 +1,172 @@
+/**
+ * VirtualOutput - Scrollable view of long reports
+ * Only the rows in view are in the DOM, so a report of any length scrolls
+ * as smoothly as a short one; its lines are kept in a bounded ring buffer
+ */
+import { OutputRow } from "../types";
+
+// Rows rendered above and below the visible ones
+const OVERSCAN_ROWS = 20;
+const DEFAULT_ROW_HEIGHT = 18;
+
+/**
+ * Fixed-capacity buffer that drops its oldest items when full
+ */
+export class RingBuffer<T> {
+  private readonly items: T[] = [];
+  private readonly capacity: number;
+  private start = 0;
+  private droppedCount = 0;
+
+  /**
+   * Create an empty buffer
+   * @param capacity Maximum number of items kept
+   */
+  constructor(capacity: number) {
+    this.capacity = capacity;
+  }
+
+  /**
+   * Append items, dropping the oldest ones beyond the capacity
+   * @param items Items to append
+   */
+  push(items: T[]): void {
+    for (const item of items) {
+      if (this.items.length < this.capacity) {
+        this.items.push(item);
+      } else {
+        this.items[this.start] = item;
+        this.start = (this.start + 1) % this.capacity;
+        this.droppedCount++;
+      }
+    }
+  }
+
+  /**
+   * Get an item by its position, oldest first
+   * @param index Position in the buffer
+   */
+  get(index: number): T {
+    return this.items[(this.start + index) % this.items.length];
+  }
+
+  get length(): number {
+    return this.items.length;
+  }
+
+  // Items that were dropped to make room
+  get dropped(): number {
+    return this.droppedCount;
+  }
+}
+
+/**
+ * VirtualOutput renders the visible rows of a ring buffer
+ */
+export class VirtualOutput {
+  private readonly viewport: HTMLDivElement;
+  private readonly spacer: HTMLDivElement;
+  private readonly content: HTMLDivElement;
+  private readonly resizeObserver: ResizeObserver;
+  private readonly rows: RingBuffer<OutputRow>;
+  private rowHeight = DEFAULT_ROW_HEIGHT;
+  private frame: number | null = null;
+
+  /**
+   * Show the rows of a buffer in a container
+   * @param container Element the view fills
+   * @param rows Lines of the report
+   */
+  constructor(container: HTMLElement, rows: RingBuffer<OutputRow>) {
+    this.rows = rows;
+    this.viewport = Object.assign(document.createElement("div"), {
+      className: "virtual-output",
+    });
+    this.spacer = Object.assign(document.createElement("div"), {
+      className: "virtual-output-spacer",
+    });
+    this.content = Object.assign(document.createElement("div"), {
+      className: "virtual-output-content",
+    });
+    this.spacer.appendChild(this.content);
+    this.viewport.appendChild(this.spacer);
+    container.replaceChildren(this.viewport);
+
+    this.measureRowHeight();
+    this.viewport.addEventListener("scroll", this.scheduleRender, {
+      passive: true,
+    });
+    this.resizeObserver = new ResizeObserver(this.scheduleRender);
+    this.resizeObserver.observe(this.viewport);
+    this.render();
+  }
+
+  // Measure the height of a row with the current font
+  private readonly measureRowHeight = (): void => {
+    const probe = this.createRow();
+    probe.textContent = " ";
+    this.content.appendChild(probe);
+    this.rowHeight = probe.getBoundingClientRect().height || DEFAULT_ROW_HEIGHT;
+    probe.remove();
+  };
+
+  private readonly createRow = (): HTMLDivElement =>
+    Object.assign(document.createElement("div"), {
+      className: "virtual-output-row",
+    });
+
+  // Render at most once per animation frame
+  private readonly scheduleRender = (): void => {
+    if (this.frame !== null) return;
+    this.frame = requestAnimationFrame(() => {
+      this.frame = null;
+      // Removing the view resizes it, which ends up here
+      if (this.viewport.isConnected) this.render();
+      else this.dispose();
+    });
+  };
+
+  // Replace the rendered rows with the ones in view
+  private readonly render = (): void => {
+    const total = this.rows.length;
+    this.spacer.style.height = `${total * this.rowHeight}px`;
+
+    const first = Math.max(
+      0,
+      Math.floor(this.viewport.scrollTop / this.rowHeight) - OVERSCAN_ROWS
+    );
+    const last = Math.min(
+      total,
+      Math.ceil(
+        (this.viewport.scrollTop + this.viewport.clientHeight) /
+          this.rowHeight
+      ) + OVERSCAN_ROWS
+    );
+
+    // Reuse the row elements of the previous render
+    while (this.content.childElementCount < last - first) {
+      this.content.appendChild(this.createRow());
+    }
+    while (this.content.childElementCount > last - first) {
+      this.content.lastElementChild?.remove();
+    }
+
+    this.content.style.transform = `translateY(${first * this.rowHeight}px)`;
+    Array.from(this.content.children).forEach((element, offset) => {
+      const row = this.rows.get(first + offset);
+      element.textContent = row.text;
+      element.className = row.tone
+        ? `virtual-output-row tone-${row.tone}`
+        : "virtual-output-row";
+    });
+  };
+
+  // Stop observing a view that was replaced
+  private readonly dispose = (): void => {
+    if (this.frame !== null) cancelAnimationFrame(this.frame);
+    this.resizeObserver.disconnect();
+    this.viewport.removeEventListener("scroll", this.scheduleRender);
+  };
+}
+
+export default VirtualOutput;
@@ -0,0 +1,311 @@
+/**
+ * BenchmarkSocket - Module handling micro-benchmark Socket.IO communication
+ */
+import { BenchmarkResult, BenchmarkVariant, CompileOptions } from "../types";
+import { socketManager, SocketEvents } from "./webSocketManager";
+import { domUtils } from "../app";
+
+// Timed runs per variant
+const ITERATIONS = 20;
+const WARMUP = 3;
+
+/**
+ * Format a counter with a metric suffix
+ * @param value Counter value
+ */
+const formatCount = (value: number | null | undefined): string => {
+  if (value === null || value === undefined) return "-";
+  if (value >= 1e9) return `${(value / 1e9).toFixed(2)}G`;
+  if (value >= 1e6) return `${(value / 1e6).toFixed(2)}M`;
+  if (value >= 1e3) return `${(value / 1e3).toFixed(1)}K`;
+  return String(Math.round(value));
+};
+
+/**
+ * Format a duration in milliseconds
+ * @param ms Duration
+ */
+const formatMs = (ms: number): string =>
+  ms >= 100 ? ms.toFixed(0) : ms >= 10 ? ms.toFixed(1) : ms.toFixed(3);
+
+/**
+ * Label a variant, e.g. "gcc -O2"
+ * @param variant Compiler configuration
+ */
+const variantLabel = (variant: BenchmarkVariant): string =>
+  `${variant.compiler} ${variant.optimization}`;
+
+/**
+ * Escape text for insertion into HTML
+ * @param text Raw text
+ */
+const escapeHtml = (text: string): string =>
+  text
+    .replace(/&/g, "&amp;")
+    .replace(/</g, "&lt;")
+    .replace(/>/g, "&gt;")
+    .replace(/"/g, "&quot;");
+
+// Bar colors of the first and second variant in the section chart
+const VARIANT_COLORS = ["var(--accent)", "rgba(var(--accent-rgb), 0.45)"];
+
+/**
+ * Chart the median time of every self-timed section per variant
+ * Bars share one scale so sections can be compared with each other
+ * @param variants Benchmarked configurations
+ * @param results Results received so far
+ */
+const renderSections = (
+  variants: BenchmarkVariant[],
+  results: (BenchmarkResult | null)[]
+): string => {
+  const names: string[] = [];
+  results.forEach((result) =>
+    result?.sections?.forEach((section) => {
+      if (!names.includes(section.name)) names.push(section.name);
+    })
+  );
+  if (names.length === 0) return "";
+
+  const slowest = Math.max(
+    ...results.flatMap(
+      (result) => result?.sections?.map((section) => section.median) ?? []
+    )
+  );
+
+  const rows = names.map((name) => {
+    const bars = variants.map((variant, index) => {
+      const section = results[index]?.sections?.find((s) => s.name === name);
+      if (!section) return "";
+      const width = slowest > 0 ? (section.median / slowest) * 100 : 0;
+      return `<div style="display: flex; align-items: center; gap: 8px;" title="${variantLabel(
+        variant
+      )}: min ${formatMs(section.min)} ms, p95 ${formatMs(
+        section.p95
+      )} ms, ${section.samples} runs"><div style="height: 10px; width: ${Math.max(
+        width,
+        0.5
+      )}%; max-width: 70%; background: ${
+        VARIANT_COLORS[index % VARIANT_COLORS.length]
+      }; border-radius: 2px;"></div><span>${formatMs(
+        section.median
+      )} ms ± ${formatMs(section.stddev)}</span></div>`;
+    });
+    return `<div style="margin-top: 6px;"><div>${escapeHtml(
+      name
+    )}</div>${bars.join(
+      ""
+    )}</div>`;
+  });
+
+  const legend = variants
+    .map(
+      (variant, index) =>
+        `<span style="margin-right: 12px;"><span style="display: inline-block; width: 10px; height: 10px; background: ${
+          VARIANT_COLORS[index % VARIANT_COLORS.length]
+        }; border-radius: 2px;"></span> ${variantLabel(variant)}</span>`
+    )
+    .join("");
+
+  return `<div style="margin-top: 12px;"><div>Sections (median ms, shared scale) ${legend}</div>${rows.join(
+    ""
+  )}</div>`;
+};
+
+/**
+ * BenchmarkSocketManager handles the Socket.IO communication for benchmarks
+ */
+export class BenchmarkSocketManager {
+  private variants: BenchmarkVariant[] = [];
+  private results: (BenchmarkResult | null)[] = [];
+  private status = "";
+
+  constructor() {
+    this.setupEventListeners();
+  }
+
+  /**
+   * Render the results table and the current status
+   */
+  private render(): void {
+    const baseline = this.results[0]?.timing?.median;
+    const rows = this.variants.map((variant, index) => {
+      const result = this.results[index];
+      const timing = result?.timing;
+      const counters = result?.counters;
+      const speedup =
+        baseline && timing ? `${(baseline / timing.median).toFixed(2)}x` : "-";
+      const cells = timing
+        ? [
+            formatMs(timing.min),
+            formatMs(timing.median),
+            formatMs(timing.p95),
+            `${formatMs(timing.mean)} ± ${formatMs(timing.stddev)}`,
+            speedup,
+          ]
+        : ["-", "-", "-", "-", "-"];
+      const counterCells = [
+        formatCount(counters?.cycles),
+        formatCount(counters?.instructions),
+        counters?.ipc?.toFixed(2) ?? "-",
+        formatCount(counters?.cacheMisses),
+        formatCount(counters?.branchMisses),
+      ];
+      return `<tr><td>${variantLabel(variant)}</td>${[...cells, ...counterCells]
+        .map((cell) => `<td style="text-align: right;">${cell}</td>`)
+        .join("")}</tr>`;
+    });
+
+    const header = [
+      "Variant",
+      "min (ms)",
+      "median",
+      "p95",
+      "mean ± sd",
+      "speed",
+      "cycles",
+      "instr.",
+      "IPC",
+      "cache miss",
+      "branch miss",
+    ]
+      .map((title) => `<th style="padding: 2px 8px;">${title}</th>`)
+      .join("");
+
+    const notes = this.results
+      .filter((result): result is BenchmarkResult => !!result)
+      .map((result) => {
+        const pinned =
+          result.cpu !== null ? `pinned to CPU ${result.cpu}` : "not pinned";
+        const overhead = result.timing
+          ? `, launch overhead ${formatMs(result.timing.launchOverhead)} ms`
+          : "";
+        const error = result.error
+          ? ` — <span style="color: #FF5555;">${result.error}</span>`
+          : "";
+        return `<div>${variantLabel(result.variant)}: ${
+          result.iterations
+        } runs ${pinned}${overhead}${error}</div>`;
+      })
+      .join("");
+
+    domUtils.setOutput(
+      `<div class="bg-[var(--bg-secondary)] p-[var(--spacing-md)] font-[var(--font-mono)] leading-[1.5] rounded-[var(--radius-md)] border border-[var(--border)] shadow-[var(--shadow-sm)] mb-[var(--spacing-sm)] overflow-x-auto"><table style="border-collapse: collapse; white-space: nowrap;"><thead><tr>${header}</tr></thead><tbody>${rows.join(
+        ""
+      )}</tbody></table>${renderSections(
+        this.variants,
+        this.results
+      )}<div style="margin-top: 8px; opacity: 0.8;">${notes}</div>${
+        this.status ? `<div class="loading">${this.status}</div>` : ""
+      }</div>`
+    );
+  }
+
+  private setupEventListeners(): void {
+    socketManager.on(SocketEvents.BENCHMARK_COMPILING, (data) => {
+      if (socketManager.getSessionType() !== "benchmark") return;
+      const variant = this.variants[data.index];
+      this.status = data.queued
+        ? `Queued for a compile slot (position ${data.position})`
+        : `Compiling ${variant ? variantLabel(variant) : ""}...`;
+      this.render();
+    });
+
+    socketManager.on(SocketEvents.BENCHMARK_PROGRESS, (data) => {
+      if (socketManager.getSessionType() !== "benchmark") return;
+      const variant = this.variants[data.index];
+      const label = variant ? variantLabel(variant) : "";
+      this.status = data.queued
+        ? `Waiting for a benchmark CPU (position ${data.position})`
+        : `Running ${label}: ${data.completed}/${data.total}`;
+      this.render();
+    });
+
+    socketManager.on(SocketEvents.BENCHMARK_RESULT, (data) => {
+      if (socketManager.getSessionType() !== "benchmark") return;
+      this.results[data.index] = data.result;
+      this.status = "";
+      this.render();
+    });
+
+    socketManager.on(SocketEvents.BENCHMARK_COMPLETE, () => {
+      if (socketManager.getSessionType() !== "benchmark") return;
+      this.status = "";
+      this.render();
+      socketManager.disconnect();
+    });
+
+    socketManager.on(SocketEvents.BENCHMARK_ERROR, (data) => {
+      if (socketManager.getSessionType() !== "benchmark") return;
+      domUtils.showOutputPanel();
+      if (data.output) {
+        const variant = this.variants[data.index];
+        domUtils.setOutput(
+          `<div class="error-output" style="white-space: pre-wrap; overflow: visible;">Compilation Error${
+            variant ? ` (${variantLabel(variant)})` : ""
+          }:<br>${data.output}</div>`
+        );
+      } else {
+        domUtils.setOutput(
+          `<div class="error-output" style="white-space: pre-wrap; overflow: visible;">Error:<br>${data.message}</div>`
+        );
+      }
+      socketManager.disconnect();
+    });
+  }
+
+  /**
+   * Benchmark the selected configuration against the other compiler at the
+   * same optimization level
+   * @param options Compilation options including code, language, compiler, etc.
+   */
+  async startBenchmark(options: CompileOptions): Promise<void> {
+    if (options.code.trim() === "") {
+      domUtils.setOutput(
+        '<div class="error-output">Error: Code cannot be empty</div>'
+      );
+      return;
+    }
+
+    this.variants = [
+      { compiler: options.compiler, optimization: options.optimization },
+      {
+        compiler: options.compiler === "clang" ? "gcc" : "clang",
+        optimization: options.optimization,
+      },
+    ];
+    this.results = [];
+    this.status = "";
+
+    try {
+      domUtils.showOutputPanel();
+      domUtils.showLoadingInOutput("Connecting...");
+
+      await socketManager.connect();
+      socketManager.setSessionType("benchmark");
+
+      domUtils.showLoadingInOutput("Sending code for benchmarking...");
+
+      await socketManager.emit(SocketEvents.BENCHMARK, {
+        code: options.code,
+        lang: options.lang,
+        variants: this.variants,
+        iterations: ITERATIONS,
+        warmup: WARMUP,
+      });
+    } catch (error) {
+      console.error("Socket operation failed:", error);
+      domUtils.setOutput(
+        '<div class="error-output">Error: Socket connection failed. Please try again.</div>'
+      );
+
+      try {
+        socketManager.disconnect();
+      } catch (e) {
+        console.error("Error disconnecting after failure:", e);
+      }
+    }
+  }
+}
+
+export default BenchmarkSocketManager;
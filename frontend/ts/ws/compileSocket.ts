@@ -2,7 +2,8 @@
  * CompileSocket - Module handling compilation-related Socket.IO communication
  */
 import { getTerminalService } from "../service/terminal";
-import { CompileOptions } from "../types";
+import { getEditorService } from "../service/editor";
+import { CompileOptions, OptimizationRemark } from "../types";
 import { socketManager, SocketEvents } from "./webSocketManager";
 import { domUtils } from "../app";
 
@@ -10,19 +11,30 @@ import { domUtils } from "../app";
  * CompileSocketManager handles the Socket.IO communication for code compilation
  */
 export class CompileSocketManager {
+  // Issued by the server so it can keep the object files of the workspace
+  // between runs; sent back with the next run
+  private workspaceId: string | undefined;
+
   constructor() {
     this.setupEventListeners();
   }
 
   private setupEventListeners(): void {
     // Handle compilation events
-    socketManager.on(SocketEvents.COMPILING, () => {
+    socketManager.on(SocketEvents.COMPILING, (data) => {
       if (socketManager.getSessionType() !== "compilation") return;
+      if (data?.workspaceId) this.workspaceId = data.workspaceId;
       domUtils.showOutputPanel();
-      domUtils.showLoadingInOutput("Compiling");
+      domUtils.showCompilingInOutput("Compiling", data);
     });
 
-    socketManager.on(SocketEvents.COMPILE_SUCCESS, () => {
+    socketManager.on(SocketEvents.COMPILE_SUCCESS, (data) => {
+      // Annotate the lines the optimizer reported on
+      const remarks: OptimizationRemark[] | undefined = data?.remarks;
+      if (remarks) {
+        getEditorService().showRemarks(remarks);
+      }
+
       // Reset any existing terminal first
       const terminalService = getTerminalService();
       terminalService.dispose();
@@ -38,6 +50,20 @@ export class CompileSocketManager {
       terminalService.setupTerminal();
     });
 
+    // Diagnostics stream in while the compiler is still running
+    socketManager.on(SocketEvents.COMPILE_DIAGNOSTIC, (data) => {
+      if (socketManager.getSessionType() !== "compilation") return;
+
+      let container = document.getElementById("compile-diagnostics");
+      if (!container) {
+        domUtils.setOutput(
+          `<div id="compile-diagnostics" class="error-output" style="white-space: pre-wrap; overflow: visible;">Compiler output:<br></div>`
+        );
+        container = document.getElementById("compile-diagnostics");
+      }
+      container?.insertAdjacentHTML("beforeend", `${data.html}\n`);
+    });
+
     socketManager.on(SocketEvents.COMPILE_ERROR, (data) => {
       domUtils.showOutputPanel();
       domUtils.setOutput(
@@ -67,7 +93,7 @@ export class CompileSocketManager {
     socketManager.on(SocketEvents.EXIT, (data) => {
       // Display the exit message
       const terminalService = getTerminalService();
-      terminalService.writeExitMessage(data.code);
+      terminalService.writeExitMessage(data.code, data.stats?.killReason);
       socketManager.disconnect();
     });
   }
@@ -75,15 +101,18 @@ export class CompileSocketManager {
   /**
    * Compile code using Socket.IO communication
    * @param options Compilation options including code, language, compiler, etc.
+   * @param remarks Annotate the editor with vectorization and inlining remarks
    */
-  async compile(options: CompileOptions): Promise<void> {
-    if (options.code.trim() === "") {
+  async compile(options: CompileOptions, remarks = false): Promise<void> {
+    if (!options.files && options.code.trim() === "") {
       domUtils.setOutput(
         '<div class="error-output">Error: Code cannot be empty</div>'
       );
       return;
     }
 
+    getEditorService().clearRemarks();
+
     try {
       domUtils.showOutputPanel();
       domUtils.showLoadingInOutput("Connecting...");
@@ -100,6 +129,11 @@ export class CompileSocketManager {
         lang: options.lang,
         compiler: options.compiler,
         optimization: options.optimization,
+        remarks,
+        ...(options.files && {
+          files: options.files,
+          workspaceId: this.workspaceId,
+        }),
       });
     } catch (error) {
       console.error("Socket operation failed:", error);
@@ -16,10 +16,10 @@ export class DebugSocketManager {
 
   private setupEventListeners(): void {
     // Handle compilation events
-    socketManager.on(SocketEvents.COMPILING, () => {
+    socketManager.on(SocketEvents.COMPILING, (data) => {
       if (socketManager.getSessionType() !== "debug") return;
       domUtils.showOutputPanel();
-      domUtils.showLoadingInOutput("Compiling for debug...");
+      domUtils.showCompilingInOutput("Compiling for debug...", data);
     });
 
     // Handle debugging events
@@ -68,7 +68,7 @@ export class DebugSocketManager {
     socketManager.on(SocketEvents.DEBUG_EXIT, (data) => {
       // Display the exit message
       const terminalService = getTerminalService();
-      terminalService.writeExitMessage(data.code);
+      terminalService.writeExitMessage(data.code, data.stats?.killReason);
       socketManager.disconnect();
     });
 
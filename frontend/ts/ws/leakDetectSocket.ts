@@ -2,7 +2,14 @@
  * LeakDetectSocket - Module handling memory leak detection Socket.IO communication
  */
 import { getTerminalService } from "../service/terminal";
-import { CompileOptions } from "../types";
+import { reportService } from "../service/reportService";
+import { RingBuffer, VirtualOutput } from "../ui/virtualOutput";
+import {
+  CompileOptions,
+  LeakCheckMode,
+  MemcheckRecord,
+  OutputRow,
+} from "../types";
 import { socketManager, SocketEvents } from "./webSocketManager";
 import { domUtils } from "../app";
 
@@ -16,10 +23,10 @@ export class LeakDetectSocketManager {
 
   private setupEventListeners(): void {
     // Handle compilation phase
-    socketManager.on(SocketEvents.LEAK_CHECK_COMPILING, () => {
+    socketManager.on(SocketEvents.LEAK_CHECK_COMPILING, (data) => {
       if (socketManager.getSessionType() !== "leak_detection") return;
       domUtils.showOutputPanel();
-      domUtils.showLoadingInOutput("Compiling for leak detection...");
+      domUtils.showCompilingInOutput("Compiling for leak detection...", data);
     });
 
     // Handle leak detection running phase
@@ -40,17 +47,31 @@ export class LeakDetectSocketManager {
     });
 
     // Handle leak detection report
-    socketManager.on(SocketEvents.LEAK_CHECK_REPORT, (data) => {
+    socketManager.on(SocketEvents.LEAK_CHECK_REPORT, async (data) => {
       domUtils.showOutputPanel();
+      socketManager.disconnect();
 
-      // Display the report using domUtils.setOutput
-      domUtils.setOutput(
-        `<div class="bg-[var(--bg-secondary)] p-[var(--spacing-md)] font-[var(--font-mono)] leading-[1.5] whitespace-pre-wrap rounded-[var(--radius-md)] border border-[var(--border)] shadow-[var(--shadow-sm)] mb-[var(--spacing-sm)]">${
-          data.report || "No leaks detected."
-        }</div>`
-      );
+      // Render the parsed records, followed by the run totals; the lines
+      // are built in the report worker and only visible ones are rendered
+      const records: MemcheckRecord[] = data.records || [];
+      const lines = await reportService.format({
+        kind: "memcheck",
+        records,
+        summary: data.summary ?? null,
+        dropped: data.dropped || 0,
+        mode: data.mode,
+      });
 
-      socketManager.disconnect();
+      const output = document.getElementById("output");
+      if (!output) return;
+      if (lines.length === 0) {
+        domUtils.setOutput("No leaks detected.");
+        return;
+      }
+
+      const rows = new RingBuffer<OutputRow>(lines.length);
+      rows.push(lines);
+      new VirtualOutput(output, rows);
     });
 
     // Handle leak detection errors
@@ -91,8 +112,12 @@ export class LeakDetectSocketManager {
   /**
    * Start leak detection using Socket.IO communication
    * @param options Compilation options including code, language, compiler, etc.
+   * @param mode Precise Valgrind check or fast sanitizer check
    */
-  async startLeakDetection(options: CompileOptions): Promise<void> {
+  async startLeakDetection(
+    options: CompileOptions,
+    mode: LeakCheckMode = "valgrind"
+  ): Promise<void> {
     if (options.code.trim() === "") {
       domUtils.setOutput(
         '<div class="error-output">Error: Code cannot be empty</div>'
@@ -116,6 +141,7 @@ export class LeakDetectSocketManager {
         lang: options.lang,
         compiler: options.compiler,
         optimization: options.optimization,
+        mode,
       });
     } catch (error) {
       console.error("Socket operation failed:", error);
@@ -0,0 +1,250 @@
+/**
+ * MatrixSocket - Module handling matrix run Socket.IO communication
+ * Builds the code with every selected compiler configuration, runs each
+ * build once and compares them in one table
+ */
+import { CompileOptions, MatrixCell, MatrixConfig } from "../types";
+import { socketManager, SocketEvents } from "./webSocketManager";
+import { domUtils } from "../app";
+
+// Optimization levels compared besides the selected one
+const OPTIMIZATIONS = ["-O0", "-O2", "-O3"];
+const COMPILERS = ["gcc", "clang"];
+
+/**
+ * Format a duration in milliseconds
+ * @param ms Duration
+ */
+const formatMs = (ms: number): string =>
+  ms >= 100 ? ms.toFixed(0) : ms >= 10 ? ms.toFixed(1) : ms.toFixed(3);
+
+/**
+ * Format a size in bytes
+ * @param bytes Size
+ */
+const formatBytes = (bytes: number | null): string => {
+  if (bytes === null) return "-";
+  if (bytes >= 1024 * 1024) return `${(bytes / 1024 / 1024).toFixed(2)} MB`;
+  if (bytes >= 1024) return `${(bytes / 1024).toFixed(1)} KB`;
+  return `${bytes} B`;
+};
+
+/**
+ * Label a configuration, e.g. "gcc -O2 -std=c++20"
+ * @param config Build configuration
+ */
+const configLabel = (config: MatrixConfig): string =>
+  `${config.compiler} ${config.optimization} ${config.standard}`;
+
+/**
+ * Escape text for insertion into HTML
+ * @param text Raw text
+ */
+const escapeHtml = (text: string): string =>
+  text
+    .replace(/&/g, "&amp;")
+    .replace(/</g, "&lt;")
+    .replace(/>/g, "&gt;")
+    .replace(/"/g, "&quot;");
+
+/**
+ * Find the output most builds agree on
+ * @param cells Cells received so far
+ */
+const commonOutput = (cells: (MatrixCell | null)[]): string | null => {
+  const counts = new Map<string, number>();
+  cells.forEach((cell) => {
+    const hash = cell?.run?.outputHash;
+    if (hash) counts.set(hash, (counts.get(hash) ?? 0) + 1);
+  });
+  let common: string | null = null;
+  counts.forEach((count, hash) => {
+    if (common === null || count > counts.get(common)!) common = hash;
+  });
+  return common;
+};
+
+/**
+ * MatrixSocketManager handles the Socket.IO communication for matrix runs
+ */
+export class MatrixSocketManager {
+  private cells: (MatrixCell | null)[] = [];
+  private total = 0;
+  private skipped = 0; // Configurations beyond the server's limit
+
+  constructor() {
+    this.setupEventListeners();
+  }
+
+  /**
+   * Render the comparison table; cells that have not finished are pending
+   * @param done Whether every cell has been received
+   */
+  private render(done: boolean): void {
+    const common = commonOutput(this.cells);
+    const fastest = Math.min(
+      ...this.cells.map((cell) =>
+        cell?.run && !cell.run.error ? cell.run.ms : Infinity
+      )
+    );
+
+    const rows = Array.from({ length: this.total }, (_, index) => {
+      const cell = this.cells[index];
+      if (!cell) {
+        return `<tr><td colspan="6" style="opacity: 0.6;">Running...</td></tr>`;
+      }
+
+      const compile = `${formatMs(cell.compileMs)}${
+        cell.cached ? " (cached)" : cell.buildCached ? " (build cached)" : ""
+      }`;
+      const run = cell.run;
+      const differs = run && common !== null && run.outputHash !== common;
+      const values = run
+        ? [
+            compile,
+            formatBytes(cell.binaryBytes),
+            `${formatMs(run.ms)}${
+              run.ms === fastest && this.total > 1 ? " ★" : ""
+            }`,
+            run.signal ?? String(run.exitCode ?? "-"),
+            `<span style="${
+              differs ? "color: #FF5555;" : ""
+            }" title="${run.outputBytes} bytes of output">${
+              run.outputHash || "-"
+            }</span>`,
+          ]
+        : [compile, "-", "-", "-", "-"];
+
+      const label = escapeHtml(configLabel(cell.config));
+      const error = cell.error ?? run?.error;
+      return `<tr${
+        error ? ` title="${escapeHtml(error)}"` : ""
+      }><td style="padding: 2px 8px;${
+        error ? " color: #FF5555;" : ""
+      }">${label}</td>${values
+        .map(
+          (value) =>
+            `<td style="padding: 2px 8px; text-align: right;">${value}</td>`
+        )
+        .join("")}</tr>`;
+    });
+
+    const header = [
+      "Configuration",
+      "compile (ms)",
+      "binary",
+      "run (ms)",
+      "exit",
+      "output",
+    ]
+      .map((title) => `<th style="padding: 2px 8px;">${title}</th>`)
+      .join("");
+
+    const failed = this.cells.filter((cell) => cell?.error);
+    const notes = failed
+      .map(
+        (cell) =>
+          `<div><span style="color: #FF5555;">${escapeHtml(
+            configLabel(cell!.config)
+          )}</span>: compilation failed</div>`
+      )
+      .join("");
+    const mismatch =
+      common !== null &&
+      this.cells.some((cell) => cell?.run && cell.run.outputHash !== common)
+        ? `<div style="color: #FF5555;">Builds disagree on the program output</div>`
+        : "";
+    const limited =
+      this.skipped > 0
+        ? `<div>${this.skipped} more configuration${
+            this.skipped === 1 ? " was" : "s were"
+          } not run: the matrix is limited to ${this.total} builds</div>`
+        : "";
+
+    domUtils.setOutput(
+      `<div class="bg-[var(--bg-secondary)] p-[var(--spacing-md)] font-[var(--font-mono)] leading-[1.5] rounded-[var(--radius-md)] border border-[var(--border)] shadow-[var(--shadow-sm)] mb-[var(--spacing-sm)] overflow-x-auto"><table style="border-collapse: collapse; white-space: nowrap;"><thead><tr>${header}</tr></thead><tbody>${rows.join(
+        ""
+      )}</tbody></table><div style="margin-top: 8px; opacity: 0.8;">${mismatch}${notes}${limited}</div>${
+        done ? "" : `<div class="loading">Building and running...</div>`
+      }</div>`
+    );
+  }
+
+  private setupEventListeners(): void {
+    socketManager.on(SocketEvents.MATRIX_CELL, (data) => {
+      if (socketManager.getSessionType() !== "matrix") return;
+      this.total = data.total;
+      this.skipped = data.skipped ?? 0;
+      this.cells[data.index] = data.cell;
+      this.render(false);
+    });
+
+    socketManager.on(SocketEvents.MATRIX_COMPLETE, (data) => {
+      if (socketManager.getSessionType() !== "matrix") return;
+      this.cells = data.cells;
+      this.total = data.cells.length;
+      this.skipped = data.skipped ?? 0;
+      this.render(true);
+      socketManager.disconnect();
+    });
+
+    socketManager.on(SocketEvents.MATRIX_ERROR, (data) => {
+      if (socketManager.getSessionType() !== "matrix") return;
+      domUtils.showOutputPanel();
+      domUtils.setOutput(
+        `<div class="error-output" style="white-space: pre-wrap; overflow: visible;">Error:<br>${escapeHtml(
+          String(data.message)
+        )}</div>`
+      );
+      socketManager.disconnect();
+    });
+  }
+
+  /**
+   * Build and run the code with both compilers at several optimization
+   * levels, including the selected one
+   * @param options Compilation options including code, language, compiler, etc.
+   */
+  async startMatrix(options: CompileOptions): Promise<void> {
+    if (options.code.trim() === "") {
+      domUtils.setOutput(
+        '<div class="error-output">Error: Code cannot be empty</div>'
+      );
+      return;
+    }
+
+    this.cells = [];
+    this.total = 0;
+    this.skipped = 0;
+
+    try {
+      domUtils.showOutputPanel();
+      domUtils.showLoadingInOutput("Connecting...");
+
+      await socketManager.connect();
+      socketManager.setSessionType("matrix");
+
+      domUtils.showLoadingInOutput("Sending code for a matrix run...");
+
+      await socketManager.emit(SocketEvents.MATRIX_RUN, {
+        code: options.code,
+        lang: options.lang,
+        compilers: COMPILERS,
+        optimizations: [...new Set([...OPTIMIZATIONS, options.optimization])],
+      });
+    } catch (error) {
+      console.error("Socket operation failed:", error);
+      domUtils.setOutput(
+        '<div class="error-output">Error: Socket connection failed. Please try again.</div>'
+      );
+
+      try {
+        socketManager.disconnect();
+      } catch (e) {
+        console.error("Error disconnecting after failure:", e);
+      }
+    }
+  }
+}
+
+export default MatrixSocketManager;
@@ -0,0 +1,308 @@
+/**
+ * ProfileSocket - Module handling sampling profiler Socket.IO communication
+ */
+import { getTerminalService } from "../service/terminal";
+import { getEditorService } from "../service/editor";
+import {
+  CompileOptions,
+  ProfileHotspot,
+  ProfileReport,
+  ProfileStack,
+} from "../types";
+import { socketManager, SocketEvents } from "./webSocketManager";
+import { domUtils } from "../app";
+
+// Height of a flame graph row in pixels
+const ROW_HEIGHT = 18;
+// Frames narrower than this share of all samples are not drawn
+const MIN_FRAME_SHARE = 0.002;
+// Hotspots listed below the flame graph
+const MAX_HOTSPOT_ROWS = 15;
+
+/**
+ * Node of the merged call tree
+ */
+interface FlameNode {
+  name: string;
+  samples: number;
+  children: Map<string, FlameNode>;
+}
+
+/**
+ * Escape text for insertion into HTML
+ * @param text Raw text
+ */
+const escapeHtml = (text: string): string =>
+  text
+    .replace(/&/g, "&amp;")
+    .replace(/</g, "&lt;")
+    .replace(/>/g, "&gt;")
+    .replace(/"/g, "&quot;");
+
+/**
+ * Merge collapsed stacks into a call tree
+ * @param stacks Collapsed stacks, outermost function first
+ */
+const buildTree = (stacks: ProfileStack[]): FlameNode => {
+  const root: FlameNode = { name: "all", samples: 0, children: new Map() };
+  stacks.forEach(({ stack, samples }) => {
+    root.samples += samples;
+    let node = root;
+    stack.split(";").forEach((name) => {
+      let child = node.children.get(name);
+      if (!child) {
+        child = { name, samples: 0, children: new Map() };
+        node.children.set(name, child);
+      }
+      child.samples += samples;
+      node = child;
+    });
+  });
+  return root;
+};
+
+/**
+ * Warm color for a frame, stable per function name
+ * Library frames ("[libc.so.6]") and unknown frames are drawn grey
+ * @param name Function name
+ */
+const frameColor = (name: string): string => {
+  if (name.startsWith("[")) return "hsl(0, 0%, 72%)";
+  let hash = 0;
+  for (let i = 0; i < name.length; i++) {
+    hash = (hash * 31 + name.charCodeAt(i)) | 0;
+  }
+  const hue = Math.abs(hash) % 50; // Red to orange
+  return `hsl(${hue}, 85%, ${58 + (Math.abs(hash >> 8) % 12)}%)`;
+};
+
+/**
+ * Render the call tree as a flame graph of positioned boxes
+ * @param root Call tree
+ */
+const renderFlameGraph = (root: FlameNode): string => {
+  const frames: string[] = [];
+  let maxDepth = 0;
+
+  const visit = (node: FlameNode, depth: number, offset: number): void => {
+    const share = node.samples / root.samples;
+    if (share < MIN_FRAME_SHARE) return;
+    maxDepth = Math.max(maxDepth, depth);
+
+    const percent = (share * 100).toFixed(2);
+    const title = `${node.name} (${node.samples} samples, ${percent}%)`;
+    frames.push(
+      `<div class="flame-frame" style="left: ${
+        offset * 100
+      }%; width: ${share * 100}%; bottom: ${
+        depth * ROW_HEIGHT
+      }px; background: ${frameColor(node.name)};" title="${escapeHtml(
+        title
+      )}">${escapeHtml(node.name)}</div>`
+    );
+
+    // Children are laid out left to right, most sampled first
+    let childOffset = offset;
+    Array.from(node.children.values())
+      .sort((a, b) => b.samples - a.samples)
+      .forEach((child) => {
+        visit(child, depth + 1, childOffset);
+        childOffset += child.samples / root.samples;
+      });
+  };
+  visit(root, 0, 0);
+
+  return `<div class="flame-graph" style="height: ${
+    (maxDepth + 1) * ROW_HEIGHT
+  }px;">${frames.join("")}</div>`;
+};
+
+/**
+ * Render the hottest source lines as a clickable table
+ * @param hotspots Hotspots, most sampled first
+ */
+const renderHotspots = (hotspots: ProfileHotspot[]): string => {
+  if (hotspots.length === 0) {
+    return '<div style="margin-top: 8px; opacity: 0.8;">No samples were taken in the program\'s own source lines.</div>';
+  }
+
+  const rows = hotspots
+    .slice(0, MAX_HOTSPOT_ROWS)
+    .map(
+      (hotspot) =>
+        `<tr class="profile-hotspot" data-line="${
+          hotspot.line
+        }"><td style="text-align: right; padding: 2px 8px;">${hotspot.percent.toFixed(
+          1
+        )}%</td><td style="padding: 2px 8px;">line <span class="line-number">${
+          hotspot.line
+        }</span></td><td style="padding: 2px 8px;">${escapeHtml(
+          hotspot.function
+        )}</td></tr>`
+    )
+    .join("");
+  return `<table style="border-collapse: collapse; margin-top: 10px; white-space: nowrap;"><thead><tr><th style="padding: 2px 8px;">samples</th><th style="padding: 2px 8px;">source</th><th style="padding: 2px 8px;">function</th></tr></thead><tbody>${rows}</tbody></table>`;
+};
+
+/**
+ * ProfileSocketManager handles the Socket.IO communication for profiling
+ */
+export class ProfileSocketManager {
+  constructor() {
+    this.setupEventListeners();
+  }
+
+  /**
+   * Render a profile report and mark its hotspots in the editor
+   * @param report Profile report
+   */
+  private renderReport(report: ProfileReport): void {
+    const tool = report.mode === "perf" ? "perf" : "built-in sampler";
+    const notes = [
+      `${report.samples} samples (${tool})`,
+      report.lost > 0 ? `${report.lost} samples lost` : "",
+      report.dropped > 0
+        ? `${report.dropped} samples in rare stacks not shown`
+        : "",
+      report.exitCode !== 0 ? `program exited with code ${report.exitCode}` : "",
+    ]
+      .filter(Boolean)
+      .join(", ");
+
+    const graph =
+      report.samples > 0
+        ? renderFlameGraph(buildTree(report.stacks))
+        : '<div style="opacity: 0.8;">No samples were taken; the program may have finished too quickly.</div>';
+
+    domUtils.setOutput(
+      `<div class="bg-[var(--bg-secondary)] p-[var(--spacing-md)] font-[var(--font-mono)] leading-[1.5] rounded-[var(--radius-md)] border border-[var(--border)] shadow-[var(--shadow-sm)] mb-[var(--spacing-sm)] overflow-x-auto" style="white-space: normal;"><div style="margin-bottom: 8px; opacity: 0.8;">${notes}</div>${graph}${renderHotspots(
+        report.hotspots
+      )}</div>`
+    );
+
+    // Only lines of the edited file can be shown in the editor
+    const editorService = getEditorService();
+    const ownLines = report.hotspots.filter((hotspot) =>
+      hotspot.file.startsWith("program.")
+    );
+    editorService.highlightHotLines(
+      ownLines.slice(0, MAX_HOTSPOT_ROWS).map((hotspot, index) => ({
+        line: hotspot.line,
+        tier: index < 3 ? 1 : index < 8 ? 2 : 3,
+      }))
+    );
+
+    // Jump to a hotspot when its row is clicked
+    document
+      .querySelectorAll<HTMLElement>("#output .profile-hotspot")
+      .forEach((row) => {
+        row.addEventListener("click", () => {
+          const line = parseInt(row.dataset.line || "", 10);
+          if (!isNaN(line)) {
+            editorService.setCursor({ line: line - 1, ch: 0 });
+            editorService.getEditor()?.focus();
+          }
+        });
+      });
+  }
+
+  private setupEventListeners(): void {
+    // Handle compilation phase
+    socketManager.on(SocketEvents.PROFILE_COMPILING, (data) => {
+      if (socketManager.getSessionType() !== "profile") return;
+      domUtils.showOutputPanel();
+      domUtils.showCompilingInOutput("Compiling for profiling...", data);
+    });
+
+    // The program runs interactively in a terminal until it exits
+    socketManager.on(SocketEvents.PROFILE_RUNNING, () => {
+      if (socketManager.getSessionType() !== "profile") return;
+      const terminalService = getTerminalService();
+      terminalService.dispose();
+      domUtils.showOutputPanel();
+
+      terminalService.setDomElements({
+        output: document.getElementById("output"),
+        outputPanel: document.getElementById("outputPanel"),
+      });
+      terminalService.setupTerminal();
+    });
+
+    socketManager.on(SocketEvents.PROFILE_REPORT, (data: ProfileReport) => {
+      if (socketManager.getSessionType() !== "profile") return;
+      domUtils.showOutputPanel();
+
+      // The report replaces the terminal
+      getTerminalService().dispose();
+      this.renderReport(data);
+      socketManager.disconnect();
+    });
+
+    socketManager.on(SocketEvents.PROFILE_ERROR, (data) => {
+      if (socketManager.getSessionType() !== "profile") return;
+      domUtils.showOutputPanel();
+      if (data.output) {
+        domUtils.setOutput(
+          `<div class="error-output" style="white-space: pre-wrap; overflow: visible;">Compilation Error:<br>${data.output}</div>`
+        );
+      } else if (data.message) {
+        domUtils.setOutput(
+          `<div class="error-output" style="white-space: pre-wrap; overflow: visible;">Error:<br>${data.message}</div>`
+        );
+      }
+      socketManager.disconnect();
+    });
+
+    // Handle program output while profiling
+    socketManager.on(SocketEvents.OUTPUT, (data) => {
+      if (socketManager.getSessionType() === "profile") {
+        getTerminalService().write(data.output);
+      }
+    });
+  }
+
+  /**
+   * Profile a run of the program using Socket.IO communication
+   * @param options Compilation options including code, language, compiler, etc.
+   */
+  async startProfile(options: CompileOptions): Promise<void> {
+    if (options.code.trim() === "") {
+      domUtils.setOutput(
+        '<div class="error-output">Error: Code cannot be empty</div>'
+      );
+      return;
+    }
+
+    getEditorService().clearHotLines();
+
+    try {
+      domUtils.showOutputPanel();
+      domUtils.showLoadingInOutput("Connecting...");
+
+      await socketManager.connect();
+      socketManager.setSessionType("profile");
+
+      domUtils.showLoadingInOutput("Sending code for profiling...");
+
+      await socketManager.emit(SocketEvents.PROFILE, {
+        code: options.code,
+        lang: options.lang,
+        compiler: options.compiler,
+        optimization: options.optimization,
+      });
+    } catch (error) {
+      console.error("Socket operation failed:", error);
+      domUtils.setOutput(
+        '<div class="error-output">Error: Socket connection failed. Please try again.</div>'
+      );
+
+      try {
+        socketManager.disconnect();
+      } catch (e) {
+        console.error("Error disconnecting after failure:", e);
+      }
+    }
+  }
+}
+
+export default ProfileSocketManager;
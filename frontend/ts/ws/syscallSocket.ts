@@ -2,29 +2,81 @@
  * SyscallSocket - Module handling strace system call tracing Socket.IO communication
  */
 import { getTerminalService } from "../service/terminal";
-import { getEditorService } from "../service/editor";
-import { CompileOptions } from "../types";
+import { reportService } from "../service/reportService";
+import { formatSyscallSummary } from "../service/reportFormat";
+import { RingBuffer, VirtualOutput } from "../ui/virtualOutput";
+import {
+  CompileOptions,
+  OutputRow,
+  SyscallRecord,
+  SyscallSummaryEntry,
+} from "../types";
 import { socketManager, SocketEvents } from "./webSocketManager";
 import { domUtils } from "../app";
 
+// Maximum number of trace lines kept for the final report
+const MAX_TRACE_LINES = 10000;
+
 /**
  * SyscallSocketManager handles the Socket.IO communication for strace system call tracing
  */
 export class SyscallSocketManager {
+  // Trace lines received while the program runs
+  private traceLines = new RingBuffer<OutputRow>(MAX_TRACE_LINES);
+  // Settles once every received batch has been formatted
+  private formatted: Promise<void> = Promise.resolve();
+
   constructor() {
     this.setupEventListeners();
   }
 
+  /**
+   * Show the live syscall totals below the terminal
+   * @param summary Per-syscall totals
+   * @param totalRecords Number of records parsed so far
+   */
+  private showLiveSummary(
+    summary: SyscallSummaryEntry[],
+    totalRecords: number
+  ): void {
+    const outputPanel = document.getElementById("outputPanel");
+    if (!outputPanel) return;
+
+    let live = document.getElementById("strace-live-summary");
+    if (!live) {
+      live = document.createElement("pre");
+      live.id = "strace-live-summary";
+      live.style.cssText =
+        "max-height: 30%; overflow: auto; margin: 0; padding: 8px; font-size: 12px;";
+      outputPanel.appendChild(live);
+    }
+
+    live.textContent = `${totalRecords} system calls traced so far\n\n${formatSyscallSummary(
+      summary.slice(0, 15)
+    ).join("\n")}`;
+  }
+
+  /**
+   * Remove the live syscall totals
+   */
+  private removeLiveSummary(): void {
+    document.getElementById("strace-live-summary")?.remove();
+  }
+
   private setupEventListeners(): void {
     // Handle compilation events
-    socketManager.on(SocketEvents.COMPILING, () => {
+    socketManager.on(SocketEvents.COMPILING, (data) => {
       if (socketManager.getSessionType() !== "strace") return;
       domUtils.showOutputPanel();
-      domUtils.showLoadingInOutput("Compiling for syscall tracing...");
+      domUtils.showCompilingInOutput("Compiling for syscall tracing...", data);
     });
 
     // Handle strace events
     socketManager.on(SocketEvents.STRACE_START, (data) => {
+      this.traceLines = new RingBuffer<OutputRow>(MAX_TRACE_LINES);
+      this.formatted = Promise.resolve();
+      this.removeLiveSummary();
+
       // Reset any existing terminal first
       const terminalService = getTerminalService();
       terminalService.dispose();
@@ -57,37 +109,72 @@ export class SyscallSocketManager {
       }
     });
 
-    socketManager.on(SocketEvents.STRACE_REPORT, (data) => {
+    socketManager.on(SocketEvents.STRACE_BATCH, (data) => {
+      if (socketManager.getSessionType() !== "strace" || !data?.records) return;
+
+      // Batches are formatted in the report worker and appended in order
+      const traceLines = this.traceLines;
+      this.formatted = Promise.all([
+        this.formatted,
+        reportService.format({
+          kind: "strace",
+          records: data.records as SyscallRecord[],
+        }),
+      ]).then(([, rows]) => traceLines.push(rows));
+    });
+
+    socketManager.on(SocketEvents.STRACE_SUMMARY, (data) => {
+      if (socketManager.getSessionType() !== "strace" || !data?.summary) return;
+      this.showLiveSummary(data.summary, data.totalRecords || 0);
+    });
+
+    socketManager.on(SocketEvents.STRACE_REPORT, async (data) => {
       domUtils.showOutputPanel();
+      this.removeLiveSummary();
 
       // Clear existing terminal
       const terminalService = getTerminalService();
       terminalService.dispose();
+      socketManager.disconnect();
+
+      const traceLines = this.traceLines;
+      await this.formatted;
 
-      // Display strace report in a code editor view
+      // Display the totals followed by the trace; only visible lines are
+      // rendered however long the trace is
       const output = document.getElementById("output");
-      if (output) {
-        output.innerHTML = '<div id="strace-view-container"></div>';
-        const container = document.getElementById("strace-view-container");
-
-        // Initialize code editor for strace output
-        const editorService = getEditorService();
-        const straceView = editorService.createReadOnlyEditor();
-
-        if (straceView && container) {
-          // Set strace output in the editor with C-like syntax highlighting
-          editorService.setStraceValue(data.report || "No syscalls detected.");
-          container.appendChild(straceView.getWrapperElement());
-          setTimeout(() => straceView.refresh(), 10);
-        }
+      if (!output) return;
+
+      if (!data.summary?.length) {
+        domUtils.setOutput("No syscalls detected.");
+        return;
       }
 
-      socketManager.disconnect();
+      const omitted = (data.totalRecords || 0) - traceLines.length;
+      const lines: OutputRow[] = [
+        ...formatSyscallSummary(data.summary).map((text) => ({ text })),
+        { text: "" },
+        ...Array.from({ length: traceLines.length }, (_, index) =>
+          traceLines.get(index)
+        ),
+        ...(omitted > 0
+          ? [
+              {
+                text: `... ${omitted} more system calls not shown`,
+                tone: "muted" as const,
+              },
+            ]
+          : []),
+      ];
+      const rows = new RingBuffer<OutputRow>(lines.length);
+      rows.push(lines);
+      new VirtualOutput(output, rows);
     });
 
     socketManager.on(SocketEvents.STRACE_ERROR, (data) => {
       // Only process strace errors for strace session
       if (socketManager.getSessionType() === "strace") {
+        this.removeLiveSummary();
         domUtils.showOutputPanel();
 
         if (data.output) {
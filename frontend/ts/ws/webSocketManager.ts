@@ -12,6 +12,7 @@ export enum SocketEvents {
   COMPILING = "compiling",
   COMPILE_SUCCESS = "compile_success",
   COMPILE_ERROR = "compile_error",
+  COMPILE_DIAGNOSTIC = "compile_diagnostic",
 
   // Execution events
   OUTPUT = "output",
@@ -44,6 +45,29 @@ export enum SocketEvents {
   STRACE_RESPONSE = "strace_response",
   STRACE_ERROR = "strace_error",
   STRACE_REPORT = "strace_report",
+  STRACE_BATCH = "strace_batch",
+  STRACE_SUMMARY = "strace_summary",
+
+  // Benchmark events
+  BENCHMARK = "benchmark",
+  BENCHMARK_COMPILING = "benchmark_compiling",
+  BENCHMARK_PROGRESS = "benchmark_progress",
+  BENCHMARK_RESULT = "benchmark_result",
+  BENCHMARK_COMPLETE = "benchmark_complete",
+  BENCHMARK_ERROR = "benchmark_error",
+
+  // Matrix run events
+  MATRIX_RUN = "matrix_run",
+  MATRIX_CELL = "matrix_cell",
+  MATRIX_COMPLETE = "matrix_complete",
+  MATRIX_ERROR = "matrix_error",
+
+  // Profiling events
+  PROFILE = "profile",
+  PROFILE_COMPILING = "profile_compiling",
+  PROFILE_RUNNING = "profile_running",
+  PROFILE_REPORT = "profile_report",
+  PROFILE_ERROR = "profile_error",
 }
 
 /**
@@ -97,18 +121,22 @@ export class WebSocketManager {
         this.notifyListeners(SocketEvents.SESSION_CREATED, data);
       });
 
-      this.socket.on(SocketEvents.COMPILING, () => {
-        this.notifyListeners(SocketEvents.COMPILING, {});
+      this.socket.on(SocketEvents.COMPILING, (data: any) => {
+        this.notifyListeners(SocketEvents.COMPILING, data || {});
       });
 
-      this.socket.on(SocketEvents.COMPILE_SUCCESS, () => {
-        this.notifyListeners(SocketEvents.COMPILE_SUCCESS, {});
+      this.socket.on(SocketEvents.COMPILE_SUCCESS, (data: any) => {
+        this.notifyListeners(SocketEvents.COMPILE_SUCCESS, data || {});
       });
 
       this.socket.on(SocketEvents.COMPILE_ERROR, (data: any) => {
         this.notifyListeners(SocketEvents.COMPILE_ERROR, data);
       });
 
+      this.socket.on(SocketEvents.COMPILE_DIAGNOSTIC, (data: any) => {
+        this.notifyListeners(SocketEvents.COMPILE_DIAGNOSTIC, data);
+      });
+
       this.socket.on(SocketEvents.EXIT, (data: any) => {
         this.notifyListeners(SocketEvents.EXIT, data);
       });
@@ -133,8 +161,8 @@ export class WebSocketManager {
       });
 
       // Handle leak detection events
-      this.socket.on(SocketEvents.LEAK_CHECK_COMPILING, () => {
-        this.notifyListeners(SocketEvents.LEAK_CHECK_COMPILING, {});
+      this.socket.on(SocketEvents.LEAK_CHECK_COMPILING, (data: any) => {
+        this.notifyListeners(SocketEvents.LEAK_CHECK_COMPILING, data || {});
       });
 
       this.socket.on(SocketEvents.LEAK_CHECK_RUNNING, () => {
@@ -158,8 +186,26 @@ export class WebSocketManager {
         SocketEvents.DEBUG_ERROR,
         SocketEvents.STRACE_RESPONSE,
         SocketEvents.STRACE_ERROR,
+        SocketEvents.STRACE_BATCH,
+        SocketEvents.STRACE_SUMMARY,
+        SocketEvents.BENCHMARK_COMPILING,
+        SocketEvents.BENCHMARK_PROGRESS,
+        SocketEvents.BENCHMARK_RESULT,
+        SocketEvents.BENCHMARK_COMPLETE,
+        SocketEvents.BENCHMARK_ERROR,
+        SocketEvents.MATRIX_CELL,
+        SocketEvents.MATRIX_COMPLETE,
+        SocketEvents.MATRIX_ERROR,
+        SocketEvents.PROFILE_COMPILING,
+        SocketEvents.PROFILE_RUNNING,
+        SocketEvents.PROFILE_REPORT,
+        SocketEvents.PROFILE_ERROR,
       ].forEach((event) => {
         this.socket?.on(event, (data: any) => {
+          // Program output is sent as binary frames
+          if (data?.output instanceof ArrayBuffer) {
+            data.output = new Uint8Array(data.output);
+          }
           this.notifyListeners(event, data);
         });
       });